@@ -1,10 +1,9 @@
 #include "Unicode.h"
+#include "Text.h"
 #include <vector>
 #include <memory>
 #include <map>
 
-typedef std::vector<char32_t> Text;
-
 namespace Parlex {
 
 #define READ_CHARACTER_SET(name, character_set) \
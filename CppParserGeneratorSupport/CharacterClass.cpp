@@ -0,0 +1,83 @@
+#include "CharacterClass.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Parlex {
+	CharacterClass::CharacterClass() {
+		std::fill(low, low + 4, 0);
+	}
+
+	CharacterClass::CharacterClass(std::uint64_t const *low, char32_t const *high, std::size_t highCount) : high(high, high + highCount) {
+		std::copy(low, low + 4, this->low);
+	}
+
+	CharacterClass CharacterClass::All() {
+		CharacterClass result;
+		result.AddRange(0, MaxCodePoint);
+		return result;
+	}
+
+	bool CharacterClass::AddRange(char32_t first, char32_t last) {
+		if (first > last || last > MaxCodePoint) {
+			throw std::invalid_argument("the range must lie within the code point space");
+		}
+		bool changed = false;
+		for (char32_t c = first; c <= std::min<char32_t>(last, 255); ++c) {
+			std::uint64_t bit = std::uint64_t(1) << (c & 63);
+			if ((low[c >> 6] & bit) == 0) {
+				low[c >> 6] |= bit;
+				changed = true;
+			}
+		}
+		if (last < 256) return changed;
+		first = std::max<char32_t>(first, 256);
+		//the first range that ends at or after the code point before first
+		std::size_t i = 0;
+		while (i < high.size() && high[i + 1] + 1 < first) i += 2;
+		if (i < high.size() && high[i] <= first && last <= high[i + 1]) return changed;
+		std::size_t j = i;
+		while (j < high.size() && high[j] <= last + 1) {
+			first = std::min(first, high[j]);
+			last = std::max(last, high[j + 1]);
+			j += 2;
+		}
+		high.erase(high.begin() + i, high.begin() + j);
+		char32_t range[] = { first, last };
+		high.insert(high.begin() + i, range, range + 2);
+		return true;
+	}
+
+	bool CharacterClass::UnionWith(CharacterClass const &other) {
+		if (&other == this) return false;
+		bool changed = false;
+		for (int i = 0; i < 4; ++i) {
+			if ((other.low[i] & ~low[i]) != 0) {
+				low[i] |= other.low[i];
+				changed = true;
+			}
+		}
+		for (std::size_t i = 0; i < other.high.size(); i += 2) {
+			changed |= AddRange(other.high[i], other.high[i + 1]);
+		}
+		return changed;
+	}
+
+	bool CharacterClass::GetIsEmpty() const {
+		return high.empty() && (low[0] | low[1] | low[2] | low[3]) == 0;
+	}
+
+	std::uint64_t const *CharacterClass::GetLowBits() const {
+		return low;
+	}
+
+	std::vector<char32_t> const &CharacterClass::GetHighRanges() const {
+		return high;
+	}
+
+	bool CharacterClass::ContainsHigh(char32_t c) const {
+		//the first range whose upper bound is at least c
+		auto i = std::lower_bound(high.begin(), high.end(), c);
+		if (i == high.end()) return false;
+		return ((i - high.begin()) & 1) != 0 || *i == c;
+	}
+}
\ No newline at end of file
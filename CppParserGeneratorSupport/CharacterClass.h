@@ -0,0 +1,45 @@
+#ifndef _CHARACTER_CLASS_H_
+#define _CHARACTER_CLASS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Parlex {
+	/// <summary>
+	/// A set of code points: a bitmap over the first 256, where nearly every
+	/// grammar's lookahead lives, and sorted inclusive ranges above that.
+	/// The counterpart of the managed CharacterClass.
+	/// </summary>
+	class CharacterClass {
+	public:
+		static char32_t const MaxCodePoint = 0x10FFFF;
+
+		CharacterClass();
+		//a class from its bitmap and its ranges above 255, as GetLowBits and GetHighRanges give them
+		CharacterClass(std::uint64_t const *low, char32_t const *high, std::size_t highCount);
+		static CharacterClass All();
+
+		//each return whether anything was added
+		bool AddRange(char32_t first, char32_t last);
+		bool UnionWith(CharacterClass const &other);
+
+		bool Contains(char32_t c) const {
+			if (c < 256) return ((low[c >> 6] >> (c & 63)) & 1) != 0;
+			return ContainsHigh(c);
+		}
+
+		bool GetIsEmpty() const;
+		//the bitmap over code points 0 to 255, 64 to a word, lowest bit first
+		std::uint64_t const *GetLowBits() const;
+		//inclusive [first, last] pairs, all above 255
+		std::vector<char32_t> const &GetHighRanges() const;
+	private:
+		bool ContainsHigh(char32_t c) const;
+
+		std::uint64_t low[4];
+		std::vector<char32_t> high;
+	};
+}
+
+#endif
\ No newline at end of file
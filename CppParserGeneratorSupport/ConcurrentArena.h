@@ -0,0 +1,116 @@
+#ifndef _CONCURRENT_ARENA_H_
+#define _CONCURRENT_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Parlex {
+	/// <summary>
+	/// An append-only array that any number of threads can allocate from at
+	/// once. Elements are addressed by dense int index and never move. The
+	/// storage is a short list of chunks, each twice the size of the one
+	/// before, so growing never copies and Release frees everything at once.
+	/// </summary>
+	template<typename T>
+	class ConcurrentArena {
+		ConcurrentArena(ConcurrentArena const &other) = delete;
+		ConcurrentArena &operator=(ConcurrentArena const &other) = delete;
+		static int const FirstChunkBits = 10;
+		static int const MaxChunks = 31 - FirstChunkBits;
+	public:
+		ConcurrentArena() : count(0) {
+			for (auto &chunk : chunks) chunk.store(nullptr, std::memory_order_relaxed);
+		}
+
+		~ConcurrentArena() {
+			Release();
+		}
+
+		//returns the index of a new value initialized element
+		std::int32_t Allocate() {
+			std::uint32_t index = count.fetch_add(1, std::memory_order_relaxed);
+			int chunk = ChunkOf(index);
+			if (chunk >= MaxChunks) {
+				throw std::length_error("ConcurrentArena is full");
+			}
+			if (chunks[chunk].load(std::memory_order_acquire) == nullptr) {
+				T *fresh = new T[ChunkSize(chunk)]();
+				T *expected = nullptr;
+				if (!chunks[chunk].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) {
+					delete[] fresh;
+				}
+			}
+			return static_cast<std::int32_t>(index);
+		}
+
+		T &operator[](std::int32_t index) {
+			std::uint32_t biased = static_cast<std::uint32_t>(index) + (1u << FirstChunkBits);
+			int chunk = HighBit(biased) - FirstChunkBits;
+			return chunks[chunk].load(std::memory_order_acquire)[biased - (1u << (chunk + FirstChunkBits))];
+		}
+
+		T const &operator[](std::int32_t index) const {
+			return const_cast<ConcurrentArena &>(*this)[index];
+		}
+
+		std::size_t GetCount() const {
+			return count.load(std::memory_order_acquire);
+		}
+
+		std::size_t GetMemoryUsage() const {
+			std::size_t total = 0;
+			for (int i = 0; i < MaxChunks; ++i) {
+				if (chunks[i].load(std::memory_order_relaxed) != nullptr) total += ChunkSize(i) * sizeof(T);
+			}
+			return total;
+		}
+
+		//not thread safe; exchanges the elements, so indices move with them
+		void Swap(ConcurrentArena &other) {
+			std::uint32_t otherCount = other.count.load();
+			other.count.store(count.load());
+			count.store(otherCount);
+			for (int i = 0; i < MaxChunks; ++i) {
+				T *otherChunk = other.chunks[i].load();
+				other.chunks[i].store(chunks[i].load());
+				chunks[i].store(otherChunk);
+			}
+		}
+
+		//not thread safe; every index handed out becomes invalid
+		void Release() {
+			for (auto &chunk : chunks) {
+				delete[] chunk.exchange(nullptr);
+			}
+			count.store(0);
+		}
+	private:
+		static int HighBit(std::uint32_t value) {
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanReverse(&bit, value);
+			return static_cast<int>(bit);
+#else
+			return 31 - __builtin_clz(value);
+#endif
+		}
+
+		static int ChunkOf(std::uint32_t index) {
+			return HighBit(index + (1u << FirstChunkBits)) - FirstChunkBits;
+		}
+
+		static std::size_t ChunkSize(int chunk) {
+			return std::size_t(1) << (chunk + FirstChunkBits);
+		}
+
+		std::atomic<std::uint32_t> count;
+		std::atomic<T *> chunks[MaxChunks];
+	};
+}
+
+#endif
\ No newline at end of file
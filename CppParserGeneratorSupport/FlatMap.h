@@ -0,0 +1,92 @@
+#ifndef _FLAT_MAP_H_
+#define _FLAT_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Parlex {
+	/// <summary>
+	/// A single threaded open addressing map from non-negative ints to ints.
+	/// Clear keeps the storage, so a map that is cleared and refilled, like
+	/// one per wavefront column, stops allocating once it has grown.
+	/// </summary>
+	class FlatMap {
+	public:
+		static std::int32_t const Absent = -1;
+
+		FlatMap() : count(0) {}
+
+		std::int32_t Find(std::int32_t key) const {
+			if (keys.empty()) return Absent;
+			std::size_t mask = keys.size() - 1;
+			for (std::size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+				if (keys[i] == key) return values[i];
+				if (keys[i] == Absent) return Absent;
+			}
+		}
+
+		//returns the value already there, or Absent after storing value
+		std::int32_t Add(std::int32_t key, std::int32_t value) {
+			if ((count + 1) * 2 > keys.size()) Grow();
+			std::size_t mask = keys.size() - 1;
+			for (std::size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+				if (keys[i] == key) return values[i];
+				if (keys[i] == Absent) {
+					keys[i] = key;
+					values[i] = value;
+					count++;
+					return Absent;
+				}
+			}
+		}
+
+		//calls function(key, value) for every pair, in no particular order
+		template<typename Function>
+		void ForEach(Function function) const {
+			for (std::size_t i = 0; i < keys.size(); ++i) {
+				if (keys[i] != Absent) function(keys[i], values[i]);
+			}
+		}
+
+		void Clear() {
+			if (count == 0) return;
+			std::fill(keys.begin(), keys.end(), std::int32_t(Absent));
+			count = 0;
+		}
+
+		std::size_t GetCount() const {
+			return count;
+		}
+
+		std::size_t GetMemoryUsage() const {
+			return keys.capacity() * sizeof(std::int32_t) * 2;
+		}
+	private:
+		static std::size_t Hash(std::int32_t key) {
+			std::uint32_t x = static_cast<std::uint32_t>(key);
+			x ^= x >> 16;
+			x *= 0x45d9f3bu;
+			x ^= x >> 16;
+			return x;
+		}
+
+		void Grow() {
+			std::vector<std::int32_t> oldKeys(keys.empty() ? 16 : keys.size() * 2, std::int32_t(Absent));
+			std::vector<std::int32_t> oldValues(oldKeys.size());
+			oldKeys.swap(keys);
+			oldValues.swap(values);
+			count = 0;
+			for (std::size_t i = 0; i < oldKeys.size(); ++i) {
+				if (oldKeys[i] != Absent) Add(oldKeys[i], oldValues[i]);
+			}
+		}
+
+		std::vector<std::int32_t> keys;
+		std::vector<std::int32_t> values;
+		std::size_t count;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "ForestImage.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace Parlex {
+	namespace {
+		std::uint32_t const ImageMagic = 0x46584C50;
+		std::size_t const HeaderSize = 8;
+		std::size_t const FlushSize = 1 << 16;
+
+		std::uint64_t ZigZag(std::int64_t value) {
+			return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+		}
+
+		std::int64_t UnZigZag(std::uint64_t value) {
+			return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+		}
+
+		void PutVarint(std::vector<std::uint8_t> &buffer, std::uint64_t value) {
+			while (value >= 0x80) {
+				buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			buffer.push_back(static_cast<std::uint8_t>(value));
+		}
+
+		template<typename T>
+		void PutRaw(std::vector<std::uint8_t> &buffer, T const &value) {
+			std::uint8_t const *bytes = reinterpret_cast<std::uint8_t const *>(&value);
+			buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+		}
+
+		//decodes records without reading past their end, whatever the bytes are
+		class RecordReader {
+		public:
+			RecordReader(std::uint8_t const *position, std::uint8_t const *end) : position(position), end(end) {}
+
+			std::uint64_t Varint() {
+				std::uint64_t value = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					if (position == end) break;
+					std::uint8_t byte = *position++;
+					value |= std::uint64_t(byte & 0x7f) << shift;
+					if ((byte & 0x80) == 0) return value;
+				}
+				throw std::runtime_error("the forest image is damaged");
+			}
+
+			std::int32_t Int(std::int64_t value) {
+				if (value < 0 || value > 0x7fffffff) {
+					throw std::runtime_error("the forest image is damaged");
+				}
+				return static_cast<std::int32_t>(value);
+			}
+
+			ForestImage::Node ReadNode(std::int32_t &previousStart) {
+				ForestImage::Node node;
+				node.symbol = Int(static_cast<std::int64_t>(Varint()));
+				node.start = Int(previousStart + UnZigZag(Varint()));
+				node.length = Int(static_cast<std::int64_t>(Varint()));
+				node.derivationCount = Int(static_cast<std::int64_t>(Varint()));
+				previousStart = node.start;
+				return node;
+			}
+
+			//the derivations and children after a node's record, which only their count of varints needs
+			void SkipDerivations(std::int32_t derivationCount) {
+				for (std::int32_t i = 0; i < derivationCount; ++i) {
+					for (std::uint64_t childCount = Varint(); childCount > 0; --childCount) {
+						Varint();
+					}
+				}
+			}
+
+			NodeId Child(NodeId parent, std::size_t nodeCount) {
+				std::int64_t child = parent + UnZigZag(Varint());
+				if (child < 0 || static_cast<std::uint64_t>(child) >= nodeCount) {
+					throw std::runtime_error("the forest image is damaged");
+				}
+				return static_cast<NodeId>(child);
+			}
+
+			std::uint8_t const *position;
+			std::uint8_t const *end;
+		};
+	}
+
+	ForestImage::ForestImage() : data(nullptr), recordsEnd(nullptr) {
+		std::memset(&footer, 0, sizeof(footer));
+		footer.root = NoNode;
+	}
+
+	void ForestImage::Write(ParseForest const &forest, std::ostream &stream) {
+		if (!forest.GetIsSealed()) {
+			throw std::logic_error("the forest must be sealed before it is written");
+		}
+		std::vector<std::uint8_t> buffer;
+		buffer.reserve(FlushSize + 64);
+		std::uint64_t flushed = 0;
+		auto flush = [&] {
+			stream.write(reinterpret_cast<char const *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+			flushed += buffer.size();
+			buffer.clear();
+		};
+		PutRaw(buffer, ImageMagic);
+		PutRaw(buffer, std::uint32_t(ImageVersion));
+		std::vector<std::uint64_t> index;
+		index.reserve((forest.GetNodeCount() + BlockSize - 1) / BlockSize);
+		std::uint64_t childCount = 0;
+		std::int32_t previousStart = 0;
+		for (NodeId node = 0; static_cast<std::size_t>(node) < forest.GetNodeCount(); ++node) {
+			//each block starts from nothing, so it can be decoded without the ones before
+			if (node % BlockSize == 0) {
+				index.push_back(flushed + buffer.size());
+				previousStart = 0;
+			}
+			ParseForest::SymbolNode const &record = forest.GetNode(node);
+			PutVarint(buffer, static_cast<std::uint64_t>(record.symbol));
+			PutVarint(buffer, ZigZag(std::int64_t(record.start) - previousStart));
+			PutVarint(buffer, static_cast<std::uint64_t>(record.length));
+			PutVarint(buffer, static_cast<std::uint64_t>(record.derivationCount));
+			previousStart = record.start;
+			for (ParseForest::Derivation const &derivation : forest.GetDerivations(node)) {
+				PutVarint(buffer, static_cast<std::uint64_t>(derivation.childCount));
+				for (NodeId child : forest.GetChildren(derivation)) {
+					PutVarint(buffer, ZigZag(std::int64_t(child) - node));
+				}
+				childCount += derivation.childCount;
+			}
+			if (buffer.size() >= FlushSize) flush();
+		}
+		Footer written = {
+			forest.GetNodeCount(), forest.GetDerivationCount(), childCount, forest.GetRoot(),
+			flushed + buffer.size(), ImageMagic, ImageVersion
+		};
+		for (std::uint64_t offset : index) {
+			PutRaw(buffer, offset);
+			if (buffer.size() >= FlushSize) flush();
+		}
+		PutRaw(buffer, written);
+		flush();
+		if (!stream) {
+			throw std::runtime_error("couldn't write the forest image");
+		}
+	}
+
+	void ForestImage::Attach(void const *image, std::size_t size) {
+		std::uint8_t const *bytes = static_cast<std::uint8_t const *>(image);
+		std::uint32_t header[2];
+		Footer candidate;
+		if (size < HeaderSize + sizeof(Footer)) {
+			throw std::invalid_argument("that isn't a forest image");
+		}
+		//copied out rather than read in place, so the image needn't be aligned
+		std::memcpy(header, bytes, sizeof(header));
+		std::memcpy(&candidate, bytes + size - sizeof(Footer), sizeof(Footer));
+		if (header[0] != ImageMagic || candidate.magic != ImageMagic) {
+			throw std::invalid_argument("that isn't a forest image, or it was written with the other byte order");
+		}
+		if (header[1] != ImageVersion || candidate.version != ImageVersion) {
+			throw std::invalid_argument("the forest image is of a different version");
+		}
+		std::uint64_t blockCount = (candidate.nodeCount + BlockSize - 1) / BlockSize;
+		bool valid = candidate.nodeCount <= 0x7fffffff && candidate.indexOffset >= HeaderSize &&
+			candidate.indexOffset <= size && blockCount <= (size - candidate.indexOffset) / sizeof(std::uint64_t) &&
+			candidate.indexOffset + blockCount * sizeof(std::uint64_t) + sizeof(Footer) == size &&
+			candidate.root >= NoNode && candidate.root < static_cast<std::int64_t>(candidate.nodeCount) &&
+			candidate.derivationCount <= candidate.indexOffset && candidate.childCount <= candidate.indexOffset;
+		std::uint64_t previous = HeaderSize;
+		for (std::uint64_t block = 0; valid && block < blockCount; ++block) {
+			std::uint64_t offset;
+			std::memcpy(&offset, bytes + candidate.indexOffset + block * sizeof(std::uint64_t), sizeof(offset));
+			valid = offset >= previous && offset < candidate.indexOffset;
+			previous = offset;
+		}
+		if (!valid) {
+			throw std::invalid_argument("the forest image's index or counts lie outside it");
+		}
+		data = bytes;
+		recordsEnd = bytes + candidate.indexOffset;
+		footer = candidate;
+	}
+
+	std::size_t ForestImage::GetNodeCount() const {
+		return static_cast<std::size_t>(footer.nodeCount);
+	}
+
+	std::size_t ForestImage::GetDerivationCount() const {
+		return static_cast<std::size_t>(footer.derivationCount);
+	}
+
+	std::size_t ForestImage::GetChildCount() const {
+		return static_cast<std::size_t>(footer.childCount);
+	}
+
+	NodeId ForestImage::GetRoot() const {
+		return static_cast<NodeId>(footer.root);
+	}
+
+	std::uint8_t const *ForestImage::Seek(NodeId node, Node &record) const {
+		if (node < 0 || static_cast<std::uint64_t>(node) >= footer.nodeCount) {
+			throw std::out_of_range("there's no such node in the forest image");
+		}
+		std::uint64_t offset;
+		std::memcpy(&offset, recordsEnd + (node / BlockSize) * sizeof(std::uint64_t), sizeof(offset));
+		RecordReader reader(data + offset, recordsEnd);
+		std::int32_t previousStart = 0;
+		for (NodeId skipped = node - node % BlockSize; skipped < node; ++skipped) {
+			reader.SkipDerivations(reader.ReadNode(previousStart).derivationCount);
+		}
+		record = reader.ReadNode(previousStart);
+		return reader.position;
+	}
+
+	ForestImage::Node ForestImage::GetNode(NodeId node) const {
+		Node record;
+		Seek(node, record);
+		return record;
+	}
+
+	ForestImage::Node ForestImage::GetDerivations(NodeId node, std::vector<std::int32_t> &offsets, std::vector<NodeId> &children) const {
+		Node record;
+		RecordReader reader(Seek(node, record), recordsEnd);
+		offsets.clear();
+		children.clear();
+		offsets.push_back(0);
+		for (std::int32_t i = 0; i < record.derivationCount; ++i) {
+			for (std::uint64_t childCount = reader.Varint(); childCount > 0; --childCount) {
+				children.push_back(reader.Child(node, GetNodeCount()));
+			}
+			offsets.push_back(static_cast<std::int32_t>(children.size()));
+		}
+		return record;
+	}
+
+	void ForestImage::Load(ParseForest &forest) const {
+		forest.Clear();
+		forest.Reserve(GetNodeCount(), GetDerivationCount(), GetChildCount());
+		std::vector<NodeId> children;
+		RecordReader reader(data + HeaderSize, recordsEnd);
+		std::int32_t previousStart = 0;
+		//a node's derivations only name its children, so each can be added before they are
+		for (NodeId node = 0; static_cast<std::size_t>(node) < GetNodeCount(); ++node) {
+			if (node % BlockSize == 0) previousStart = 0;
+			Node record = reader.ReadNode(previousStart);
+			forest.AddNode(record.symbol, record.start, record.length);
+			for (std::int32_t i = 0; i < record.derivationCount; ++i) {
+				children.clear();
+				for (std::uint64_t childCount = reader.Varint(); childCount > 0; --childCount) {
+					children.push_back(reader.Child(node, GetNodeCount()));
+				}
+				forest.AddDerivation(node, children.data(), static_cast<int>(children.size()));
+			}
+		}
+		forest.SetRoot(GetRoot());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef _FOREST_IMAGE_H_
+#define _FOREST_IMAGE_H_
+
+#include "ParseForest.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Parlex {
+	/// <summary>
+	/// A ParseForest as a compact file, for handing a parse to another
+	/// process or caching it on disk. Each node is a run of varints: its
+	/// symbol, its start as a difference from the node before's, its length
+	/// and derivation count, then each derivation's child count and
+	/// children, relative to the node. An index of where every sixteenth
+	/// node starts, and the counts, follow the nodes, so Write makes one
+	/// pass and never seeks. Attach reads an image in place, such as a
+	/// MappedFile, and any node is found by decoding at most a block of
+	/// them.
+	/// </summary>
+	class ForestImage {
+		ForestImage(ForestImage const &other) = delete;
+		ForestImage &operator=(ForestImage const &other) = delete;
+	public:
+		static std::uint32_t const ImageVersion = 1;
+
+		struct Node {
+			std::int32_t symbol;
+			std::int32_t start;
+			std::int32_t length;
+			std::int32_t derivationCount;
+		};
+
+		ForestImage();
+
+		//forest must be sealed; throws std::runtime_error if the stream fails
+		static void Write(ParseForest const &forest, std::ostream &stream);
+		/// <summary>
+		/// Read the forest image holds in place; image must outlive this
+		/// unchanged. Throws std::invalid_argument if it isn't an image of
+		/// this version written on a machine of the same byte order. Nodes
+		/// are only decoded when asked for, so damage within them is found
+		/// then, and thrown as std::runtime_error.
+		/// </summary>
+		void Attach(void const *image, std::size_t size);
+
+		std::size_t GetNodeCount() const;
+		std::size_t GetDerivationCount() const;
+		std::size_t GetChildCount() const;
+		NodeId GetRoot() const;
+		Node GetNode(NodeId node) const;
+		//node's derivations as CSR: derivation i's children are children[offsets[i]] up to children[offsets[i + 1]]
+		Node GetDerivations(NodeId node, std::vector<std::int32_t> &offsets, std::vector<NodeId> &children) const;
+		//decode every node into forest, replacing what it held
+		void Load(ParseForest &forest) const;
+	private:
+		static std::size_t const BlockSize = 16;
+
+		struct Footer {
+			std::uint64_t nodeCount;
+			std::uint64_t derivationCount;
+			std::uint64_t childCount;
+			std::int64_t root;
+			std::uint64_t indexOffset;
+			std::uint32_t magic;
+			std::uint32_t version;
+		};
+
+		//decodes node's record from the start of its block, returning where its derivations start
+		std::uint8_t const *Seek(NodeId node, Node &record) const;
+
+		std::uint8_t const *data;
+		//the end of the node records, where the index starts
+		std::uint8_t const *recordsEnd;
+		Footer footer;
+	};
+}
+
+#endif
\ No newline at end of file
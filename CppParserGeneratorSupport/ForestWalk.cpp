@@ -0,0 +1,318 @@
+#include "ForestWalk.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace Parlex {
+	TreeCursor::TreeCursor(ParseForest const &forest) : forest(forest), choices(nullptr), start(NoNode), node(NoNode), enter(false), left(nullptr) {}
+
+	void TreeCursor::Reset(NodeId node, std::vector<std::int32_t> const *choices) {
+		this->choices = choices;
+		stack.clear();
+		start = node;
+		this->node = NoNode;
+		enter = false;
+		left = nullptr;
+	}
+
+	bool TreeCursor::MoveNext() {
+		if (stack.empty()) {
+			if (start == NoNode) return false;
+			Enter(start);
+			start = NoNode;
+			return true;
+		}
+		Frame &top = stack.back();
+		if (top.derivation != nullptr && top.nextChild < top.derivation->childCount) {
+			Enter(forest.GetChildren(*top.derivation)[top.nextChild++]);
+			return true;
+		}
+		node = top.node;
+		left = top.derivation;
+		enter = false;
+		stack.pop_back();
+		return true;
+	}
+
+	ParseForest::Derivation const *TreeCursor::GetDerivation() const {
+		return enter ? stack.back().derivation : left;
+	}
+
+	void TreeCursor::Enter(NodeId node) {
+		//a path longer than the forest has nodes must take one twice
+		if (stack.size() >= forest.GetNodeCount()) {
+			throw std::logic_error("the derivations taken lead into a node inside itself");
+		}
+		Span<ParseForest::Derivation> derivations = forest.GetDerivations(node);
+		Frame frame = { node, nullptr, 0 };
+		if (!derivations.empty()) {
+			frame.derivation = &derivations[choices != nullptr ? (*choices)[node] : 0];
+		}
+		stack.push_back(frame);
+		this->node = node;
+		enter = true;
+	}
+
+	TreeEnumerator::TreeEnumerator(ParseForest const &forest, NodeId node) :
+		forest(forest),
+		root(node),
+		started(false),
+		finished(node == NoNode),
+		open(forest.GetNodeCount(), false)
+	{}
+
+	bool TreeEnumerator::MoveNext() {
+		if (finished) return false;
+		bool advanced = true;
+		if (!started) {
+			started = true;
+			Append(root, -1, -1);
+			Frame frame = { 0, 0 };
+			stack.push_back(frame);
+			open[root] = true;
+		} else {
+			advanced = Increment();
+		}
+		//a prefix that runs into a cycle does so whatever follows it, so the search moves past the prefix
+		while (advanced) {
+			if (Extend()) return true;
+			advanced = Increment();
+		}
+		finished = true;
+		tree.clear();
+		slots.clear();
+		return false;
+	}
+
+	Span<TreeEnumerator::Occurrence> TreeEnumerator::GetTree() const {
+		if (tree.empty()) return Span<Occurrence>();
+		return Span<Occurrence>(&tree[0], tree.size());
+	}
+
+	void TreeEnumerator::GetChoices(std::vector<std::int32_t> &choices) const {
+		choices.assign(forest.GetNodeCount(), 0);
+		for (Occurrence const &occurrence : tree) {
+			if (occurrence.derivation >= 0) choices[occurrence.node] = occurrence.derivation;
+		}
+	}
+
+	bool TreeEnumerator::Extend() {
+		while (!stack.empty()) {
+			Frame &top = stack.back();
+			Occurrence const &occurrence = tree[top.occurrence];
+			Span<NodeId> children;
+			if (occurrence.derivation >= 0) {
+				children = forest.GetChildren(forest.GetDerivations(occurrence.node)[occurrence.derivation]);
+			}
+			if (static_cast<std::size_t>(top.nextChild) < children.size()) {
+				std::int32_t parent = top.occurrence;
+				std::int32_t slot = top.nextChild++;
+				NodeId child = children[slot];
+				if (open[child]) return false;
+				Append(child, parent, slot);
+				open[child] = true;
+				Frame frame = { static_cast<std::int32_t>(tree.size() - 1), 0 };
+				stack.push_back(frame);
+			} else {
+				open[occurrence.node] = false;
+				stack.pop_back();
+			}
+		}
+		return true;
+	}
+
+	bool TreeEnumerator::Increment() {
+		std::int32_t last = static_cast<std::int32_t>(tree.size()) - 1;
+		while (last >= 0) {
+			Occurrence const &occurrence = tree[last];
+			if (occurrence.derivation >= 0 && static_cast<std::size_t>(occurrence.derivation + 1) < forest.GetDerivations(occurrence.node).size()) break;
+			--last;
+		}
+		for (Frame const &frame : stack) {
+			open[tree[frame.occurrence].node] = false;
+		}
+		stack.clear();
+		if (last < 0) return false;
+		tree[last].derivation++;
+		tree.resize(last + 1);
+		slots.resize(last + 1);
+		//the path down to it, each ancestor resuming after the child on the path
+		for (std::int32_t occurrence = last; occurrence >= 0; occurrence = tree[occurrence].parent) {
+			Frame frame = { occurrence, 0 };
+			stack.push_back(frame);
+			open[tree[occurrence].node] = true;
+		}
+		std::reverse(stack.begin(), stack.end());
+		for (std::size_t i = 0; i + 1 < stack.size(); ++i) {
+			stack[i].nextChild = slots[stack[i + 1].occurrence] + 1;
+		}
+		return true;
+	}
+
+	void TreeEnumerator::Append(NodeId node, std::int32_t parent, std::int32_t slot) {
+		Occurrence occurrence = { node, forest.GetDerivations(node).empty() ? -1 : 0, parent };
+		tree.push_back(occurrence);
+		slots.push_back(slot);
+	}
+
+	namespace {
+		std::uint64_t MultiplyCounts(std::uint64_t l, std::uint64_t r) {
+			if (l == 0 || r == 0) return 0;
+			return l > ManyTrees / r ? ManyTrees : l * r;
+		}
+
+		std::uint64_t AddCounts(std::uint64_t l, std::uint64_t r) {
+			return l > ManyTrees - r ? ManyTrees : l + r;
+		}
+
+		enum VisitState : std::uint8_t { Unvisited, Open, Done };
+
+		//the reachable nodes are made ready bottom up: a node waits on one count per child it has in
+		//any derivation, and whoever brings it to zero visits it next, posting any other parents freed
+		class ParallelVisit {
+			ParallelVisit(ParallelVisit const &other) = delete;
+			ParallelVisit &operator=(ParallelVisit const &other) = delete;
+		public:
+			ParallelVisit(ParseForest const &forest, IForestVisitor &visitor, IScheduler &scheduler) :
+				forest(forest), visitor(visitor), scheduler(scheduler), visited(0) {}
+
+			std::size_t Run(NodeId root) {
+				if (root == NoNode) return 0;
+				std::vector<bool> seen(forest.GetNodeCount(), false);
+				std::vector<NodeId> order;
+				seen[root] = true;
+				order.push_back(root);
+				parentOffsets.assign(forest.GetNodeCount() + 1, 0);
+				waiting.reset(new std::atomic<std::int32_t>[forest.GetNodeCount()]);
+				for (std::size_t next = 0; next < order.size(); ++next) {
+					std::int32_t childCount = 0;
+					for (ParseForest::Derivation const &derivation : forest.GetDerivations(order[next])) {
+						for (NodeId child : forest.GetChildren(derivation)) {
+							++parentOffsets[child + 1];
+							++childCount;
+							if (!seen[child]) {
+								seen[child] = true;
+								order.push_back(child);
+							}
+						}
+					}
+					waiting[order[next]].store(childCount, std::memory_order_relaxed);
+					if (childCount == 0) leaves.push_back(order[next]);
+				}
+				for (std::size_t i = 1; i < parentOffsets.size(); ++i) {
+					parentOffsets[i] += parentOffsets[i - 1];
+				}
+				parents.resize(parentOffsets.back());
+				std::vector<std::int32_t> cursors(parentOffsets.begin(), parentOffsets.end() - 1);
+				for (NodeId node : order) {
+					for (ParseForest::Derivation const &derivation : forest.GetDerivations(node)) {
+						for (NodeId child : forest.GetChildren(derivation)) {
+							parents[cursors[child]++] = node;
+						}
+					}
+				}
+				//a few runs of leaves per thread, so a wide forest isn't posted leaf by leaf
+				std::size_t chunk = std::max<std::size_t>(1, leaves.size() / (8 * static_cast<std::size_t>(scheduler.GetThreadCount())));
+				for (std::size_t first = 0; first < leaves.size(); first += chunk) {
+					WorkItem item = { LeavesItem, this, static_cast<std::int32_t>(first), static_cast<std::int32_t>(std::min(first + chunk, leaves.size())) };
+					scheduler.Post(item);
+				}
+				scheduler.Join();
+				return visited.load();
+			}
+		private:
+			static void LeavesItem(void *context, std::int32_t first, std::int32_t last) {
+				ParallelVisit *visit = static_cast<ParallelVisit *>(context);
+				for (std::int32_t i = first; i < last; ++i) {
+					visit->VisitFrom(visit->leaves[i]);
+				}
+			}
+
+			static void NodeItem(void *context, std::int32_t node, std::int32_t) {
+				static_cast<ParallelVisit *>(context)->VisitFrom(node);
+			}
+
+			void VisitFrom(NodeId node) {
+				while (node != NoNode) {
+					visitor.Visit(forest, node);
+					visited.fetch_add(1, std::memory_order_relaxed);
+					NodeId next = NoNode;
+					for (std::int32_t i = parentOffsets[node]; i < parentOffsets[node + 1]; ++i) {
+						NodeId parent = parents[i];
+						//the last child's decrement acquires every other child's
+						if (waiting[parent].fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+						if (next == NoNode) {
+							next = parent;
+						} else {
+							WorkItem item = { NodeItem, this, parent, 0 };
+							scheduler.Post(item);
+						}
+					}
+					node = next;
+				}
+			}
+
+			ParseForest const &forest;
+			IForestVisitor &visitor;
+			IScheduler &scheduler;
+			//CSR, one entry per place a node is a child, indexed by node
+			std::vector<std::int32_t> parentOffsets;
+			std::vector<NodeId> parents;
+			std::vector<NodeId> leaves;
+			std::unique_ptr<std::atomic<std::int32_t>[]> waiting;
+			std::atomic<std::size_t> visited;
+		};
+	}
+
+	void CountTrees(ParseForest const &forest, NodeId root, std::vector<std::uint64_t> &counts) {
+		counts.assign(forest.GetNodeCount(), 0);
+		if (root == NoNode) return;
+		struct Frame {
+			NodeId node;
+			std::int32_t derivation;
+			std::int32_t child;
+			std::uint64_t product;
+			std::uint64_t sum;
+		};
+		std::vector<std::uint8_t> states(forest.GetNodeCount(), Unvisited);
+		std::vector<Frame> stack;
+		Frame first = { root, 0, 0, 1, 0 };
+		stack.push_back(first);
+		states[root] = Open;
+		//each node is finished once, after its children, so every count is read only when final
+		while (!stack.empty()) {
+			Frame &top = stack.back();
+			Span<ParseForest::Derivation> derivations = forest.GetDerivations(top.node);
+			if (static_cast<std::size_t>(top.derivation) == derivations.size()) {
+				counts[top.node] = derivations.empty() ? 1 : top.sum;
+				states[top.node] = Done;
+				stack.pop_back();
+				continue;
+			}
+			Span<NodeId> children = forest.GetChildren(derivations[top.derivation]);
+			if (static_cast<std::size_t>(top.child) == children.size()) {
+				top.sum = AddCounts(top.sum, top.product);
+				top.derivation++;
+				top.child = 0;
+				top.product = 1;
+				continue;
+			}
+			NodeId child = children[top.child];
+			if (states[child] == Unvisited) {
+				Frame frame = { child, 0, 0, 1, 0 };
+				states[child] = Open;
+				stack.push_back(frame);
+				continue;
+			}
+			//a child still open is an ancestor, so the trees through it never end
+			top.product = MultiplyCounts(top.product, states[child] == Open ? ManyTrees : counts[child]);
+			top.child++;
+		}
+	}
+
+	std::size_t VisitParallel(ParseForest const &forest, NodeId root, IForestVisitor &visitor, IScheduler &scheduler) {
+		ParallelVisit visit(forest, visitor, scheduler);
+		return visit.Run(root);
+	}
+}
\ No newline at end of file
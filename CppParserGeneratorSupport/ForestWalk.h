@@ -0,0 +1,131 @@
+#ifndef _FOREST_WALK_H_
+#define _FOREST_WALK_H_
+
+#include "ParseForest.h"
+#include "IForestVisitor.h"
+#include "IScheduler.h"
+#include "Span.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Parlex {
+	/// <summary>
+	/// A depth first walk of one tree of a sealed forest, read like a stream:
+	/// each MoveNext enters or leaves a node. At each node the derivation
+	/// choices numbers is taken, or the first if there are no choices. The
+	/// stack is kept from walk to walk, so once it has grown as deep as the
+	/// forest, walking allocates nothing.
+	/// </summary>
+	class TreeCursor {
+		TreeCursor(TreeCursor const &other) = delete;
+		TreeCursor &operator=(TreeCursor const &other) = delete;
+	public:
+		explicit TreeCursor(ParseForest const &forest);
+
+		//choices, if given, is indexed by node and must outlive the walk
+		void Reset(NodeId node, std::vector<std::int32_t> const *choices = nullptr);
+		//false once the node Reset was given has been left; throws
+		//std::logic_error if the derivations taken lead into a node twice
+		bool MoveNext();
+		NodeId GetNode() const {
+			return node;
+		}
+		//whether MoveNext entered GetNode, rather than left it
+		bool GetIsEnter() const {
+			return enter;
+		}
+		//the number of nodes above GetNode
+		int GetDepth() const {
+			return static_cast<int>(stack.size()) - (enter ? 1 : 0);
+		}
+		//the derivation taken at GetNode, or null if it has none
+		ParseForest::Derivation const *GetDerivation() const;
+	private:
+		struct Frame {
+			NodeId node;
+			ParseForest::Derivation const *derivation;
+			std::int32_t nextChild;
+		};
+
+		void Enter(NodeId node);
+
+		ParseForest const &forest;
+		std::vector<std::int32_t> const *choices;
+		std::vector<Frame> stack;
+		NodeId start;
+		NodeId node;
+		bool enter;
+		ParseForest::Derivation const *left;
+	};
+
+	/// <summary>
+	/// The distinct trees of a sealed forest below one node, each made only
+	/// when MoveNext asks for it, so the first k of exponentially many cost k
+	/// trees' work. A tree is its nodes in preorder, each with the
+	/// derivation it takes; trees come in the order of those choices, the
+	/// last one varying fastest. A node is never taken inside itself, so a
+	/// cyclic forest's endless trees are cut to those that don't repeat.
+	/// </summary>
+	class TreeEnumerator {
+		TreeEnumerator(TreeEnumerator const &other) = delete;
+		TreeEnumerator &operator=(TreeEnumerator const &other) = delete;
+	public:
+		struct Occurrence {
+			NodeId node;
+			//an index into the node's derivations, or -1 if it has none
+			std::int32_t derivation;
+			//an index into the tree, or -1 for its root
+			std::int32_t parent;
+		};
+
+		TreeEnumerator(ParseForest const &forest, NodeId node);
+
+		bool MoveNext();
+		//valid until the next MoveNext
+		Span<Occurrence> GetTree() const;
+		//the choices a TreeCursor can walk the current tree by, unless a node occurs in it twice with different derivations
+		void GetChoices(std::vector<std::int32_t> &choices) const;
+	private:
+		struct Frame {
+			std::int32_t occurrence;
+			std::int32_t nextChild;
+		};
+
+		//false if the tree can't be finished without entering a node inside itself
+		bool Extend();
+		//takes the last occurrence's next derivation that has one, dropping what follows it
+		bool Increment();
+		void Append(NodeId node, std::int32_t parent, std::int32_t slot);
+
+		ParseForest const &forest;
+		NodeId root;
+		bool started;
+		bool finished;
+		std::vector<Occurrence> tree;
+		//which of its parent's children each occurrence is
+		std::vector<std::int32_t> slots;
+		std::vector<Frame> stack;
+		//whether a node is on the stack
+		std::vector<bool> open;
+	};
+
+	//a tree count too large to hold, or endless because of a cycle
+	std::uint64_t const ManyTrees = ~std::uint64_t(0);
+
+	//the number of distinct trees below each node root reaches, as counts[node], in
+	//one bottom up pass; a node root doesn't reach counts 0
+	void CountTrees(ParseForest const &forest, NodeId root, std::vector<std::uint64_t> &counts);
+
+	/// <summary>
+	/// Calls visitor for each node root reaches, after it has been called
+	/// for every node below it, so subtrees that share nothing are visited
+	/// on different threads. A node is visited once however many parents it
+	/// has. A node in a cycle is never ready, so it's never visited; the
+	/// number of nodes that were is returned. Blocks until the visits are
+	/// done, so it can't be called from a work item.
+	/// </summary>
+	std::size_t VisitParallel(ParseForest const &forest, NodeId root, IForestVisitor &visitor, IScheduler &scheduler);
+}
+
+#endif
\ No newline at end of file
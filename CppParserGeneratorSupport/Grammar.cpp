@@ -0,0 +1,684 @@
+#include "Grammar.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Parlex {
+	namespace {
+		//"PLXG" in the first four bytes, so an image of the other byte order doesn't match
+		std::uint32_t const ImageMagic = 0x47584C50;
+
+		//appends each section 8 byte aligned, so its records can be read where they lie
+		class ImageWriter {
+		public:
+			template<typename T>
+			std::uint32_t Append(T const *data, std::size_t count) {
+				bytes.resize((bytes.size() + 7) & ~std::size_t(7));
+				std::size_t offset = bytes.size();
+				bytes.resize(offset + count * sizeof(T));
+				if (count != 0) std::memcpy(&bytes[offset], data, count * sizeof(T));
+				return static_cast<std::uint32_t>(offset);
+			}
+
+			std::vector<char> bytes;
+		};
+	}
+
+	Grammar::Grammar() :
+		main(-1), compiled(false), header(nullptr), symbolRecords(nullptr), stateRecords(nullptr), transitionRecords(nullptr), startStateOffsets(nullptr),
+		startStates(nullptr), classRecords(nullptr), syncPointRecords(nullptr), codePoints(nullptr), names(nullptr)
+	{}
+
+	void Grammar::ThrowIfCompiled() const {
+		if (compiled) {
+			throw std::logic_error("a Grammar can't be changed once it is compiled");
+		}
+	}
+
+	int Grammar::AddSymbol(SymbolKind kind, std::string const &name) {
+		ThrowIfCompiled();
+		Symbol symbol;
+		symbol.kind = kind;
+		symbol.name = name;
+		symbol.greedy = false;
+		symbol.hasPrecedence = false;
+		symbol.precedence = 0;
+		symbol.associativity = Associativity::Left;
+		symbol.openLeft = false;
+		symbol.openRight = false;
+		symbol.maxLength = Unbounded;
+		symbol.function = nullptr;
+		symbol.lookaheadSupplied = false;
+		symbol.nullable = false;
+		symbol.canPrecedeEnd = false;
+		symbols.push_back(symbol);
+		return static_cast<int>(symbols.size() - 1);
+	}
+
+	int Grammar::AddStringTerminal(std::string const &name, std::u32string const &text) {
+		int result = AddSymbol(SymbolKind::StringTerminal, name);
+		symbols[result].text = text;
+		return result;
+	}
+
+	int Grammar::AddCharacterSetTerminal(std::string const &name, std::vector<char32_t> const &codePoints) {
+		int result = AddSymbol(SymbolKind::CharacterSetTerminal, name);
+		std::vector<char32_t> sorted(codePoints);
+		std::sort(sorted.begin(), sorted.end());
+		//collapse into inclusive [first, last] pairs
+		std::vector<char32_t> &ranges = symbols[result].ranges;
+		for (char32_t c : sorted) {
+			if (!ranges.empty() && ranges.back() + 1 >= c) {
+				ranges.back() = std::max(ranges.back(), c);
+			} else {
+				ranges.push_back(c);
+				ranges.push_back(c);
+			}
+		}
+		return result;
+	}
+
+	int Grammar::AddFunctionTerminal(std::string const &name, TerminalFunction function) {
+		int result = AddSymbol(SymbolKind::FunctionTerminal, name);
+		symbols[result].function = function;
+		return result;
+	}
+
+	int Grammar::AddProduction(std::string const &name, bool greedy) {
+		int result = AddSymbol(SymbolKind::Production, name);
+		symbols[result].greedy = greedy;
+		return result;
+	}
+
+	int Grammar::AddState(int production, bool start, bool accept) {
+		ThrowIfCompiled();
+		if (symbols.at(production).kind != SymbolKind::Production) {
+			throw std::invalid_argument("states can only be added to productions");
+		}
+		State state = { production, start, accept, 0, 0, Unbounded };
+		states.push_back(state);
+		return static_cast<int>(states.size() - 1);
+	}
+
+	void Grammar::AddTransition(int fromState, int symbol, int toState) {
+		ThrowIfCompiled();
+		PendingTransition transition = { fromState, symbol, toState };
+		pending.push_back(transition);
+	}
+
+	void Grammar::SetMain(int production) {
+		ThrowIfCompiled();
+		main = production;
+	}
+
+	void Grammar::SetLookahead(int symbol, bool nullable, CharacterClass const &first, CharacterClass const &follow, bool canPrecedeEnd) {
+		ThrowIfCompiled();
+		Symbol &target = symbols.at(symbol);
+		target.lookaheadSupplied = true;
+		target.nullable = nullable;
+		target.first = first;
+		target.follow = follow;
+		target.canPrecedeEnd = canPrecedeEnd;
+	}
+
+	void Grammar::AddSyncPoint(int separator, int symbol) {
+		ThrowIfCompiled();
+		if (symbols.at(separator).kind != SymbolKind::StringTerminal || symbols[separator].text.empty()) {
+			throw std::invalid_argument("a sync point's separator must be a non-empty string terminal");
+		}
+		if (symbol < 0 || symbol >= GetSymbolCount()) {
+			throw std::invalid_argument("a sync point's symbol doesn't exist");
+		}
+		SyncPoint syncPoint = { separator, symbol };
+		syncPoints.push_back(syncPoint);
+	}
+
+	void Grammar::SetPrecedence(int production, int precedence, Associativity associativity) {
+		ThrowIfCompiled();
+		if (symbols.at(production).kind != SymbolKind::Production) {
+			throw std::invalid_argument("only a production can have a precedence");
+		}
+		Symbol &target = symbols[production];
+		target.hasPrecedence = true;
+		target.precedence = precedence;
+		target.associativity = associativity;
+	}
+
+	void Grammar::Compile() {
+		ThrowIfCompiled();
+		for (PendingTransition const &transition : pending) {
+			if (transition.from < 0 || transition.from >= GetStateCount() || transition.to < 0 || transition.to >= GetStateCount() ||
+				transition.symbol < 0 || transition.symbol >= GetSymbolCount()) {
+				throw std::logic_error("a transition refers to a state or symbol that doesn't exist");
+			}
+			if (states[transition.from].production != states[transition.to].production) {
+				throw std::logic_error("a transition leaves its production's states");
+			}
+		}
+		//an operator is open on a side where another operator can be its child; only
+		//a child open toward its parent's far side can make their precedences clash
+		for (PendingTransition const &transition : pending) {
+			if (!symbols[transition.symbol].hasPrecedence) continue;
+			Symbol &production = symbols[states[transition.from].production];
+			if (states[transition.from].start) production.openLeft = true;
+			if (states[transition.to].accept) production.openRight = true;
+		}
+		std::stable_sort(pending.begin(), pending.end(), [](PendingTransition const &l, PendingTransition const &r) { return l.from < r.from; });
+		std::vector<Transition> transitions;
+		transitions.reserve(pending.size());
+		for (PendingTransition const &transition : pending) {
+			State &from = states[transition.from];
+			if (from.transitionCount == 0) from.firstTransition = static_cast<std::int32_t>(transitions.size());
+			from.transitionCount++;
+			Transition compiledTransition = { transition.symbol, transition.to };
+			transitions.push_back(compiledTransition);
+		}
+		std::vector<PendingTransition>().swap(pending);
+
+		std::vector<std::int32_t> startStateOffsets(symbols.size() + 1, 0);
+		for (State const &state : states) {
+			if (state.start) startStateOffsets[state.production + 1]++;
+		}
+		for (std::size_t i = 1; i < startStateOffsets.size(); ++i) {
+			startStateOffsets[i] += startStateOffsets[i - 1];
+		}
+		std::vector<std::int32_t> startStates(startStateOffsets.back());
+		std::vector<std::int32_t> cursors(startStateOffsets.begin(), startStateOffsets.end() - 1);
+		for (std::size_t i = 0; i < states.size(); ++i) {
+			if (states[i].start) startStates[cursors[states[i].production]++] = static_cast<std::int32_t>(i);
+		}
+		ComputeLookahead(transitions);
+		ComputeMaxLengths(transitions, startStateOffsets, startStates);
+		WriteImage(transitions, startStateOffsets, startStates);
+		for (Symbol const &symbol : symbols) {
+			functions.push_back(symbol.function);
+		}
+		std::vector<Symbol>().swap(symbols);
+		std::vector<State>().swap(states);
+		std::vector<SyncPoint>().swap(syncPoints);
+		compiled = true;
+	}
+
+	void Grammar::WriteImage(std::vector<Transition> const &transitions, std::vector<std::int32_t> const &startStateOffsets, std::vector<std::int32_t> const &startStates) {
+		ImageHeader image;
+		std::memset(&image, 0, sizeof(image));
+		image.magic = ImageMagic;
+		image.version = ImageVersion;
+		image.main = main;
+		image.symbolCount = static_cast<std::int32_t>(symbols.size());
+		image.stateCount = static_cast<std::int32_t>(states.size());
+		image.transitionCount = static_cast<std::int32_t>(transitions.size());
+		image.startStateCount = static_cast<std::int32_t>(startStates.size());
+		image.syncPointCount = static_cast<std::int32_t>(syncPoints.size());
+
+		std::vector<SymbolRecord> symbolTable;
+		std::vector<ClassRecord> classTable;
+		std::vector<char32_t> codePointPool;
+		std::string namePool;
+		auto addClass = [&](CharacterClass const &added) {
+			ClassRecord record;
+			std::copy(added.GetLowBits(), added.GetLowBits() + 4, record.low);
+			std::vector<char32_t> const &high = added.GetHighRanges();
+			record.highOffset = static_cast<std::int32_t>(codePointPool.size());
+			record.highCount = static_cast<std::int32_t>(high.size());
+			codePointPool.insert(codePointPool.end(), high.begin(), high.end());
+			classTable.push_back(record);
+		};
+		for (Symbol const &symbol : symbols) {
+			std::vector<char32_t> data(symbol.text.begin(), symbol.text.end());
+			data.insert(data.end(), symbol.ranges.begin(), symbol.ranges.end());
+			std::int32_t flags = (symbol.greedy ? Greedy : 0) | (symbol.nullable ? Nullable : 0) | (symbol.canPrecedeEnd ? CanPrecedeEnd : 0);
+			if (symbol.hasPrecedence) {
+				flags |= HasPrecedence;
+				if (symbol.associativity == Associativity::Left) flags |= LeftAssociative;
+				if (symbol.associativity == Associativity::Right) flags |= RightAssociative;
+				if (symbol.openLeft) flags |= OpenLeft;
+				if (symbol.openRight) flags |= OpenRight;
+			}
+			SymbolRecord record = {
+				static_cast<std::int32_t>(symbol.kind), flags,
+				static_cast<std::int32_t>(namePool.size()), static_cast<std::int32_t>(symbol.name.size()),
+				static_cast<std::int32_t>(codePointPool.size()), static_cast<std::int32_t>(data.size()),
+				symbol.precedence, symbol.maxLength
+			};
+			symbolTable.push_back(record);
+			namePool += symbol.name;
+			codePointPool.insert(codePointPool.end(), data.begin(), data.end());
+			addClass(symbol.first);
+			addClass(symbol.follow);
+			image.hasGreedy = image.hasGreedy || symbol.greedy;
+		}
+		std::vector<StateRecord> stateTable;
+		for (State const &state : states) {
+			StateRecord record = { state.production, (state.start ? Start : 0) | (state.accept ? Accept : 0), state.firstTransition, state.transitionCount, state.maxRemaining };
+			stateTable.push_back(record);
+		}
+		image.codePointCount = static_cast<std::int32_t>(codePointPool.size());
+		image.nameSize = static_cast<std::int32_t>(namePool.size());
+
+		ImageWriter writer;
+		writer.Append(&image, 1);
+		image.symbolOffset = writer.Append(symbolTable.data(), symbolTable.size());
+		image.stateOffset = writer.Append(stateTable.data(), stateTable.size());
+		image.transitionOffset = writer.Append(transitions.data(), transitions.size());
+		image.startStateOffsetOffset = writer.Append(startStateOffsets.data(), startStateOffsets.size());
+		image.startStateOffset = writer.Append(startStates.data(), startStates.size());
+		image.classOffset = writer.Append(classTable.data(), classTable.size());
+		image.syncPointOffset = writer.Append(syncPoints.data(), syncPoints.size());
+		image.codePointOffset = writer.Append(codePointPool.data(), codePointPool.size());
+		image.nameOffset = writer.Append(namePool.data(), namePool.size());
+		image.size = writer.bytes.size();
+		std::memcpy(&writer.bytes[0], &image, sizeof(image));
+		ownImage.assign((writer.bytes.size() + 7) / 8, 0);
+		std::memcpy(ownImage.data(), writer.bytes.data(), writer.bytes.size());
+		SetImage(ownImage.data(), writer.bytes.size());
+	}
+
+	void Grammar::SetImage(void const *image, std::size_t size) {
+		if (reinterpret_cast<std::uintptr_t>(image) % 8 != 0) {
+			throw std::invalid_argument("a grammar image must be 8 byte aligned");
+		}
+		ImageHeader const *candidate = static_cast<ImageHeader const *>(image);
+		if (size < sizeof(ImageHeader) || candidate->magic != ImageMagic) {
+			throw std::invalid_argument("that isn't a grammar image, or it was written with the other byte order");
+		}
+		if (candidate->version != ImageVersion) {
+			throw std::invalid_argument("the grammar image is of a different version");
+		}
+		if (candidate->size > size) {
+			throw std::invalid_argument("the grammar image is cut short");
+		}
+		auto section = [&](std::uint32_t offset, std::int64_t count, std::size_t recordSize) {
+			if (count < 0 || offset % 8 != 0 || offset + count * std::uint64_t(recordSize) > candidate->size) {
+				throw std::invalid_argument("a section of the grammar image lies outside it");
+			}
+			return static_cast<char const *>(image) + offset;
+		};
+		std::int64_t symbolCount = candidate->symbolCount;
+		symbolRecords = reinterpret_cast<SymbolRecord const *>(section(candidate->symbolOffset, symbolCount, sizeof(SymbolRecord)));
+		stateRecords = reinterpret_cast<StateRecord const *>(section(candidate->stateOffset, candidate->stateCount, sizeof(StateRecord)));
+		transitionRecords = reinterpret_cast<Transition const *>(section(candidate->transitionOffset, candidate->transitionCount, sizeof(Transition)));
+		startStateOffsets = reinterpret_cast<std::int32_t const *>(section(candidate->startStateOffsetOffset, symbolCount + 1, sizeof(std::int32_t)));
+		startStates = reinterpret_cast<std::int32_t const *>(section(candidate->startStateOffset, candidate->startStateCount, sizeof(std::int32_t)));
+		classRecords = reinterpret_cast<ClassRecord const *>(section(candidate->classOffset, 2 * symbolCount, sizeof(ClassRecord)));
+		syncPointRecords = reinterpret_cast<SyncPoint const *>(section(candidate->syncPointOffset, candidate->syncPointCount, sizeof(SyncPoint)));
+		codePoints = reinterpret_cast<char32_t const *>(section(candidate->codePointOffset, candidate->codePointCount, sizeof(char32_t)));
+		names = section(candidate->nameOffset, candidate->nameSize, 1);
+
+		//one pass over the indices, so a damaged image is refused instead of read out of bounds
+		auto within = [](std::int64_t first, std::int64_t count, std::int64_t size) { return first >= 0 && count >= 0 && first + count <= size; };
+		bool valid = candidate->main >= -1 && candidate->main < symbolCount && startStateOffsets[0] == 0 && startStateOffsets[symbolCount] == candidate->startStateCount;
+		for (std::int64_t i = 0; valid && i < symbolCount; ++i) {
+			SymbolRecord const &record = symbolRecords[i];
+			valid = record.kind >= 0 && record.kind <= static_cast<std::int32_t>(SymbolKind::Production) &&
+				within(record.nameOffset, record.nameLength, candidate->nameSize) && within(record.dataOffset, record.dataLength, candidate->codePointCount) &&
+				within(classRecords[2 * i].highOffset, classRecords[2 * i].highCount, candidate->codePointCount) &&
+				within(classRecords[2 * i + 1].highOffset, classRecords[2 * i + 1].highCount, candidate->codePointCount) &&
+				startStateOffsets[i] <= startStateOffsets[i + 1];
+		}
+		for (std::int32_t i = 0; valid && i < candidate->stateCount; ++i) {
+			valid = stateRecords[i].production >= 0 && stateRecords[i].production < symbolCount &&
+				within(stateRecords[i].firstTransition, stateRecords[i].transitionCount, candidate->transitionCount);
+		}
+		for (std::int32_t i = 0; valid && i < candidate->transitionCount; ++i) {
+			valid = transitionRecords[i].symbol >= 0 && transitionRecords[i].symbol < symbolCount && transitionRecords[i].target >= 0 && transitionRecords[i].target < candidate->stateCount;
+		}
+		for (std::int32_t i = 0; valid && i < candidate->startStateCount; ++i) {
+			valid = startStates[i] >= 0 && startStates[i] < candidate->stateCount;
+		}
+		for (std::int32_t i = 0; valid && i < candidate->syncPointCount; ++i) {
+			valid = syncPointRecords[i].separator >= 0 && syncPointRecords[i].separator < symbolCount && syncPointRecords[i].symbol >= 0 && syncPointRecords[i].symbol < symbolCount;
+		}
+		if (!valid) {
+			throw std::invalid_argument("the grammar image refers to something outside it");
+		}
+		header = candidate;
+	}
+
+	void Grammar::Save(std::ostream &stream) const {
+		if (!compiled) {
+			throw std::logic_error("only a compiled Grammar can be saved");
+		}
+		stream.write(reinterpret_cast<char const *>(header), static_cast<std::streamsize>(header->size));
+	}
+
+	void Grammar::Attach(void const *image, std::size_t size) {
+		ThrowIfCompiled();
+		if (!symbols.empty() || !states.empty()) {
+			throw std::logic_error("only an empty Grammar can attach an image");
+		}
+		SetImage(image, size);
+		main = header->main;
+		functions.assign(header->symbolCount, nullptr);
+		compiled = true;
+	}
+
+	void Grammar::BindFunction(int symbol, TerminalFunction function) {
+		if (!compiled) {
+			throw std::logic_error("functions are bound to a compiled Grammar; add them with AddFunctionTerminal before");
+		}
+		if (symbol < 0 || symbol >= GetSymbolCount() || GetKind(symbol) != SymbolKind::FunctionTerminal) {
+			throw std::invalid_argument("only a function terminal can be bound to a function");
+		}
+		functions[symbol] = function;
+	}
+
+	void Grammar::ComputeMaxLengths(std::vector<Transition> const &transitions, std::vector<std::int32_t> const &startStateOffsets, std::vector<std::int32_t> const &startStates) {
+		//longest paths, taken in dependency order: a state waits on its transitions'
+		//targets and on the start states of the productions they consume. Whatever
+		//is never ready is on, or leads into, a cycle, so it stays Unbounded
+		std::int32_t stateCount = static_cast<std::int32_t>(states.size());
+		//nodes are the states, then a node per symbol standing for its start states
+		std::vector<std::int32_t> waiting(states.size() + symbols.size(), 0);
+		std::vector<std::int32_t> dependentOffsets(waiting.size() + 1, 0);
+		auto forEachDependency = [&](std::int32_t node, auto const &visit) {
+			if (node < stateCount) {
+				State const &state = states[node];
+				for (std::int32_t i = 0; i < state.transitionCount; ++i) {
+					Transition const &transition = transitions[state.firstTransition + i];
+					visit(transition.target);
+					if (symbols[transition.symbol].kind == SymbolKind::Production) visit(stateCount + transition.symbol);
+				}
+			} else {
+				std::int32_t symbol = node - stateCount;
+				for (std::int32_t i = startStateOffsets[symbol]; i < startStateOffsets[symbol + 1]; ++i) {
+					visit(startStates[i]);
+				}
+			}
+		};
+		for (std::int32_t node = 0; node < static_cast<std::int32_t>(waiting.size()); ++node) {
+			forEachDependency(node, [&](std::int32_t dependency) {
+				waiting[node]++;
+				dependentOffsets[dependency + 1]++;
+			});
+		}
+		for (std::size_t i = 1; i < dependentOffsets.size(); ++i) {
+			dependentOffsets[i] += dependentOffsets[i - 1];
+		}
+		std::vector<std::int32_t> dependents(dependentOffsets.back());
+		std::vector<std::int32_t> cursors(dependentOffsets.begin(), dependentOffsets.end() - 1);
+		for (std::int32_t node = 0; node < static_cast<std::int32_t>(waiting.size()); ++node) {
+			forEachDependency(node, [&](std::int32_t dependency) {
+				dependents[cursors[dependency]++] = node;
+			});
+		}
+
+		for (Symbol &symbol : symbols) {
+			switch (symbol.kind) {
+			case SymbolKind::StringTerminal:
+				symbol.maxLength = static_cast<std::int32_t>(symbol.text.size());
+				break;
+			case SymbolKind::CharacterSetTerminal:
+				symbol.maxLength = symbol.ranges.empty() ? -1 : 1;
+				break;
+			default:
+				symbol.maxLength = Unbounded;
+				break;
+			}
+		}
+		std::vector<std::int32_t> ready;
+		for (std::int32_t node = 0; node < static_cast<std::int32_t>(waiting.size()); ++node) {
+			if (waiting[node] == 0) ready.push_back(node);
+		}
+		while (!ready.empty()) {
+			std::int32_t node = ready.back();
+			ready.pop_back();
+			if (node < stateCount) {
+				State &state = states[node];
+				std::int32_t longest = state.accept ? 0 : -1;
+				for (std::int32_t i = 0; i < state.transitionCount; ++i) {
+					Transition const &transition = transitions[state.firstTransition + i];
+					longest = std::max(longest, AddLengths(symbols[transition.symbol].maxLength, states[transition.target].maxRemaining));
+				}
+				state.maxRemaining = longest;
+			} else {
+				std::int32_t symbol = node - stateCount;
+				if (symbols[symbol].kind == SymbolKind::Production) {
+					std::int32_t longest = -1;
+					for (std::int32_t i = startStateOffsets[symbol]; i < startStateOffsets[symbol + 1]; ++i) {
+						longest = std::max(longest, states[startStates[i]].maxRemaining);
+					}
+					symbols[symbol].maxLength = longest;
+				}
+			}
+			for (std::int32_t i = dependentOffsets[node]; i < dependentOffsets[node + 1]; ++i) {
+				if (--waiting[dependents[i]] == 0) ready.push_back(dependents[i]);
+			}
+		}
+	}
+
+	void Grammar::ComputeLookahead(std::vector<Transition> const &transitions) {
+		auto transitionsOf = [&](std::size_t state) {
+			if (states[state].transitionCount == 0) return Span<Transition>();
+			return Span<Transition>(&transitions[states[state].firstTransition], states[state].transitionCount);
+		};
+		for (Symbol &symbol : symbols) {
+			if (symbol.lookaheadSupplied) continue;
+			switch (symbol.kind) {
+			case SymbolKind::StringTerminal:
+				symbol.nullable = symbol.text.empty();
+				if (!symbol.text.empty()) symbol.first.AddRange(symbol.text[0], symbol.text[0]);
+				break;
+			case SymbolKind::CharacterSetTerminal:
+				for (std::size_t i = 0; i < symbol.ranges.size(); i += 2) {
+					symbol.first.AddRange(symbol.ranges[i], symbol.ranges[i + 1]);
+				}
+				break;
+			case SymbolKind::FunctionTerminal:
+				//nothing is known about a function, so it could start with, or be, anything
+				symbol.nullable = true;
+				symbol.first = CharacterClass::All();
+				break;
+			default:
+				break;
+			}
+		}
+
+		//what can come first from each state, and whether it reaches an accept state
+		//without consuming anything, iterated to a fixpoint along with the productions
+		std::vector<CharacterClass> stateFirst(states.size());
+		std::vector<char> stateNullable(states.size(), 0);
+		for (bool changed = true; changed;) {
+			changed = false;
+			//transitions mostly lead to later states, so going backwards settles sooner
+			for (std::size_t i = states.size(); i-- > 0;) {
+				bool nullable = states[i].accept;
+				for (Transition const &transition : transitionsOf(i)) {
+					Symbol const &symbol = symbols[transition.symbol];
+					changed |= stateFirst[i].UnionWith(symbol.first);
+					if (symbol.nullable) {
+						changed |= stateFirst[i].UnionWith(stateFirst[transition.target]);
+						nullable = nullable || stateNullable[transition.target];
+					}
+				}
+				if (nullable && !stateNullable[i]) {
+					stateNullable[i] = 1;
+					changed = true;
+				}
+				Symbol &production = symbols[states[i].production];
+				if (states[i].start && !production.lookaheadSupplied) {
+					changed |= production.first.UnionWith(stateFirst[i]);
+					if (stateNullable[i] && !production.nullable) {
+						production.nullable = true;
+						changed = true;
+					}
+				}
+			}
+		}
+
+		if (main < 0) return;
+		if (!symbols[main].lookaheadSupplied) symbols[main].canPrecedeEnd = true;
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (std::size_t i = 0; i < states.size(); ++i) {
+				Symbol const &owner = symbols[states[i].production];
+				for (Transition const &transition : transitionsOf(i)) {
+					Symbol &symbol = symbols[transition.symbol];
+					if (symbol.lookaheadSupplied) continue;
+					changed |= symbol.follow.UnionWith(stateFirst[transition.target]);
+					if (stateNullable[transition.target]) {
+						//whatever can follow the owner can follow a symbol that can end it
+						changed |= symbol.follow.UnionWith(owner.follow);
+						if (owner.canPrecedeEnd && !symbol.canPrecedeEnd) {
+							symbol.canPrecedeEnd = true;
+							changed = true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	bool Grammar::GetIsCompiled() const {
+		return compiled;
+	}
+
+	int Grammar::GetSymbolCount() const {
+		return compiled ? header->symbolCount : static_cast<int>(symbols.size());
+	}
+
+	int Grammar::GetStateCount() const {
+		return compiled ? header->stateCount : static_cast<int>(states.size());
+	}
+
+	int Grammar::GetMain() const {
+		return main;
+	}
+
+	int Grammar::FindSymbol(std::string const &name) const {
+		for (int i = 0; i < GetSymbolCount(); ++i) {
+			if ((compiled ? GetName(i) : symbols[i].name) == name) return i;
+		}
+		return -1;
+	}
+
+	SymbolKind Grammar::GetKind(int symbol) const {
+		return static_cast<SymbolKind>(symbolRecords[symbol].kind);
+	}
+
+	std::string Grammar::GetName(int symbol) const {
+		return std::string(names + symbolRecords[symbol].nameOffset, symbolRecords[symbol].nameLength);
+	}
+
+	bool Grammar::GetIsTerminal(int symbol) const {
+		return symbolRecords[symbol].kind != static_cast<std::int32_t>(SymbolKind::Production);
+	}
+
+	bool Grammar::GetIsGreedy(int symbol) const {
+		return (symbolRecords[symbol].flags & Greedy) != 0;
+	}
+
+	bool Grammar::GetIsBound(int symbol) const {
+		return GetKind(symbol) != SymbolKind::FunctionTerminal || functions[symbol] != nullptr;
+	}
+
+	int Grammar::GetPrecedence(int symbol) const {
+		return symbolRecords[symbol].precedence;
+	}
+
+	Associativity Grammar::GetAssociativity(int symbol) const {
+		std::int32_t flags = symbolRecords[symbol].flags;
+		if ((flags & LeftAssociative) != 0) return Associativity::Left;
+		if ((flags & RightAssociative) != 0) return Associativity::Right;
+		return Associativity::None;
+	}
+
+	bool Grammar::MatchTerminal(int symbol, Text const &codepoints, int position, int &length) const {
+		SymbolRecord const &terminal = symbolRecords[symbol];
+		char32_t const *data = codePoints + terminal.dataOffset;
+		switch (static_cast<SymbolKind>(terminal.kind)) {
+		case SymbolKind::StringTerminal:
+			if (position < 0 || codepoints.size() < position + static_cast<std::size_t>(terminal.dataLength)) return false;
+			if (!std::equal(data, data + terminal.dataLength, codepoints.begin() + position)) return false;
+			length = terminal.dataLength;
+			return true;
+		case SymbolKind::CharacterSetTerminal: {
+			if (static_cast<std::size_t>(position) >= codepoints.size()) return false;
+			char32_t c = codepoints[position];
+			//the first range whose upper bound is at least c
+			char32_t const *i = std::lower_bound(data, data + terminal.dataLength, c);
+			if (i == data + terminal.dataLength) return false;
+			if (((i - data) & 1) == 0 && *i != c) return false;
+			length = 1;
+			return true;
+		}
+		case SymbolKind::FunctionTerminal:
+			return functions[symbol](codepoints, position, length);
+		default:
+			return false;
+		}
+	}
+
+	Span<char32_t> Grammar::GetText(int symbol) const {
+		if (symbolRecords[symbol].dataLength == 0) return Span<char32_t>();
+		return Span<char32_t>(codePoints + symbolRecords[symbol].dataOffset, symbolRecords[symbol].dataLength);
+	}
+
+	Span<char32_t> Grammar::GetRanges(int symbol) const {
+		return GetText(symbol);
+	}
+
+	Span<std::int32_t> Grammar::GetStartStates(int production) const {
+		std::int32_t first = startStateOffsets[production];
+		std::int32_t count = startStateOffsets[production + 1] - first;
+		if (count == 0) return Span<std::int32_t>();
+		return Span<std::int32_t>(startStates + first, count);
+	}
+
+	int Grammar::GetMaxLength(int symbol) const {
+		return symbolRecords[symbol].maxLength;
+	}
+
+	int Grammar::GetMaxRemaining(int state) const {
+		return stateRecords[state].maxRemaining;
+	}
+
+	bool Grammar::GetIsAccept(int state) const {
+		return (stateRecords[state].flags & Accept) != 0;
+	}
+
+	int Grammar::GetProductionOf(int state) const {
+		return stateRecords[state].production;
+	}
+
+	Span<Grammar::Transition> Grammar::GetTransitions(int state) const {
+		StateRecord const &from = stateRecords[state];
+		if (from.transitionCount == 0) return Span<Transition>();
+		return Span<Transition>(transitionRecords + from.firstTransition, from.transitionCount);
+	}
+
+	bool Grammar::GetIsNullable(int symbol) const {
+		return (symbolRecords[symbol].flags & Nullable) != 0;
+	}
+
+	CharacterClass Grammar::GetFirst(int symbol) const {
+		ClassRecord const &record = classRecords[2 * symbol];
+		return CharacterClass(record.low, codePoints + record.highOffset, record.highCount);
+	}
+
+	CharacterClass Grammar::GetFollow(int symbol) const {
+		ClassRecord const &record = classRecords[2 * symbol + 1];
+		return CharacterClass(record.low, codePoints + record.highOffset, record.highCount);
+	}
+
+	bool Grammar::GetCanPrecedeEnd(int symbol) const {
+		return (symbolRecords[symbol].flags & CanPrecedeEnd) != 0;
+	}
+
+	bool Grammar::GetHasGreedy() const {
+		return header->hasGreedy != 0;
+	}
+
+	Span<Grammar::SyncPoint> Grammar::GetSyncPoints() const {
+		if (header->syncPointCount == 0) return Span<SyncPoint>();
+		return Span<SyncPoint>(syncPointRecords, header->syncPointCount);
+	}
+
+	bool Grammar::HighContains(ClassRecord const &record, char32_t c) const {
+		//the first range whose upper bound is at least c
+		char32_t const *high = codePoints + record.highOffset;
+		char32_t const *i = std::lower_bound(high, high + record.highCount, c);
+		if (i == high + record.highCount) return false;
+		return ((i - high) & 1) != 0 || *i == c;
+	}
+}
\ No newline at end of file
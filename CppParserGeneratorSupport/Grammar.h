@@ -0,0 +1,303 @@
+#ifndef _GRAMMAR_H_
+#define _GRAMMAR_H_
+
+#include "Text.h"
+#include "Span.h"
+#include "CharacterClass.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Parlex {
+	enum class SymbolKind {
+		StringTerminal,
+		CharacterSetTerminal,
+		FunctionTerminal,
+		Production
+	};
+
+	//which operand of an operator may be another of the same precedence; None for neither, as for comparisons
+	enum class Associativity {
+		Right,
+		Left,
+		None
+	};
+
+	//reads a terminal at position, reporting how many code points matched
+	typedef bool (*TerminalFunction)(Text const &codepoints, int position, int &length);
+
+	/// <summary>
+	/// The native form of an NfaGrammar. Every terminal and production is a
+	/// symbol with a dense id, and each production is an NFA whose states
+	/// are numbered across the whole grammar. Symbols and states are added
+	/// first, then Compile lays everything the engine reads out as one flat
+	/// image; the grammar can't be changed after that. The image holds no
+	/// pointers, so Save can write it out and Attach can use a copy of it,
+	/// such as a MappedFile shared by every process that parses, where it
+	/// lies.
+	/// </summary>
+	class Grammar {
+		Grammar(Grammar const &other) = delete;
+		Grammar &operator=(Grammar const &other) = delete;
+	public:
+		static std::uint32_t const ImageVersion = 3;
+		//a length no bound is known for, such as a repetition's or a function terminal's
+		static std::int32_t const Unbounded = 0x7fffffff;
+
+		struct Transition {
+			std::int32_t symbol;
+			std::int32_t target;
+		};
+
+		//after a match of separator, symbol is likely to start
+		struct SyncPoint {
+			std::int32_t separator;
+			std::int32_t symbol;
+		};
+
+		Grammar();
+
+		int AddStringTerminal(std::string const &name, std::u32string const &text);
+		int AddCharacterSetTerminal(std::string const &name, std::vector<char32_t> const &codePoints);
+		int AddFunctionTerminal(std::string const &name, TerminalFunction function);
+		int AddProduction(std::string const &name, bool greedy = false);
+		int AddState(int production, bool start, bool accept);
+		void AddTransition(int fromState, int symbol, int toState);
+		void SetMain(int production);
+		//fixes a symbol's lookahead instead of letting Compile work it out, as the
+		//managed LookaheadSets can for terminals that are only known as functions
+		void SetLookahead(int symbol, bool nullable, CharacterClass const &first, CharacterClass const &follow, bool canPrecedeEnd);
+		//declares where a large text can be split for speculative parsing, such as symbol
+		//Record after the string terminal "\n"; separator must be a non-empty string terminal
+		void AddSyncPoint(int separator, int symbol);
+		/// <summary>
+		/// Declares production an operator: a derivation of it whose first or
+		/// last child is a match of a production of lower precedence, or of
+		/// the same precedence on a side associativity doesn't allow, is
+		/// dropped as soon as it's found; a child that can't have an operand on
+		/// its parent's side, like a prefix operator ending an operand, never
+		/// clashes. Only direct children are looked at, so an operand should
+		/// name the operator productions themselves, as a choice of
+		/// transitions, rather than one production that wraps them.
+		/// </summary>
+		void SetPrecedence(int production, int precedence, Associativity associativity);
+		//throws std::logic_error if a transition leaves its production's states
+		void Compile();
+		bool GetIsCompiled() const;
+		//write the compiled image out, as Attach takes it
+		void Save(std::ostream &stream) const;
+		/// <summary>
+		/// Make this empty grammar the compiled one image holds, reading it in
+		/// place: image must be 8 byte aligned, and outlive the grammar
+		/// unchanged. Throws std::invalid_argument if it isn't an image of
+		/// this version written on a machine of the same byte order. Function
+		/// terminals can't be saved, so each has to be bound again.
+		/// </summary>
+		void Attach(void const *image, std::size_t size);
+		void BindFunction(int symbol, TerminalFunction function);
+
+		int GetSymbolCount() const;
+		int GetStateCount() const;
+		int GetMain() const;
+		int FindSymbol(std::string const &name) const;
+		SymbolKind GetKind(int symbol) const;
+		std::string GetName(int symbol) const;
+		bool GetIsTerminal(int symbol) const;
+		bool GetIsGreedy(int symbol) const;
+		//false only for a function terminal no function has been bound to, as after Attach
+		bool GetIsBound(int symbol) const;
+		//a function terminal's function must be bound; the parse engine and scan check that up front
+		bool MatchTerminal(int symbol, Text const &codepoints, int position, int &length) const;
+		//the text of a string terminal
+		Span<char32_t> GetText(int symbol) const;
+		//a character set's sorted, inclusive [first, last] code point pairs
+		Span<char32_t> GetRanges(int symbol) const;
+
+		Span<std::int32_t> GetStartStates(int production) const;
+		bool GetIsAccept(int state) const;
+		int GetProductionOf(int state) const;
+		Span<Transition> GetTransitions(int state) const;
+
+		//the sum of two of the lengths below, -1 if either is and Unbounded if either is or it overflows
+		static std::int32_t AddLengths(std::int32_t l, std::int32_t r) {
+			if (l < 0 || r < 0) return -1;
+			if (l == Unbounded || r == Unbounded || std::int64_t(l) + r >= Unbounded) return Unbounded;
+			return l + r;
+		}
+		//the most code points a match of symbol can span: -1 if it can't match, or Unbounded
+		int GetMaxLength(int symbol) const;
+		//the most code points its production can still match once in state, likewise
+		int GetMaxRemaining(int state) const;
+
+		bool GetIsNullable(int symbol) const;
+		CharacterClass GetFirst(int symbol) const;
+		CharacterClass GetFollow(int symbol) const;
+		//whether the end of the text can follow the symbol
+		bool GetCanPrecedeEnd(int symbol) const;
+		bool GetHasGreedy() const;
+		Span<SyncPoint> GetSyncPoints() const;
+		bool GetHasPrecedence(int symbol) const {
+			return (symbolRecords[symbol].flags & HasPrecedence) != 0;
+		}
+		int GetPrecedence(int symbol) const;
+		Associativity GetAssociativity(int symbol) const;
+
+		//whether a derivation of an operator production may have first and last as its outermost children
+		bool GetAllowsChildren(int production, int first, int last) const {
+			SymbolRecord const &parent = symbolRecords[production];
+			return AllowsChild(parent, symbolRecords[first], OpenRight, LeftAssociative) && AllowsChild(parent, symbolRecords[last], OpenLeft, RightAssociative);
+		}
+
+		//false if symbol can't match at position; the follow sets assume the whole text is being parsed
+		bool MayMatchAt(int symbol, Text const &codepoints, int position, bool useFollow) const {
+			std::int32_t flags = symbolRecords[symbol].flags;
+			if (static_cast<std::size_t>(position) < codepoints.size()) {
+				char32_t c = codepoints[position];
+				if (ClassContains(classRecords[2 * symbol], c)) return true;
+				return (flags & Nullable) != 0 && (!useFollow || ClassContains(classRecords[2 * symbol + 1], c));
+			}
+			return (flags & Nullable) != 0 && (!useFollow || (flags & CanPrecedeEnd) != 0);
+		}
+	private:
+		//the image: a header, then each section 8 byte aligned at the offset the header gives
+		struct ImageHeader {
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint64_t size;
+			std::int32_t main;
+			std::int32_t hasGreedy;
+			std::int32_t symbolCount;
+			std::int32_t stateCount;
+			std::int32_t transitionCount;
+			std::int32_t startStateCount;
+			std::int32_t syncPointCount;
+			std::int32_t codePointCount;
+			std::int32_t nameSize;
+			std::uint32_t symbolOffset;
+			std::uint32_t stateOffset;
+			std::uint32_t transitionOffset;
+			std::uint32_t startStateOffsetOffset;
+			std::uint32_t startStateOffset;
+			std::uint32_t classOffset;
+			std::uint32_t syncPointOffset;
+			std::uint32_t codePointOffset;
+			std::uint32_t nameOffset;
+		};
+
+		enum SymbolFlags { Greedy = 1, Nullable = 2, CanPrecedeEnd = 4, HasPrecedence = 8, LeftAssociative = 16, RightAssociative = 32, OpenLeft = 64, OpenRight = 128 };
+		enum StateFlags { Start = 1, Accept = 2 };
+
+		//a string's text or a character set's ranges are dataLength code points of the code point pool
+		struct SymbolRecord {
+			std::int32_t kind;
+			std::int32_t flags;
+			std::int32_t nameOffset;
+			std::int32_t nameLength;
+			std::int32_t dataOffset;
+			std::int32_t dataLength;
+			std::int32_t precedence;
+			std::int32_t maxLength;
+		};
+
+		struct StateRecord {
+			std::int32_t production;
+			std::int32_t flags;
+			std::int32_t firstTransition;
+			std::int32_t transitionCount;
+			std::int32_t maxRemaining;
+		};
+
+		//a CharacterClass in place; symbol s's FIRST is class 2s and its FOLLOW 2s + 1
+		struct ClassRecord {
+			std::uint64_t low[4];
+			std::int32_t highOffset;
+			std::int32_t highCount;
+		};
+
+		bool ClassContains(ClassRecord const &record, char32_t c) const {
+			if (c < 256) return ((record.low[c >> 6] >> (c & 63)) & 1) != 0;
+			return HighContains(record, c);
+		}
+
+		//a prefix operator can end an operand, and a postfix one start it, whatever their precedence
+		static bool AllowsChild(SymbolRecord const &parent, SymbolRecord const &child, std::int32_t open, std::int32_t side) {
+			if ((child.flags & HasPrecedence) == 0 || (child.flags & open) == 0) return true;
+			if (child.precedence != parent.precedence) return child.precedence > parent.precedence;
+			return (parent.flags & side) != 0;
+		}
+
+		struct Symbol {
+			SymbolKind kind;
+			std::string name;
+			bool greedy;
+			bool hasPrecedence;
+			std::int32_t precedence;
+			Associativity associativity;
+			bool openLeft;
+			bool openRight;
+			std::int32_t maxLength;
+			//the text of a string terminal, or the sorted code point ranges of a character set
+			std::u32string text;
+			std::vector<char32_t> ranges;
+			TerminalFunction function;
+			//nullable, FIRST and FOLLOW, from SetLookahead or Compile
+			bool lookaheadSupplied;
+			bool nullable;
+			bool canPrecedeEnd;
+			CharacterClass first;
+			CharacterClass follow;
+		};
+
+		struct State {
+			std::int32_t production;
+			bool start;
+			bool accept;
+			std::int32_t firstTransition;
+			std::int32_t transitionCount;
+			std::int32_t maxRemaining;
+		};
+
+		struct PendingTransition {
+			std::int32_t from;
+			std::int32_t symbol;
+			std::int32_t to;
+		};
+
+		int AddSymbol(SymbolKind kind, std::string const &name);
+		void ThrowIfCompiled() const;
+		void ComputeLookahead(std::vector<Transition> const &transitions);
+		void ComputeMaxLengths(std::vector<Transition> const &transitions, std::vector<std::int32_t> const &startStateOffsets, std::vector<std::int32_t> const &startStates);
+		void WriteImage(std::vector<Transition> const &transitions, std::vector<std::int32_t> const &startStateOffsets, std::vector<std::int32_t> const &startStates);
+		//points the accessors at image, after checking its header and that every section lies within it
+		void SetImage(void const *image, std::size_t size);
+		bool HighContains(ClassRecord const &record, char32_t c) const;
+
+		//what's added before Compile, released once the image is written
+		std::vector<Symbol> symbols;
+		std::vector<State> states;
+		std::vector<PendingTransition> pending;
+		std::vector<SyncPoint> syncPoints;
+		int main;
+		bool compiled;
+
+		//the image Compile wrote, unless one was attached
+		std::vector<std::uint64_t> ownImage;
+		ImageHeader const *header;
+		SymbolRecord const *symbolRecords;
+		StateRecord const *stateRecords;
+		Transition const *transitionRecords;
+		//CSR, indexed by symbol; empty for terminals
+		std::int32_t const *startStateOffsets;
+		std::int32_t const *startStates;
+		ClassRecord const *classRecords;
+		SyncPoint const *syncPointRecords;
+		char32_t const *codePoints;
+		char const *names;
+		//function pointers only mean something in one process, so they're kept beside the image
+		std::vector<TerminalFunction> functions;
+	};
+}
+
+#endif
\ No newline at end of file
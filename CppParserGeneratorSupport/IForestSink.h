@@ -0,0 +1,17 @@
+#ifndef _I_FOREST_SINK_H_
+#define _I_FOREST_SINK_H_
+
+#include "ParseForest.h"
+#include "Span.h"
+
+namespace Parlex {
+	//where a streaming parse hands the subtrees it is done with
+	class IForestSink {
+	public:
+		virtual ~IForestSink() {}
+		//subtrees are the main production's next children, in text order; forest is only valid during the call
+		virtual void Emit(ParseForest const &forest, Span<NodeId> subtrees) = 0;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef _I_FOREST_VISITOR_H_
+#define _I_FOREST_VISITOR_H_
+
+#include "ParseForest.h"
+
+namespace Parlex {
+	//what VisitParallel calls for each node, from several threads at once
+	class IForestVisitor {
+	public:
+		virtual ~IForestVisitor() {}
+		//every node below node has been visited, and what those visits wrote is visible
+		virtual void Visit(ParseForest const &forest, NodeId node) = 0;
+	};
+}
+
+#endif
\ No newline at end of file
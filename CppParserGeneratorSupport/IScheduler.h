@@ -0,0 +1,26 @@
+#ifndef _I_SCHEDULER_H_
+#define _I_SCHEDULER_H_
+
+#include <cstdint>
+
+namespace Parlex {
+	//a unit of parse work; plain data, so queuing one never allocates
+	struct WorkItem {
+		void (*function)(void *context, std::int32_t a, std::int32_t b);
+		void *context;
+		std::int32_t a;
+		std::int32_t b;
+	};
+
+	class IScheduler {
+	public:
+		virtual ~IScheduler() {}
+		//may be called from any thread, including from inside a work item
+		virtual void Post(WorkItem const &item) = 0;
+		//block until every posted item, and every item those posted, has run
+		virtual void Join() = 0;
+		virtual int GetThreadCount() const = 0;
+	};
+}
+
+#endif
\ No newline at end of file
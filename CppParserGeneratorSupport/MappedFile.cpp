@@ -0,0 +1,79 @@
+#include "MappedFile.h"
+#include <stdexcept>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Parlex {
+#ifdef _WIN32
+	MappedFile::MappedFile(std::string const &path) : data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("couldn't open " + path);
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) {
+			CloseHandle(file);
+			throw std::runtime_error("couldn't find the size of " + path);
+		}
+		size = static_cast<std::size_t>(fileSize.QuadPart);
+		//an empty file can't be mapped, and has nothing to map anyway
+		if (size == 0) return;
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr) {
+			if (mapping != nullptr) CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("couldn't map " + path);
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		if (data != nullptr) UnmapViewOfFile(data);
+		if (mapping != nullptr) CloseHandle(mapping);
+		CloseHandle(file);
+	}
+#else
+	MappedFile::MappedFile(std::string const &path) : data(nullptr), size(0) {
+		int descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			throw std::runtime_error("couldn't open " + path);
+		}
+		struct stat status;
+		if (fstat(descriptor, &status) != 0) {
+			close(descriptor);
+			throw std::runtime_error("couldn't find the size of " + path);
+		}
+		size = static_cast<std::size_t>(status.st_size);
+		if (size != 0) {
+			void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+			if (mapped == MAP_FAILED) {
+				close(descriptor);
+				throw std::runtime_error("couldn't map " + path);
+			}
+			data = mapped;
+		}
+		//the mapping holds its own reference to the file
+		close(descriptor);
+	}
+
+	MappedFile::~MappedFile() {
+		if (data != nullptr) munmap(const_cast<void *>(data), size);
+	}
+#endif
+
+	void const *MappedFile::GetData() const {
+		return data;
+	}
+
+	std::size_t MappedFile::GetSize() const {
+		return size;
+	}
+}
\ No newline at end of file
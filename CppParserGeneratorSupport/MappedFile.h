@@ -0,0 +1,34 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+namespace Parlex {
+	/// <summary>
+	/// A whole file mapped read only into memory. A saved Grammar image
+	/// can be attached straight from it, and every process that maps the
+	/// same file shares one copy of its pages.
+	/// </summary>
+	class MappedFile {
+		MappedFile(MappedFile const &other) = delete;
+		MappedFile &operator=(MappedFile const &other) = delete;
+	public:
+		//throws std::runtime_error if the file can't be opened or mapped
+		explicit MappedFile(std::string const &path);
+		~MappedFile();
+
+		//page aligned, or null for an empty file
+		void const *GetData() const;
+		std::size_t GetSize() const;
+	private:
+		void const *data;
+		std::size_t size;
+#ifdef _WIN32
+		void *file;
+		void *mapping;
+#endif
+	};
+}
+
+#endif
\ No newline at end of file
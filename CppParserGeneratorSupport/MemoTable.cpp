@@ -0,0 +1,83 @@
+#include "MemoTable.h"
+
+namespace Parlex {
+	MemoTable::MemoTable(std::size_t initialCapacity) : count(0) {
+		//a power of two, and at least one full probe run
+		this->initialCapacity = MaxProbes;
+		while (this->initialCapacity < initialCapacity) this->initialCapacity <<= 1;
+		for (auto &level : levels) level.store(nullptr, std::memory_order_relaxed);
+	}
+
+	MemoTable::~MemoTable() {
+		for (auto &level : levels) {
+			Level *table = level.exchange(nullptr);
+			if (table) {
+				delete[] table->slots;
+				delete table;
+			}
+		}
+	}
+
+	MemoTable::Level &MemoTable::GetLevel(int level) {
+		Level *table = levels[level].load(std::memory_order_acquire);
+		if (table) return *table;
+		std::size_t capacity = initialCapacity << level;
+		Level *fresh = new Level;
+		fresh->slots = new Slot[capacity];
+		fresh->mask = capacity - 1;
+		for (std::size_t i = 0; i < capacity; ++i) {
+			fresh->slots[i].key.store(EmptyKey, std::memory_order_relaxed);
+			fresh->slots[i].value.store(Absent, std::memory_order_relaxed);
+		}
+		if (!levels[level].compare_exchange_strong(table, fresh, std::memory_order_acq_rel)) {
+			delete[] fresh->slots;
+			delete fresh;
+			return *table;
+		}
+		return *fresh;
+	}
+
+	std::int32_t MemoTable::Find(std::uint64_t key) const {
+		for (int level = 0; level < MaxLevels; ++level) {
+			Level *table = levels[level].load(std::memory_order_acquire);
+			if (!table) return Absent;
+			std::size_t index = Hash(key);
+			for (int probe = 0; probe < MaxProbes; ++probe, ++index) {
+				Slot &slot = table->slots[index & table->mask];
+				std::uint64_t found = slot.key.load(std::memory_order_acquire);
+				//keys only go on to the next level once this run is full
+				if (found == EmptyKey) return Absent;
+				if (found == key) return AwaitValue(slot);
+			}
+		}
+		return Absent;
+	}
+
+	std::size_t MemoTable::GetCount() const {
+		return count.load(std::memory_order_relaxed);
+	}
+
+	std::size_t MemoTable::GetCapacity() const {
+		std::size_t total = 0;
+		for (int level = 0; level < MaxLevels; ++level) {
+			if (levels[level].load(std::memory_order_relaxed)) total += initialCapacity << level;
+		}
+		return total;
+	}
+
+	std::size_t MemoTable::GetMemoryUsage() const {
+		return GetCapacity() * sizeof(Slot);
+	}
+
+	void MemoTable::Clear() {
+		for (int level = 0; level < MaxLevels; ++level) {
+			Level *table = levels[level].load(std::memory_order_relaxed);
+			if (!table) break;
+			for (std::size_t i = 0; i <= table->mask; ++i) {
+				table->slots[i].key.store(EmptyKey, std::memory_order_relaxed);
+				table->slots[i].value.store(Absent, std::memory_order_relaxed);
+			}
+		}
+		count.store(0);
+	}
+}
\ No newline at end of file
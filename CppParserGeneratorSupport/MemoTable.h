@@ -0,0 +1,113 @@
+#ifndef _MEMO_TABLE_H_
+#define _MEMO_TABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+namespace Parlex {
+	/// <summary>
+	/// A lock-free open addressing map from 64 bit keys to int values, used
+	/// to find the Dispatcher for a (position, symbol) pair. Keys are only
+	/// ever added. Each key probes a bounded run of slots; when that run is
+	/// full the key goes on to the next level, which is twice the size, so
+	/// the table grows without ever moving an entry.
+	/// </summary>
+	class MemoTable {
+		MemoTable(MemoTable const &other) = delete;
+		MemoTable &operator=(MemoTable const &other) = delete;
+		static int const MaxLevels = 24;
+		static int const MaxProbes = 32;
+	public:
+		static std::uint64_t const EmptyKey = ~std::uint64_t(0);
+		static std::int32_t const Absent = -1;
+
+		MemoTable(std::size_t initialCapacity = 1 << 16);
+		~MemoTable();
+
+		static std::uint64_t PackKey(std::int32_t position, std::int32_t symbol) {
+			return (std::uint64_t(std::uint32_t(position)) << 32) | std::uint32_t(symbol);
+		}
+
+		static std::int32_t GetPosition(std::uint64_t key) {
+			return std::int32_t(key >> 32);
+		}
+
+		static std::int32_t GetSymbol(std::uint64_t key) {
+			return std::int32_t(key & 0xFFFFFFFF);
+		}
+
+		/// <summary>
+		/// Return the value for key. If there is none, exactly one of the
+		/// threads asking calls create, and the others wait for its result.
+		/// </summary>
+		template<typename F>
+		std::int32_t GetOrAdd(std::uint64_t key, F create, bool *added = nullptr) {
+			if (added) *added = false;
+			for (int level = 0; level < MaxLevels; ++level) {
+				Level &table = GetLevel(level);
+				std::size_t index = Hash(key);
+				for (int probe = 0; probe < MaxProbes; ++probe, ++index) {
+					Slot &slot = table.slots[index & table.mask];
+					std::uint64_t found = slot.key.load(std::memory_order_acquire);
+					if (found == EmptyKey && slot.key.compare_exchange_strong(found, key, std::memory_order_acq_rel)) {
+						std::int32_t value = create();
+						slot.value.store(value, std::memory_order_release);
+						count.fetch_add(1, std::memory_order_relaxed);
+						if (added) *added = true;
+						return value;
+					}
+					if (found == key) {
+						return AwaitValue(slot);
+					}
+				}
+			}
+			throw std::length_error("MemoTable is full");
+		}
+
+		//returns Absent if key hasn't been added
+		std::int32_t Find(std::uint64_t key) const;
+		std::size_t GetCount() const;
+		std::size_t GetCapacity() const;
+		std::size_t GetMemoryUsage() const;
+		//not thread safe
+		void Clear();
+	private:
+		struct Slot {
+			std::atomic<std::uint64_t> key;
+			std::atomic<std::int32_t> value;
+		};
+
+		struct Level {
+			Slot *slots;
+			std::size_t mask;
+		};
+
+		static std::size_t Hash(std::uint64_t key) {
+			key ^= key >> 33;
+			key *= 0xff51afd7ed558ccdull;
+			key ^= key >> 33;
+			key *= 0xc4ceb9fe1a85ec53ull;
+			key ^= key >> 33;
+			return static_cast<std::size_t>(key);
+		}
+
+		static std::int32_t AwaitValue(Slot &slot) {
+			std::int32_t value;
+			while ((value = slot.value.load(std::memory_order_acquire)) == Absent) {
+				std::this_thread::yield();
+			}
+			return value;
+		}
+
+		Level &GetLevel(int level);
+
+		std::size_t initialCapacity;
+		std::atomic<Level *> levels[MaxLevels];
+		std::atomic<std::size_t> count;
+	};
+}
+
+#endif
\ No newline at end of file
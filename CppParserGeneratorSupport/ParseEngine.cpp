@@ -0,0 +1,1366 @@
+#include "ParseEngine.h"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+namespace Parlex {
+	ParseEngine::ParseEngine(Grammar const &grammar, IScheduler &scheduler, ExecutionMode mode, LookaheadMode lookahead) :
+		grammar(grammar), scheduler(scheduler), mode(mode), lookahead(lookahead), terminalScan(nullptr), speculationChunkSize(0), text(nullptr), root(NoLink), forcedCompletionCount(0), prunedCount(0), filteredCount(0), cancelledCount(0), mergedCount(0),
+		previous(nullptr), reusedCount(0), windowStart(0), lowestDirty(0), liveEpoch(0), peakColumnCount(0),
+		sink(nullptr), compactAt(MinCompaction), emittedCount(0), compactionCount(0)
+	{
+		if (!grammar.GetIsCompiled()) {
+			throw std::logic_error("the Grammar must be compiled before it is used to parse");
+		}
+		//an unbound function would otherwise only be found matching it, inside a work item
+		for (int symbol = 0; symbol < grammar.GetSymbolCount(); ++symbol) {
+			if (!grammar.GetIsBound(symbol)) {
+				throw std::logic_error("the function terminal " + grammar.GetName(symbol) + " must be bound before the Grammar is used to parse");
+			}
+		}
+		if (lookahead == LookaheadMode::FirstAndFollow && grammar.GetHasGreedy()) {
+			this->lookahead = LookaheadMode::First;
+		}
+	}
+
+	void ParseEngine::Reset() {
+		dispatcherTable.Clear();
+		matchClassTable.Clear();
+		dispatchers.Release();
+		matchClasses.Release();
+		derivations.Release();
+		chainLinks.Release();
+		dependencies.Release();
+		itemTable.Clear();
+		items.Release();
+		forcedCompletionCount = 0;
+		prunedCount.store(0, std::memory_order_relaxed);
+		filteredCount.store(0, std::memory_order_relaxed);
+		cancelledCount.store(0, std::memory_order_relaxed);
+		mergedCount.store(0, std::memory_order_relaxed);
+		reusedCount.store(0, std::memory_order_relaxed);
+		RecycleColumnsBefore(windowStart + static_cast<std::int32_t>(window.size()));
+		windowStart = 0;
+		lowestDirty = 0;
+		openDispatchers.clear();
+		peakColumnCount = 0;
+		compactAt = MinCompaction;
+		emittedCount = 0;
+		compactionCount = 0;
+		emitted.Clear();
+	}
+
+	void ParseEngine::SetTerminalScan(TerminalScan const *scan) {
+		terminalScan = scan;
+	}
+
+	void ParseEngine::SetSpeculation(std::size_t chunkSize) {
+		if (chunkSize != 0 && mode != ExecutionMode::Dispatch) {
+			throw std::logic_error("only ExecutionMode::Dispatch can speculate");
+		}
+		speculationChunkSize = chunkSize;
+	}
+
+	void ParseEngine::SetStreaming(IForestSink *sink) {
+		if (sink != nullptr && mode != ExecutionMode::Wavefront) {
+			throw std::logic_error("only ExecutionMode::Wavefront can stream");
+		}
+		this->sink = sink;
+	}
+
+	void ParseEngine::Parse(Text const &text) {
+		previous = nullptr;
+		edits.clear();
+		editStarts.clear();
+		editShifts.clear();
+		ParseText(text);
+	}
+
+	void ParseEngine::Reparse(Text const &text, ParseSnapshot const &previous, std::vector<TextEdit> const &edits) {
+		if (mode != ExecutionMode::Dispatch) {
+			throw std::logic_error("only ExecutionMode::Dispatch can reparse");
+		}
+		if (previous.GetGrammar() != &grammar) {
+			throw std::invalid_argument("the snapshot was taken with a different grammar");
+		}
+		this->edits = edits;
+		editStarts.clear();
+		editShifts.clear();
+		std::int64_t shift = 0;
+		std::int64_t end = 0;
+		for (TextEdit const &edit : edits) {
+			if (edit.position < end || edit.removed < 0 || edit.inserted < 0 || edit.position + std::int64_t(edit.removed) > std::int64_t(previous.GetTextSize())) {
+				throw std::invalid_argument("the edits must be in order, not overlap, and lie within the old text");
+			}
+			end = edit.position + std::int64_t(edit.removed);
+			editStarts.push_back(static_cast<std::int32_t>(edit.position + shift));
+			shift += std::int64_t(edit.inserted) - edit.removed;
+			editShifts.push_back(static_cast<std::int32_t>(shift));
+		}
+		if (std::int64_t(previous.GetTextSize()) + shift != std::int64_t(text.size())) {
+			throw std::invalid_argument("the edits don't turn the old text's length into the new one's");
+		}
+		this->previous = &previous;
+		ParseText(text);
+	}
+
+	std::int32_t ParseEngine::OldPosition(std::int32_t position) const {
+		//the last edit whose inserted text starts at or before position
+		auto i = std::upper_bound(editStarts.begin(), editStarts.end(), position);
+		if (i == editStarts.begin()) return position;
+		std::size_t edit = i - editStarts.begin() - 1;
+		if (position < editStarts[edit] + edits[edit].inserted) return -1;
+		return position - editShifts[edit];
+	}
+
+	std::int32_t ParseEngine::NewPosition(std::int32_t oldPosition) const {
+		//moved by every edit that ends at or before it
+		auto i = std::upper_bound(edits.begin(), edits.end(), oldPosition, [](std::int32_t position, TextEdit const &edit) {
+			return position < edit.position + edit.removed;
+		});
+		if (i == edits.begin()) return oldPosition;
+		return oldPosition + editShifts[i - edits.begin() - 1];
+	}
+
+	bool ParseEngine::GetIsClean(std::int32_t oldPosition, std::int32_t extent) const {
+		//the first edit that ends after oldPosition has to start at or after extent
+		auto after = std::upper_bound(edits.begin(), edits.end(), oldPosition, [](std::int32_t position, TextEdit const &edit) {
+			return position < edit.position + edit.removed;
+		});
+		return after == edits.end() || after->position >= extent;
+	}
+
+	bool ParseEngine::Reuse(std::int32_t dispatcher) {
+		Dispatcher &record = dispatchers[dispatcher];
+		std::int32_t oldPosition = OldPosition(record.position);
+		if (oldPosition < 0) return false;
+		std::int32_t entry = previous->Find(oldPosition, record.symbol);
+		if (entry == ParseSnapshot::Absent) return false;
+		std::int32_t extent = previous->GetEntry(entry).extent;
+		if (!GetIsClean(oldPosition, extent)) return false;
+
+		for (std::int32_t match : previous->GetEntryMatches(entry)) {
+			std::int32_t matchClass = matchClasses.Allocate();
+			MatchClass &created = matchClasses[matchClass];
+			created.dispatcher = dispatcher;
+			created.length = previous->GetMatch(match).length;
+			created.next = record.firstMatchClass;
+			created.firstDerivation = NoLink;
+			created.linked = true;
+			created.published = true;
+			created.reusedMatch = match;
+			record.firstMatchClass = matchClass;
+			record.longest = std::max(record.longest, created.length);
+		}
+		//everything it read is on one side of every edit, so it all moved the same way
+		record.reusedExtent = extent + record.position - oldPosition;
+		record.completed = true;
+		record.pending.store(0, std::memory_order_relaxed);
+		reusedCount.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void ParseEngine::ParseText(Text const &text) {
+		if (grammar.GetMain() < 0) {
+			throw std::logic_error("the Grammar has no main production");
+		}
+		if (terminalScan != nullptr && terminalScan->GetTextSize() != text.size()) {
+			throw std::logic_error("the TerminalScan is of a different text");
+		}
+		Reset();
+		this->text = &text;
+		if (mode == ExecutionMode::Wavefront) {
+			ParseWavefront();
+			return;
+		}
+		root = GetDispatcher(0, grammar.GetMain());
+		if (speculationChunkSize != 0 && text.size() > speculationChunkSize && !grammar.GetSyncPoints().empty()) {
+			for (std::size_t first = 0; first < text.size(); first += speculationChunkSize) {
+				Post(SpeculateItem, static_cast<std::int32_t>(first), static_cast<std::int32_t>(std::min(first + speculationChunkSize, text.size())));
+			}
+		}
+		for (;;) {
+			scheduler.Join();
+			//like the managed DeadLockBreaker: once no work is left, whatever hasn't
+			//completed is waiting on a cycle of dispatchers that can find nothing more
+			std::size_t forced = 0;
+			std::int32_t count = static_cast<std::int32_t>(dispatchers.GetCount());
+			for (std::int32_t i = 0; i < count; ++i) {
+				if (!dispatchers[i].completed) {
+					Post(CompleteItem, i, 0);
+					forced++;
+				}
+			}
+			if (forced == 0) break;
+			forcedCompletionCount += forced;
+		}
+	}
+
+	void ParseEngine::Post(void (*function)(void *, std::int32_t, std::int32_t), std::int32_t a, std::int32_t b) {
+		WorkItem item = { function, this, a, b };
+		scheduler.Post(item);
+	}
+
+	void ParseEngine::StartItem(void *context, std::int32_t dispatcher, std::int32_t) {
+		static_cast<ParseEngine *>(context)->Start(dispatcher);
+	}
+
+	void ParseEngine::ResumeItem(void *context, std::int32_t dependency, std::int32_t matchClass) {
+		static_cast<ParseEngine *>(context)->Resume(dependency, matchClass);
+	}
+
+	void ParseEngine::CompleteItem(void *context, std::int32_t dispatcher, std::int32_t) {
+		static_cast<ParseEngine *>(context)->Complete(dispatcher);
+	}
+
+	void ParseEngine::SpeculateItem(void *context, std::int32_t first, std::int32_t last) {
+		static_cast<ParseEngine *>(context)->Speculate(first, last);
+	}
+
+	void ParseEngine::Speculate(std::int32_t first, std::int32_t last) {
+		Span<Grammar::SyncPoint> syncPoints = grammar.GetSyncPoints();
+		for (std::int32_t position = first; position < last; ++position) {
+			for (Grammar::SyncPoint const &syncPoint : syncPoints) {
+				int length;
+				if (!MatchTerminal(syncPoint.separator, position, length)) continue;
+				//a separator straddling the chunk's end is this chunk's, so none is missed or seen twice
+				if (PassesLookahead(position + length, syncPoint.symbol)) {
+					GetDispatcher(position + length, syncPoint.symbol, true);
+				}
+			}
+		}
+	}
+
+	std::int32_t ParseEngine::GetDispatcher(std::int32_t position, std::int32_t symbol, bool speculative) {
+		return dispatcherTable.GetOrAdd(MemoTable::PackKey(position, symbol), [&] {
+			std::int32_t result = dispatchers.Allocate();
+			Dispatcher &dispatcher = dispatchers[result];
+			dispatcher.position = position;
+			dispatcher.symbol = symbol;
+			dispatcher.firstMatchClass = NoLink;
+			dispatcher.firstDependency = NoLink;
+			dispatcher.firstOwned = NoLink;
+			dispatcher.pending.store(1, std::memory_order_relaxed);
+			dispatcher.longest = -1;
+			dispatcher.completed = false;
+			dispatcher.reusedExtent = -1;
+			dispatcher.speculative = speculative;
+			if (previous != nullptr && Reuse(result)) return result;
+			Post(StartItem, result, 0);
+			return result;
+		});
+	}
+
+	bool ParseEngine::PassesLookahead(std::int32_t position, std::int32_t symbol) {
+		if (lookahead == LookaheadMode::None) return true;
+		int length;
+		//the scan knows exactly whether a terminal matches, so it never needs a dispatcher to find out
+		bool passes = terminalScan != nullptr && grammar.GetIsTerminal(symbol) ?
+			terminalScan->Match(symbol, position, length) :
+			grammar.MayMatchAt(symbol, *text, position, lookahead == LookaheadMode::FirstAndFollow);
+		if (!passes) prunedCount.fetch_add(1, std::memory_order_relaxed);
+		return passes;
+	}
+
+	bool ParseEngine::MatchTerminal(std::int32_t symbol, std::int32_t position, int &length) const {
+		if (terminalScan != nullptr) return terminalScan->Match(symbol, position, length);
+		return grammar.MatchTerminal(symbol, *text, position, length);
+	}
+
+	bool ParseEngine::PassesPrecedence(std::int32_t symbol, std::int32_t chain) {
+		if (!grammar.GetHasPrecedence(symbol) || chain == NoLink || chainLinks[chain].previous == NoLink) return true;
+		std::int32_t first = chain;
+		while (chainLinks[first].previous != NoLink) {
+			first = chainLinks[first].previous;
+		}
+		std::int32_t firstSymbol = dispatchers[matchClasses[chainLinks[first].matchClass].dispatcher].symbol;
+		std::int32_t lastSymbol = dispatchers[matchClasses[chainLinks[chain].matchClass].dispatcher].symbol;
+		if (grammar.GetAllowsChildren(symbol, firstSymbol, lastSymbol)) return true;
+		filteredCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	void ParseEngine::Start(std::int32_t dispatcher) {
+		Dispatcher &record = dispatchers[dispatcher];
+		if (grammar.GetIsTerminal(record.symbol)) {
+			int length;
+			if (MatchTerminal(record.symbol, record.position, length)) {
+				AddResult(dispatcher, length, NoLink);
+			}
+		} else {
+			//every start item is there before anything can come back to one
+			std::int32_t first = NoLink;
+			for (std::int32_t state : grammar.GetStartStates(record.symbol)) {
+				first = AddDispatchItem(state, NoLink, first);
+			}
+			if (first != NoLink) {
+				itemTable.GetOrAdd(MemoTable::PackKey(record.position, dispatcher), [&] { return first; });
+			}
+			for (std::int32_t state : grammar.GetStartStates(record.symbol)) {
+				EnterState(dispatcher, state, record.position, NoLink);
+			}
+		}
+		Release(dispatcher);
+	}
+
+	void ParseEngine::EnterState(std::int32_t dispatcher, std::int32_t state, std::int32_t position, std::int32_t chain) {
+		if (grammar.GetIsAccept(state)) {
+			AddResult(dispatcher, position - dispatchers[dispatcher].position, chain);
+		}
+		for (Grammar::Transition const &transition : grammar.GetTransitions(state)) {
+			Subscribe(dispatcher, transition.target, position, chain, transition.symbol);
+		}
+	}
+
+	void ParseEngine::Subscribe(std::int32_t owner, std::int32_t state, std::int32_t position, std::int32_t chain, std::int32_t symbol) {
+		//checked before the dispatcher table, so a symbol that can't match here costs no lookup
+		if (!PassesLookahead(position, symbol)) return;
+		Dispatcher &ownerRecord = dispatchers[owner];
+		//a greedy dispatcher races its alternatives, and drops any that can't beat its longest match
+		std::int32_t reach = Grammar::Unbounded;
+		if (grammar.GetIsGreedy(ownerRecord.symbol)) {
+			reach = Grammar::AddLengths(Grammar::AddLengths(position - ownerRecord.position, grammar.GetMaxLength(symbol)), grammar.GetMaxRemaining(state));
+		}
+		std::int32_t dependency = dependencies.Allocate();
+		Dependency &record = dependencies[dependency];
+		record.owner = owner;
+		record.state = state;
+		record.chain = chain;
+		record.nextOwned = NoLink;
+		record.reach = reach;
+		record.cancelled.store(false, std::memory_order_relaxed);
+		record.released.store(false, std::memory_order_relaxed);
+		//the hold is taken before a cancellation can see the dependency
+		ownerRecord.pending.fetch_add(1, std::memory_order_relaxed);
+		if (reach != Grammar::Unbounded) {
+			std::lock_guard<SpinLock> guard(ownerRecord.lock);
+			if (reach < ownerRecord.longest) {
+				//never subscribed, so the record is left unused
+				ownerRecord.pending.fetch_sub(1, std::memory_order_relaxed);
+				cancelledCount.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			record.nextOwned = ownerRecord.firstOwned;
+			ownerRecord.firstOwned = dependency;
+		}
+		std::int32_t child = GetDispatcher(position, symbol);
+		Dispatcher &childRecord = dispatchers[child];
+		std::lock_guard<SpinLock> guard(childRecord.lock);
+		record.next = childRecord.firstDependency;
+		childRecord.firstDependency = dependency;
+		for (std::int32_t i = childRecord.firstMatchClass; i != NoLink; i = matchClasses[i].next) {
+			if (matchClasses[i].published && !record.cancelled.load(std::memory_order_relaxed)) {
+				ownerRecord.pending.fetch_add(1, std::memory_order_relaxed);
+				Post(ResumeItem, dependency, i);
+			}
+		}
+		if (childRecord.completed && !record.released.exchange(true)) {
+			Release(owner);
+		}
+	}
+
+	void ParseEngine::AddResult(std::int32_t dispatcher, std::int32_t length, std::int32_t chain) {
+		//dropped before it has a match class, so ambiguity the precedences resolve is never stored
+		if (!PassesPrecedence(dispatchers[dispatcher].symbol, chain)) return;
+		std::int32_t matchClass = matchClassTable.GetOrAdd(MemoTable::PackKey(dispatcher, length), [&] {
+			std::int32_t result = matchClasses.Allocate();
+			MatchClass &record = matchClasses[result];
+			record.dispatcher = dispatcher;
+			record.length = length;
+			record.firstDerivation = NoLink;
+			record.linked = false;
+			record.published = false;
+			record.reusedMatch = ParseSnapshot::Absent;
+			return result;
+		});
+		std::int32_t derivation = derivations.Allocate();
+		derivations[derivation].chain = chain;
+		Dispatcher &record = dispatchers[dispatcher];
+		MatchClass &matchClassRecord = matchClasses[matchClass];
+		std::lock_guard<SpinLock> guard(record.lock);
+		derivations[derivation].next = matchClassRecord.firstDerivation;
+		matchClassRecord.firstDerivation = derivation;
+		if (!matchClassRecord.linked) {
+			matchClassRecord.linked = true;
+			matchClassRecord.next = record.firstMatchClass;
+			record.firstMatchClass = matchClass;
+			if (length > record.longest) {
+				record.longest = length;
+				if (record.firstOwned != NoLink) CancelBeaten(record);
+			}
+		}
+		if (!matchClassRecord.published && (record.completed || !grammar.GetIsGreedy(record.symbol))) {
+			Publish(record, matchClass);
+		}
+	}
+
+	void ParseEngine::CancelBeaten(Dispatcher &dispatcher) {
+		//what's cancelled leaves the list, so each dependency is looked at until it goes
+		std::int32_t *link = &dispatcher.firstOwned;
+		while (*link != NoLink) {
+			Dependency &record = dependencies[*link];
+			if (record.reach >= dispatcher.longest) {
+				link = &record.nextOwned;
+				continue;
+			}
+			*link = record.nextOwned;
+			record.cancelled.store(true, std::memory_order_release);
+			cancelledCount.fetch_add(1, std::memory_order_relaxed);
+			//the caller's own count keeps this from completing the dispatcher under its lock
+			if (!record.released.exchange(true)) Release(record.owner);
+		}
+	}
+
+	void ParseEngine::Publish(Dispatcher &dispatcher, std::int32_t matchClass) {
+		matchClasses[matchClass].published = true;
+		for (std::int32_t i = dispatcher.firstDependency; i != NoLink; i = dependencies[i].next) {
+			if (dependencies[i].cancelled.load(std::memory_order_relaxed)) continue;
+			dispatchers[dependencies[i].owner].pending.fetch_add(1, std::memory_order_relaxed);
+			Post(ResumeItem, i, matchClass);
+		}
+	}
+
+	void ParseEngine::Resume(std::int32_t dependency, std::int32_t matchClass) {
+		Dependency const &record = dependencies[dependency];
+		if (record.cancelled.load(std::memory_order_acquire)) {
+			Release(record.owner);
+			return;
+		}
+		MatchClass const &matchClassRecord = matchClasses[matchClass];
+		std::int32_t position = dispatchers[matchClassRecord.dispatcher].position + matchClassRecord.length;
+		std::int32_t link = JoinItem(record.owner, record.state, position, record.chain, matchClass);
+		if (link != NoLink) EnterState(record.owner, record.state, position, link);
+		Release(record.owner);
+	}
+
+	std::int32_t ParseEngine::AddLink(std::int32_t previous, std::int32_t matchClass) {
+		std::int32_t link = chainLinks.Allocate();
+		chainLinks[link].previous = previous;
+		chainLinks[link].matchClass = matchClass;
+		chainLinks[link].alternative = NoLink;
+		return link;
+	}
+
+	std::int32_t ParseEngine::AddDispatchItem(std::int32_t state, std::int32_t chain, std::int32_t next) {
+		std::int32_t item = items.Allocate();
+		items[item].state = state;
+		items[item].chain = chain;
+		items[item].next = next;
+		return item;
+	}
+
+	std::int32_t ParseEngine::JoinItem(std::int32_t owner, std::int32_t state, std::int32_t position, std::int32_t previous, std::int32_t matchClass) {
+		std::int32_t link = NoLink;
+		bool added;
+		std::int32_t first = itemTable.GetOrAdd(MemoTable::PackKey(position, owner), [&] {
+			link = AddLink(previous, matchClass);
+			return AddDispatchItem(state, link, NoLink);
+		}, &added);
+		if (added) return link;
+		Dispatcher &ownerRecord = dispatchers[owner];
+		std::lock_guard<SpinLock> guard(ownerRecord.lock);
+		for (std::int32_t item = first; item != NoLink; item = items[item].next) {
+			if (items[item].state == state && GetIsMergeable(ownerRecord.symbol, items[item].chain, previous, matchClass)) {
+				Merge(items[item].chain, previous, matchClass);
+				return NoLink;
+			}
+		}
+		//after the first, so the list can grow without the table's value changing
+		link = AddLink(previous, matchClass);
+		items[first].next = AddDispatchItem(state, link, items[first].next);
+		return link;
+	}
+
+	bool ParseEngine::GetIsMergeable(std::int32_t symbol, std::int32_t canonical, std::int32_t previous, std::int32_t matchClass) const {
+		if (!grammar.GetHasPrecedence(symbol) || canonical == NoLink) return true;
+		//every path packed into a link has the same first child, so the canonical path stands for them
+		auto firstOf = [this](std::int32_t link) {
+			while (chainLinks[link].previous != NoLink) {
+				link = chainLinks[link].previous;
+			}
+			return chainLinks[link].matchClass;
+		};
+		auto symbolOf = [this](std::int32_t matchClass) {
+			return dispatchers[matchClasses[matchClass].dispatcher].symbol;
+		};
+		return symbolOf(chainLinks[canonical].matchClass) == symbolOf(matchClass) &&
+			symbolOf(firstOf(canonical)) == symbolOf(previous == NoLink ? matchClass : firstOf(previous));
+	}
+
+	void ParseEngine::Merge(std::int32_t canonical, std::int32_t previous, std::int32_t matchClass) {
+		mergedCount.fetch_add(1, std::memory_order_relaxed);
+		//a path back to a start item, or straight back to the item it left, went round matching nothing
+		if (canonical == NoLink || previous == canonical) return;
+		std::int32_t link = AddLink(previous, matchClass);
+		chainLinks[link].alternative = chainLinks[canonical].alternative;
+		chainLinks[canonical].alternative = link;
+	}
+
+	template<typename Visit>
+	void ParseEngine::ForEachPath(std::int32_t chain, PathWalk &walk, Visit visit) const {
+		walk.children.clear();
+		if (chain == NoLink) {
+			visit(walk.children);
+			return;
+		}
+		//a depth first walk back from the last child, where links holds the
+		//alternative taken at each canonical link on the path so far
+		walk.onPath.resize(chainLinks.GetCount(), false);
+		walk.links.clear();
+		walk.canonicals.clear();
+		auto enter = [&](std::int32_t link) {
+			walk.onPath[link] = true;
+			walk.canonicals.push_back(link);
+			walk.links.push_back(link);
+		};
+		enter(chain);
+		while (!walk.links.empty()) {
+			std::int32_t previous = chainLinks[walk.links.back()].previous;
+			if (previous != NoLink && !walk.onPath[previous]) {
+				enter(previous);
+				continue;
+			}
+			if (previous == NoLink) {
+				walk.children.clear();
+				for (auto i = walk.links.rbegin(); i != walk.links.rend(); ++i) {
+					walk.children.push_back(chainLinks[*i].matchClass);
+				}
+				visit(walk.children);
+			}
+			//on to the next alternative, backing out of links that have run out
+			while (!walk.links.empty()) {
+				std::int32_t next = chainLinks[walk.links.back()].alternative;
+				if (next != NoLink) {
+					walk.links.back() = next;
+					break;
+				}
+				walk.onPath[walk.canonicals.back()] = false;
+				walk.canonicals.pop_back();
+				walk.links.pop_back();
+			}
+		}
+	}
+
+	void ParseEngine::Release(std::int32_t dispatcher) {
+		if (dispatchers[dispatcher].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			//posted rather than called, so a long chain of completions doesn't grow the stack
+			Post(CompleteItem, dispatcher, 0);
+		}
+	}
+
+	void ParseEngine::Complete(std::int32_t dispatcher) {
+		Dispatcher &record = dispatchers[dispatcher];
+		std::int32_t firstDependency;
+		{
+			std::lock_guard<SpinLock> guard(record.lock);
+			if (record.completed) return;
+			record.completed = true;
+			if (grammar.GetIsGreedy(record.symbol)) {
+				//only the longest match survives, as in Dispatcher.NodeCompleted
+				for (std::int32_t i = record.firstMatchClass; i != NoLink; i = matchClasses[i].next) {
+					if (matchClasses[i].length == record.longest && !matchClasses[i].published) {
+						Publish(record, i);
+					}
+				}
+			}
+			firstDependency = record.firstDependency;
+		}
+		for (std::int32_t i = firstDependency; i != NoLink; i = dependencies[i].next) {
+			if (!dependencies[i].released.exchange(true)) Release(dependencies[i].owner);
+		}
+	}
+
+	std::int32_t ParseEngine::FindRootMatchClass() const {
+		if (root == NoLink) return NoLink;
+		std::int32_t length = static_cast<std::int32_t>(text->size());
+		for (std::int32_t i = dispatchers[root].firstMatchClass; i != NoLink; i = matchClasses[i].next) {
+			if (matchClasses[i].length == length && matchClasses[i].published) return i;
+		}
+		return NoLink;
+	}
+
+	std::vector<int> ParseEngine::GetRootLengths() const {
+		std::vector<int> result;
+		if (root == NoLink) return result;
+		for (std::int32_t i = dispatchers[root].firstMatchClass; i != NoLink; i = matchClasses[i].next) {
+			if (matchClasses[i].published) result.push_back(matchClasses[i].length);
+		}
+		std::sort(result.begin(), result.end());
+		return result;
+	}
+
+	bool ParseEngine::BuildForest(ParseForest &forest) const {
+		forest.Clear();
+		std::int32_t rootMatchClass = FindRootMatchClass();
+		if (rootMatchClass == NoLink) return false;
+		std::vector<NodeId> nodeOf;
+		WriteForest(forest, std::vector<std::int32_t>(1, rootMatchClass), nodeOf);
+		forest.SetRoot(nodeOf[rootMatchClass]);
+		return true;
+	}
+
+	void ParseEngine::WriteForest(ParseForest &forest, std::vector<std::int32_t> const &roots, std::vector<NodeId> &nodeOf) const {
+		//a breadth first walk from the roots, so only reachable match classes become nodes,
+		//and each node's derivations are added together, leaving the forest sealed
+		nodeOf.assign(matchClasses.GetCount(), NoNode);
+		//what a Reparse reused is copied out of the previous snapshot, moved to its new position
+		std::vector<NodeId> nodeOfOld(previous != nullptr ? previous->GetMatchCount() : 0, NoNode);
+		//match classes, and matches of the previous snapshot as ~match
+		std::vector<std::int32_t> queue;
+		std::vector<NodeId> children;
+		PathWalk walk;
+		auto visit = [&](std::int32_t matchClass) {
+			if (nodeOf[matchClass] == NoNode) {
+				MatchClass const &record = matchClasses[matchClass];
+				if (record.reusedMatch != ParseSnapshot::Absent && nodeOfOld[record.reusedMatch] != NoNode) {
+					nodeOf[matchClass] = nodeOfOld[record.reusedMatch];
+				} else {
+					Dispatcher const &owner = dispatchers[record.dispatcher];
+					nodeOf[matchClass] = forest.AddNode(owner.symbol, owner.position, record.length);
+					if (record.reusedMatch != ParseSnapshot::Absent) nodeOfOld[record.reusedMatch] = nodeOf[matchClass];
+					queue.push_back(matchClass);
+				}
+			}
+			return nodeOf[matchClass];
+		};
+		auto visitOld = [&](std::int32_t match) {
+			if (nodeOfOld[match] == NoNode) {
+				ParseSnapshot::Match const &record = previous->GetMatch(match);
+				nodeOfOld[match] = forest.AddNode(record.symbol, NewPosition(record.start), record.length);
+				queue.push_back(~match);
+			}
+			return nodeOfOld[match];
+		};
+		auto copyDerivations = [&](NodeId node, std::int32_t match) {
+			for (std::int32_t chain : previous->GetDerivations(match)) {
+				children.clear();
+				for (std::int32_t link = chain; link != ParseSnapshot::NoLink; link = previous->GetChainLink(link).previous) {
+					children.push_back(previous->GetChainLink(link).match);
+				}
+				std::reverse(children.begin(), children.end());
+				for (NodeId &child : children) {
+					child = visitOld(child);
+				}
+				forest.AddDerivation(node, children.data(), static_cast<int>(children.size()));
+			}
+		};
+		for (std::int32_t root : roots) {
+			visit(root);
+		}
+		for (std::size_t next = 0; next < queue.size(); ++next) {
+			if (queue[next] < 0) {
+				std::int32_t match = ~queue[next];
+				copyDerivations(nodeOfOld[match], match);
+				continue;
+			}
+			std::int32_t matchClass = queue[next];
+			NodeId node = nodeOf[matchClass];
+			if (matchClasses[matchClass].reusedMatch != ParseSnapshot::Absent) {
+				copyDerivations(node, matchClasses[matchClass].reusedMatch);
+				continue;
+			}
+			if (grammar.GetIsTerminal(dispatchers[matchClasses[matchClass].dispatcher].symbol)) continue;
+			for (std::int32_t derivation = matchClasses[matchClass].firstDerivation; derivation != NoLink; derivation = derivations[derivation].next) {
+				ForEachPath(derivations[derivation].chain, walk, [&](std::vector<std::int32_t> const &path) {
+					children.clear();
+					for (std::int32_t child : path) {
+						children.push_back(visit(child));
+					}
+					forest.AddDerivation(node, children.data(), static_cast<int>(children.size()));
+				});
+			}
+		}
+	}
+
+	std::vector<std::int32_t> ParseEngine::GetExtents() const {
+		std::int32_t end = static_cast<std::int32_t>(text->size()) + 1;
+		std::int32_t count = static_cast<std::int32_t>(dispatchers.GetCount());
+		std::vector<std::int32_t> result(count);
+		for (std::int32_t i = 0; i < count; ++i) {
+			Dispatcher const &record = dispatchers[i];
+			std::int32_t extent = record.position + 1;
+			if (record.reusedExtent >= 0) {
+				extent = record.reusedExtent;
+			} else if (grammar.GetKind(record.symbol) == SymbolKind::StringTerminal) {
+				extent = record.position + static_cast<std::int32_t>(grammar.GetText(record.symbol).size());
+				//a string cut off by the end of the text looked at the end
+				if (extent >= end) extent = end;
+			} else if (grammar.GetKind(record.symbol) == SymbolKind::FunctionTerminal) {
+				extent = end;
+			}
+			result[i] = std::min(extent, end);
+		}
+		//a production read whatever its children read, and the code point after each of their
+		//matches, where it went on; children mostly come after their owners, so go backwards
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (std::int32_t i = count; i-- > 0;) {
+				Dispatcher const &child = dispatchers[i];
+				std::int32_t extent = std::max(result[i], std::min(child.position + child.longest + 1, end));
+				for (std::int32_t dependency = child.firstDependency; dependency != NoLink; dependency = dependencies[dependency].next) {
+					std::int32_t owner = dependencies[dependency].owner;
+					if (result[owner] < extent) {
+						result[owner] = extent;
+						changed = true;
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+	void ParseEngine::TakeSnapshot(ParseSnapshot &snapshot) const {
+		if (text == nullptr) {
+			throw std::logic_error("nothing has been parsed to take a snapshot of");
+		}
+		if (sink != nullptr) {
+			throw std::logic_error("a streaming parse has forgotten too much to take a snapshot of");
+		}
+		snapshot.Reset(grammar, text->size());
+		std::vector<std::int32_t> matchOf(matchClasses.GetCount(), std::int32_t(ParseSnapshot::Absent));
+		std::vector<std::int32_t> linkOf(chainLinks.GetCount(), std::int32_t(ParseSnapshot::NoLink));
+		std::vector<std::int32_t> oldMatchOf(previous != nullptr ? previous->GetMatchCount() : 0, std::int32_t(ParseSnapshot::Absent));
+		std::vector<std::int32_t> oldLinkOf(previous != nullptr ? previous->GetChainLinkCount() : 0, std::int32_t(ParseSnapshot::NoLink));
+		//matches copied from the previous snapshot whose derivations haven't been yet
+		std::vector<std::int32_t> pendingOld;
+		std::vector<std::int32_t> chains;
+		std::vector<std::int32_t> path;
+		auto copyOldMatch = [&](std::int32_t match) {
+			if (oldMatchOf[match] == ParseSnapshot::Absent) {
+				ParseSnapshot::Match const &record = previous->GetMatch(match);
+				oldMatchOf[match] = snapshot.AddMatch(NewPosition(record.start), record.symbol, record.length);
+				pendingOld.push_back(match);
+			}
+			return oldMatchOf[match];
+		};
+		//chains share their prefixes, so each link is copied once, and only the part of a chain not yet seen is walked
+		auto copyChain = [&](std::int32_t chain) {
+			path.clear();
+			std::int32_t link = chain;
+			for (; link != NoLink && linkOf[link] == ParseSnapshot::NoLink; link = chainLinks[link].previous) {
+				path.push_back(link);
+			}
+			std::int32_t copied = link == NoLink ? ParseSnapshot::NoLink : linkOf[link];
+			for (auto i = path.rbegin(); i != path.rend(); ++i) {
+				copied = linkOf[*i] = snapshot.AddChainLink(copied, matchOf[chainLinks[*i].matchClass]);
+			}
+			return copied;
+		};
+		auto copyOldChain = [&](std::int32_t chain) {
+			path.clear();
+			std::int32_t link = chain;
+			for (; link != ParseSnapshot::NoLink && oldLinkOf[link] == ParseSnapshot::NoLink; link = previous->GetChainLink(link).previous) {
+				path.push_back(link);
+			}
+			std::int32_t copied = link == ParseSnapshot::NoLink ? ParseSnapshot::NoLink : oldLinkOf[link];
+			for (auto i = path.rbegin(); i != path.rend(); ++i) {
+				copied = oldLinkOf[*i] = snapshot.AddChainLink(copied, copyOldMatch(previous->GetChainLink(*i).match));
+			}
+			return copied;
+		};
+		auto copyPendingOld = [&] {
+			while (!pendingOld.empty()) {
+				std::int32_t match = pendingOld.back();
+				pendingOld.pop_back();
+				chains.clear();
+				for (std::int32_t chain : previous->GetDerivations(match)) {
+					chains.push_back(copyOldChain(chain));
+				}
+				snapshot.SetDerivations(oldMatchOf[match], chains.data(), static_cast<std::int32_t>(chains.size()));
+			}
+		};
+
+		//every published match class gets its id first, so chains can refer to any of them
+		std::int32_t matchClassCount = static_cast<std::int32_t>(matchClasses.GetCount());
+		for (std::int32_t i = 0; i < matchClassCount; ++i) {
+			MatchClass const &record = matchClasses[i];
+			if (!record.published) continue;
+			if (record.reusedMatch != ParseSnapshot::Absent) {
+				matchOf[i] = copyOldMatch(record.reusedMatch);
+			} else {
+				matchOf[i] = snapshot.AddMatch(dispatchers[record.dispatcher].position, dispatchers[record.dispatcher].symbol, record.length);
+			}
+		}
+		//the snapshot has no alternatives, so a chain with any along it is copied a path at a time;
+		//a link's previous is always older than it, so one pass finds which have none
+		std::int32_t linkCount = static_cast<std::int32_t>(chainLinks.GetCount());
+		std::vector<bool> isSimple(linkCount);
+		for (std::int32_t i = 0; i < linkCount; ++i) {
+			ChainLink const &link = chainLinks[i];
+			isSimple[i] = link.alternative == NoLink && (link.previous == NoLink || isSimple[link.previous]);
+		}
+		PathWalk walk;
+		for (std::int32_t i = 0; i < matchClassCount; ++i) {
+			MatchClass const &record = matchClasses[i];
+			if (!record.published || record.reusedMatch != ParseSnapshot::Absent || grammar.GetIsTerminal(dispatchers[record.dispatcher].symbol)) continue;
+			chains.clear();
+			for (std::int32_t derivation = record.firstDerivation; derivation != NoLink; derivation = derivations[derivation].next) {
+				std::int32_t chain = derivations[derivation].chain;
+				if (chain == NoLink || isSimple[chain]) {
+					chains.push_back(copyChain(chain));
+					continue;
+				}
+				ForEachPath(chain, walk, [&](std::vector<std::int32_t> const &path) {
+					std::int32_t copied = ParseSnapshot::NoLink;
+					for (std::int32_t child : path) {
+						copied = snapshot.AddChainLink(copied, matchOf[child]);
+					}
+					chains.push_back(copied);
+				});
+			}
+			snapshot.SetDerivations(matchOf[i], chains.data(), static_cast<std::int32_t>(chains.size()));
+		}
+		copyPendingOld();
+
+		std::vector<std::int32_t> extents = GetExtents();
+		std::vector<std::int32_t> matches;
+		for (std::int32_t i = 0; i < static_cast<std::int32_t>(dispatchers.GetCount()); ++i) {
+			matches.clear();
+			for (std::int32_t matchClass = dispatchers[i].firstMatchClass; matchClass != NoLink; matchClass = matchClasses[matchClass].next) {
+				if (matchClasses[matchClass].published) matches.push_back(matchOf[matchClass]);
+			}
+			snapshot.AddEntry(dispatchers[i].position, dispatchers[i].symbol, extents[i], matches.data(), static_cast<std::int32_t>(matches.size()));
+		}
+		if (previous == nullptr) return;
+		//what the previous snapshot knew that no edit touched stays reusable, even where this parse didn't ask
+		for (std::int32_t i = 0; i < static_cast<std::int32_t>(previous->GetEntryCount()); ++i) {
+			ParseSnapshot::Entry const &entry = previous->GetEntry(i);
+			if (!GetIsClean(entry.position, entry.extent)) continue;
+			std::int32_t position = NewPosition(entry.position);
+			if (dispatcherTable.Find(MemoTable::PackKey(position, entry.symbol)) != MemoTable::Absent) continue;
+			matches.clear();
+			for (std::int32_t match : previous->GetEntryMatches(i)) {
+				matches.push_back(copyOldMatch(match));
+			}
+			snapshot.AddEntry(position, entry.symbol, entry.extent + position - entry.position, matches.data(), static_cast<std::int32_t>(matches.size()));
+		}
+		copyPendingOld();
+	}
+
+	ParseMetrics ParseEngine::GetMetrics() const {
+		ParseMetrics result;
+		result.dispatcherCount = dispatchers.GetCount();
+		result.matchClassCount = matchClasses.GetCount();
+		result.derivationCount = derivations.GetCount();
+		result.dependencyCount = dependencies.GetCount();
+		result.forcedCompletionCount = forcedCompletionCount;
+		result.peakColumnCount = peakColumnCount;
+		result.prunedCount = prunedCount.load(std::memory_order_relaxed);
+		result.filteredCount = filteredCount.load(std::memory_order_relaxed);
+		result.cancelledCount = cancelledCount.load(std::memory_order_relaxed);
+		result.reusedCount = reusedCount.load(std::memory_order_relaxed);
+		result.emittedCount = emittedCount;
+		result.compactionCount = compactionCount;
+		result.mergedCount = mergedCount.load(std::memory_order_relaxed);
+		for (std::int32_t i = 0; i < static_cast<std::int32_t>(dispatchers.GetCount()); ++i) {
+			if (!dispatchers[i].speculative) continue;
+			result.speculativeCount++;
+			if (dispatchers[i].firstDependency == NoLink) result.speculativeMissCount++;
+		}
+		result.memoryUsage = dispatcherTable.GetMemoryUsage() + matchClassTable.GetMemoryUsage() +
+			dispatchers.GetMemoryUsage() + matchClasses.GetMemoryUsage() + derivations.GetMemoryUsage() +
+			chainLinks.GetMemoryUsage() + dependencies.GetMemoryUsage() + itemTable.GetMemoryUsage() + items.GetMemoryUsage();
+		for (auto const &column : window) {
+			result.memoryUsage += (column->states.capacity() + column->owners.capacity() + column->chains.capacity() + column->sameOwner.capacity()) * sizeof(std::int32_t) +
+				column->predictions.GetMemoryUsage() + column->completions.GetMemoryUsage() + column->itemsOfOwner.GetMemoryUsage();
+		}
+		return result;
+	}
+
+	void ParseEngine::ParseWavefront() {
+		root = WavefrontDispatcher(0, grammar.GetMain());
+		std::int32_t high = 0;
+		for (;;) {
+			//bring every column up to high to a fixpoint, in position order; items
+			//only ever land at or after the position being worked on
+			for (std::int32_t position = lowestDirty; position <= high; ++position) {
+				Column &column = GetColumn(position);
+				while (column.processed < column.states.size()) {
+					std::size_t i = column.processed++;
+					std::int32_t state = column.states[i];
+					std::int32_t owner = column.owners[i];
+					std::int32_t chain = column.chains[i];
+					if (grammar.GetIsAccept(state)) {
+						WavefrontResult(owner, position - dispatchers[owner].position, chain);
+					}
+					for (Grammar::Transition const &transition : grammar.GetTransitions(state)) {
+						WavefrontSubscribe(owner, transition.target, position, chain, transition.symbol);
+					}
+				}
+			}
+			lowestDirty = high + 1;
+			if (CompleteUnreachable(high)) continue;
+			if (openDispatchers.empty()) break;
+			high++;
+			//a greedy dispatcher's longest match is only published once it completes,
+			//and its dependents resume where that match ends, so its columns are kept
+			std::int32_t frontier = high;
+			for (std::int32_t dispatcher : openDispatchers) {
+				if (grammar.GetIsGreedy(dispatchers[dispatcher].symbol)) {
+					frontier = std::min(frontier, dispatchers[dispatcher].position);
+				}
+			}
+			RecycleColumnsBefore(frontier);
+			if (sink != nullptr && GetRecordCount() >= compactAt) Cut();
+		}
+	}
+
+	ParseEngine::Column &ParseEngine::GetColumn(std::int32_t position) {
+		while (windowStart + static_cast<std::int32_t>(window.size()) <= position) {
+			if (spareColumns.empty()) {
+				window.emplace_back(new Column);
+				window.back()->processed = 0;
+			} else {
+				window.push_back(std::move(spareColumns.back()));
+				spareColumns.pop_back();
+			}
+		}
+		peakColumnCount = std::max(peakColumnCount, window.size());
+		return *window[position - windowStart];
+	}
+
+	void ParseEngine::RecycleColumnsBefore(std::int32_t position) {
+		while (windowStart < position && !window.empty()) {
+			std::unique_ptr<Column> column = std::move(window.front());
+			window.pop_front();
+			column->states.clear();
+			column->owners.clear();
+			column->chains.clear();
+			column->itemsOfOwner.Clear();
+			column->sameOwner.clear();
+			column->processed = 0;
+			column->predictions.Clear();
+			column->completions.Clear();
+			spareColumns.push_back(std::move(column));
+			windowStart++;
+		}
+		if (window.empty()) windowStart = std::max(windowStart, position);
+	}
+
+	std::size_t ParseEngine::GetRecordCount() const {
+		return dispatchers.GetCount() + matchClasses.GetCount() + derivations.GetCount() + chainLinks.GetCount() + dependencies.GetCount();
+	}
+
+	void ParseEngine::Cut() {
+		//nothing but main can reach back before the first position an open dispatcher besides main starts at
+		std::int32_t cut = windowStart;
+		for (std::int32_t dispatcher : openDispatchers) {
+			if (dispatcher != root) cut = std::min(cut, dispatchers[dispatcher].position);
+		}
+		//every chain main could still extend, walked back to its last child ending by the cut
+		std::int32_t boundary = NoLink;
+		bool found = false;
+		bool settled = true;
+		auto meet = [&](std::int32_t chain) {
+			std::int32_t link = chain;
+			while (link != NoLink) {
+				MatchClass const &child = matchClasses[chainLinks[link].matchClass];
+				if (dispatchers[child.dispatcher].position + child.length <= cut) break;
+				if (chainLinks[link].alternative != NoLink) settled = false;
+				link = chainLinks[link].previous;
+			}
+			if (!found) boundary = link;
+			else if (link != boundary) settled = false;
+			found = true;
+			//main's children before the cut have to be one path to be emitted
+			for (; link != NoLink && settled; link = chainLinks[link].previous) {
+				if (chainLinks[link].alternative != NoLink) settled = false;
+			}
+		};
+		for (auto const &column : window) {
+			for (std::size_t i = 0; i < column->owners.size(); ++i) {
+				if (column->owners[i] == root) meet(column->chains[i]);
+			}
+		}
+		for (std::int32_t dispatcher : openDispatchers) {
+			for (std::int32_t i = dispatchers[dispatcher].firstDependency; i != NoLink; i = dependencies[i].next) {
+				if (dependencies[i].owner == root) meet(dependencies[i].chain);
+			}
+		}
+		if (!settled || boundary == NoLink) {
+			Compact(NoLink);
+			return;
+		}
+		std::vector<std::int32_t> children;
+		for (std::int32_t link = boundary; link != NoLink; link = chainLinks[link].previous) {
+			children.push_back(chainLinks[link].matchClass);
+		}
+		std::reverse(children.begin(), children.end());
+		std::vector<NodeId> nodeOf;
+		emitted.Clear();
+		WriteForest(emitted, children, nodeOf);
+		std::vector<NodeId> subtrees;
+		subtrees.reserve(children.size());
+		for (std::int32_t child : children) {
+			subtrees.push_back(nodeOf[child]);
+		}
+		emittedCount += subtrees.size();
+		sink->Emit(emitted, Span<NodeId>(subtrees.data(), subtrees.size()));
+		Compact(boundary);
+	}
+
+	void ParseEngine::Compact(std::int32_t cutLink) {
+		//a copying collection: the live roots are main, the open dispatchers and
+		//the window, and only an open dispatcher's dependencies can still advance.
+		//A match class is kept if it ends in the window or a kept chain holds it
+		std::vector<std::int32_t> dispatcherOf(dispatchers.GetCount(), std::int32_t(NoLink));
+		std::vector<std::int32_t> matchClassOf(matchClasses.GetCount(), std::int32_t(NoLink));
+		std::vector<std::int32_t> linkOf(chainLinks.GetCount(), std::int32_t(NoLink));
+		std::vector<std::int32_t> dependencyOf(dependencies.GetCount(), std::int32_t(NoLink));
+		std::vector<std::int32_t> keptDispatchers;
+		std::vector<std::int32_t> keptMatchClasses;
+		std::vector<std::int32_t> keptLinks;
+		std::vector<std::int32_t> keptDependencies;
+		auto keepDispatcher = [&](std::int32_t dispatcher) {
+			if (dispatcherOf[dispatcher] != NoLink) return;
+			dispatcherOf[dispatcher] = static_cast<std::int32_t>(keptDispatchers.size());
+			keptDispatchers.push_back(dispatcher);
+		};
+		auto keepMatchClass = [&](std::int32_t matchClass) {
+			if (matchClassOf[matchClass] != NoLink) return;
+			matchClassOf[matchClass] = static_cast<std::int32_t>(keptMatchClasses.size());
+			keptMatchClasses.push_back(matchClass);
+		};
+		//a link's alternatives are kept with it, and their chains, so this works through a stack of chains
+		std::vector<std::int32_t> chainStack;
+		auto keepChain = [&](std::int32_t link) {
+			chainStack.push_back(link);
+			while (!chainStack.empty()) {
+				link = chainStack.back();
+				chainStack.pop_back();
+				while (link != NoLink && link != cutLink && linkOf[link] == NoLink) {
+					linkOf[link] = static_cast<std::int32_t>(keptLinks.size());
+					keptLinks.push_back(link);
+					keepMatchClass(chainLinks[link].matchClass);
+					if (chainLinks[link].alternative != NoLink) chainStack.push_back(chainLinks[link].alternative);
+					link = chainLinks[link].previous;
+				}
+			}
+		};
+		auto chainOf = [&](std::int32_t link) {
+			return link == NoLink || link == cutLink ? NoLink : linkOf[link];
+		};
+		if (root != NoLink) keepDispatcher(root);
+		for (std::int32_t dispatcher : openDispatchers) {
+			keepDispatcher(dispatcher);
+		}
+		for (auto const &column : window) {
+			for (std::size_t i = 0; i < column->owners.size(); ++i) {
+				keepDispatcher(column->owners[i]);
+				keepChain(column->chains[i]);
+			}
+			column->predictions.ForEach([&](std::int32_t, std::int32_t dispatcher) {
+				keepDispatcher(dispatcher);
+			});
+			column->completions.ForEach([&](std::int32_t dispatcher, std::int32_t matchClass) {
+				keepDispatcher(dispatcher);
+				keepMatchClass(matchClass);
+			});
+		}
+		//the lists grow while they're walked
+		std::size_t nextDispatcher = 0;
+		std::size_t nextMatchClass = 0;
+		while (nextDispatcher < keptDispatchers.size() || nextMatchClass < keptMatchClasses.size()) {
+			for (; nextDispatcher < keptDispatchers.size(); ++nextDispatcher) {
+				Dispatcher const &record = dispatchers[keptDispatchers[nextDispatcher]];
+				if (record.completed) continue;
+				for (std::int32_t i = record.firstDependency; i != NoLink; i = dependencies[i].next) {
+					dependencyOf[i] = static_cast<std::int32_t>(keptDependencies.size());
+					keptDependencies.push_back(i);
+					keepDispatcher(dependencies[i].owner);
+					keepChain(dependencies[i].chain);
+				}
+			}
+			for (; nextMatchClass < keptMatchClasses.size(); ++nextMatchClass) {
+				MatchClass const &record = matchClasses[keptMatchClasses[nextMatchClass]];
+				keepDispatcher(record.dispatcher);
+				for (std::int32_t i = record.firstDerivation; i != NoLink; i = derivations[i].next) {
+					keepChain(derivations[i].chain);
+				}
+			}
+		}
+
+		//copy in the new order; the lists keep their order, minus what was dropped
+		ConcurrentArena<Dispatcher> newDispatchers;
+		ConcurrentArena<MatchClass> newMatchClasses;
+		ConcurrentArena<Derivation> newDerivations;
+		ConcurrentArena<ChainLink> newChainLinks;
+		ConcurrentArena<Dependency> newDependencies;
+		for (std::int32_t old : keptLinks) {
+			ChainLink &link = newChainLinks[newChainLinks.Allocate()];
+			link = chainLinks[old];
+			link.previous = chainOf(link.previous);
+			link.matchClass = matchClassOf[link.matchClass];
+			link.alternative = chainOf(link.alternative);
+		}
+		for (std::int32_t old : keptDependencies) {
+			Dependency const &from = dependencies[old];
+			Dependency &to = newDependencies[newDependencies.Allocate()];
+			to.owner = dispatcherOf[from.owner];
+			to.state = from.state;
+			to.chain = chainOf(from.chain);
+			to.next = NoLink;
+			to.nextOwned = NoLink;
+			to.reach = from.reach;
+			to.cancelled.store(from.cancelled.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			to.released.store(from.released.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+		for (std::int32_t old : keptMatchClasses) {
+			MatchClass &matchClass = newMatchClasses[newMatchClasses.Allocate()];
+			matchClass = matchClasses[old];
+			matchClass.dispatcher = dispatcherOf[matchClass.dispatcher];
+			matchClass.next = NoLink;
+			matchClass.firstDerivation = NoLink;
+			std::int32_t *tail = &matchClass.firstDerivation;
+			for (std::int32_t i = matchClasses[old].firstDerivation; i != NoLink; i = derivations[i].next) {
+				std::int32_t derivation = newDerivations.Allocate();
+				newDerivations[derivation].chain = chainOf(derivations[i].chain);
+				newDerivations[derivation].next = NoLink;
+				*tail = derivation;
+				tail = &newDerivations[derivation].next;
+			}
+		}
+		for (std::int32_t old : keptDispatchers) {
+			Dispatcher const &from = dispatchers[old];
+			Dispatcher &to = newDispatchers[newDispatchers.Allocate()];
+			to.position = from.position;
+			to.symbol = from.symbol;
+			to.pending.store(from.pending.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			to.longest = from.longest;
+			to.completed = from.completed;
+			to.liveMark = from.liveMark;
+			to.reusedExtent = from.reusedExtent;
+			to.speculative = from.speculative;
+			to.firstOwned = NoLink;
+			to.firstMatchClass = NoLink;
+			std::int32_t *tail = &to.firstMatchClass;
+			for (std::int32_t i = from.firstMatchClass; i != NoLink; i = matchClasses[i].next) {
+				if (matchClassOf[i] == NoLink) continue;
+				*tail = matchClassOf[i];
+				tail = &newMatchClasses[matchClassOf[i]].next;
+			}
+			to.firstDependency = NoLink;
+			tail = &to.firstDependency;
+			for (std::int32_t i = from.firstDependency; i != NoLink; i = dependencies[i].next) {
+				if (dependencyOf[i] == NoLink) continue;
+				*tail = dependencyOf[i];
+				tail = &newDependencies[dependencyOf[i]].next;
+			}
+		}
+
+		FlatMap remapped;
+		for (auto &column : window) {
+			column->itemsOfOwner.Clear();
+			for (std::size_t i = 0; i < column->owners.size(); ++i) {
+				column->owners[i] = dispatcherOf[column->owners[i]];
+				column->chains[i] = chainOf(column->chains[i]);
+				//the owners' lists are rebuilt under their new numbers
+				std::int32_t first = column->itemsOfOwner.Add(column->owners[i], static_cast<std::int32_t>(i));
+				column->sameOwner[i] = FlatMap::Absent;
+				if (first != FlatMap::Absent) {
+					column->sameOwner[i] = column->sameOwner[first];
+					column->sameOwner[first] = static_cast<std::int32_t>(i);
+				}
+			}
+			remapped.Clear();
+			column->predictions.ForEach([&](std::int32_t symbol, std::int32_t dispatcher) {
+				remapped.Add(symbol, dispatcherOf[dispatcher]);
+			});
+			std::swap(remapped, column->predictions);
+			remapped.Clear();
+			column->completions.ForEach([&](std::int32_t dispatcher, std::int32_t matchClass) {
+				remapped.Add(dispatcherOf[dispatcher], matchClassOf[matchClass]);
+			});
+			std::swap(remapped, column->completions);
+		}
+		for (std::int32_t &dispatcher : openDispatchers) {
+			dispatcher = dispatcherOf[dispatcher];
+		}
+		if (root != NoLink) root = dispatcherOf[root];
+		dispatchers.Swap(newDispatchers);
+		matchClasses.Swap(newMatchClasses);
+		derivations.Swap(newDerivations);
+		chainLinks.Swap(newChainLinks);
+		dependencies.Swap(newDependencies);
+		compactionCount++;
+		compactAt = std::max(std::size_t(MinCompaction), GetRecordCount() * 2);
+	}
+
+	void ParseEngine::AddItem(std::int32_t position, std::int32_t state, std::int32_t owner, std::int32_t chain) {
+		Column &column = GetColumn(position);
+		std::int32_t item = static_cast<std::int32_t>(column.states.size());
+		column.states.push_back(state);
+		column.owners.push_back(owner);
+		column.chains.push_back(chain);
+		column.sameOwner.push_back(std::int32_t(FlatMap::Absent));
+		std::int32_t first = column.itemsOfOwner.Add(owner, item);
+		if (first != FlatMap::Absent) {
+			column.sameOwner[item] = column.sameOwner[first];
+			column.sameOwner[first] = item;
+		}
+		lowestDirty = std::min(lowestDirty, position);
+	}
+
+	std::int32_t ParseEngine::WavefrontDispatcher(std::int32_t position, std::int32_t symbol) {
+		Column &column = GetColumn(position);
+		std::int32_t result = column.predictions.Find(symbol);
+		if (result != FlatMap::Absent) return result;
+		result = dispatchers.Allocate();
+		column.predictions.Add(symbol, result);
+		Dispatcher &dispatcher = dispatchers[result];
+		dispatcher.position = position;
+		dispatcher.symbol = symbol;
+		dispatcher.firstMatchClass = NoLink;
+		dispatcher.firstDependency = NoLink;
+		dispatcher.firstOwned = NoLink;
+		dispatcher.pending.store(0, std::memory_order_relaxed);
+		dispatcher.longest = -1;
+		dispatcher.liveMark = -1;
+		dispatcher.reusedExtent = -1;
+		dispatcher.speculative = false;
+		if (grammar.GetIsTerminal(symbol)) {
+			dispatcher.completed = true;
+			int length;
+			if (MatchTerminal(symbol, position, length)) {
+				WavefrontResult(result, length, NoLink);
+			}
+		} else {
+			dispatcher.completed = false;
+			openDispatchers.push_back(result);
+			for (std::int32_t state : grammar.GetStartStates(symbol)) {
+				AddItem(position, state, result, NoLink);
+			}
+		}
+		return result;
+	}
+
+	void ParseEngine::WavefrontSubscribe(std::int32_t owner, std::int32_t state, std::int32_t position, std::int32_t chain, std::int32_t symbol) {
+		if (!PassesLookahead(position, symbol)) return;
+		std::int32_t child = WavefrontDispatcher(position, symbol);
+		std::int32_t dependency = dependencies.Allocate();
+		Dependency &record = dependencies[dependency];
+		record.owner = owner;
+		record.state = state;
+		record.chain = chain;
+		record.nextOwned = NoLink;
+		record.reach = Grammar::Unbounded;
+		record.cancelled.store(false, std::memory_order_relaxed);
+		record.released.store(true, std::memory_order_relaxed);
+		Dispatcher &childRecord = dispatchers[child];
+		record.next = childRecord.firstDependency;
+		childRecord.firstDependency = dependency;
+		for (std::int32_t i = childRecord.firstMatchClass; i != NoLink; i = matchClasses[i].next) {
+			if (matchClasses[i].published) WavefrontAdvance(dependency, i);
+		}
+	}
+
+	void ParseEngine::WavefrontResult(std::int32_t dispatcher, std::int32_t length, std::int32_t chain) {
+		Dispatcher &record = dispatchers[dispatcher];
+		if (!PassesPrecedence(record.symbol, chain)) return;
+		Column &column = GetColumn(record.position + length);
+		std::int32_t matchClass = column.completions.Find(dispatcher);
+		if (matchClass == FlatMap::Absent) {
+			matchClass = matchClasses.Allocate();
+			column.completions.Add(dispatcher, matchClass);
+			MatchClass &created = matchClasses[matchClass];
+			created.dispatcher = dispatcher;
+			created.length = length;
+			created.firstDerivation = NoLink;
+			created.linked = true;
+			created.published = false;
+			created.reusedMatch = ParseSnapshot::Absent;
+			created.next = record.firstMatchClass;
+			record.firstMatchClass = matchClass;
+			record.longest = std::max(record.longest, length);
+		}
+		MatchClass &matchClassRecord = matchClasses[matchClass];
+		std::int32_t derivation = derivations.Allocate();
+		derivations[derivation].chain = chain;
+		derivations[derivation].next = matchClassRecord.firstDerivation;
+		matchClassRecord.firstDerivation = derivation;
+		if (!matchClassRecord.published && (record.completed || !grammar.GetIsGreedy(record.symbol))) {
+			WavefrontPublish(record, matchClass);
+		}
+	}
+
+	void ParseEngine::WavefrontPublish(Dispatcher &dispatcher, std::int32_t matchClass) {
+		matchClasses[matchClass].published = true;
+		for (std::int32_t i = dispatcher.firstDependency; i != NoLink; i = dependencies[i].next) {
+			WavefrontAdvance(i, matchClass);
+		}
+	}
+
+	void ParseEngine::WavefrontAdvance(std::int32_t dependency, std::int32_t matchClass) {
+		Dependency const &record = dependencies[dependency];
+		MatchClass const &matchClassRecord = matchClasses[matchClass];
+		std::int32_t position = dispatchers[matchClassRecord.dispatcher].position + matchClassRecord.length;
+		Column &column = GetColumn(position);
+		std::int32_t symbol = dispatchers[record.owner].symbol;
+		for (std::int32_t item = column.itemsOfOwner.Find(record.owner); item != FlatMap::Absent; item = column.sameOwner[item]) {
+			if (column.states[item] == record.state && GetIsMergeable(symbol, column.chains[item], record.chain, matchClass)) {
+				Merge(column.chains[item], record.chain, matchClass);
+				return;
+			}
+		}
+		AddItem(position, record.state, record.owner, AddLink(record.chain, matchClass));
+	}
+
+	bool ParseEngine::CompleteUnreachable(std::int32_t high) {
+		//a dispatcher can still find matches only if it, or something it waits
+		//on, has items beyond high; everything else is unreachable and complete
+		liveEpoch++;
+		liveQueue.clear();
+		auto mark = [this](std::int32_t dispatcher) {
+			if (dispatchers[dispatcher].liveMark != liveEpoch) {
+				dispatchers[dispatcher].liveMark = liveEpoch;
+				liveQueue.push_back(dispatcher);
+			}
+		};
+		for (std::int32_t position = std::max(high + 1, windowStart); position < windowStart + static_cast<std::int32_t>(window.size()); ++position) {
+			for (std::int32_t owner : window[position - windowStart]->owners) {
+				mark(owner);
+			}
+		}
+		for (std::size_t next = 0; next < liveQueue.size(); ++next) {
+			for (std::int32_t i = dispatchers[liveQueue[next]].firstDependency; i != NoLink; i = dependencies[i].next) {
+				mark(dependencies[i].owner);
+			}
+		}
+
+		//greedy dispatchers publish their longest match now, innermost first, and
+		//anything waiting on them must catch up before the rest are completed
+		std::vector<std::int32_t> &greedy = liveQueue;
+		greedy.clear();
+		for (std::int32_t dispatcher : openDispatchers) {
+			Dispatcher const &record = dispatchers[dispatcher];
+			if (record.liveMark != liveEpoch && grammar.GetIsGreedy(record.symbol)) greedy.push_back(dispatcher);
+		}
+		std::sort(greedy.begin(), greedy.end(), [this](std::int32_t l, std::int32_t r) {
+			if (dispatchers[l].position != dispatchers[r].position) return dispatchers[l].position > dispatchers[r].position;
+			return l > r;
+		});
+		bool resumed = false;
+		for (std::int32_t dispatcher : greedy) {
+			Dispatcher &record = dispatchers[dispatcher];
+			record.completed = true;
+			for (std::int32_t i = record.firstMatchClass; i != NoLink; i = matchClasses[i].next) {
+				if (matchClasses[i].length == record.longest && !matchClasses[i].published) {
+					WavefrontPublish(record, i);
+				}
+			}
+			if (lowestDirty <= high) {
+				resumed = true;
+				break;
+			}
+		}
+		if (!resumed) {
+			for (std::int32_t dispatcher : openDispatchers) {
+				if (dispatchers[dispatcher].liveMark != liveEpoch) dispatchers[dispatcher].completed = true;
+			}
+		}
+		openDispatchers.erase(std::remove_if(openDispatchers.begin(), openDispatchers.end(), [this](std::int32_t dispatcher) {
+			return dispatchers[dispatcher].completed;
+		}), openDispatchers.end());
+		return resumed;
+	}
+}
\ No newline at end of file
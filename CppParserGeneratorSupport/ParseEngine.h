@@ -0,0 +1,363 @@
+#ifndef _PARSE_ENGINE_H_
+#define _PARSE_ENGINE_H_
+
+#include "Text.h"
+#include "Grammar.h"
+#include "ParseForest.h"
+#include "TerminalScan.h"
+#include "ParseSnapshot.h"
+#include "MemoTable.h"
+#include "ConcurrentArena.h"
+#include "IScheduler.h"
+#include "IForestSink.h"
+#include "SpinLock.h"
+#include "FlatMap.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace Parlex {
+	enum class ExecutionMode {
+		//dispatchers run as work items on the scheduler, in whatever order it picks them up
+		Dispatch,
+		/// <summary>
+		/// Earley style: one thread works through the input a position at a
+		/// time, and each position's items are kept as structure of arrays.
+		/// Once nothing live can reach back to a position, its item set and
+		/// lookup tables are recycled, so memory is touched mostly in order
+		/// and the working set follows the open constructs, not the input.
+		/// </summary>
+		Wavefront
+	};
+
+	enum class LookaheadMode {
+		None,
+		//skip a symbol when the next code point can't start it and it can't match nothing
+		First,
+		/// <summary>
+		/// Also skip a symbol that can match nothing when the next code point
+		/// can't follow it. Follow sets assume the whole text is parsed, so
+		/// GetRootLengths only reports the full length. They're ignored for
+		/// grammars with greedy productions, whose longest match they could change.
+		/// </summary>
+		FirstAndFollow
+	};
+
+	struct ParseMetrics {
+		std::size_t dispatcherCount;
+		std::size_t matchClassCount;
+		std::size_t derivationCount;
+		std::size_t dependencyCount;
+		//dispatchers that were only completed by breaking a cycle of dependencies
+		std::size_t forcedCompletionCount;
+		//in wavefront mode, the most positions whose item sets were held at once
+		std::size_t peakColumnCount;
+		//subscriptions dropped because the lookahead ruled their symbol out
+		std::size_t prunedCount;
+		//derivations of operator productions the grammar's precedences ruled out
+		std::size_t filteredCount;
+		//paths of greedy dispatchers dropped because they couldn't beat the longest match found
+		std::size_t cancelledCount;
+		//dispatchers a Reparse took from its snapshot instead of running
+		std::size_t reusedCount;
+		//dispatchers started at a sync point before anything asked for them, and those nothing ever did
+		std::size_t speculativeCount;
+		std::size_t speculativeMissCount;
+		//in a streaming parse, the subtrees handed to the sink, and the times the records were compacted
+		std::size_t emittedCount;
+		std::size_t compactionCount;
+		//paths that reached an item another path already had, packed into it instead of run again
+		std::size_t mergedCount;
+		std::size_t memoryUsage;
+
+		ParseMetrics() : dispatcherCount(0), matchClassCount(0), derivationCount(0), dependencyCount(0), forcedCompletionCount(0), peakColumnCount(0), prunedCount(0), filteredCount(0), cancelledCount(0), reusedCount(0), speculativeCount(0), speculativeMissCount(0), emittedCount(0), compactionCount(0), mergedCount(0), memoryUsage(0) {}
+	};
+
+	/// <summary>
+	/// The native counterpart of the managed ParseEngine. There is one
+	/// Dispatcher per (position, symbol) pair asked for, found through a
+	/// lock-free MemoTable. A Dispatcher runs its production's NFA, and each
+	/// transition subscribes to the Dispatcher for the transition's symbol at
+	/// the current position; every match class that Dispatcher finds resumes
+	/// the NFA after it. All the work is posted to an IScheduler, so a
+	/// WorkStealingPool parses an ambiguous grammar on every core. There is
+	/// one item per (dispatcher, state, position): a path that reaches one
+	/// that exists is packed into its chain, as in an SPPF, rather than run
+	/// again, so a nullable repetition such as Q* with an empty Q ends.
+	/// </summary>
+	class ParseEngine {
+		ParseEngine(ParseEngine const &other) = delete;
+		ParseEngine &operator=(ParseEngine const &other) = delete;
+	public:
+		//the grammar must be compiled, and both must outlive the engine
+		ParseEngine(Grammar const &grammar, IScheduler &scheduler, ExecutionMode mode = ExecutionMode::Dispatch, LookaheadMode lookahead = LookaheadMode::First);
+
+		//answer terminals from scan, which must have scanned the text given to Parse, or run them directly if it's null
+		void SetTerminalScan(TerminalScan const *scan);
+		/// <summary>
+		/// Split texts longer than chunkSize code points into chunks, each
+		/// posted as a work item that starts the dispatcher for a sync point's
+		/// symbol wherever the grammar's sync points occur in it, so a huge
+		/// flat document is parsed on every core from the start. Those
+		/// dispatchers are memoized like any other: one the main production
+		/// reaches is already done, and one it never reaches is left out of
+		/// the forest, so a wrong guess only costs its own work. 0, the
+		/// default, turns it off; the engine must be in ExecutionMode::Dispatch.
+		/// </summary>
+		void SetSpeculation(std::size_t chunkSize);
+		/// <summary>
+		/// Parse with bounded memory, handing finished subtrees to sink. Once
+		/// every open dispatcher but main's starts at or after a cut position,
+		/// and everything main could still derive goes through the same
+		/// children before it, those children are emitted and main forgets
+		/// them; the records nothing live can reach any more are then freed by
+		/// compacting the rest. Memory follows the longest open construct when
+		/// main is a repetition, and BuildForest only has main's children after
+		/// the last cut. null, the default, turns it off; the engine must be in
+		/// ExecutionMode::Wavefront, and sink must outlive the engine's parses.
+		/// </summary>
+		void SetStreaming(IForestSink *sink);
+		//parse the whole of text with the grammar's main production; text must outlive the engine's results
+		void Parse(Text const &text);
+		/// <summary>
+		/// Parse text, an edited copy of the text previous was taken from,
+		/// reusing every entry of previous that no edit falls within. The
+		/// edits are in the old text's positions, in order and not
+		/// overlapping. previous must outlive the engine's results, and the
+		/// engine must be in ExecutionMode::Dispatch.
+		/// </summary>
+		void Reparse(Text const &text, ParseSnapshot const &previous, std::vector<TextEdit> const &edits);
+		//record every dispatcher and match of the last parse in snapshot, for a later Reparse
+		void TakeSnapshot(ParseSnapshot &snapshot) const;
+		//returns false, leaving forest empty, if main doesn't match the whole text
+		bool BuildForest(ParseForest &forest) const;
+		//the lengths main matched at the start of the text, longest last
+		std::vector<int> GetRootLengths() const;
+		ParseMetrics GetMetrics() const;
+	private:
+		static std::int32_t const NoLink = -1;
+
+		struct Dispatcher {
+			std::int32_t position;
+			std::int32_t symbol;
+			SpinLock lock;
+			//linked lists of MatchClass and Dependency records, newest first
+			std::int32_t firstMatchClass;
+			std::int32_t firstDependency;
+			//a greedy dispatcher's own dependencies that may be cancelled, guarded by the lock
+			std::int32_t firstOwned;
+			//work that may still add matches: the starting work item, resumptions, and incomplete subscriptions
+			std::atomic<std::int32_t> pending;
+			std::int32_t longest;
+			bool completed;
+			//the wavefront liveness pass that last reached it
+			std::int32_t liveMark;
+			//the extent of a dispatcher a Reparse reused, or -1
+			std::int32_t reusedExtent;
+			//started at a sync point rather than asked for
+			bool speculative;
+		};
+
+		struct MatchClass {
+			std::int32_t dispatcher;
+			std::int32_t length;
+			std::int32_t next;
+			std::int32_t firstDerivation;
+			//whether it is in its dispatcher's list yet, which whoever first takes the lock does
+			bool linked;
+			//greedy dispatchers hold their matches back until they complete
+			bool published;
+			//the previous snapshot's match for one a Reparse reused, or ParseSnapshot::Absent
+			std::int32_t reusedMatch;
+		};
+
+		struct Derivation {
+			std::int32_t chain;
+			std::int32_t next;
+		};
+
+		/// <summary>
+		/// The match classes a derivation has consumed so far, as a list
+		/// shared by every derivation with the same prefix. A link is the
+		/// chain of one item; the other paths that reached that item hang off
+		/// it as a list of alternatives, which are never any link's previous.
+		/// A derivation stands for every path through the alternatives.
+		/// </summary>
+		struct ChainLink {
+			std::int32_t previous;
+			std::int32_t matchClass;
+			std::int32_t alternative;
+		};
+
+		//a production's NFA in a state at a position; in dispatch mode, the items of a (position, dispatcher) pair are a list
+		struct Item {
+			std::int32_t state;
+			std::int32_t chain;
+			std::int32_t next;
+		};
+
+		//scratch for ForEachPath
+		struct PathWalk {
+			std::vector<std::int32_t> links;
+			std::vector<std::int32_t> canonicals;
+			std::vector<std::int32_t> children;
+			std::vector<bool> onPath;
+		};
+
+		/// <summary>
+		/// A production waiting, in an NFA state, on another dispatcher's
+		/// matches. Until the other completes it holds a count of the owner's
+		/// pending work, let go of by whichever comes first: the completion,
+		/// or a greedy owner cancelling it once its longest match is beyond
+		/// the dependency's reach.
+		/// </summary>
+		struct Dependency {
+			std::int32_t owner;
+			std::int32_t state;
+			std::int32_t chain;
+			std::int32_t next;
+			std::int32_t nextOwned;
+			//the longest match the owner can find along this path, or Grammar::Unbounded
+			std::int32_t reach;
+			std::atomic<bool> cancelled;
+			std::atomic<bool> released;
+		};
+
+		static void StartItem(void *context, std::int32_t dispatcher, std::int32_t unused);
+		static void ResumeItem(void *context, std::int32_t dependency, std::int32_t matchClass);
+		static void CompleteItem(void *context, std::int32_t dispatcher, std::int32_t unused);
+		static void SpeculateItem(void *context, std::int32_t first, std::int32_t last);
+
+		std::int32_t GetDispatcher(std::int32_t position, std::int32_t symbol, bool speculative = false);
+		//start the sync points' symbols after every separator that starts in [first, last)
+		void Speculate(std::int32_t first, std::int32_t last);
+		//false, counting it, if the grammar's lookahead says symbol can't match at position
+		bool PassesLookahead(std::int32_t position, std::int32_t symbol);
+		bool MatchTerminal(std::int32_t symbol, std::int32_t position, int &length) const;
+		//false, counting it, if symbol's precedence rules out a derivation with these children
+		bool PassesPrecedence(std::int32_t symbol, std::int32_t chain);
+		void Start(std::int32_t dispatcher);
+		void EnterState(std::int32_t dispatcher, std::int32_t state, std::int32_t position, std::int32_t chain);
+		void Subscribe(std::int32_t owner, std::int32_t state, std::int32_t position, std::int32_t chain, std::int32_t symbol);
+		void AddResult(std::int32_t dispatcher, std::int32_t length, std::int32_t chain);
+		//call with the dispatcher's lock held
+		void Publish(Dispatcher &dispatcher, std::int32_t matchClass);
+		//call with the dispatcher's lock held, after its longest match grew
+		void CancelBeaten(Dispatcher &dispatcher);
+		void Resume(std::int32_t dependency, std::int32_t matchClass);
+		std::int32_t AddLink(std::int32_t previous, std::int32_t matchClass);
+		std::int32_t AddDispatchItem(std::int32_t state, std::int32_t chain, std::int32_t next);
+		//returns the chain of a new item for owner, or NoLink if an item it already had took the path
+		std::int32_t JoinItem(std::int32_t owner, std::int32_t state, std::int32_t position, std::int32_t previous, std::int32_t matchClass);
+		//whether a path can be packed into canonical without changing what PassesPrecedence sees
+		bool GetIsMergeable(std::int32_t symbol, std::int32_t canonical, std::int32_t previous, std::int32_t matchClass) const;
+		//pack the path (previous, matchClass) into the item whose chain is canonical; dispatch mode holds the owner's lock
+		void Merge(std::int32_t canonical, std::int32_t previous, std::int32_t matchClass);
+		//calls visit(children) with each path chain packs, children first to last; paths round a cycle are skipped
+		template<typename Visit>
+		void ForEachPath(std::int32_t chain, PathWalk &walk, Visit visit) const;
+		void Complete(std::int32_t dispatcher);
+		void Release(std::int32_t dispatcher);
+		void Post(void (*function)(void *, std::int32_t, std::int32_t), std::int32_t a, std::int32_t b);
+		void Reset();
+		void ParseText(Text const &text);
+		std::int32_t FindRootMatchClass() const;
+		//add a node for each of roots, and everything below them, to forest; nodeOf maps match classes to their nodes
+		void WriteForest(ParseForest &forest, std::vector<std::int32_t> const &roots, std::vector<NodeId> &nodeOf) const;
+
+		//take the dispatcher's matches from the previous snapshot, if no edit touched what it read
+		bool Reuse(std::int32_t dispatcher);
+		//-1 for a position in inserted text
+		std::int32_t OldPosition(std::int32_t position) const;
+		std::int32_t NewPosition(std::int32_t oldPosition) const;
+		//whether no edit falls within what an entry of the previous snapshot read
+		bool GetIsClean(std::int32_t oldPosition, std::int32_t extent) const;
+		std::vector<std::int32_t> GetExtents() const;
+
+		//one position's items, as parallel arrays, and what was found there
+		struct Column {
+			std::vector<std::int32_t> states;
+			std::vector<std::int32_t> owners;
+			std::vector<std::int32_t> chains;
+			//owner to its first item here, and each item to the next with the same owner
+			FlatMap itemsOfOwner;
+			std::vector<std::int32_t> sameOwner;
+			std::size_t processed;
+			//symbol to the dispatcher started here, and dispatcher to its match class ending here
+			FlatMap predictions;
+			FlatMap completions;
+		};
+
+		void ParseWavefront();
+		Column &GetColumn(std::int32_t position);
+		void AddItem(std::int32_t position, std::int32_t state, std::int32_t owner, std::int32_t chain);
+		std::int32_t WavefrontDispatcher(std::int32_t position, std::int32_t symbol);
+		void WavefrontSubscribe(std::int32_t owner, std::int32_t state, std::int32_t position, std::int32_t chain, std::int32_t symbol);
+		void WavefrontResult(std::int32_t dispatcher, std::int32_t length, std::int32_t chain);
+		void WavefrontPublish(Dispatcher &dispatcher, std::int32_t matchClass);
+		void WavefrontAdvance(std::int32_t dependency, std::int32_t matchClass);
+		//returns true if completing greedy dispatchers added items at or before high
+		bool CompleteUnreachable(std::int32_t high);
+		void RecycleColumnsBefore(std::int32_t position);
+		//emit main's children before the cut, if they're settled, then compact
+		void Cut();
+		//renumber whatever is still reachable into fresh arenas; cutLink and the chain before it are dropped
+		void Compact(std::int32_t cutLink);
+		std::size_t GetRecordCount() const;
+
+		Grammar const &grammar;
+		IScheduler &scheduler;
+		ExecutionMode mode;
+		LookaheadMode lookahead;
+		TerminalScan const *terminalScan;
+		std::size_t speculationChunkSize;
+		Text const *text;
+		std::int32_t root;
+		MemoTable dispatcherTable;
+		//keyed by (dispatcher, length)
+		MemoTable matchClassTable;
+		ConcurrentArena<Dispatcher> dispatchers;
+		ConcurrentArena<MatchClass> matchClasses;
+		ConcurrentArena<Derivation> derivations;
+		ConcurrentArena<ChainLink> chainLinks;
+		ConcurrentArena<Dependency> dependencies;
+		//keyed by (position, dispatcher), to the first of its items there
+		MemoTable itemTable;
+		ConcurrentArena<Item> items;
+		std::size_t forcedCompletionCount;
+		std::atomic<std::size_t> prunedCount;
+		std::atomic<std::size_t> filteredCount;
+		std::atomic<std::size_t> cancelledCount;
+		std::atomic<std::size_t> mergedCount;
+
+		ParseSnapshot const *previous;
+		std::vector<TextEdit> edits;
+		//where each edit's inserted text starts in the new text, and how far the old text after it moved
+		std::vector<std::int32_t> editStarts;
+		std::vector<std::int32_t> editShifts;
+		std::atomic<std::size_t> reusedCount;
+
+		//the columns from windowStart on, columns to reuse, and the wavefront's state
+		std::deque<std::unique_ptr<Column>> window;
+		std::vector<std::unique_ptr<Column>> spareColumns;
+		std::int32_t windowStart;
+		std::int32_t lowestDirty;
+		std::vector<std::int32_t> openDispatchers;
+		std::vector<std::int32_t> liveQueue;
+		std::int32_t liveEpoch;
+		std::size_t peakColumnCount;
+
+		static std::size_t const MinCompaction = 1 << 16;
+		IForestSink *sink;
+		//the record count that triggers the next cut
+		std::size_t compactAt;
+		std::size_t emittedCount;
+		std::size_t compactionCount;
+		ParseForest emitted;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "ParseForest.h"
+#include <stdexcept>
+#include <utility>
+
+namespace Parlex {
+	ParseForest::ParseForest() : root(NoNode), sealed(true) {}
+
+	ParseForest::ParseForest(ParseForest &&other) :
+		nodes(std::move(other.nodes)),
+		derivations(std::move(other.derivations)),
+		owners(std::move(other.owners)),
+		children(std::move(other.children)),
+		root(other.root),
+		sealed(other.sealed)
+	{
+		other.Release();
+	}
+
+	ParseForest &ParseForest::operator=(ParseForest &&other) {
+		if (this != &other) {
+			nodes = std::move(other.nodes);
+			derivations = std::move(other.derivations);
+			owners = std::move(other.owners);
+			children = std::move(other.children);
+			root = other.root;
+			sealed = other.sealed;
+			other.Release();
+		}
+		return *this;
+	}
+
+	void ParseForest::Reserve(std::size_t nodeCount, std::size_t derivationCount, std::size_t childCount) {
+		nodes.reserve(nodeCount);
+		derivations.reserve(derivationCount);
+		owners.reserve(derivationCount);
+		children.reserve(childCount);
+	}
+
+	NodeId ParseForest::AddNode(int symbol, int start, int length) {
+		SymbolNode node = { symbol, start, length, 0, 0 };
+		nodes.push_back(node);
+		return static_cast<NodeId>(nodes.size() - 1);
+	}
+
+	void ParseForest::AddDerivation(NodeId node, NodeId const *childIds, int childCount) {
+		SymbolNode &owner = nodes[node];
+		int index = static_cast<int>(derivations.size());
+		if (owner.derivationCount == 0) {
+			owner.firstDerivation = index;
+		} else if (owner.firstDerivation + owner.derivationCount != index) {
+			sealed = false;
+		}
+		owner.derivationCount++;
+		Derivation derivation = { static_cast<std::int32_t>(children.size()), childCount };
+		derivations.push_back(derivation);
+		owners.push_back(node);
+		children.insert(children.end(), childIds, childIds + childCount);
+	}
+
+	void ParseForest::Seal() {
+		if (sealed) return;
+		//a counting sort on the owner keeps each node's derivations in the order they were added
+		std::int32_t next = 0;
+		for (SymbolNode &node : nodes) {
+			node.firstDerivation = next;
+			next += node.derivationCount;
+		}
+		std::vector<Derivation> sortedDerivations(derivations.size());
+		std::vector<NodeId> sortedOwners(owners.size());
+		std::vector<std::int32_t> cursors(nodes.size());
+		for (std::size_t i = 0; i < nodes.size(); ++i) {
+			cursors[i] = nodes[i].firstDerivation;
+		}
+		for (std::size_t i = 0; i < derivations.size(); ++i) {
+			std::int32_t target = cursors[owners[i]]++;
+			sortedDerivations[target] = derivations[i];
+			sortedOwners[target] = owners[i];
+		}
+		derivations.swap(sortedDerivations);
+		owners.swap(sortedOwners);
+		sealed = true;
+	}
+
+	bool ParseForest::GetIsSealed() const {
+		return sealed;
+	}
+
+	void ParseForest::RemoveUnreachable() {
+		Seal();
+		if (root == NoNode) {
+			Clear();
+			return;
+		}
+		//the kept nodes, in the order they're met, are their own queue: a node's
+		//children are numbered while it is copied, so each node is read once
+		std::vector<NodeId> renumbered(nodes.size(), NoNode);
+		std::vector<NodeId> order;
+		renumbered[root] = 0;
+		order.push_back(root);
+		std::vector<SymbolNode> keptNodes;
+		std::vector<Derivation> keptDerivations;
+		std::vector<NodeId> keptOwners;
+		std::vector<NodeId> keptChildren;
+		for (std::size_t next = 0; next < order.size(); ++next) {
+			SymbolNode node = nodes[order[next]];
+			std::int32_t firstDerivation = static_cast<std::int32_t>(keptDerivations.size());
+			for (std::int32_t i = node.firstDerivation; i < node.firstDerivation + node.derivationCount; ++i) {
+				Derivation const &derivation = derivations[i];
+				Derivation kept = { static_cast<std::int32_t>(keptChildren.size()), derivation.childCount };
+				for (std::int32_t j = derivation.firstChild; j < derivation.firstChild + derivation.childCount; ++j) {
+					NodeId child = children[j];
+					if (renumbered[child] == NoNode) {
+						renumbered[child] = static_cast<NodeId>(order.size());
+						order.push_back(child);
+					}
+					keptChildren.push_back(renumbered[child]);
+				}
+				keptDerivations.push_back(kept);
+				keptOwners.push_back(static_cast<NodeId>(next));
+			}
+			node.firstDerivation = node.derivationCount == 0 ? 0 : firstDerivation;
+			keptNodes.push_back(node);
+		}
+		nodes.swap(keptNodes);
+		derivations.swap(keptDerivations);
+		owners.swap(keptOwners);
+		children.swap(keptChildren);
+		root = 0;
+	}
+
+	void ParseForest::Clear() {
+		nodes.clear();
+		derivations.clear();
+		owners.clear();
+		children.clear();
+		root = NoNode;
+		sealed = true;
+	}
+
+	void ParseForest::Release() {
+		std::vector<SymbolNode>().swap(nodes);
+		std::vector<Derivation>().swap(derivations);
+		std::vector<NodeId>().swap(owners);
+		std::vector<NodeId>().swap(children);
+		root = NoNode;
+		sealed = true;
+	}
+
+	NodeId ParseForest::GetRoot() const {
+		return root;
+	}
+
+	void ParseForest::SetRoot(NodeId node) {
+		root = node;
+	}
+
+	std::size_t ParseForest::GetNodeCount() const {
+		return nodes.size();
+	}
+
+	std::size_t ParseForest::GetDerivationCount() const {
+		return derivations.size();
+	}
+
+	ParseForest::SymbolNode const &ParseForest::GetNode(NodeId node) const {
+		return nodes[node];
+	}
+
+	Span<ParseForest::Derivation> ParseForest::GetDerivations(NodeId node) const {
+		if (!sealed) {
+			throw std::logic_error("the forest must be sealed before it is walked");
+		}
+		SymbolNode const &symbolNode = nodes[node];
+		if (symbolNode.derivationCount == 0) return Span<Derivation>();
+		return Span<Derivation>(&derivations[symbolNode.firstDerivation], symbolNode.derivationCount);
+	}
+
+	Span<NodeId> ParseForest::GetChildren(Derivation const &derivation) const {
+		if (derivation.childCount == 0) return Span<NodeId>();
+		return Span<NodeId>(&children[derivation.firstChild], derivation.childCount);
+	}
+
+	NodeId ParseForest::GetOwner(std::size_t derivation) const {
+		return owners[derivation];
+	}
+
+	bool ParseForest::GetIsAmbiguous() const {
+		for (SymbolNode const &node : nodes) {
+			if (node.derivationCount > 1) return true;
+		}
+		return false;
+	}
+
+	std::size_t ParseForest::GetMemoryUsage() const {
+		return nodes.capacity() * sizeof(SymbolNode) +
+			derivations.capacity() * sizeof(Derivation) +
+			owners.capacity() * sizeof(NodeId) +
+			children.capacity() * sizeof(NodeId);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef _PARSE_FOREST_H_
+#define _PARSE_FOREST_H_
+
+#include "Span.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Parlex {
+	typedef std::int32_t NodeId;
+	NodeId const NoNode = -1;
+
+	/// <summary>
+	/// A shared packed parse forest, the native counterpart of
+	/// AbstractSyntaxGraph. A symbol node is a (symbol, start, length) match
+	/// class with a dense id. Its derivations, the packed nodes, are a
+	/// contiguous run of one array, and each derivation's children are a
+	/// contiguous run of symbol node ids in another, so nothing is allocated
+	/// per node and Clear or Release drops the whole forest at once.
+	/// </summary>
+	class ParseForest {
+		ParseForest(ParseForest const &other) = delete;
+		ParseForest &operator=(ParseForest const &other) = delete;
+	public:
+		struct SymbolNode {
+			std::int32_t symbol;
+			std::int32_t start;
+			std::int32_t length;
+			std::int32_t firstDerivation;
+			std::int32_t derivationCount;
+		};
+
+		struct Derivation {
+			std::int32_t firstChild;
+			std::int32_t childCount;
+		};
+
+		ParseForest();
+		ParseForest(ParseForest &&other);
+		ParseForest &operator=(ParseForest &&other);
+
+		void Reserve(std::size_t nodeCount, std::size_t derivationCount, std::size_t childCount);
+		NodeId AddNode(int symbol, int start, int length);
+		//derivations of a node may be added in any order relative to other
+		//nodes', but the forest must then be sealed before it is walked
+		void AddDerivation(NodeId node, NodeId const *children, int childCount);
+		//sort the derivations so that each node's are contiguous; cheap if they already are
+		void Seal();
+		bool GetIsSealed() const;
+		//drop every node the root can't reach, numbering the rest in the order a
+		//walk from the root meets them; one pass over what's kept, after sealing
+		void RemoveUnreachable();
+
+		//forget every node but keep the storage for the next parse
+		void Clear();
+		//forget every node and return the storage
+		void Release();
+
+		NodeId GetRoot() const;
+		void SetRoot(NodeId node);
+		std::size_t GetNodeCount() const;
+		std::size_t GetDerivationCount() const;
+		SymbolNode const &GetNode(NodeId node) const;
+		Span<Derivation> GetDerivations(NodeId node) const;
+		Span<NodeId> GetChildren(Derivation const &derivation) const;
+		//the node that a derivation, indexed as in the whole forest, belongs to
+		NodeId GetOwner(std::size_t derivation) const;
+		bool GetIsAmbiguous() const;
+		std::size_t GetMemoryUsage() const;
+	private:
+		std::vector<SymbolNode> nodes;
+		std::vector<Derivation> derivations;
+		std::vector<NodeId> owners;
+		std::vector<NodeId> children;
+		NodeId root;
+		bool sealed;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "ParseSnapshot.h"
+#include <stdexcept>
+
+namespace Parlex {
+	ParseSnapshot::ParseSnapshot() : grammar(nullptr), textSize(0) {}
+
+	void ParseSnapshot::Clear() {
+		grammar = nullptr;
+		textSize = 0;
+		index.Clear();
+		entries.clear();
+		entryMatches.clear();
+		matches.clear();
+		derivations.clear();
+		chainLinks.clear();
+	}
+
+	void ParseSnapshot::Reset(Grammar const &grammar, std::size_t textSize) {
+		Clear();
+		this->grammar = &grammar;
+		this->textSize = textSize;
+	}
+
+	std::int32_t ParseSnapshot::AddMatch(std::int32_t start, std::int32_t symbol, std::int32_t length) {
+		Match match = { start, symbol, length, 0, 0 };
+		matches.push_back(match);
+		return static_cast<std::int32_t>(matches.size() - 1);
+	}
+
+	void ParseSnapshot::SetDerivations(std::int32_t match, std::int32_t const *chains, std::int32_t count) {
+		Match &record = matches.at(match);
+		if (record.derivationCount != 0) {
+			throw std::logic_error("a match's derivations can only be set once");
+		}
+		record.firstDerivation = static_cast<std::int32_t>(derivations.size());
+		record.derivationCount = count;
+		derivations.insert(derivations.end(), chains, chains + count);
+	}
+
+	std::int32_t ParseSnapshot::AddChainLink(std::int32_t previous, std::int32_t match) {
+		ChainLink link = { previous, match };
+		chainLinks.push_back(link);
+		return static_cast<std::int32_t>(chainLinks.size() - 1);
+	}
+
+	void ParseSnapshot::AddEntry(std::int32_t position, std::int32_t symbol, std::int32_t extent, std::int32_t const *matches, std::int32_t matchCount) {
+		Entry entry = { position, symbol, extent, static_cast<std::int32_t>(entryMatches.size()), matchCount };
+		entryMatches.insert(entryMatches.end(), matches, matches + matchCount);
+		std::int32_t id = static_cast<std::int32_t>(entries.size());
+		entries.push_back(entry);
+		index.GetOrAdd(MemoTable::PackKey(position, symbol), [id] { return id; });
+	}
+
+	Grammar const *ParseSnapshot::GetGrammar() const {
+		return grammar;
+	}
+
+	std::size_t ParseSnapshot::GetTextSize() const {
+		return textSize;
+	}
+
+	std::int32_t ParseSnapshot::Find(std::int32_t position, std::int32_t symbol) const {
+		return index.Find(MemoTable::PackKey(position, symbol));
+	}
+
+	std::size_t ParseSnapshot::GetEntryCount() const {
+		return entries.size();
+	}
+
+	ParseSnapshot::Entry const &ParseSnapshot::GetEntry(std::int32_t entry) const {
+		return entries[entry];
+	}
+
+	Span<std::int32_t> ParseSnapshot::GetEntryMatches(std::int32_t entry) const {
+		Entry const &record = entries[entry];
+		if (record.matchCount == 0) return Span<std::int32_t>();
+		return Span<std::int32_t>(&entryMatches[record.firstMatch], record.matchCount);
+	}
+
+	std::size_t ParseSnapshot::GetMatchCount() const {
+		return matches.size();
+	}
+
+	ParseSnapshot::Match const &ParseSnapshot::GetMatch(std::int32_t match) const {
+		return matches[match];
+	}
+
+	Span<std::int32_t> ParseSnapshot::GetDerivations(std::int32_t match) const {
+		Match const &record = matches[match];
+		if (record.derivationCount == 0) return Span<std::int32_t>();
+		return Span<std::int32_t>(&derivations[record.firstDerivation], record.derivationCount);
+	}
+
+	std::size_t ParseSnapshot::GetChainLinkCount() const {
+		return chainLinks.size();
+	}
+
+	ParseSnapshot::ChainLink const &ParseSnapshot::GetChainLink(std::int32_t link) const {
+		return chainLinks[link];
+	}
+
+	std::size_t ParseSnapshot::GetMemoryUsage() const {
+		return index.GetMemoryUsage() + entries.capacity() * sizeof(Entry) + entryMatches.capacity() * sizeof(std::int32_t) +
+			matches.capacity() * sizeof(Match) + derivations.capacity() * sizeof(std::int32_t) + chainLinks.capacity() * sizeof(ChainLink);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#ifndef _PARSE_SNAPSHOT_H_
+#define _PARSE_SNAPSHOT_H_
+
+#include "Grammar.h"
+#include "MemoTable.h"
+#include "Span.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Parlex {
+	//replace removed code points at position with inserted new ones; position and removed are in the old text
+	struct TextEdit {
+		std::int32_t position;
+		std::int32_t removed;
+		std::int32_t inserted;
+	};
+
+	/// <summary>
+	/// What a parse found, kept so the next parse of an edited text can
+	/// reuse it. There is an entry per (position, symbol) pair that was
+	/// asked for, with the matches it published and its extent: the end of
+	/// the text it read, one past the text if it looked at the end. An
+	/// entry that no edit falls within is still right after the edits,
+	/// shifted. The matches form a packed forest whose derivations are
+	/// chains of children shared between derivations with a common prefix,
+	/// as in the engine, so a production with a match per prefix of a long
+	/// repetition stays linear.
+	/// </summary>
+	class ParseSnapshot {
+		ParseSnapshot(ParseSnapshot const &other) = delete;
+		ParseSnapshot &operator=(ParseSnapshot const &other) = delete;
+	public:
+		static std::int32_t const Absent = -1;
+		static std::int32_t const NoLink = -1;
+
+		struct Entry {
+			std::int32_t position;
+			std::int32_t symbol;
+			std::int32_t extent;
+			std::int32_t firstMatch;
+			std::int32_t matchCount;
+		};
+
+		struct Match {
+			std::int32_t start;
+			std::int32_t symbol;
+			std::int32_t length;
+			std::int32_t firstDerivation;
+			std::int32_t derivationCount;
+		};
+
+		struct ChainLink {
+			std::int32_t previous;
+			std::int32_t match;
+		};
+
+		ParseSnapshot();
+
+		void Clear();
+		void Reset(Grammar const &grammar, std::size_t textSize);
+		std::int32_t AddMatch(std::int32_t start, std::int32_t symbol, std::int32_t length);
+		//each derivation is the last link of its chain of children; called at most once per match
+		void SetDerivations(std::int32_t match, std::int32_t const *chains, std::int32_t count);
+		std::int32_t AddChainLink(std::int32_t previous, std::int32_t match);
+		void AddEntry(std::int32_t position, std::int32_t symbol, std::int32_t extent, std::int32_t const *matches, std::int32_t matchCount);
+
+		Grammar const *GetGrammar() const;
+		std::size_t GetTextSize() const;
+		//returns Absent if nothing was asked for symbol at position
+		std::int32_t Find(std::int32_t position, std::int32_t symbol) const;
+		std::size_t GetEntryCount() const;
+		Entry const &GetEntry(std::int32_t entry) const;
+		Span<std::int32_t> GetEntryMatches(std::int32_t entry) const;
+		std::size_t GetMatchCount() const;
+		Match const &GetMatch(std::int32_t match) const;
+		Span<std::int32_t> GetDerivations(std::int32_t match) const;
+		std::size_t GetChainLinkCount() const;
+		ChainLink const &GetChainLink(std::int32_t link) const;
+		std::size_t GetMemoryUsage() const;
+	private:
+		Grammar const *grammar;
+		std::size_t textSize;
+		MemoTable index;
+		std::vector<Entry> entries;
+		std::vector<std::int32_t> entryMatches;
+		std::vector<Match> matches;
+		std::vector<std::int32_t> derivations;
+		std::vector<ChainLink> chainLinks;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "PositionIndex.h"
+#include <algorithm>
+#include <stdexcept>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARLEX_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Parlex {
+	namespace {
+		int Utf8Length(char32_t c) {
+			return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+		}
+
+		//the UTF-8 size of count code points, adding base + i + 1 to lineStarts, if given, for each '\n' at i
+		std::int64_t Scan(char32_t const *codePoints, std::size_t count, std::int64_t base, std::vector<std::int64_t> *lineStarts) {
+			std::int64_t bytes = 0;
+			std::size_t i = 0;
+#ifdef PARLEX_SSE2
+			//each lane counts how many of the 0x7f, 0x7ff and 0xffff bounds its code points pass
+			__m128i extra = _mm_setzero_si128();
+			__m128i const newline = _mm_set1_epi32('\n');
+			__m128i const twoBytes = _mm_set1_epi32(0x7f);
+			__m128i const threeBytes = _mm_set1_epi32(0x7ff);
+			__m128i const fourBytes = _mm_set1_epi32(0xffff);
+			for (; i + 4 <= count; i += 4) {
+				__m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(codePoints + i));
+				extra = _mm_sub_epi32(extra, _mm_cmpgt_epi32(block, twoBytes));
+				extra = _mm_sub_epi32(extra, _mm_cmpgt_epi32(block, threeBytes));
+				extra = _mm_sub_epi32(extra, _mm_cmpgt_epi32(block, fourBytes));
+				if (lineStarts != nullptr) {
+					int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, newline)));
+					for (int lane = 0; mask != 0; ++lane, mask >>= 1) {
+						if ((mask & 1) != 0) lineStarts->push_back(base + static_cast<std::int64_t>(i) + lane + 1);
+					}
+				}
+			}
+			std::int32_t lanes[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), extra);
+			bytes = static_cast<std::int64_t>(i) + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+			for (; i < count; ++i) {
+				bytes += Utf8Length(codePoints[i]);
+				if (lineStarts != nullptr && codePoints[i] == '\n') lineStarts->push_back(base + static_cast<std::int64_t>(i) + 1);
+			}
+			return bytes;
+		}
+	}
+
+	void PositionIndex::ShiftedPositions::Reset(std::int64_t first) {
+		values.assign(1, first);
+		shiftFrom = 1;
+		shift = 0;
+	}
+
+	std::size_t PositionIndex::ShiftedPositions::UpperBound(std::int64_t value, std::size_t hint) const {
+		//a search around the hint touches a few nearby entries where a plain one would miss the cache across the whole array
+		std::size_t count = values.size();
+		std::size_t low = std::min(hint, count);
+		std::size_t high = low;
+		std::size_t step = 1;
+		if (low < count && Get(low) <= value) {
+			low = high = low + 1;
+			while (high < count && Get(high) <= value) {
+				low = high + 1;
+				high = low + step;
+				step *= 2;
+			}
+			high = std::min(high, count);
+		} else {
+			while (low > 0 && Get(low - 1) > value) {
+				high = low - 1;
+				low = high > step ? high - step : 0;
+				step *= 2;
+			}
+		}
+		while (low < high) {
+			std::size_t middle = low + (high - low) / 2;
+			if (Get(middle) <= value) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+		return low;
+	}
+
+	void PositionIndex::ShiftedPositions::Splice(std::size_t first, std::size_t last, std::vector<std::int64_t> const &added, std::int64_t delta) {
+		//move the boundary to last: entries it passes over take on the shift, or give it up
+		if (last < shiftFrom) {
+			for (std::size_t i = last; i < shiftFrom; ++i) values[i] -= shift;
+		} else {
+			for (std::size_t i = shiftFrom; i < last; ++i) values[i] += shift;
+		}
+		shift += delta;
+		//what's replaced lies before the boundary, so added goes in as it is
+		std::size_t common = std::min(last - first, added.size());
+		std::copy(added.begin(), added.begin() + common, values.begin() + first);
+		if (added.size() > common) {
+			values.insert(values.begin() + last, added.begin() + common, added.end());
+		} else {
+			values.erase(values.begin() + first + common, values.begin() + last);
+		}
+		shiftFrom = first + added.size();
+	}
+
+	PositionIndex::PositionIndex() : text(nullptr), codePointCount(0), byteCount(0) {
+		lineStarts.Reset(0);
+		checkpointCodePoints.Reset(0);
+		checkpointBytes.Reset(0);
+	}
+
+	void PositionIndex::Build(Text const &text) {
+		if (text.size() > 0x7fffffff) {
+			throw std::invalid_argument("the text is too long for code point positions");
+		}
+		this->text = &text;
+		codePointCount = static_cast<std::int32_t>(text.size());
+		lineStarts.Reset(0);
+		checkpointCodePoints.Reset(0);
+		checkpointBytes.Reset(0);
+		byteCount = AddCheckpoints(0, 0, codePointCount, checkpointCodePoints.values, checkpointBytes.values, &lineStarts.values);
+		lineStarts.shiftFrom = lineStarts.values.size();
+		checkpointCodePoints.shiftFrom = checkpointCodePoints.values.size();
+		checkpointBytes.shiftFrom = checkpointBytes.values.size();
+	}
+
+	std::int64_t PositionIndex::AddCheckpoints(std::int64_t first, std::int64_t byte, std::int64_t end, std::vector<std::int64_t> &codePoints, std::vector<std::int64_t> &bytes, std::vector<std::int64_t> *lines) const {
+		for (std::int64_t position = first; position < end; position += CheckpointInterval) {
+			std::int64_t last = std::min(position + CheckpointInterval, end);
+			byte += Scan(text->data() + position, static_cast<std::size_t>(last - position), position, lines);
+			if (last < end) {
+				codePoints.push_back(last);
+				bytes.push_back(byte);
+			}
+		}
+		return byte;
+	}
+
+	void PositionIndex::Edit(Text const &text, std::int32_t start, std::int32_t removed, std::int32_t inserted) {
+		if (start < 0 || removed < 0 || inserted < 0 || start + std::int64_t(removed) > codePointCount || static_cast<std::int64_t>(text.size()) != std::int64_t(codePointCount) - removed + inserted || text.size() > 0x7fffffff) {
+			throw std::invalid_argument("the edit doesn't agree with the text's size");
+		}
+		this->text = &text;
+		codePointCount = static_cast<std::int32_t>(text.size());
+		std::int64_t delta = std::int64_t(inserted) - removed;
+		std::int64_t removedEnd = std::int64_t(start) + removed;
+
+		//lines starting after start and up to the end of what was removed began after a removed '\n'
+		addedLines.clear();
+		if (inserted > 0) Scan(text.data() + start, inserted, start, &addedLines);
+		std::size_t firstLine = lineStarts.UpperBound(start, Guess(start, codePointCount, lineStarts));
+		std::size_t lastLine = lineStarts.UpperBound(removedEnd, Guess(removedEnd, codePointCount, lineStarts));
+		lineStarts.Splice(firstLine, lastLine, addedLines, delta);
+
+		//the checkpoints from the last one at or before start to the first past the removed code points are laid again
+		std::size_t before = checkpointCodePoints.UpperBound(start, Guess(start, codePointCount, checkpointCodePoints)) - 1;
+		std::size_t after = checkpointCodePoints.UpperBound(removedEnd, Guess(removedEnd, codePointCount, checkpointCodePoints));
+		bool hasAfter = after < checkpointCodePoints.values.size();
+		std::int64_t end = hasAfter ? checkpointCodePoints.Get(after) + delta : static_cast<std::int64_t>(text.size());
+		addedCodePoints.clear();
+		addedBytes.clear();
+		std::int64_t endByte = AddCheckpoints(checkpointCodePoints.Get(before), checkpointBytes.Get(before), end, addedCodePoints, addedBytes, nullptr);
+		std::int64_t byteDelta = hasAfter ? endByte - checkpointBytes.Get(after) : endByte - byteCount;
+		checkpointCodePoints.Splice(before + 1, after, addedCodePoints, delta);
+		checkpointBytes.Splice(before + 1, after, addedBytes, byteDelta);
+		byteCount += byteDelta;
+	}
+
+	std::int32_t PositionIndex::GetCodePointCount() const {
+		return codePointCount;
+	}
+
+	std::int64_t PositionIndex::GetByteCount() const {
+		return byteCount;
+	}
+
+	std::int32_t PositionIndex::GetLineCount() const {
+		return static_cast<std::int32_t>(lineStarts.values.size());
+	}
+
+	std::int64_t PositionIndex::GetByteOffset(std::int32_t codePoint) const {
+		if (codePoint < 0 || codePoint > GetCodePointCount()) {
+			throw std::out_of_range("the code point is outside the text");
+		}
+		std::size_t checkpoint = checkpointCodePoints.UpperBound(codePoint, Guess(codePoint, codePointCount, checkpointCodePoints)) - 1;
+		std::int64_t first = checkpointCodePoints.Get(checkpoint);
+		std::int64_t byte = checkpointBytes.Get(checkpoint);
+		if (GetIsAscii(checkpoint)) return byte + (codePoint - first);
+		return byte + Scan(text->data() + first, static_cast<std::size_t>(codePoint - first), 0, nullptr);
+	}
+
+	std::int32_t PositionIndex::GetCodePointAtByte(std::int64_t byteOffset) const {
+		if (byteOffset < 0 || byteOffset > byteCount) {
+			throw std::out_of_range("the byte offset is outside the text");
+		}
+		std::size_t checkpoint = checkpointBytes.UpperBound(byteOffset, Guess(byteOffset, byteCount, checkpointBytes)) - 1;
+		std::int64_t codePoint = checkpointCodePoints.Get(checkpoint);
+		std::int64_t byte = checkpointBytes.Get(checkpoint);
+		if (GetIsAscii(checkpoint)) return static_cast<std::int32_t>(codePoint + (byteOffset - byte));
+		Text const &codePoints = *text;
+		while (codePoint < codePointCount) {
+			int length = Utf8Length(codePoints[codePoint]);
+			if (byte + length > byteOffset) break;
+			byte += length;
+			++codePoint;
+		}
+		return static_cast<std::int32_t>(codePoint);
+	}
+
+	std::size_t PositionIndex::Guess(std::int64_t value, std::int64_t total, ShiftedPositions const &positions) {
+		if (total <= 0) return 0;
+		return static_cast<std::size_t>(static_cast<double>(value) / total * (positions.values.size() - 1)) + 1;
+	}
+
+	bool PositionIndex::GetIsAscii(std::size_t checkpoint) const {
+		//an interval whose bytes are as many as its code points needs no scan
+		if (checkpoint + 1 < checkpointBytes.values.size()) {
+			return checkpointBytes.Get(checkpoint + 1) - checkpointBytes.Get(checkpoint) == checkpointCodePoints.Get(checkpoint + 1) - checkpointCodePoints.Get(checkpoint);
+		}
+		return byteCount - checkpointBytes.Get(checkpoint) == codePointCount - checkpointCodePoints.Get(checkpoint);
+	}
+
+	PositionIndex::LineColumn PositionIndex::GetLineColumn(std::int32_t codePoint) const {
+		if (codePoint < 0 || codePoint > GetCodePointCount()) {
+			throw std::out_of_range("the code point is outside the text");
+		}
+		std::size_t line = lineStarts.UpperBound(codePoint, Guess(codePoint, codePointCount, lineStarts)) - 1;
+		LineColumn position = { static_cast<std::int32_t>(line), static_cast<std::int32_t>(codePoint - lineStarts.Get(line)) };
+		return position;
+	}
+
+	std::int32_t PositionIndex::GetCodePointAt(LineColumn position) const {
+		std::int64_t codePoint = GetLineStart(position.line) + std::int64_t(position.column);
+		if (position.column < 0 || codePoint > GetCodePointCount()) {
+			throw std::out_of_range("the column is outside the text");
+		}
+		return static_cast<std::int32_t>(codePoint);
+	}
+
+	std::int32_t PositionIndex::GetLineStart(std::int32_t line) const {
+		if (line < 0 || line >= GetLineCount()) {
+			throw std::out_of_range("there's no such line");
+		}
+		return static_cast<std::int32_t>(lineStarts.Get(line));
+	}
+
+	std::size_t PositionIndex::GetMemoryUsage() const {
+		return (lineStarts.values.capacity() + checkpointCodePoints.values.capacity() + checkpointBytes.values.capacity() +
+			addedLines.capacity() + addedCodePoints.capacity() + addedBytes.capacity()) * sizeof(std::int64_t);
+	}
+}
\ No newline at end of file
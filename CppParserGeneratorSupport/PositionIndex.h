@@ -0,0 +1,91 @@
+#ifndef _POSITION_INDEX_H_
+#define _POSITION_INDEX_H_
+
+#include "Text.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Parlex {
+	/// <summary>
+	/// Converts the code point positions a parse reports to and from the
+	/// UTF-8 byte offsets and line/column pairs that messages and editors
+	/// want, without rescanning the text. It keeps where each line starts,
+	/// and the byte offset of a checkpoint every CheckpointInterval code
+	/// points, so a conversion is a binary search and a scan of less than
+	/// one interval. Both are found four code points at a time with SSE2
+	/// where it's available. Edit rescans only what was inserted and the
+	/// interval around it. A line ends after each '\n'.
+	/// </summary>
+	class PositionIndex {
+		PositionIndex(PositionIndex const &other) = delete;
+		PositionIndex &operator=(PositionIndex const &other) = delete;
+	public:
+		static std::int32_t const CheckpointInterval = 64;
+
+		//both from 0; the column counts code points
+		struct LineColumn {
+			std::int32_t line;
+			std::int32_t column;
+		};
+
+		PositionIndex();
+
+		//text must outlive the index, and only change as Edit is told
+		void Build(Text const &text);
+		//text has had the removed code points at start replaced with inserted ones;
+		//throws std::invalid_argument if its size doesn't agree
+		void Edit(Text const &text, std::int32_t start, std::int32_t removed, std::int32_t inserted);
+
+		std::int32_t GetCodePointCount() const;
+		std::int64_t GetByteCount() const;
+		std::int32_t GetLineCount() const;
+		//these throw std::out_of_range for a position past the end of the text
+		std::int64_t GetByteOffset(std::int32_t codePoint) const;
+		//the code point whose encoding byteOffset falls in
+		std::int32_t GetCodePointAtByte(std::int64_t byteOffset) const;
+		LineColumn GetLineColumn(std::int32_t codePoint) const;
+		//the column isn't checked against the length of its line
+		std::int32_t GetCodePointAt(LineColumn position) const;
+		std::int32_t GetLineStart(std::int32_t line) const;
+		std::size_t GetMemoryUsage() const;
+	private:
+		//a sorted array in which the entries from shiftFrom on are stored short by shift,
+		//so an edit only touches the entries between where it is and where the last one was
+		struct ShiftedPositions {
+			std::vector<std::int64_t> values;
+			std::size_t shiftFrom;
+			std::int64_t shift;
+
+			std::int64_t Get(std::size_t i) const {
+				return values[i] + (i >= shiftFrom ? shift : 0);
+			}
+
+			void Reset(std::int64_t first);
+			//the index of the first entry greater than value, galloping out from hint
+			std::size_t UpperBound(std::int64_t value, std::size_t hint) const;
+			//replace the entries in [first, last) with added, and move those after them by delta
+			void Splice(std::size_t first, std::size_t last, std::vector<std::int64_t> const &added, std::int64_t delta);
+		};
+
+		//where value would be if positions were spread evenly over total
+		static std::size_t Guess(std::int64_t value, std::int64_t total, ShiftedPositions const &positions);
+		bool GetIsAscii(std::size_t checkpoint) const;
+		//scans code points from a checkpoint, adding one every interval up to end, and returns the byte offset of end
+		std::int64_t AddCheckpoints(std::int64_t first, std::int64_t byte, std::int64_t end, std::vector<std::int64_t> &codePoints, std::vector<std::int64_t> &bytes, std::vector<std::int64_t> *lines) const;
+
+		Text const *text;
+		//the text's size as last told, which an edit is checked against
+		std::int32_t codePointCount;
+		std::int64_t byteCount;
+		ShiftedPositions lineStarts;
+		ShiftedPositions checkpointCodePoints;
+		ShiftedPositions checkpointBytes;
+		//scratch for Edit
+		std::vector<std::int64_t> addedLines;
+		std::vector<std::int64_t> addedCodePoints;
+		std::vector<std::int64_t> addedBytes;
+	};
+}
+
+#endif
\ No newline at end of file
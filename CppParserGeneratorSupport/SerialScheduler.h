@@ -0,0 +1,34 @@
+#ifndef _SERIAL_SCHEDULER_H_
+#define _SERIAL_SCHEDULER_H_
+
+#include "IScheduler.h"
+#include <deque>
+
+namespace Parlex {
+	/// <summary>
+	/// Runs work items one at a time on the thread that calls Join, most
+	/// recently posted first. For small inputs and for debugging.
+	/// </summary>
+	class SerialScheduler : public IScheduler {
+	public:
+		void Post(WorkItem const &item) {
+			items.push_back(item);
+		}
+
+		void Join() {
+			while (!items.empty()) {
+				WorkItem item = items.back();
+				items.pop_back();
+				item.function(item.context, item.a, item.b);
+			}
+		}
+
+		int GetThreadCount() const {
+			return 1;
+		}
+	private:
+		std::deque<WorkItem> items;
+	};
+}
+
+#endif
\ No newline at end of file
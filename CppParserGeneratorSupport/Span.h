@@ -0,0 +1,24 @@
+#ifndef _SPAN_H_
+#define _SPAN_H_
+
+#include <cstddef>
+
+namespace Parlex {
+	//a view of a contiguous run of elements in one of the native arrays
+	template<typename T>
+	class Span {
+	public:
+		Span() : first(nullptr), last(nullptr) {}
+		Span(T const *first, std::size_t count) : first(first), last(first + count) {}
+		T const *begin() const { return first; }
+		T const *end() const { return last; }
+		std::size_t size() const { return last - first; }
+		bool empty() const { return first == last; }
+		T const &operator[](std::size_t index) const { return first[index]; }
+	private:
+		T const *first;
+		T const *last;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef _SPIN_LOCK_H_
+#define _SPIN_LOCK_H_
+
+#include <atomic>
+#include <thread>
+
+namespace Parlex {
+	//a one byte lock for data that is held for a handful of instructions at a time
+	class SpinLock {
+	public:
+		SpinLock() : held(false) {}
+
+		void lock() {
+			while (held.exchange(true, std::memory_order_acquire)) {
+				while (held.load(std::memory_order_relaxed)) std::this_thread::yield();
+			}
+		}
+
+		void unlock() {
+			held.store(false, std::memory_order_release);
+		}
+	private:
+		std::atomic<bool> held;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "TerminalScan.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace Parlex {
+	TerminalScan::TerminalScan(Grammar const &grammar) : grammar(grammar), text(nullptr), textSize(0), variableCount(0) {
+		if (!grammar.GetIsCompiled()) {
+			throw std::logic_error("the Grammar must be compiled before its terminals are scanned");
+		}
+		terminalOf.assign(grammar.GetSymbolCount(), std::int32_t(NoTerminal));
+		for (int symbol = 0; symbol < grammar.GetSymbolCount(); ++symbol) {
+			if (!grammar.GetIsTerminal(symbol)) continue;
+			if (!grammar.GetIsBound(symbol)) {
+				throw std::logic_error("the function terminal " + grammar.GetName(symbol) + " must be bound before its terminals are scanned");
+			}
+			terminalOf[symbol] = static_cast<std::int32_t>(symbolOf.size());
+			symbolOf.push_back(symbol);
+		}
+		wordsPerRow = std::max<std::size_t>(1, (symbolOf.size() + 63) / 64);
+		lowTable.assign(256 * wordsPerRow, 0);
+		everywhere.assign(wordsPerRow, 0);
+		fixedLengths.assign(symbolOf.size(), -1);
+		variableOf.assign(symbolOf.size(), std::int32_t(NoTerminal));
+		for (std::int32_t terminal = 0; terminal < static_cast<std::int32_t>(symbolOf.size()); ++terminal) {
+			int symbol = symbolOf[terminal];
+			std::uint64_t bit = std::uint64_t(1) << (terminal & 63);
+			std::size_t word = terminal >> 6;
+			switch (grammar.GetKind(symbol)) {
+			case SymbolKind::StringTerminal: {
+				Span<char32_t> text = grammar.GetText(symbol);
+				fixedLengths[terminal] = static_cast<std::int32_t>(text.size());
+				if (text.empty()) {
+					everywhere[word] |= bit;
+				} else if (text[0] < 256) {
+					lowTable[text[0] * wordsPerRow + word] |= bit;
+					if (text.size() > 1) checked.push_back(terminal);
+				} else {
+					highClassified.push_back(terminal);
+				}
+				break;
+			}
+			case SymbolKind::CharacterSetTerminal: {
+				Span<char32_t> ranges = grammar.GetRanges(symbol);
+				fixedLengths[terminal] = 1;
+				for (std::size_t i = 0; i < ranges.size(); i += 2) {
+					for (char32_t c = ranges[i]; c <= std::min<char32_t>(ranges[i + 1], 255); ++c) {
+						lowTable[c * wordsPerRow + word] |= bit;
+					}
+				}
+				if (!ranges.empty() && ranges[ranges.size() - 1] >= 256) highClassified.push_back(terminal);
+				break;
+			}
+			default:
+				variableOf[terminal] = static_cast<std::int32_t>(variableCount++);
+				functions.push_back(terminal);
+				break;
+			}
+		}
+	}
+
+	void TerminalScan::Scan(Text const &text, IScheduler &scheduler, std::size_t chunkSize) {
+		if (chunkSize == 0) {
+			throw std::invalid_argument("chunkSize must be positive");
+		}
+		this->text = &text;
+		textSize = text.size();
+		//every word is written by its chunk, so the rows needn't be cleared first
+		std::size_t rowCount = textSize + 1;
+		rows.resize(rowCount * wordsPerRow);
+		variableLengths.resize(rowCount * variableCount);
+		//whole cache lines of rows per chunk, so neighbouring chunks don't share one
+		chunkSize = (chunkSize + 63) & ~std::size_t(63);
+		for (std::size_t first = 0; first < rowCount; first += chunkSize) {
+			WorkItem item = { ChunkItem, this, static_cast<std::int32_t>(first), static_cast<std::int32_t>(std::min(first + chunkSize, rowCount)) };
+			scheduler.Post(item);
+		}
+		scheduler.Join();
+	}
+
+	void TerminalScan::ChunkItem(void *context, std::int32_t first, std::int32_t last) {
+		static_cast<TerminalScan *>(context)->ScanChunk(first, last);
+	}
+
+	void TerminalScan::ScanChunk(std::int32_t first, std::int32_t last) {
+		Text const &codepoints = *text;
+		for (std::int32_t position = first; position < last; ++position) {
+			std::uint64_t *row = &rows[position * wordsPerRow];
+			std::copy(everywhere.begin(), everywhere.end(), row);
+			int length;
+			if (static_cast<std::size_t>(position) < textSize) {
+				char32_t c = codepoints[position];
+				if (c < 256) {
+					std::uint64_t const *classified = &lowTable[c * wordsPerRow];
+					for (std::size_t i = 0; i < wordsPerRow; ++i) {
+						row[i] |= classified[i];
+					}
+					//a string's tail may run past the chunk; it's checked against the text
+					//itself, so matches across a chunk boundary need no second pass
+					for (std::int32_t terminal : checked) {
+						std::uint64_t bit = std::uint64_t(1) << (terminal & 63);
+						if ((row[terminal >> 6] & bit) != 0 && !grammar.MatchTerminal(symbolOf[terminal], codepoints, position, length)) {
+							row[terminal >> 6] &= ~bit;
+						}
+					}
+				} else {
+					for (std::int32_t terminal : highClassified) {
+						if (grammar.MatchTerminal(symbolOf[terminal], codepoints, position, length)) {
+							row[terminal >> 6] |= std::uint64_t(1) << (terminal & 63);
+						}
+					}
+				}
+			}
+			for (std::int32_t terminal : functions) {
+				if (grammar.MatchTerminal(symbolOf[terminal], codepoints, position, length)) {
+					row[terminal >> 6] |= std::uint64_t(1) << (terminal & 63);
+					variableLengths[position * variableCount + variableOf[terminal]] = length;
+				}
+			}
+		}
+	}
+
+	int TerminalScan::GetTerminalCount() const {
+		return static_cast<int>(symbolOf.size());
+	}
+
+	std::size_t TerminalScan::GetTextSize() const {
+		return textSize;
+	}
+
+	std::size_t TerminalScan::GetMemoryUsage() const {
+		return (rows.capacity() + lowTable.capacity()) * sizeof(std::uint64_t) + variableLengths.capacity() * sizeof(std::int32_t);
+	}
+
+	void TerminalScan::Release() {
+		std::vector<std::uint64_t>().swap(rows);
+		std::vector<std::int32_t>().swap(variableLengths);
+		text = nullptr;
+		textSize = 0;
+	}
+}
\ No newline at end of file
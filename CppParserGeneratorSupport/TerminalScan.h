@@ -0,0 +1,75 @@
+#ifndef _TERMINAL_SCAN_H_
+#define _TERMINAL_SCAN_H_
+
+#include "Text.h"
+#include "Grammar.h"
+#include "IScheduler.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Parlex {
+	/// <summary>
+	/// Every terminal of a grammar run over the whole text up front, as a
+	/// bitset row per position with a bit per terminal. A code point below
+	/// 256 classifies against every character set and one code point string
+	/// at once through a lookup table; longer strings only have their first
+	/// code point looked up before they're checked. The text is scanned in
+	/// chunks posted to an IScheduler, and Match then costs the engine a
+	/// load and a bit test instead of running the terminal.
+	/// </summary>
+	class TerminalScan {
+		TerminalScan(TerminalScan const &other) = delete;
+		TerminalScan &operator=(TerminalScan const &other) = delete;
+	public:
+		static std::int32_t const NoTerminal = -1;
+
+		//the grammar must be compiled, and must outlive the scan
+		explicit TerminalScan(Grammar const &grammar);
+
+		//text must outlive the scan's use; chunkSize is in code points
+		void Scan(Text const &text, IScheduler &scheduler, std::size_t chunkSize = 1 << 14);
+
+		bool Match(int symbol, int position, int &length) const {
+			std::int32_t terminal = terminalOf[symbol];
+			if (terminal == NoTerminal || static_cast<std::size_t>(position) > textSize) return false;
+			std::uint64_t word = rows[position * wordsPerRow + (terminal >> 6)];
+			if (((word >> (terminal & 63)) & 1) == 0) return false;
+			length = fixedLengths[terminal] >= 0 ? fixedLengths[terminal] : variableLengths[position * variableCount + variableOf[terminal]];
+			return true;
+		}
+
+		int GetTerminalCount() const;
+		std::size_t GetTextSize() const;
+		std::size_t GetMemoryUsage() const;
+		void Release();
+	private:
+		static void ChunkItem(void *context, std::int32_t first, std::int32_t last);
+		void ScanChunk(std::int32_t first, std::int32_t last);
+
+		Grammar const &grammar;
+		Text const *text;
+		std::size_t textSize;
+		//symbol to dense terminal index, and back
+		std::vector<std::int32_t> terminalOf;
+		std::vector<std::int32_t> symbolOf;
+		std::size_t wordsPerRow;
+		//for each code point below 256, the terminals that can match, or start matching, on it
+		std::vector<std::uint64_t> lowTable;
+		//bits set on every row, for terminals that match nothing
+		std::vector<std::uint64_t> everywhere;
+		//strings longer than one code point, whose candidates lowTable only suggests
+		std::vector<std::int32_t> checked;
+		//terminals run at every position: functions, and whatever lowTable can't answer above 255
+		std::vector<std::int32_t> functions;
+		std::vector<std::int32_t> highClassified;
+		//the length of a terminal's matches, or -1 when it varies and is kept per position
+		std::vector<std::int32_t> fixedLengths;
+		std::vector<std::int32_t> variableOf;
+		std::size_t variableCount;
+		std::vector<std::uint64_t> rows;
+		std::vector<std::int32_t> variableLengths;
+	};
+}
+
+#endif
\ No newline at end of file
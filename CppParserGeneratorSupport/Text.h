@@ -0,0 +1,9 @@
+#ifndef _TEXT_H_
+#define _TEXT_H_
+
+#include <vector>
+
+//a document as UTF-32 code points, the unit that parse positions count in
+typedef std::vector<char32_t> Text;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "WorkStealingPool.h"
+
+namespace Parlex {
+	namespace {
+		//which pool, and which of its workers, the current thread is
+		thread_local WorkStealingPool *currentPool = nullptr;
+		thread_local int currentWorker = -1;
+	}
+
+	WorkStealingPool::WorkStealingPool(int threadCount) :
+		queued(0), outstanding(0), sleeping(0), nextExternal(0), steals(0), stopping(false)
+	{
+		if (threadCount < 1) {
+			threadCount = std::thread::hardware_concurrency();
+			if (threadCount < 1) threadCount = 1;
+		}
+		for (int i = 0; i < threadCount; ++i) {
+			workers.emplace_back(new Worker);
+		}
+		for (int i = 0; i < threadCount; ++i) {
+			workers[i]->thread = std::thread(&WorkStealingPool::WorkerLoop, this, i);
+		}
+	}
+
+	WorkStealingPool::~WorkStealingPool() {
+		{
+			std::lock_guard<std::mutex> guard(idleLock);
+			stopping = true;
+		}
+		workAvailable.notify_all();
+		for (auto &worker : workers) {
+			worker->thread.join();
+		}
+	}
+
+	void WorkStealingPool::Post(WorkItem const &item) {
+		outstanding.fetch_add(1);
+		int target = currentPool == this ? currentWorker : static_cast<int>(nextExternal.fetch_add(1, std::memory_order_relaxed) % workers.size());
+		{
+			std::lock_guard<std::mutex> guard(workers[target]->lock);
+			workers[target]->items.push_back(item);
+		}
+		queued.fetch_add(1);
+		if (sleeping.load() > 0) {
+			std::lock_guard<std::mutex> guard(idleLock);
+			workAvailable.notify_one();
+		}
+	}
+
+	void WorkStealingPool::Join() {
+		std::unique_lock<std::mutex> guard(idleLock);
+		idle.wait(guard, [this] { return outstanding.load() == 0; });
+	}
+
+	int WorkStealingPool::GetThreadCount() const {
+		return static_cast<int>(workers.size());
+	}
+
+	std::uint64_t WorkStealingPool::GetStealCount() const {
+		return steals.load(std::memory_order_relaxed);
+	}
+
+	bool WorkStealingPool::TryTake(int index, WorkItem &item) {
+		{
+			Worker &own = *workers[index];
+			std::lock_guard<std::mutex> guard(own.lock);
+			if (!own.items.empty()) {
+				item = own.items.back();
+				own.items.pop_back();
+				return true;
+			}
+		}
+		int count = static_cast<int>(workers.size());
+		for (int i = 1; i < count; ++i) {
+			Worker &victim = *workers[(index + i) % count];
+			std::lock_guard<std::mutex> guard(victim.lock);
+			if (!victim.items.empty()) {
+				item = victim.items.front();
+				victim.items.pop_front();
+				steals.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void WorkStealingPool::WorkerLoop(int index) {
+		currentPool = this;
+		currentWorker = index;
+		int misses = 0;
+		for (;;) {
+			WorkItem item;
+			if (queued.load() > 0 && TryTake(index, item)) {
+				queued.fetch_sub(1);
+				misses = 0;
+				item.function(item.context, item.a, item.b);
+				if (outstanding.fetch_sub(1) == 1) {
+					std::lock_guard<std::mutex> guard(idleLock);
+					idle.notify_all();
+				}
+				continue;
+			}
+			if (++misses < 64) {
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex> guard(idleLock);
+			sleeping.fetch_add(1);
+			workAvailable.wait(guard, [this] { return stopping || queued.load() > 0; });
+			sleeping.fetch_sub(1);
+			if (stopping) return;
+			misses = 0;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef _WORK_STEALING_POOL_H_
+#define _WORK_STEALING_POOL_H_
+
+#include "IScheduler.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parlex {
+	/// <summary>
+	/// A fixed set of threads, each with its own deque of work items. A
+	/// thread runs its own newest item first, which keeps it working on the
+	/// input it has just touched, and only steals the oldest item from
+	/// another thread when its own deque is empty.
+	/// </summary>
+	class WorkStealingPool : public IScheduler {
+		WorkStealingPool(WorkStealingPool const &other) = delete;
+	public:
+		//threadCount < 1 means one per hardware thread
+		WorkStealingPool(int threadCount = -1);
+		~WorkStealingPool();
+		void Post(WorkItem const &item);
+		//must not be called from one of the pool's own threads
+		void Join();
+		int GetThreadCount() const;
+		std::uint64_t GetStealCount() const;
+	private:
+		struct Worker {
+			std::mutex lock;
+			std::deque<WorkItem> items;
+			std::thread thread;
+		};
+
+		void WorkerLoop(int index);
+		bool TryTake(int index, WorkItem &item);
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		//posted and not yet taken, and posted and not yet finished
+		std::atomic<std::int64_t> queued;
+		std::atomic<std::int64_t> outstanding;
+		std::atomic<int> sleeping;
+		std::atomic<std::uint32_t> nextExternal;
+		std::atomic<std::uint64_t> steals;
+		std::mutex idleLock;
+		std::condition_variable workAvailable;
+		std::condition_variable idle;
+		bool stopping;
+	};
+}
+
+#endif
\ No newline at end of file
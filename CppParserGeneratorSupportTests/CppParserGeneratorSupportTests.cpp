@@ -0,0 +1,27 @@
+// CppParserGeneratorSupportTests.cpp : Defines the entry point for the console application.
+//
+
+#ifdef _MSC_VER //for doing leak detection
+#	define _CRTDBG_MAP_ALLOC
+#	include <stdlib.h>
+#	include <crtdbg.h>
+#endif
+
+#include "parse_engine_tests.h"
+#include "reparse_tests.h"
+#include "streaming_tests.h"
+#include "forest_image_tests.h"
+#include "position_index_tests.h"
+
+int main()
+{
+#ifdef _MSC_VER
+	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+	parse_engine_tests::test_all();
+	reparse_tests::test_all();
+	streaming_tests::test_all();
+	forest_image_tests::test_all();
+	position_index_tests::test_all();
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "ForestImage.h"
+#include "ParseEngine.h"
+#include "SerialScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class forest_image_tests {
+	//image holds exactly forest, whether read in place or loaded back
+	static void compare(Parlex::ParseForest const &forest, Parlex::ForestImage const &image) {
+		assert(image.GetNodeCount() == forest.GetNodeCount());
+		assert(image.GetDerivationCount() == forest.GetDerivationCount());
+		assert(image.GetRoot() == forest.GetRoot());
+		std::vector<std::int32_t> offsets;
+		std::vector<Parlex::NodeId> children;
+		for (Parlex::NodeId node = 0; std::size_t(node) < forest.GetNodeCount(); node++) {
+			auto const &record = forest.GetNode(node);
+			auto read = image.GetDerivations(node, offsets, children);
+			assert(read.symbol == record.symbol && read.start == record.start && read.length == record.length);
+			auto derivations = forest.GetDerivations(node);
+			assert(std::size_t(read.derivationCount) == derivations.size());
+			assert(offsets.size() == derivations.size() + 1);
+			for (std::size_t index = 0; index < derivations.size(); index++) {
+				auto expected = forest.GetChildren(derivations[index]);
+				assert(std::size_t(offsets[index + 1] - offsets[index]) == expected.size());
+				assert(std::equal(expected.begin(), expected.end(), children.begin() + offsets[index]));
+			}
+		}
+		Parlex::ParseForest loaded;
+		image.Load(loaded);
+		assert(loaded.GetIsSealed() && loaded.GetNodeCount() == forest.GetNodeCount() && loaded.GetRoot() == forest.GetRoot());
+		for (Parlex::NodeId node = 0; std::size_t(node) < forest.GetNodeCount(); node++) {
+			auto expected = forest.GetDerivations(node);
+			auto actual = loaded.GetDerivations(node);
+			assert(expected.size() == actual.size());
+			for (std::size_t index = 0; index < expected.size(); index++) {
+				auto expectedChildren = forest.GetChildren(expected[index]);
+				auto actualChildren = loaded.GetChildren(actual[index]);
+				assert(expectedChildren.size() == actualChildren.size());
+				assert(std::equal(expectedChildren.begin(), expectedChildren.end(), actualChildren.begin()));
+			}
+		}
+	}
+
+	static std::string write(Parlex::ParseForest const &forest) {
+		std::ostringstream stream;
+		Parlex::ForestImage::Write(forest, stream);
+		return stream.str();
+	}
+
+public:
+	//the forest of an ambiguous parse survives the round trip, even from an unaligned copy
+	static void test_01() {
+		Parlex::Grammar grammar;
+		int x = grammar.AddStringTerminal("x", U"x");
+		int plus = grammar.AddStringTerminal("+", U"+");
+		int newline = grammar.AddStringTerminal("newline", U"\n");
+		int sum = grammar.AddProduction("Sum");
+		int main = grammar.AddProduction("Main");
+		int s0 = grammar.AddState(sum, true, false);
+		int s1 = grammar.AddState(sum, false, true);
+		int s2 = grammar.AddState(sum, false, false);
+		grammar.AddTransition(s0, x, s1);
+		grammar.AddTransition(s0, sum, s2);
+		grammar.AddTransition(s2, plus, s0);
+		int m0 = grammar.AddState(main, true, false);
+		int m1 = grammar.AddState(main, false, true);
+		grammar.AddTransition(m0, sum, m1);
+		grammar.AddTransition(m1, newline, m0);
+		grammar.SetMain(main);
+		grammar.Compile();
+
+		Text text;
+		for (int line = 0; line < 2000; line++) {
+			if (line > 0) text.push_back(U'\n');
+			for (int term = 0; term <= line % 4; term++) {
+				if (term > 0) text.push_back(U'+');
+				text.push_back(U'x');
+			}
+		}
+		Parlex::SerialScheduler serial;
+		Parlex::ParseEngine engine(grammar, serial, Parlex::ExecutionMode::Wavefront);
+		engine.Parse(text);
+		Parlex::ParseForest forest;
+		bool matched = engine.BuildForest(forest);
+		assert(matched);
+		forest.Seal();
+		std::string bytes = write(forest);
+		Parlex::ForestImage image;
+		image.Attach(bytes.data(), bytes.size());
+		compare(forest, image);
+		std::string shifted = " " + bytes;
+		Parlex::ForestImage unaligned;
+		unaligned.Attach(shifted.data() + 1, bytes.size());
+		compare(forest, unaligned);
+	}
+
+	//random forests round trip, and damaged images throw rather than read out of bounds
+	static void test_02() {
+		std::mt19937 random(3);
+		for (int round = 0; round < 100; round++) {
+			Parlex::ParseForest forest;
+			int nodeCount = 1 + random() % 300;
+			for (int node = 0; node < nodeCount; node++) {
+				forest.AddNode(random() % 100000, random() % (1 << 30), random() % 1000);
+			}
+			int derivationCount = random() % 600;
+			for (int derivation = 0; derivation < derivationCount; derivation++) {
+				Parlex::NodeId children[4];
+				int childCount = random() % 5;
+				for (int child = 0; child < childCount; child++) children[child] = random() % nodeCount;
+				forest.AddDerivation(random() % nodeCount, children, childCount);
+			}
+			forest.SetRoot(round % 5 == 0 ? Parlex::NoNode : Parlex::NodeId(random() % nodeCount));
+			forest.Seal();
+			std::string bytes = write(forest);
+			Parlex::ForestImage image;
+			image.Attach(bytes.data(), bytes.size());
+			compare(forest, image);
+			for (int attempt = 0; attempt < 50; attempt++) {
+				std::string damaged = bytes;
+				if (attempt % 2) damaged.resize(random() % damaged.size());
+				else damaged[random() % damaged.size()] ^= char(1 + random() % 255);
+				try {
+					Parlex::ForestImage read;
+					read.Attach(damaged.data(), damaged.size());
+					std::vector<std::int32_t> offsets;
+					std::vector<Parlex::NodeId> children;
+					for (std::size_t node = 0; node < read.GetNodeCount(); node++) {
+						read.GetDerivations(Parlex::NodeId(node), offsets, children);
+					}
+					Parlex::ParseForest loaded;
+					read.Load(loaded);
+				}
+				catch (std::exception const &) {}
+			}
+		}
+		Parlex::ParseForest empty;
+		std::string bytes = write(empty);
+		Parlex::ForestImage image;
+		image.Attach(bytes.data(), bytes.size());
+		assert(image.GetNodeCount() == 0 && image.GetRoot() == Parlex::NoNode);
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+	}
+};
\ No newline at end of file
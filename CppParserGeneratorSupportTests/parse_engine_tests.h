@@ -0,0 +1,297 @@
+#include "ParseEngine.h"
+#include "SerialScheduler.h"
+#include "TerminalScan.h"
+#include "WorkStealingPool.h"
+
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+class parse_engine_tests {
+	//the number of trees below node, or 0 if main didn't match
+	static std::uint64_t count_trees(Parlex::ParseForest const &forest, Parlex::NodeId node, std::vector<std::uint64_t> &memo) {
+		if (memo[node] != ~std::uint64_t(0)) return memo[node];
+		auto derivations = forest.GetDerivations(node);
+		std::uint64_t total = derivations.empty() ? 1 : 0;
+		for (auto derivation : derivations) {
+			std::uint64_t product = 1;
+			for (Parlex::NodeId child : forest.GetChildren(derivation)) {
+				product *= count_trees(forest, child, memo);
+			}
+			total += product;
+		}
+		return memo[node] = total;
+	}
+
+	static std::uint64_t count_trees(Parlex::ParseEngine const &engine) {
+		Parlex::ParseForest forest;
+		if (!engine.BuildForest(forest)) return 0;
+		std::vector<std::uint64_t> memo(forest.GetNodeCount(), ~std::uint64_t(0));
+		return count_trees(forest, forest.GetRoot(), memo);
+	}
+
+	//one or more x's
+	static bool match_xs(Text const &codepoints, int position, int &length) {
+		length = 0;
+		while (static_cast<std::size_t>(position + length) < codepoints.size() && codepoints[position + length] == U'x') length++;
+		return length > 0;
+	}
+
+	static Text make_text(char const *characters) {
+		Text text;
+		while (*characters) text.push_back(*characters++);
+		return text;
+	}
+
+	//E = E '+' E | D, D = digit+ (greedy)
+	static void build_sums(Parlex::Grammar &grammar) {
+		int plus = grammar.AddStringTerminal("+", U"+");
+		int digit = grammar.AddCharacterSetTerminal("digit", { U'0', U'1', U'2', U'3', U'4', U'5', U'6', U'7', U'8', U'9' });
+		int sum = grammar.AddProduction("E");
+		int digits = grammar.AddProduction("D", true);
+		int s0 = grammar.AddState(sum, true, false);
+		int s1 = grammar.AddState(sum, false, false);
+		int s2 = grammar.AddState(sum, false, false);
+		int s3 = grammar.AddState(sum, false, true);
+		grammar.AddTransition(s0, sum, s1);
+		grammar.AddTransition(s1, plus, s2);
+		grammar.AddTransition(s2, sum, s3);
+		grammar.AddTransition(s0, digits, s3);
+		int d0 = grammar.AddState(digits, true, false);
+		int d1 = grammar.AddState(digits, false, true);
+		grammar.AddTransition(d0, digit, d1);
+		grammar.AddTransition(d1, digit, d1);
+		grammar.SetMain(sum);
+		grammar.Compile();
+	}
+
+	//Main = '[' List ']' (' ' '[' List ']')*, List = (digit (',' digit)*)?, whose follow set lets FirstAndFollow prune
+	static void build_lists(Parlex::Grammar &grammar) {
+		int open = grammar.AddStringTerminal("[", U"[");
+		int close = grammar.AddStringTerminal("]", U"]");
+		int comma = grammar.AddStringTerminal(",", U",");
+		int space = grammar.AddStringTerminal(" ", U" ");
+		int digit = grammar.AddCharacterSetTerminal("digit", { U'0', U'1', U'2' });
+		int main = grammar.AddProduction("Main");
+		int list = grammar.AddProduction("List");
+		int m0 = grammar.AddState(main, true, false);
+		int m1 = grammar.AddState(main, false, false);
+		int m2 = grammar.AddState(main, false, false);
+		int m3 = grammar.AddState(main, false, true);
+		grammar.AddTransition(m0, open, m1);
+		grammar.AddTransition(m1, list, m2);
+		grammar.AddTransition(m2, close, m3);
+		grammar.AddTransition(m3, space, m0);
+		int l0 = grammar.AddState(list, true, true);
+		int l1 = grammar.AddState(list, false, true);
+		int l2 = grammar.AddState(list, false, false);
+		grammar.AddTransition(l0, digit, l1);
+		grammar.AddTransition(l1, comma, l2);
+		grammar.AddTransition(l2, digit, l1);
+		grammar.SetMain(main);
+		grammar.Compile();
+	}
+
+public:
+	//both modes find every bracketing of a sum, serially and on the pool
+	static void test_01() {
+		Parlex::Grammar grammar;
+		build_sums(grammar);
+		Parlex::SerialScheduler serial;
+		Parlex::WorkStealingPool pool(3);
+		std::uint64_t const catalan[] = { 1, 1, 2, 5, 14, 42, 132, 429 };
+		for (int operandCount = 1; operandCount <= 8; operandCount++) {
+			Text text;
+			for (int operand = 0; operand < operandCount; operand++) {
+				if (operand > 0) text.push_back(U'+');
+				text.push_back(U'1');
+				text.push_back(U'2');
+			}
+			for (auto mode : { Parlex::ExecutionMode::Dispatch, Parlex::ExecutionMode::Wavefront }) {
+				Parlex::ParseEngine serialEngine(grammar, serial, mode);
+				serialEngine.Parse(text);
+				assert(count_trees(serialEngine) == catalan[operandCount - 1]);
+				if (mode == Parlex::ExecutionMode::Dispatch) {
+					Parlex::ParseEngine poolEngine(grammar, pool, mode);
+					poolEngine.Parse(text);
+					assert(count_trees(poolEngine) == catalan[operandCount - 1]);
+				}
+			}
+		}
+		Parlex::ParseEngine engine(grammar, serial, Parlex::ExecutionMode::Wavefront);
+		Text unfinished = make_text("1+2+");
+		engine.Parse(unfinished);
+		assert(count_trees(engine) == 0);
+	}
+
+	//every lookahead mode finds the same trees, and the stronger ones prune at least as much
+	static void test_02() {
+		Parlex::Grammar grammar;
+		build_lists(grammar);
+		Parlex::SerialScheduler serial;
+		Parlex::WorkStealingPool pool(2);
+		for (char const *characters : { "[] [1,2] [0] [2,2,2,1]", "[1,] []" }) {
+			Text text = make_text(characters);
+			for (auto mode : { Parlex::ExecutionMode::Dispatch, Parlex::ExecutionMode::Wavefront }) {
+				Parlex::IScheduler &scheduler = mode == Parlex::ExecutionMode::Dispatch ? static_cast<Parlex::IScheduler&>(pool) : serial;
+				Parlex::ParseEngine none(grammar, scheduler, mode, Parlex::LookaheadMode::None);
+				Parlex::ParseEngine first(grammar, scheduler, mode, Parlex::LookaheadMode::First);
+				Parlex::ParseEngine follow(grammar, scheduler, mode, Parlex::LookaheadMode::FirstAndFollow);
+				none.Parse(text);
+				first.Parse(text);
+				follow.Parse(text);
+				assert(count_trees(none) == count_trees(first));
+				assert(count_trees(none) == count_trees(follow));
+				assert(none.GetMetrics().prunedCount == 0);
+				assert(first.GetMetrics().prunedCount > 0);
+				assert(follow.GetMetrics().prunedCount >= first.GetMetrics().prunedCount);
+			}
+		}
+	}
+
+	//a greedy production cancels the paths its longest match has beaten, without changing the forest
+	static void test_03() {
+		Parlex::Grammar grammar;
+		int a = grammar.AddStringTerminal("a", U"a");
+		int b = grammar.AddStringTerminal("b", U"b");
+		int c = grammar.AddStringTerminal("c", U"c");
+		int space = grammar.AddStringTerminal(" ", U" ");
+		int main = grammar.AddProduction("Main");
+		int token = grammar.AddProduction("Token", true);
+		int pair = grammar.AddProduction("Pair");
+		int triple = grammar.AddProduction("Triple");
+		int t0 = grammar.AddState(token, true, false);
+		int t1 = grammar.AddState(token, false, true);
+		grammar.AddTransition(t0, a, t1);
+		grammar.AddTransition(t0, pair, t1);
+		grammar.AddTransition(t0, triple, t1);
+		int p0 = grammar.AddState(pair, true, false);
+		int p1 = grammar.AddState(pair, false, false);
+		int p2 = grammar.AddState(pair, false, true);
+		grammar.AddTransition(p0, a, p1);
+		grammar.AddTransition(p1, b, p2);
+		int r0 = grammar.AddState(triple, true, false);
+		int r1 = grammar.AddState(triple, false, false);
+		int r2 = grammar.AddState(triple, false, false);
+		int r3 = grammar.AddState(triple, false, true);
+		grammar.AddTransition(r0, a, r1);
+		grammar.AddTransition(r1, b, r2);
+		grammar.AddTransition(r2, c, r3);
+		int m0 = grammar.AddState(main, true, false);
+		int m1 = grammar.AddState(main, false, true);
+		grammar.AddTransition(m0, token, m1);
+		grammar.AddTransition(m1, space, m0);
+		grammar.SetMain(main);
+		grammar.Compile();
+
+		Parlex::SerialScheduler serial;
+		Parlex::WorkStealingPool pool(3);
+		std::mt19937 random(1);
+		char const *tokens[] = { "a", "ab", "abc" };
+		std::size_t cancelledCount = 0;
+		for (int trial = 0; trial < 100; trial++) {
+			Text text;
+			int tokenCount = 1 + random() % 20;
+			for (int index = 0; index < tokenCount; index++) {
+				if (index > 0) text.push_back(U' ');
+				for (char const *character = tokens[random() % 3]; *character; character++) text.push_back(*character);
+			}
+			Parlex::ParseEngine wavefront(grammar, serial, Parlex::ExecutionMode::Wavefront);
+			Parlex::ParseEngine dispatch(grammar, pool);
+			wavefront.Parse(text);
+			dispatch.Parse(text);
+			assert(count_trees(wavefront) == 1);
+			assert(count_trees(dispatch) == 1);
+			cancelledCount += dispatch.GetMetrics().cancelledCount;
+		}
+		assert(cancelledCount > 0);
+	}
+
+	//a repetition of something that can match nothing ends, as in [x]*, and finds each tree once
+	static void test_04() {
+		//Main = Group*, Group = Item*, Item = 'x' | nothing
+		Parlex::Grammar grammar;
+		int x = grammar.AddStringTerminal("x", U"x");
+		int main = grammar.AddProduction("Main");
+		int group = grammar.AddProduction("Group");
+		int item = grammar.AddProduction("Item");
+		int m0 = grammar.AddState(main, true, true);
+		grammar.AddTransition(m0, group, m0);
+		int g0 = grammar.AddState(group, true, true);
+		grammar.AddTransition(g0, item, g0);
+		int i0 = grammar.AddState(item, true, true);
+		int i1 = grammar.AddState(item, false, true);
+		grammar.AddTransition(i0, x, i1);
+		grammar.SetMain(main);
+		grammar.Compile();
+
+		Parlex::SerialScheduler serial;
+		Parlex::WorkStealingPool pool(3);
+		for (int length = 0; length <= 8; length++) {
+			Text text(length, U'x');
+			//empty items and groups are left out, so the trees are the ways to cut the x's into groups
+			std::uint64_t expected = length == 0 ? 1 : std::uint64_t(1) << (length - 1);
+			for (auto mode : { Parlex::ExecutionMode::Dispatch, Parlex::ExecutionMode::Wavefront }) {
+				Parlex::ParseEngine serialEngine(grammar, serial, mode);
+				serialEngine.Parse(text);
+				assert(count_trees(serialEngine) == expected);
+				assert(serialEngine.GetMetrics().mergedCount > 0);
+				if (mode == Parlex::ExecutionMode::Dispatch) {
+					Parlex::ParseEngine poolEngine(grammar, pool, mode);
+					poolEngine.Parse(text);
+					assert(count_trees(poolEngine) == expected);
+				}
+			}
+		}
+	}
+
+	//an unbound function terminal is reported when the engine or scan is made, not from a work item
+	static void test_05() {
+		Parlex::Grammar grammar;
+		int xs = grammar.AddFunctionTerminal("xs", nullptr);
+		int main = grammar.AddProduction("Main");
+		int m0 = grammar.AddState(main, true, false);
+		int m1 = grammar.AddState(main, false, true);
+		grammar.AddTransition(m0, xs, m1);
+		grammar.SetMain(main);
+		grammar.Compile();
+
+		Parlex::SerialScheduler serial;
+		bool threw = false;
+		try {
+			Parlex::ParseEngine engine(grammar, serial);
+		}
+		catch (std::logic_error const &) {
+			threw = true;
+		}
+		assert(threw);
+		threw = false;
+		try {
+			Parlex::TerminalScan scan(grammar);
+		}
+		catch (std::logic_error const &) {
+			threw = true;
+		}
+		assert(threw);
+
+		grammar.BindFunction(xs, match_xs);
+		Text text = make_text("xxx");
+		Parlex::TerminalScan scan(grammar);
+		scan.Scan(text, serial);
+		for (auto mode : { Parlex::ExecutionMode::Dispatch, Parlex::ExecutionMode::Wavefront }) {
+			Parlex::ParseEngine engine(grammar, serial, mode);
+			engine.Parse(text);
+			assert(count_trees(engine) == 1);
+		}
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+		test_03();
+		test_04();
+		test_05();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "PositionIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+class position_index_tests {
+	static int utf8_length(char32_t codePoint) {
+		return codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+	}
+
+	static char32_t random_code_point(std::mt19937 &random) {
+		switch (random() % 6) {
+		case 0: return U'\n';
+		case 1: return 0x80 + random() % 0x780;
+		case 2: return 0x800 + random() % 0xF000;
+		case 3: return 0x10000 + random() % 0x100000;
+		default: return U'a' + random() % 26;
+		}
+	}
+
+	//every conversion agrees with walking the text from the start
+	static void check(Parlex::PositionIndex const &index, Text const &text) {
+		assert(index.GetCodePointCount() == int(text.size()));
+		std::vector<std::int64_t> byteOffsets;
+		std::vector<int> lineStarts(1, 0);
+		std::int64_t byteOffset = 0;
+		int line = 0, column = 0;
+		for (std::size_t position = 0; position <= text.size(); position++) {
+			byteOffsets.push_back(byteOffset);
+			assert(index.GetByteOffset(int(position)) == byteOffset);
+			auto lineColumn = index.GetLineColumn(int(position));
+			assert(lineColumn.line == line && lineColumn.column == column);
+			assert(index.GetCodePointAt(lineColumn) == int(position));
+			if (position == text.size()) break;
+			byteOffset += utf8_length(text[position]);
+			if (text[position] == U'\n') {
+				line++;
+				column = 0;
+				lineStarts.push_back(int(position) + 1);
+			}
+			else {
+				column++;
+			}
+		}
+		assert(index.GetByteCount() == byteOffset);
+		assert(index.GetLineCount() == int(lineStarts.size()));
+		std::size_t codePoint = 0;
+		for (std::int64_t offset = 0; offset <= byteOffset; offset++) {
+			while (codePoint < text.size() && byteOffsets[codePoint + 1] <= offset) codePoint++;
+			assert(index.GetCodePointAtByte(offset) == int(codePoint));
+		}
+		for (std::size_t lineIndex = 0; lineIndex < lineStarts.size(); lineIndex++) {
+			assert(index.GetLineStart(int(lineIndex)) == lineStarts[lineIndex]);
+		}
+	}
+
+public:
+	//random texts, then random edits of them, small and large
+	static void test_01() {
+		std::mt19937 random(5);
+		for (int round = 0; round < 20; round++) {
+			Text text;
+			int length = random() % 3000;
+			for (int position = 0; position < length; position++) text.push_back(random_code_point(random));
+			Parlex::PositionIndex index;
+			index.Build(text);
+			check(index, text);
+			for (int edit = 0; edit < 40; edit++) {
+				int start = random() % (text.size() + 1);
+				int available = int(text.size()) - start;
+				int removed = std::min<int>(available, random() % 4 == 0 ? random() % 2000 : random() % 20);
+				int inserted = random() % 5 == 0 ? random() % 1500 : random() % 30;
+				Text insertion;
+				for (int position = 0; position < inserted; position++) insertion.push_back(random_code_point(random));
+				text.erase(text.begin() + start, text.begin() + start + removed);
+				text.insert(text.begin() + start, insertion.begin(), insertion.end());
+				index.Edit(text, start, removed, inserted);
+				if (edit % 10 == 9 || text.size() < 300) check(index, text);
+			}
+			check(index, text);
+		}
+	}
+
+	static void test_02() {
+		Text text(1, U'a');
+		Parlex::PositionIndex index;
+		index.Build(text);
+		bool threw = false;
+		try {
+			index.GetByteOffset(2);
+		}
+		catch (std::out_of_range const &) {
+			threw = true;
+		}
+		assert(threw);
+		threw = false;
+		try {
+			index.Edit(text, 0, 1, 2);
+		}
+		catch (std::invalid_argument const &) {
+			threw = true;
+		}
+		assert(threw);
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "ParseEngine.h"
+#include "ParseSnapshot.h"
+#include "SerialScheduler.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+class reparse_tests {
+	typedef std::tuple<int, int, int> node_key;
+	//every node's derivations by (symbol, start, length), which two forests share however they number their nodes
+	typedef std::map<node_key, std::set<std::vector<node_key>>> canonical_forest;
+
+	static node_key key_of(Parlex::ParseForest const &forest, Parlex::NodeId node) {
+		auto const &record = forest.GetNode(node);
+		return node_key(record.symbol, record.start, record.length);
+	}
+
+	static canonical_forest canonicalize(Parlex::ParseForest const &forest) {
+		canonical_forest result;
+		std::vector<Parlex::NodeId> stack(1, forest.GetRoot());
+		std::vector<bool> seen(forest.GetNodeCount(), false);
+		while (!stack.empty()) {
+			Parlex::NodeId node = stack.back();
+			stack.pop_back();
+			if (seen[node]) continue;
+			seen[node] = true;
+			auto &derivations = result[key_of(forest, node)];
+			for (auto derivation : forest.GetDerivations(node)) {
+				std::vector<node_key> children;
+				for (Parlex::NodeId child : forest.GetChildren(derivation)) {
+					children.push_back(key_of(forest, child));
+					stack.push_back(child);
+				}
+				derivations.insert(children);
+			}
+		}
+		return result;
+	}
+
+	//Main = Item*, Item = '(' Item* ')' | Word | ' ' | Ambiguous, Word = letter+ (greedy), Ambiguous = "abc" | letter letter letter
+	static void build_items(Parlex::Grammar &grammar) {
+		std::vector<char32_t> letters;
+		for (char32_t letter = U'a'; letter <= U'e'; letter++) letters.push_back(letter);
+		int letter = grammar.AddCharacterSetTerminal("letter", letters);
+		int space = grammar.AddStringTerminal(" ", U" ");
+		int open = grammar.AddStringTerminal("(", U"(");
+		int close = grammar.AddStringTerminal(")", U")");
+		int keyword = grammar.AddStringTerminal("abc", U"abc");
+		int main = grammar.AddProduction("Main");
+		int item = grammar.AddProduction("Item");
+		int word = grammar.AddProduction("Word", true);
+		int ambiguous = grammar.AddProduction("Ambiguous");
+		int m0 = grammar.AddState(main, true, true);
+		grammar.AddTransition(m0, item, m0);
+		int i0 = grammar.AddState(item, true, false);
+		int i1 = grammar.AddState(item, false, false);
+		int i2 = grammar.AddState(item, false, true);
+		grammar.AddTransition(i0, open, i1);
+		grammar.AddTransition(i1, item, i1);
+		grammar.AddTransition(i1, close, i2);
+		grammar.AddTransition(i0, word, i2);
+		grammar.AddTransition(i0, space, i2);
+		grammar.AddTransition(i0, ambiguous, i2);
+		int w0 = grammar.AddState(word, true, false);
+		int w1 = grammar.AddState(word, false, true);
+		grammar.AddTransition(w0, letter, w1);
+		grammar.AddTransition(w1, letter, w1);
+		int a0 = grammar.AddState(ambiguous, true, false);
+		int a1 = grammar.AddState(ambiguous, false, true);
+		int a2 = grammar.AddState(ambiguous, false, false);
+		int a3 = grammar.AddState(ambiguous, false, false);
+		grammar.AddTransition(a0, keyword, a1);
+		grammar.AddTransition(a0, letter, a2);
+		grammar.AddTransition(a2, letter, a3);
+		grammar.AddTransition(a3, letter, a1);
+		grammar.SetMain(main);
+		grammar.Compile();
+	}
+
+public:
+	//a reparse after random edits finds the same forest as a fresh parse, and one with no edits reuses its snapshot
+	static void test_01() {
+		Parlex::Grammar grammar;
+		build_items(grammar);
+		Parlex::SerialScheduler serial;
+		Parlex::WorkStealingPool pool(2);
+		std::mt19937 random(7);
+		char const alphabet[] = "abcde ()";
+		auto random_character = [&]() { return char32_t(alphabet[random() % 8]); };
+		for (int trial = 0; trial < 100; trial++) {
+			Parlex::IScheduler &scheduler = trial % 2 ? static_cast<Parlex::IScheduler&>(pool) : serial;
+			Text text;
+			int length = 5 + random() % 40;
+			for (int index = 0; index < length; index++) text.push_back(random_character());
+			Parlex::ParseEngine first(grammar, scheduler);
+			first.Parse(text);
+			Parlex::ParseSnapshot snapshot;
+			first.TakeSnapshot(snapshot);
+
+			std::vector<int> positions;
+			int editCount = 1 + random() % 3;
+			for (int index = 0; index < editCount; index++) positions.push_back(random() % (text.size() + 1));
+			std::sort(positions.begin(), positions.end());
+			std::vector<Parlex::TextEdit> edits;
+			Text edited;
+			int copied = 0;
+			for (int position : positions) {
+				if (position < copied) continue;
+				int removed = std::min<int>(random() % 3, int(text.size()) - position);
+				int inserted = removed == 0 ? 1 + random() % 2 : random() % 3;
+				edited.insert(edited.end(), text.begin() + copied, text.begin() + position);
+				for (int index = 0; index < inserted; index++) edited.push_back(random_character());
+				Parlex::TextEdit edit = { position, removed, inserted };
+				edits.push_back(edit);
+				copied = position + removed;
+			}
+			edited.insert(edited.end(), text.begin() + copied, text.end());
+
+			Parlex::ParseEngine reparsed(grammar, scheduler);
+			reparsed.Reparse(edited, snapshot, edits);
+			Parlex::ParseEngine fresh(grammar, scheduler);
+			fresh.Parse(edited);
+			Parlex::ParseForest reparsedForest, freshForest;
+			bool matched = fresh.BuildForest(freshForest);
+			bool reparsedMatched = reparsed.BuildForest(reparsedForest);
+			assert(reparsedMatched == matched);
+			assert(reparsed.GetRootLengths() == fresh.GetRootLengths());
+			if (matched) {
+				assert(canonicalize(reparsedForest) == canonicalize(freshForest));
+			}
+
+			Parlex::ParseSnapshot next;
+			reparsed.TakeSnapshot(next);
+			Parlex::ParseEngine unchanged(grammar, scheduler);
+			unchanged.Reparse(edited, next, std::vector<Parlex::TextEdit>());
+			assert(unchanged.GetMetrics().reusedCount > 0);
+			assert(unchanged.GetMetrics().dispatcherCount <= fresh.GetMetrics().dispatcherCount);
+		}
+	}
+
+	static void test_all() {
+		test_01();
+	}
+};
\ No newline at end of file
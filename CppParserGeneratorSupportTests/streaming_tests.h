@@ -0,0 +1,170 @@
+#include "ParseEngine.h"
+#include "IForestSink.h"
+#include "SerialScheduler.h"
+
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+class streaming_tests {
+	struct subtree {
+		int symbol;
+		int start;
+		int length;
+		std::uint64_t treeCount;
+		bool operator==(subtree const &other) const {
+			return symbol == other.symbol && start == other.start && length == other.length && treeCount == other.treeCount;
+		}
+	};
+
+	static std::uint64_t count_trees(Parlex::ParseForest const &forest, Parlex::NodeId node, std::vector<std::uint64_t> &memo) {
+		if (memo[node] != ~std::uint64_t(0)) return memo[node];
+		auto derivations = forest.GetDerivations(node);
+		std::uint64_t total = derivations.empty() ? 1 : 0;
+		for (auto derivation : derivations) {
+			std::uint64_t product = 1;
+			for (Parlex::NodeId child : forest.GetChildren(derivation)) {
+				product *= count_trees(forest, child, memo);
+			}
+			total += product;
+		}
+		return memo[node] = total;
+	}
+
+	static subtree describe(Parlex::ParseForest const &forest, Parlex::NodeId node, std::vector<std::uint64_t> &memo) {
+		auto const &record = forest.GetNode(node);
+		subtree result = { record.symbol, record.start, record.length, count_trees(forest, node, memo) };
+		return result;
+	}
+
+	class CollectingSink : public Parlex::IForestSink {
+	public:
+		std::vector<subtree> subtrees;
+		void Emit(Parlex::ParseForest const &forest, Parlex::Span<Parlex::NodeId> emitted) {
+			std::vector<std::uint64_t> memo(forest.GetNodeCount(), ~std::uint64_t(0));
+			for (Parlex::NodeId node : emitted) {
+				subtrees.push_back(describe(forest, node, memo));
+			}
+		}
+	};
+
+	//main's children in the last forest; false if main didn't match or its root is ambiguous
+	static bool get_root_children(Parlex::ParseEngine const &engine, std::vector<subtree> &children) {
+		Parlex::ParseForest forest;
+		if (!engine.BuildForest(forest)) return false;
+		auto derivations = forest.GetDerivations(forest.GetRoot());
+		if (derivations.size() != 1) return false;
+		std::vector<std::uint64_t> memo(forest.GetNodeCount(), ~std::uint64_t(0));
+		for (Parlex::NodeId child : forest.GetChildren(derivations[0])) {
+			children.push_back(describe(forest, child, memo));
+		}
+		return true;
+	}
+
+	//the subtrees emitted, then those left in the forest, are main's children in a parse that kept everything
+	static void check(Parlex::Grammar const &grammar, Text const &text, bool expectCuts) {
+		Parlex::SerialScheduler serial;
+		Parlex::ParseEngine whole(grammar, serial, Parlex::ExecutionMode::Wavefront);
+		whole.Parse(text);
+		std::vector<subtree> expected;
+		bool matched = get_root_children(whole, expected);
+
+		Parlex::ParseEngine streaming(grammar, serial, Parlex::ExecutionMode::Wavefront);
+		CollectingSink sink;
+		streaming.SetStreaming(&sink);
+		streaming.Parse(text);
+		std::vector<subtree> tail;
+		assert(get_root_children(streaming, tail) == matched);
+		auto metrics = streaming.GetMetrics();
+		assert(metrics.emittedCount == sink.subtrees.size());
+		if (!matched) return;
+		assert(!expectCuts || metrics.emittedCount > 0);
+		std::vector<subtree> actual = sink.subtrees;
+		actual.insert(actual.end(), tail.begin(), tail.end());
+		assert(actual == expected);
+	}
+
+public:
+	//comma separated lines, with fields greedy or not
+	static void test_01() {
+		for (bool greedy : { false, true }) {
+			Parlex::Grammar grammar;
+			std::vector<char32_t> letters;
+			for (char32_t letter = U'a'; letter <= U'z'; letter++) letters.push_back(letter);
+			int letter = grammar.AddCharacterSetTerminal("letter", letters);
+			int comma = grammar.AddStringTerminal(",", U",");
+			int newline = grammar.AddStringTerminal("newline", U"\n");
+			int main = grammar.AddProduction("Main");
+			int line = grammar.AddProduction("Line");
+			int field = grammar.AddProduction("Field", greedy);
+			int m0 = grammar.AddState(main, true, true);
+			grammar.AddTransition(m0, line, m0);
+			int l0 = grammar.AddState(line, true, false);
+			int l1 = grammar.AddState(line, false, false);
+			int l2 = grammar.AddState(line, false, true);
+			grammar.AddTransition(l0, field, l1);
+			grammar.AddTransition(l1, comma, l0);
+			grammar.AddTransition(l1, newline, l2);
+			int f0 = grammar.AddState(field, true, false);
+			int f1 = grammar.AddState(field, false, true);
+			grammar.AddTransition(f0, letter, f1);
+			grammar.AddTransition(f1, letter, f1);
+			grammar.SetMain(main);
+			grammar.Compile();
+
+			std::mt19937 random(7);
+			Text text;
+			for (int index = 0; index < 20000; index++) {
+				int fieldCount = 1 + random() % 4;
+				for (int fieldIndex = 0; fieldIndex < fieldCount; fieldIndex++) {
+					if (fieldIndex > 0) text.push_back(U',');
+					int length = 1 + random() % 6;
+					for (int character = 0; character < length; character++) text.push_back(U'a' + random() % 26);
+				}
+				text.push_back(U'\n');
+			}
+			check(grammar, text, true);
+			Text broken;
+			for (char32_t character : std::u32string(U"ab,c\nd,\n")) broken.push_back(character);
+			check(grammar, broken, false);
+		}
+	}
+
+	//lines that are each ambiguous are still emitted, with every tree
+	static void test_02() {
+		Parlex::Grammar grammar;
+		int a = grammar.AddStringTerminal("a", U"a");
+		int newline = grammar.AddStringTerminal("newline", U"\n");
+		int main = grammar.AddProduction("Main");
+		int line = grammar.AddProduction("Line");
+		int run = grammar.AddProduction("Run");
+		int m0 = grammar.AddState(main, true, true);
+		grammar.AddTransition(m0, line, m0);
+		int l0 = grammar.AddState(line, true, false);
+		int l1 = grammar.AddState(line, false, false);
+		int l2 = grammar.AddState(line, false, false);
+		int l3 = grammar.AddState(line, false, true);
+		grammar.AddTransition(l0, run, l1);
+		grammar.AddTransition(l1, run, l2);
+		grammar.AddTransition(l2, newline, l3);
+		int r0 = grammar.AddState(run, true, true);
+		grammar.AddTransition(r0, a, r0);
+		grammar.SetMain(main);
+		grammar.Compile();
+
+		std::mt19937 random(3);
+		Text text;
+		for (int index = 0; index < 30000; index++) {
+			int length = random() % 5;
+			for (int character = 0; character < length; character++) text.push_back(U'a');
+			text.push_back(U'\n');
+		}
+		check(grammar, text, true);
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+	}
+};
\ No newline at end of file
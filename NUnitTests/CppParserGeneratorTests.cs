@@ -0,0 +1,155 @@
+using System;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using Automata;
+using NUnit.Framework;
+using Parlex;
+
+namespace NUnitTests {
+    [TestFixture]
+    public class CppParserGeneratorTests {
+        private static NfaProduction MakeProduction(String name, int stateCount, params Object[] transitions) {
+            //transitions are (from, recognizer, to) triples; state 0 starts and the last accepts
+            var production = new NfaProduction(name, false);
+            var states = new Nfa<Recognizer>.State[stateCount];
+            for (int i = 0; i < stateCount; ++i) {
+                states[i] = new Nfa<Recognizer>.State();
+                production.Nfa.States.Add(states[i]);
+            }
+            production.Nfa.StartStates.Add(states[0]);
+            production.Nfa.AcceptStates.Add(states[stateCount - 1]);
+            for (int i = 0; i < transitions.Length; i += 3) {
+                production.Nfa.TransitionFunction[states[(int)transitions[i]]][(Recognizer)transitions[i + 1]].Add(states[(int)transitions[i + 2]]);
+            }
+            return production;
+        }
+
+        [Test]
+        public void AssignmentTest() {
+            var identifier = MakeProduction("identifier", 2, 0, StandardSymbols.Letter, 1, 1, StandardSymbols.Letter, 1);
+            var syntax = MakeProduction("syntax", 4, 0, identifier, 1, 1, new StringTerminal("="), 2, 2, identifier, 3);
+            var g = new NfaGrammar();
+            g.Productions.Add(syntax);
+            g.Productions.Add(identifier);
+            g.Main = syntax;
+
+            var header = new CppParserGenerator().GenerateHeader(g, "AssignmentParser");
+            Assert.IsTrue(header.Contains("class AssignmentParser {"));
+            Assert.IsTrue(header.Contains("int ParseSyntax(int p) {"));
+            Assert.IsTrue(header.Contains("for (;;) {"));
+            //identifier is asked for from two places, syntax only once
+            Assert.IsTrue(header.Contains("std::vector<int> memoIdentifier;"));
+            Assert.IsFalse(header.Contains("memoSyntax"));
+        }
+
+        [Test]
+        public void LeftRecursionTest() {
+            //e = e "+" decimalDigit | decimalDigit
+            var e = new NfaProduction("e", false);
+            var states = new Nfa<Recognizer>.State[4];
+            for (int i = 0; i < states.Length; ++i) {
+                states[i] = new Nfa<Recognizer>.State();
+                e.Nfa.States.Add(states[i]);
+            }
+            e.Nfa.StartStates.Add(states[0]);
+            e.Nfa.AcceptStates.Add(states[3]);
+            e.Nfa.TransitionFunction[states[0]][e].Add(states[1]);
+            e.Nfa.TransitionFunction[states[1]][new StringTerminal("+")].Add(states[2]);
+            e.Nfa.TransitionFunction[states[2]][StandardSymbols.DecimalDigit].Add(states[3]);
+            e.Nfa.TransitionFunction[states[0]][StandardSymbols.DecimalDigit].Add(states[3]);
+            var g = new NfaGrammar();
+            g.Productions.Add(e);
+            g.Main = e;
+
+            Assert.Throws<NotSupportedException>(() => new CppParserGenerator().GenerateHeader(g, "ExpressionParser"));
+        }
+
+        [Test]
+        public void CompiledHeaderTest() {
+            //syntax = identifier "=" '"' (letter | escape sequence | Unicode escape sequence | control)* '"'
+            var compiler = FindOnPath("g++") ?? FindOnPath("clang++") ?? FindOnPath("cl");
+            if (compiler == null) {
+                Assert.Ignore("no C++ compiler on the path");
+            }
+            var quote = new StringTerminal("\"");
+            var control = new CharacterSetTerminal("control", Enumerable.Range(0, 0x20));
+            var identifier = MakeProduction("identifier", 2, 0, StandardSymbols.Letter, 1, 1, StandardSymbols.Letter, 1);
+            var value = MakeProduction("value", 3, 0, quote, 1, 1, StandardSymbols.Letter, 1, 1, StandardSymbols.SimpleEscapeSequence, 1, 1, StandardSymbols.UnicodeEscapeSequence, 1, 1, control, 1, 1, quote, 2);
+            var syntax = MakeProduction("syntax", 4, 0, identifier, 1, 1, new StringTerminal("="), 2, 2, value, 3);
+            var g = new NfaGrammar();
+            g.Productions.Add(syntax);
+            g.Productions.Add(identifier);
+            g.Productions.Add(value);
+            g.Main = syntax;
+
+            var directory = Path.Combine(Path.GetTempPath(), Path.GetRandomFileName());
+            Directory.CreateDirectory(directory);
+            try {
+                new CppParserGenerator().Generate(directory, g, "AssignmentParser");
+                //one line in, a 1 or 0 out for whether it parses
+                File.WriteAllText(Path.Combine(directory, "Check.cpp"), String.Join("\n",
+                    "#include \"AssignmentParser.h\"",
+                    "#include <iostream>",
+                    "#include <string>",
+                    "",
+                    "int main() {",
+                    "\tstd::string line;",
+                    "\twhile (std::getline(std::cin, line)) {",
+                    "\t\tif (!line.empty() && line[line.size() - 1] == '\\r') line.erase(line.size() - 1);",
+                    "\t\tstd::vector<char32_t> text(line.begin(), line.end());",
+                    "\t\tstd::cout << (AssignmentParser(text.data(), static_cast<int>(text.size())).Parse() ? '1' : '0');",
+                    "\t}",
+                    "\treturn 0;",
+                    "}",
+                    ""));
+                var executable = Path.Combine(directory, "Check.exe");
+                var arguments = Path.GetFileNameWithoutExtension(compiler) == "cl"
+                    ? "/nologo /EHsc /W4 /WX Check.cpp /Fe\"" + executable + "\""
+                    : "-std=c++11 -Wall -Wextra -Werror Check.cpp -o \"" + executable + "\"";
+                String output;
+                Assert.AreEqual(0, Run(compiler, arguments, directory, "", out output), output);
+
+                var inputs = new[] {
+                    "a=\"b\"", "name=\"\\n\\x00004Ax\"", "ab=\"\"",
+                    "a=\"b", "a=b", "=\"b\"", "a=\"\\q\"", "a=\"\\x12G456\"", "a=\"\\x123\""
+                };
+                Assert.AreEqual(0, Run(executable, "", directory, String.Join("\n", inputs) + "\n", out output), output);
+                Assert.AreEqual("111000000", output);
+            } finally {
+                Directory.Delete(directory, true);
+            }
+        }
+
+        private static String FindOnPath(String name) {
+            foreach (var directory in (Environment.GetEnvironmentVariable("PATH") ?? "").Split(Path.PathSeparator).Where(x => x.Length > 0)) {
+                foreach (var file in new[] {name, name + ".exe"}) {
+                    var path = Path.Combine(directory, file);
+                    if (File.Exists(path)) {
+                        return path;
+                    }
+                }
+            }
+            return null;
+        }
+
+        private static int Run(String fileName, String arguments, String workingDirectory, String input, out String output) {
+            var info = new ProcessStartInfo(fileName, arguments) {
+                WorkingDirectory = workingDirectory,
+                UseShellExecute = false,
+                CreateNoWindow = true,
+                RedirectStandardInput = true,
+                RedirectStandardOutput = true,
+                RedirectStandardError = true
+            };
+            using (var process = Process.Start(info)) {
+                var errors = process.StandardError.ReadToEndAsync();
+                process.StandardInput.Write(input);
+                process.StandardInput.Close();
+                output = process.StandardOutput.ReadToEnd() + errors.Result;
+                process.WaitForExit();
+                return process.ExitCode;
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+using Automata;
+using NUnit.Framework;
+using Parlex;
+
+namespace NUnitTests {
+    [TestFixture]
+    public class LookaheadSetsTests {
+        [Test]
+        public void ListTest() {
+            //list = "[" [items] "]", items = decimalDigit {"," decimalDigit}
+            var items = new NfaProduction("items", false);
+            var items0 = new Nfa<Recognizer>.State();
+            var items1 = new Nfa<Recognizer>.State();
+            var items2 = new Nfa<Recognizer>.State();
+            items.Nfa.States.Add(items0);
+            items.Nfa.States.Add(items1);
+            items.Nfa.States.Add(items2);
+            items.Nfa.StartStates.Add(items0);
+            items.Nfa.AcceptStates.Add(items1);
+            items.Nfa.TransitionFunction[items0][StandardSymbols.DecimalDigit].Add(items1);
+            items.Nfa.TransitionFunction[items1][new StringTerminal(",")].Add(items2);
+            items.Nfa.TransitionFunction[items2][StandardSymbols.DecimalDigit].Add(items1);
+
+            var list = new NfaProduction("list", false);
+            var list0 = new Nfa<Recognizer>.State();
+            var list1 = new Nfa<Recognizer>.State();
+            var list2 = new Nfa<Recognizer>.State();
+            var list3 = new Nfa<Recognizer>.State();
+            list.Nfa.States.Add(list0);
+            list.Nfa.States.Add(list1);
+            list.Nfa.States.Add(list2);
+            list.Nfa.States.Add(list3);
+            list.Nfa.StartStates.Add(list0);
+            list.Nfa.AcceptStates.Add(list3);
+            list.Nfa.TransitionFunction[list0][new StringTerminal("[")].Add(list1);
+            list.Nfa.TransitionFunction[list1][items].Add(list2);
+            list.Nfa.TransitionFunction[list1][new StringTerminal("]")].Add(list3);
+            list.Nfa.TransitionFunction[list2][new StringTerminal("]")].Add(list3);
+
+            var g = new NfaGrammar();
+            g.Productions.Add(list);
+            g.Productions.Add(items);
+            g.Main = list;
+
+            var sets = new LookaheadSets(g);
+            Assert.IsFalse(sets.IsNullable(list));
+            Assert.IsFalse(sets.IsNullable(items));
+            Assert.IsTrue(sets.GetFirst(list).Contains('['));
+            Assert.IsFalse(sets.GetFirst(list).Contains(']'));
+            Assert.IsTrue(sets.GetFirst(items).Contains('7'));
+            Assert.IsFalse(sets.GetFirst(items).Contains(','));
+            Assert.IsTrue(sets.GetFollow(items).Contains(']'));
+            Assert.IsFalse(sets.GetFollow(items).Contains(','));
+            Assert.IsTrue(sets.CanPrecedeEnd(list));
+            Assert.IsFalse(sets.CanPrecedeEnd(items));
+        }
+
+        [Test]
+        public void CharacterClassTest() {
+            var c = new CharacterClass(new[] {'a', 'b', 'c', 0x3B1, 0x3B2, 0x10FFFF});
+            Assert.IsTrue(c.Contains('b'));
+            Assert.IsTrue(c.Contains(0x3B2));
+            Assert.IsFalse(c.Contains(0x3B3));
+            CollectionAssert.AreEqual(new[] {System.Tuple.Create(97, 99), System.Tuple.Create(0x3B1, 0x3B2), System.Tuple.Create(0x10FFFF, 0x10FFFF)}, c.GetRanges());
+            var complement = c.Complement();
+            Assert.IsFalse(complement.Contains('a'));
+            Assert.IsTrue(complement.Contains('d'));
+            Assert.IsTrue(complement.Contains(0x3B3));
+            Assert.IsFalse(complement.Contains(0x10FFFF));
+            Assert.IsFalse(complement.UnionWith(new CharacterClass(new[] {'z'})));
+        }
+    }
+}
\ No newline at end of file
@@ -2,7 +2,155 @@
 #include "Collective.h"
 
 namespace Synchronox {
-	Box::Box() : isHalted(false), collective(nullptr)
+	Box::Box() : yield(nullptr), state(0), dependents(nullptr), defersTransmission(false), stackSize(0), homeRunner(-1), allocation(nullptr), allocationSize(0), timerGeneration(0), timerPending(false), selectRotation(0), collective(nullptr)
 	{
 	}
+
+	Box::~Box() {}
+
+	void Box::Initializer() {}
+
+	void Box::Terminator() {}
+
+	std::vector<IInput*> Box::GetInputs() {
+		std::unique_lock<std::mutex> lock(sync);
+		return inputs;
+	}
+
+	std::vector<IOutput*> Box::GetOutputs() {
+		std::unique_lock<std::mutex> lock(sync);
+		return outputs;
+	}
+
+	void Box::Deleter::operator()(Box* box) const {
+		void* allocation = box->allocation;
+		if (!allocation) {
+			delete box;
+			return;
+		}
+		std::size_t size = box->allocationSize;
+		box->~Box();
+		Topology::FreeOnNode(allocation, size);
+	}
+
+	bool Box::GetIsHalted() {
+		return TestState(Halted);
+	}
+
+	bool Box::TestState(std::uint32_t flag) const {
+		return (state.load(std::memory_order_acquire) & flag) != 0;
+	}
+
+	bool Box::SetState(std::uint32_t flag) {
+		return (state.fetch_or(flag) & flag) != 0;
+	}
+
+	bool Box::ClearState(std::uint32_t flag) {
+		return (state.fetch_and(~flag) & flag) != 0;
+	}
+
+	std::unique_lock<std::mutex> Box::Lock() {
+		return std::unique_lock<std::mutex>(sync);
+	}
+
+	void Box::Join() {
+		completion.Wait();
+	}
+
+	void Box::Suspend() {
+		SuspendUntil(std::chrono::steady_clock::time_point::max());
+	}
+
+	//returns when woken or once the deadline has passed, whichever is first
+	void Box::SuspendUntil(std::chrono::steady_clock::time_point deadline) {
+		bool timed = deadline != std::chrono::steady_clock::time_point::max();
+		if (yield && std::this_thread::get_id() == runnerThread) {
+			if (timed) {
+				collective->ScheduleWake(this, deadline);
+			}
+			(*yield)();
+			if (timed) {
+				collective->CancelWake(this);
+			}
+			return;
+		}
+		std::unique_lock<std::mutex> lock(wakeSync);
+		SetState(ThreadBlocked);
+		while (!ClearState(PendingWork)) {
+			if (timed) {
+				if (wakeCondition.wait_until(lock, deadline) == std::cv_status::timeout) break;
+			}
+			else {
+				wakeCondition.wait(lock);
+			}
+		}
+		ClearState(ThreadBlocked);
+	}
+
+	void Box::SuspendFor(std::chrono::steady_clock::duration timeout) {
+		SuspendUntil(std::chrono::steady_clock::now() + timeout);
+	}
+
+	std::uint64_t Box::GetCollectiveId() {
+		return collective->GetId();
+	}
+
+	RemoteEndpoint* Box::GetRemoteEndpoint() {
+		return nullptr;
+	}
+
+	void Box::ThrowIfCancelled() {
+		if (collective) {
+			collective->GetCancellationToken().ThrowIfCancellationRequested();
+		}
+	}
+
+	void Box::Wake() {
+		if (state.fetch_or(PendingWork) & ThreadBlocked) {
+			std::unique_lock<std::mutex> lock(wakeSync);
+			wakeCondition.notify_all();
+		}
+	}
+
+	int Box::Select(IInput** candidates, int count) {
+		for (;;) {
+			ThrowIfCancelled();
+			bool anyLive = false;
+			for (int offset = 0; offset < count; offset++) {
+				int index = (selectRotation + offset) % count;
+				switch (candidates[index]->Poll()) {
+				case IInput::PollResult::Ready:
+				case IInput::PollResult::Halted:
+					selectRotation = (index + 1) % count;
+					return index;
+				case IInput::PollResult::Empty:
+					anyLive = true;
+					break;
+				case IInput::PollResult::HaltObserved:
+					break;
+				}
+			}
+			if (!anyLive) {
+				return -1;
+			}
+			//anything enqueued since the poll has set PendingWork, so the wake-up isn't lost
+			for (int index = 0; index < count; index++) {
+				candidates[index]->SetIsBlocked(true);
+			}
+			Suspend();
+			for (int index = 0; index < count; index++) {
+				candidates[index]->SetIsBlocked(false);
+			}
+		}
+	}
+
+	void Box::_internal_use_only_register_input(IInput *input) {
+		std::unique_lock<std::mutex> lock(sync);
+		inputs.push_back(input);
+	}
+
+	void Box::_internal_use_only_register_output(IOutput *output) {
+		std::unique_lock<std::mutex> lock(sync);
+		outputs.push_back(output);
+	}
 }
\ No newline at end of file
@@ -5,43 +5,123 @@
 #include <vector>
 #include "IInput.h"
 #include "IOutput.h"
+#include "RemoteEndpoint.h"
 #include <boost/coroutine/coroutine.hpp>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
 
 namespace Synchronox {
 	typedef boost::coroutines::symmetric_coroutine<void> coroutine;
 
 	class Collective;
 
+	template<typename T>
+	class Input;
+
+	template<typename T>
+	class Output;
+
 	class Box
 	{
+	public:
+		virtual ~Box();
 	protected:
 		Box();
 		virtual void Initializer();
 		virtual void Computer() = 0;
 		virtual void Terminator();
+
+		/// <summary>
+		/// Suspend until any of the inputs has a datum queued or halts, and
+		/// return the index of that input. A halt is reported only once per
+		/// input, and -1 is returned once every input has halted.
+		/// </summary>
+		template<typename... T>
+		int Select(Input<T>&... inputs) {
+			IInput* candidates[] = { &inputs... };
+			return Select(candidates, static_cast<int>(sizeof...(T)));
+		}
+
+		//return control to the runner until woken, or until the timeout passes
+		void SuspendFor(std::chrono::steady_clock::duration timeout);
+		std::uint64_t GetCollectiveId();
+		void ThrowIfCancelled();
+		//overridden by Boxes that connect to another process
+		virtual RemoteEndpoint* GetRemoteEndpoint();
 	private:
 		coroutine::yield_type *yield;
+		//the runner resuming the coroutine; any other thread that waits on this Box blocks instead of yielding
+		std::thread::id runnerThread;
 		friend class Collective;
-		std::atomic<bool> hasPendingWork;
-		bool isHalted;
+		template<typename T>
+		friend class Input;
+		template<typename T>
+		friend class Output;
+		enum StateFlag : std::uint32_t {
+			PendingWork = 1,
+			//set by the runner that is currently resuming this Box, so that no other runner resumes it concurrently
+			Running = 2,
+			Halted = 4,
+			//for waits that happen outside of the coroutine, such as in Initializer
+			ThreadBlocked = 8
+		};
+		//Every runner reads the state of every Box on each pass, so it is
+		//kept in one word, on a cache line that nothing else is written to
+		char statePadding[64];
+		std::atomic<std::uint32_t> state;
+		char stateTailPadding[64 - sizeof(std::uint32_t)];
+		//the Boxes with an Input connected to one of this Box's Outputs, owned by the Collective
+		std::atomic<std::vector<Box*> const*> dependents;
+		//set for a Box in a superstep Collective, whose Outputs then hold data until the barrier
+		bool defersTransmission;
+		//created when the Box first runs, so that only running Boxes hold a stack
 		coroutine::call_type coro;
+		std::size_t stackSize;
+		boost::coroutines::stack_context stack;
+		//the runner that services this Box first, or -1 if any runner may
+		int homeRunner;
+		//the pages of its own the Box was constructed in, on its home runner's node, or null if it was allocated with new
+		void* allocation;
+		std::size_t allocationSize;
+		//guarded by the Collective's timersMutex; a queued timer fires only if its generation is still this one
+		std::uint64_t timerGeneration;
+		bool timerPending;
+		std::mutex wakeSync;
+		std::condition_variable wakeCondition;
+		//where the next Select starts looking, so no input is starved
+		int selectRotation;
 		NoResetEvent completion;
+		std::mutex sync;
 		std::vector<IInput*> inputs;
 		std::vector<IOutput*> outputs;
 		Collective* collective;
 
 		std::vector<IInput*> GetInputs();
 		std::vector<IOutput*> GetOutputs();
+		//destroys a Box however it was allocated
+		struct Deleter {
+			void operator()(Box* box) const;
+		};
 		bool GetIsHalted();
+		bool TestState(std::uint32_t flag) const;
+		//each returns whether the flag was already set
+		bool SetState(std::uint32_t flag);
+		bool ClearState(std::uint32_t flag);
 
 		std::unique_lock<std::mutex> Lock();
 		void VerifyConstructionCompleted();
 		void Join();
+		//return control to the runner, or block the calling thread, until new work arrives for this Box
+		void Suspend();
+		void SuspendUntil(std::chrono::steady_clock::time_point deadline);
+		void Wake();
+		int Select(IInput** candidates, int count);
 		void _internal_use_only_register_input(IInput *input);
 		void _internal_use_only_register_output(IOutput *output);
-		std::atomic<bool> needsService;
 	};
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef _CANCELLATION_TOKEN_H_
+#define _CANCELLATION_TOKEN_H_
+
+#include <atomic>
+#include <exception>
+
+namespace Synchronox {
+	/// <summary>
+	/// Thrown from a port operation once the Collective has been cancelled.
+	/// It unwinds the Box's Computer, after which the Box halts normally.
+	/// </summary>
+	class OperationCancelledException : public std::exception {
+	public:
+		const char* what() const throw() {
+			return "The Collective was cancelled";
+		}
+	};
+
+	class CancellationToken {
+		CancellationToken(CancellationToken const &other) = delete;
+	public:
+		CancellationToken() : cancelled(false) {}
+
+		void Cancel() {
+			cancelled = true;
+		}
+
+		bool IsCancellationRequested() const {
+			return cancelled.load(std::memory_order_relaxed);
+		}
+
+		void ThrowIfCancellationRequested() const {
+			if (IsCancellationRequested()) {
+				throw OperationCancelledException();
+			}
+		}
+	private:
+		std::atomic<bool> cancelled;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef _CHANNEL_TRAITS_H_
+#define _CHANNEL_TRAITS_H_
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
+
+namespace Synchronox {
+	/// <summary>
+	/// How a T is written to and read from a SharedRing or a SpillFile.
+	/// Trivially copyable types are copied as they are; specialize this
+	/// for any other type.
+	/// </summary>
+	template<typename T>
+	struct ChannelTraits {
+		static_assert(std::is_trivially_copyable<T>::value, "specialize ChannelTraits to send a type that isn't trivially copyable");
+
+		static void Serialize(T const &datum, std::vector<char> &buffer) {
+			char const* bytes = reinterpret_cast<char const*>(&datum);
+			buffer.assign(bytes, bytes + sizeof(T));
+		}
+
+		static void Deserialize(std::vector<char> const &buffer, T &datum) {
+			assert(buffer.size() == sizeof(T));
+			std::memcpy(&datum, buffer.data(), sizeof(T));
+		}
+	};
+
+	template<>
+	struct ChannelTraits<std::string> {
+		static void Serialize(std::string const &datum, std::vector<char> &buffer) {
+			buffer.assign(datum.begin(), datum.end());
+		}
+
+		static void Deserialize(std::vector<char> const &buffer, std::string &datum) {
+			datum.assign(buffer.begin(), buffer.end());
+		}
+	};
+}
+
+#endif
\ No newline at end of file
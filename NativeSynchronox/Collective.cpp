@@ -1,182 +1,602 @@
 #include "Collective.h"
 #include <cassert>
+#include <algorithm>
 #include <set>
+#include <map>
+#include <queue>
 #include <utility>
+#include <random>
 
 namespace Synchronox {
-	Collective::Collective(int threadCount) {
+	Collective::Collective(int threadCount, PlacementPolicy placement, ExecutionMode mode) : boxCount(0), haltedBoxCount(0), connectionCount(0), timerCount(0), placement(placement), unpinnedRunnerCount(0), mode(mode), superstepArrivedCount(0), superstepGeneration(0), superstepCount(0) {
+		std::random_device entropy;
+		id = (static_cast<std::uint64_t>(entropy()) << 32 | entropy()) ^ reinterpret_cast<std::uintptr_t>(this);
+
 		if (threadCount == -1) {
 			threadCount = std::thread::hardware_concurrency();
 		}
 		assert(threadCount > 0);
 
+		//consecutive runners get consecutive processors of the same node, among those the process may use
+		auto const &processors = Topology::GetCurrent().GetProcessorsByNode();
+		for (int index = 0; index < threadCount; index++) {
+			runnerProcessors.push_back(processors[index % processors.size()]);
+		}
+
 		for (int spawn = 0; spawn < threadCount; spawn++) {
-			runners.emplace_back([this](coroutine::yield_type& yield) { RunnerLoop(yield); });
-			coroutine::call_type* coro = &runners.back();
-			runnerThreads.emplace_back([this, coro] {
-				(*coro)();
+			runnerThreads.emplace_back([this, spawn] {
+				RunnerLoop(spawn);
 			});
 		}
 	}
 
+	Collective::~Collective() {
+		//release the runners, even if construction was never completed
+		blocker.Set();
+		startBlocker.Set();
+		for (auto &thread : runnerThreads) {
+			thread.join();
+		}
+	}
+
 	bool Collective::IsDone() {
 		return blocker.IsSet();
 	}
 
 	void Collective::Join() {
 		blocker.Wait();
-		std::unique_lock<std::mutex> lock(boxesMutex);
-		int index = 0;
-		while (index < boxes.size()) {
-			lock.unlock();
-			boxes[index]->Join();
-			lock.lock();
+		for (auto &boxPtr : boxes) {
+			boxPtr->Join();
+		}
+	}
+
+	bool Collective::JoinUntil(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::duration grace) {
+		if (blocker.WaitUntil(deadline)) {
+			Join();
+			return true;
+		}
+		Cancel();
+		if (blocker.WaitUntil(deadline + grace)) {
+			Join();
 		}
+		return false;
+	}
+
+	bool Collective::JoinFor(std::chrono::steady_clock::duration timeout, std::chrono::steady_clock::duration grace) {
+		return JoinUntil(std::chrono::steady_clock::now() + timeout, grace);
+	}
+
+	void Collective::Cancel() {
+		cancellationToken.Cancel();
+		for (auto &boxPtr : boxes) {
+			boxPtr->Wake();
+		}
+	}
+
+	CancellationToken const &Collective::GetCancellationToken() {
+		return cancellationToken;
+	}
+
+	std::uint64_t Collective::GetId() const {
+		return id;
+	}
+
+	std::uint64_t Collective::GetSuperstepCount() const {
+		return superstepCount;
+	}
+
+	int Collective::GetUnpinnedRunnerCount() const {
+		return unpinnedRunnerCount;
+	}
+
+	StackPool &Collective::GetStackPool() {
+		return stackPool;
 	}
 
 	void Collective::ConstructionCompleted() {
+		if (placement == PlacementPolicy::Connected) {
+			PlaceBoxes();
+		}
 		startBlocker.Set();
 	}
 
-	void Collective::Terminator() {}
+	//A Box created by a runner lives with its creator, which it is likely
+	//connected to. Others are dealt out round robin until PlaceBoxes runs.
+	int Collective::ChooseHomeRunner() {
+		if (placement != PlacementPolicy::Connected) return -1;
+		if (currentRunner.get()) return *currentRunner;
+		return boxCount % static_cast<int>(runnerThreads.size());
+	}
 
-	void Collective::PropagateHalt(Box* box) {
-		std::set<Box*> dependentBoxes;
-		for (auto output : box->GetOutputs()) {
-			for (auto input : output->GetConnectedInputs()) {
-				dependentBoxes.insert(input->GetOwner());
+	int Collective::GetNodeOfRunner(int runnerIndex) {
+		return Topology::GetCurrent().GetNodeOfProcessor(runnerProcessors[runnerIndex]);
+	}
+
+	//Move the Box's own pages, and the storage of its empty queues, to its home runner's node
+	void Collective::SetHome(Box* box, int runnerIndex) {
+		box->homeRunner = runnerIndex;
+		if (runnerIndex < 0) return;
+		int node = GetNodeOfRunner(runnerIndex);
+		if (box->allocation) {
+			Topology::BindToNode(box->allocation, box->allocationSize, node);
+		}
+		for (auto input : box->GetInputs()) {
+			input->SetHomeNode(node);
+		}
+	}
+
+	/// <summary>
+	/// Order the Boxes breadth first over the Connect graph, so that
+	/// connected Boxes are adjacent, and deal that order out to the runners
+	/// in contiguous blocks. Since consecutive runners are pinned to
+	/// processors of the same node, neighboring blocks share a node too.
+	/// Each Box's own pages are moved to its runner's node, and its queues
+	/// allocate from that node. Its stack is bound to the node when it
+	/// first runs. Moving pages that are already in use needs BindToNode,
+	/// so without it a Box keeps the node CreateBox chose. A Box created
+	/// after this runs has the creating runner as its home.
+	/// </summary>
+	void Collective::PlaceBoxes() {
+		std::vector<Box*> creationOrder;
+		std::map<Box*, std::vector<Box*>> neighbors;
+		for (auto &boxPtr : boxes) {
+			Box* box = boxPtr.get();
+			creationOrder.push_back(box);
+			for (auto output : box->GetOutputs()) {
+				for (auto input : output->GetConnectedInputs()) {
+					neighbors[box].push_back(input->GetOwner());
+					neighbors[input->GetOwner()].push_back(box);
+				}
 			}
 		}
-		for (auto dependentBox : dependentBoxes) {
-			if (!dependentBox->GetIsHalted()) {
-				for (auto input : dependentBox->GetInputs()) {
-					input->CheckWillHalt();
+		//boxes is newest first
+		std::reverse(creationOrder.begin(), creationOrder.end());
+
+		std::vector<Box*> order;
+		std::set<Box*> visited;
+		for (Box* root : creationOrder) {
+			if (!visited.insert(root).second) continue;
+			std::queue<Box*> frontier;
+			frontier.push(root);
+			while (!frontier.empty()) {
+				Box* box = frontier.front();
+				frontier.pop();
+				order.push_back(box);
+				for (Box* neighbor : neighbors[box]) {
+					if (visited.insert(neighbor).second) {
+						frontier.push(neighbor);
+					}
 				}
 			}
 		}
+
+		std::size_t runnerCount = runnerThreads.size();
+		for (std::size_t index = 0; index < order.size(); index++) {
+			Box* box = order[index];
+			SetHome(box, static_cast<int>(index * runnerCount / order.size()));
+		}
+	}
+
+	void Collective::Terminator() {}
+
+	void Collective::SetStackSize(std::type_index boxType, std::size_t stackSize) {
+		std::unique_lock<std::mutex> lock(stackSizesMutex);
+		stackSizes[boxType] = stackSize;
+	}
+
+	std::size_t Collective::GetStackSize(std::type_index boxType) {
+		std::unique_lock<std::mutex> lock(stackSizesMutex);
+		auto i = stackSizes.find(boxType);
+		return i == stackSizes.end() ? stackPool.GetDefaultStackSize() : i->second;
+	}
+
+	void Collective::StartCoroutine(Box* box) {
+		box->coro = coroutine::call_type([this, box](coroutine::yield_type& yield) {
+			box->yield = &yield;
+			try {
+				box->Computer();
+			}
+			catch (OperationCancelledException const &) {
+			}
+			Halt(box);
+		}, boost::coroutines::attributes(box->stackSize), PooledStackAllocator(stackPool, &box->stack));
+		if (box->homeRunner >= 0 && placement == PlacementPolicy::Connected) {
+			void* base = static_cast<char*>(box->stack.sp) - box->stack.size;
+			Topology::BindToNode(base, box->stack.size, GetNodeOfRunner(box->homeRunner));
+		}
+	}
+
+	//Once a Box's Computer has returned, its coroutine is released so that
+	//the stack goes back to the pool for the next Box that starts
+	void Collective::RecycleStack(Box* box) {
+		if (!box->coro) {
+			box->coro = coroutine::call_type();
+		}
+	}
+
+	//Replaces any timer the Box already has
+	void Collective::ScheduleWake(Box* box, std::chrono::steady_clock::time_point deadline) {
+		std::unique_lock<std::mutex> lock(timersMutex);
+		if (!box->timerPending) {
+			box->timerPending = true;
+			timerCount++;
+		}
+		timers.push(timer_t(deadline, ++box->timerGeneration, box));
+		CompactTimers();
+	}
+
+	//Once a timed wait has returned, however it was woken, its timer is no longer wanted
+	void Collective::CancelWake(Box* box) {
+		std::unique_lock<std::mutex> lock(timersMutex);
+		if (!box->timerPending) return;
+		box->timerPending = false;
+		box->timerGeneration++;
+		timerCount--;
+		CompactTimers();
+	}
+
+	//Wake any Box whose timed wait has expired. A Box that was woken some
+	//other way just sees a spurious wake-up, and rechecks its inputs.
+	void Collective::WakeExpired() {
+		if (timerCount == 0) return;
+		auto now = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> lock(timersMutex);
+		while (!timers.empty() && std::get<0>(timers.top()) <= now) {
+			Box* box = std::get<2>(timers.top());
+			if (box->timerPending && box->timerGeneration == std::get<1>(timers.top())) {
+				box->timerPending = false;
+				timerCount--;
+				box->Wake();
+			}
+			timers.pop();
+		}
+	}
+
+	//Stale timers with far deadlines would otherwise pile up behind the live ones,
+	//so once they outnumber them the queue is rebuilt from the live ones alone
+	void Collective::CompactTimers() {
+		if (timers.size() <= 2 * std::size_t(timerCount) + 64) return;
+		std::vector<timer_t> live;
+		while (!timers.empty()) {
+			Box* box = std::get<2>(timers.top());
+			if (box->timerPending && box->timerGeneration == std::get<1>(timers.top())) {
+				live.push_back(timers.top());
+			}
+			timers.pop();
+		}
+		timers = std::priority_queue<timer_t, std::vector<timer_t>, std::greater<timer_t>>(std::greater<timer_t>(), std::move(live));
+	}
+
+	std::size_t Collective::GetQueuedTimerCount() {
+		std::unique_lock<std::mutex> lock(timersMutex);
+		return timers.size();
+	}
+
+	//Runs on the Box's own coroutine, after its Computer has returned
+	void Collective::Halt(Box* box) {
+		try {
+			box->Terminator();
+		}
+		catch (OperationCancelledException const &) {
+		}
+		box->SetState(Box::Halted);
+		//whatever the Box sent during this superstep must arrive before its halt does
+		if (box->defersTransmission) {
+			for (auto output : box->GetOutputs()) {
+				output->Transmit();
+			}
+		}
+		PropagateHalt(box);
+		box->completion.Set();
+		BoxHalted();
+	}
+
+	//Whether a dependent's input halts depends on the state of all of its
+	//producers, which it reads itself, so it only needs waking
+	void Collective::PropagateHalt(Box* box) {
+		auto dependents = box->dependents.load(std::memory_order_acquire);
+		if (!dependents) return;
+		for (Box* dependent : *dependents) {
+			if (!dependent->GetIsHalted()) {
+				dependent->Wake();
+			}
+		}
+	}
+
+	//Before the runners start, a list is only read by this thread, so it
+	//grows in place. After, a runner may be reading it, so it is replaced.
+	void Collective::AddDependent(Box* producer, Box* consumer) {
+		std::unique_lock<std::mutex> lock(dependentsMutex);
+		auto current = producer->dependents.load(std::memory_order_relaxed);
+		if (current && !current->empty() && current->back() == consumer) return;
+		if (current && !startBlocker.IsSet()) {
+			const_cast<std::vector<Box*>*>(current)->push_back(consumer);
+			return;
+		}
+		std::unique_ptr<std::vector<Box*>> replacement(current ? new std::vector<Box*>(*current) : new std::vector<Box*>());
+		replacement->push_back(consumer);
+		producer->dependents.store(replacement.get(), std::memory_order_release);
+		dependentLists.push_back(std::move(replacement));
 	}
 
 	void Collective::BoxHalted() {
-		haltedBoxCount++;
+		if (++haltedBoxCount == boxCount) {
+			Terminator();
+			blocker.Set();
+		}
+	}
+
+	//An unlocked pass first, which may be wrong, and only if it finds
+	//something, a locked pass, which is exact and may halt a Box
+	bool Collective::DeadlockBreaker() {
+		return DetectDeadlock(false) && DetectDeadlock(true);
 	}
 
 	/// <summary>
-	/// Construct a doubly linked graph from the current input/output dependencies
-	/// The graph excludes any vertices that would represent halted a Box
-	/// A vertex is "blocked" if it has any "inNeighbors"
-	/// Non-blocked vertices, and their successors, are removed
-	/// The remaining vertices' corresponding boxes are deadlocked
-	/// 
+	/// A Box is blocked if it waits on an input, and is deadlocked if every
+	/// Box it waits on is deadlocked too. Blocked Boxes are found, then any
+	/// Box that waits on an unblocked one is removed, transitively. The
+	/// remaining Boxes, if any, are deadlocked.
+	///
+	/// A Box that receives from another process waits on no Box here. It is
+	/// first assumed to be blocked whenever nothing is queued, and each Box
+	/// that sends to another process tells its receiving end whether it is
+	/// deadlocked under that assumption. Then the receiving Box counts as
+	/// blocked only if the other end confirms it is stalled. So a cycle
+	/// that crosses processes is found once each process has run this
+	/// twice. Only the Collective with the lowest id in such a cycle breaks
+	/// it, by halting one of its receiving Boxes.
+	///
 	/// This algorithm is O(n + k)
-	/// 	
 	/// </summary>
-	/// <param name="lockCollective">the lockCollective parameter determines
-	/// if all boxes will be locked before testing. Without locking, false
-	/// positives/negatives are possible. With locking, the test is guaranteed
-	/// to be correct.</param>
-	/// <returns>Box*</returns>
-	Box* Collective::DetectDeadlock(bool lockCollective) {
-		std::unique_lock<std::mutex> lock;
-		std::vector<std::unique_lock<std::mutex>> boxLocks;
-		std::vector<Box*> boxesCopy;
-
-		//fill boxesCopy, locking each Box if lockCollective is true
-		if (lockCollective) {
-			lock = std::move(std::unique_lock<std::mutex>(boxesMutex));			
-			for (std::unique_ptr<Box> &boxPtr : boxes) {
+	/// <param name="breakDeadlock">lock every input while testing, so that
+	/// the result is exact, and halt an input of one of the deadlocked
+	/// Boxes. Without locking, false positives/negatives are possible.</param>
+	/// <returns>whether a deadlock was found</returns>
+	bool Collective::DetectDeadlock(bool breakDeadlock) {
+		class vertex {
+		public:
+			Box* box;
+			RemoteEndpoint* remote;
+			std::vector<IInput*> inputs;
+			//the Boxes that send to each input
+			std::vector<std::vector<Box*>> producers;
+			std::vector<IInput*> blockedInputs;
+			std::vector<vertex*> dependents;
+			bool isDeadlocked;
+		};
+
+		//a snapshot of the graph, taken before locking since reading it takes the same locks
+		int generation = connectionCount;
+		std::vector<vertex> vertices;
+		{
+			std::unique_lock<std::mutex> lock(boxesMutex);
+			for (auto &boxPtr : boxes) {
 				if (boxPtr->GetIsHalted()) continue;
-				boxLocks.push_back(std::move(boxPtr->Lock()));
-				boxesCopy.push_back(boxPtr.get());
+				vertex v = vertex();
+				v.box = boxPtr.get();
+				v.remote = v.box->GetRemoteEndpoint();
+				vertices.push_back(std::move(v));
 			}
 		}
-		else {
-			std::unique_lock<std::mutex> shortLock(boxesMutex);
-			for (std::unique_ptr<Box> &boxPtr : boxes) {
-				if (boxPtr->GetIsHalted()) continue;
-				boxesCopy.push_back(boxPtr.get());
+		std::map<Box*, vertex*> boxToVertex;
+		for (auto &v : vertices) {
+			boxToVertex[v.box] = &v;
+			v.inputs = v.box->GetInputs();
+			for (IInput* input : v.inputs) {
+				std::vector<Box*> producers;
+				for (IOutput* output : input->GetConnectedOutputs()) {
+					producers.push_back(output->GetOwner());
+				}
+				v.producers.push_back(std::move(producers));
 			}
 		}
 
-		class vertex {
+		class unlocker {
 		public:
-			bool isHalted;
-			std::set<vertex*> inNeighbors;
-			std::set<vertex*> outNeighbors;
-			Box* box;
-		};
+			std::vector<IInput*> locked;
+			~unlocker() {
+				for (IInput* input : locked) input->Unlock();
+			}
+		} locks;
+		if (breakDeadlock) {
+			for (auto &v : vertices) {
+				for (IInput* input : v.inputs) {
+					input->Lock();
+					locks.locked.push_back(input);
+				}
+			}
+			if (connectionCount != generation) return false;
+		}
 
-		//construct the vertices of the graph
-		typedef std::map<Box*, std::unique_ptr<vertex>> map_t;
-		map_t boxToVertex;
-		auto getVertex = [&boxToVertex](Box* box) { 
-			auto pair = boxToVertex.insert(map_t::value_type(box, std::move(std::unique_ptr<vertex>())));
-			if (pair.second) {
-				pair.first->second = std::move(std::unique_ptr<vertex>());
-			}
-			vertex *result = pair.first->second.get();
-			result->box = box;
-			return result;
-		};
+		auto findDeadlocked = [&](bool assumeRemoteBlocked) {
+			std::queue<vertex*> unblocked;
+			for (auto &v : vertices) {
+				v.blockedInputs.clear();
+				v.dependents.clear();
+			}
+			for (auto &v : vertices) {
+				bool isBlocked = false;
+				bool waitsOnUnknown = false;
+				if (v.remote && v.remote->GetRole() == RemoteEndpoint::Role::Receiver) {
+					isBlocked = assumeRemoteBlocked ? v.remote->GetIsStarved() : v.remote->GetIsPeerStalled();
+				}
+				else if (!v.box->TestState(Box::Running | Box::PendingWork)) {
+					bool anyProducer = false;
+					for (std::size_t index = 0; index < v.inputs.size(); index++) {
+						if (!v.inputs[index]->GetIsBlocked()) continue;
+						v.blockedInputs.push_back(v.inputs[index]);
+						for (Box* producer : v.producers[index]) {
+							if (producer->GetIsHalted()) continue;
+							anyProducer = true;
+							auto found = boxToVertex.find(producer);
+							if (found == boxToVertex.end()) {
+								waitsOnUnknown = true;
+							}
+							else {
+								found->second->dependents.push_back(&v);
+							}
+						}
+					}
+					//with every producer halted, the Box is about to see the halt
+					isBlocked = anyProducer && !waitsOnUnknown;
+				}
+				v.isDeadlocked = isBlocked;
+				if (!isBlocked) unblocked.push(&v);
+			}
 
-		//construct the edges
-		for (std::unique_ptr<Box> &boxPtr : boxes) {
-			vertex *inVertex = getVertex(boxPtr.get());
-			for (IInput* input : boxPtr->GetInputs()) {
-				if (input->GetIsBlocked()) {
-					for (IOutput *output : input->GetConnectedOutputs()) {
-						vertex *outVertex = getVertex(output->GetOwner());
-						inVertex->outNeighbors.insert(outVertex);
-						outVertex->inNeighbors.insert(inVertex);
+			//this is similar to Kahn's "Topological sorting of large networks"
+			//except that a vertex is removed as soon as any in edge is
+			while (!unblocked.empty()) {
+				vertex* u = unblocked.front();
+				unblocked.pop();
+				for (vertex* dependent : u->dependents) {
+					if (dependent->isDeadlocked) {
+						dependent->isDeadlocked = false;
+						unblocked.push(dependent);
 					}
 				}
 			}
-		}
 
-		//Find and separate any unblocked boxes (ones that have no in neighbors)
-		std::set<vertex*> transitivelyBlockedSet;
-		std::queue<vertex*> transitivelyUnblocked;
-		for (auto &pair : boxToVertex) {
-			vertex *v = pair.second.get();
-			if (v->inNeighbors.size() > 0) {
-				transitivelyBlockedSet.insert(v);
+			std::vector<vertex*> results;
+			for (auto &v : vertices) {
+				if (v.isDeadlocked) results.push_back(&v);
 			}
-			else {
-				transitivelyUnblocked.push(v);
+			return results;
+		};
+
+		auto assumingRemoteBlocked = findDeadlocked(true);
+		if (!breakDeadlock) return !assumingRemoteBlocked.empty();
+		std::set<vertex*> stalled(assumingRemoteBlocked.begin(), assumingRemoteBlocked.end());
+		for (auto &v : vertices) {
+			if (v.remote && v.remote->GetRole() == RemoteEndpoint::Role::Sender) {
+				v.remote->SetIsStalled(stalled.count(&v) > 0);
 			}
 		}
 
-		//and apply the unblocked "property" transitively down stream
-		//this is similar to Kahn's "Topological sorting of large networks"
-		//except that nodes are removed regardless of whether they have any
-		//remaining in edges
-		while (transitivelyUnblocked.size() > 0) {
-			vertex *unblocked = transitivelyUnblocked.front();
-			transitivelyUnblocked.pop();
-			for (vertex *downstream : unblocked->outNeighbors) {
-				transitivelyBlockedSet.erase(downstream);
-				transitivelyUnblocked.push(downstream);
+		auto deadlocked = findDeadlocked(false);
+		if (deadlocked.empty()) return false;
+		std::vector<vertex*> receivers;
+		for (vertex* v : deadlocked) {
+			if (v->remote && v->remote->GetRole() == RemoteEndpoint::Role::Receiver) {
+				receivers.push_back(v);
 			}
 		}
-
-		//the remaining vertices, if any, are deadlocked
-		//return the associated box of one of them
-		if (transitivelyBlockedSet.size() > 0) {
-			return (*transitivelyBlockedSet.begin())->box;
+		if (!receivers.empty()) {
+			for (vertex* receiver : receivers) {
+				//left for the other process to break
+				if (receiver->remote->GetPeerId() < id) return true;
+			}
+			receivers.front()->remote->BreakDeadlock();
+			return true;
 		}
-		return nullptr;
-
-		//all locks are freed thanks to vector of unique_ptrs
-		//all vertices are freed thanks to map of unique_ptrs
+		deadlocked.front()->blockedInputs.front()->SignalHalt();
+		return true;
 	}
 
-	void Collective::RunnerLoop(coroutine::yield_type& yield) {
+	//Each runner resumes Boxes directly, so a Box that suspends returns
+	//control to whichever runner resumed it
+	void Collective::RunnerLoop(int runnerIndex) {
+		currentRunner.reset(new int(runnerIndex));
+		if (placement != PlacementPolicy::Any && !Topology::PinCurrentThread(runnerProcessors[runnerIndex])) {
+			unpinnedRunnerCount++;
+		}
 		startBlocker.Wait();
 		while (!blocker.IsSet()) {
+			WakeExpired();
+			bool ranAny = false;
 			for (auto &boxPtr : boxes) {
-				if (boxPtr->hasPendingWork.exchange(false)) {
-					yield(boxPtr->coro);
+				if (placement == PlacementPolicy::Connected && boxPtr->homeRunner != runnerIndex) continue;
+				ranAny |= TryRun(boxPtr.get());
+			}
+			if (placement == PlacementPolicy::Connected && !ranAny) {
+				//nothing to do at home, so help out elsewhere
+				for (auto &boxPtr : boxes) {
+					ranAny |= TryRun(boxPtr.get());
+				}
+			}
+			if (mode == ExecutionMode::Superstep) {
+				if (!ranAny) {
+					AwaitSuperstep();
 				}
+				continue;
+			}
+			//the first runner looks for deadlocks whenever it finds nothing to do
+			if (runnerIndex == 0 && !ranAny) {
+				auto now = std::chrono::steady_clock::now();
+				if (now >= nextDeadlockCheck) {
+					nextDeadlockCheck = now + std::chrono::milliseconds(5);
+					DeadlockBreaker();
+				}
+			}
+		}
+	}
+
+	//Resume the Box if it has work and no other runner has it, returning
+	//whether it ran. A Box with nothing to do costs a single load.
+	bool Collective::TryRun(Box* box) {
+		std::uint32_t state = box->state.load(std::memory_order_acquire);
+		do {
+			if ((state & (Box::Running | Box::Halted)) || !(state & Box::PendingWork)) return false;
+		} while (!box->state.compare_exchange_weak(state, (state | Box::Running) & ~Box::PendingWork));
+		if (!box->coro) {
+			StartCoroutine(box);
+		}
+		box->runnerThread = std::this_thread::get_id();
+		box->coro();
+		RecycleStack(box);
+		box->ClearState(Box::Running);
+		return true;
+	}
+
+	//The last runner to run out of work ends the superstep, while the
+	//others wait for it
+	void Collective::AwaitSuperstep() {
+		std::unique_lock<std::mutex> lock(superstepMutex);
+		if (++superstepArrivedCount < runnerThreads.size()) {
+			std::uint64_t generation = superstepGeneration;
+			while (superstepGeneration == generation && !blocker.IsSet()) {
+				superstepCondition.wait_for(lock, std::chrono::milliseconds(1));
+			}
+			return;
+		}
+		ExchangeMessages();
+		superstepArrivedCount = 0;
+		superstepGeneration++;
+		superstepCondition.notify_all();
+	}
+
+	//Runs at the barrier, while no Box is running
+	void Collective::ExchangeMessages() {
+		WakeExpired();
+		std::size_t messageCount = 0;
+		for (auto &boxPtr : boxes) {
+			for (auto output : boxPtr->GetOutputs()) {
+				messageCount += output->Transmit();
+			}
+		}
+		superstepCount++;
+
+		//a Box halting, a timer, or a cancellation may have left work without any message
+		std::vector<IInput*> blockedInputs;
+		for (auto &boxPtr : boxes) {
+			if (boxPtr->GetIsHalted()) continue;
+			if (boxPtr->TestState(Box::PendingWork)) return;
+			for (auto input : boxPtr->GetInputs()) {
+				if (input->GetIsBlocked()) {
+					blockedInputs.push_back(input);
+				}
+			}
+		}
+		if (messageCount > 0 || timerCount > 0) return;
+
+		//nothing can ever arrive, so rather than halting one Box per barrier, halt them all now
+		for (auto input : blockedInputs) {
+			input->Lock();
+			if (input->GetIsBlocked()) {
+				input->SignalHalt();
 			}
+			input->Unlock();
 		}
 	}
 }
\ No newline at end of file
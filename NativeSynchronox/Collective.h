@@ -7,6 +7,13 @@
 #include <map>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <typeindex>
+#include <queue>
+#include <tuple>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
 #include <boost/coroutine/coroutine.hpp>
 #include <boost/thread/tss.hpp>
 #include <boost/lockfree/queue.hpp>
@@ -15,56 +22,185 @@
 #include "Box.h"
 #include "Input.h"
 #include "Output.h"
+#include "StackPool.h"
+#include "CancellationToken.h"
+#include "Topology.h"
 #include "lock_free_forward_list.h"
 
 namespace Synchronox {
 	typedef boost::coroutines::symmetric_coroutine<void> coroutine;
 
+	enum class PlacementPolicy {
+		//any runner may resume any Box
+		Any,
+		//as Any, but each runner is pinned to its own processor
+		Pinned,
+		//runners are pinned, and each Box is given a home runner so that
+		//connected Boxes share a processor, or at least a NUMA node. Each
+		//Box is allocated on pages of its own on that node, and the data
+		//queued on its Inputs is allocated there too
+		Connected
+	};
+
+	enum class ExecutionMode {
+		//each datum is delivered as soon as it is enqueued
+		Asynchronous,
+		/// <summary>
+		/// Bulk synchronous: the runners run every Box with pending input
+		/// until it blocks, while Outputs hold on to what is enqueued. When
+		/// all are idle, the data is delivered in bulk at a barrier, and the
+		/// next superstep begins. A superstep that delivers nothing is a
+		/// fixpoint, which ends by halting every blocked input at once, so
+		/// anything a Box enqueues as it then halts is discarded. For
+		/// iterative computations, this replaces per datum locking and
+		/// deadlock detection.
+		/// </summary>
+		Superstep
+	};
+
 	class Collective {
 		Collective(Collective const &other) = delete;
 	public:
 		template<typename T>
 		void Connect(Input<T>& input, Output<T>& output) {
 			output.Connect(input);
+			AddDependent(output.GetOwner(), input.GetOwner());
+			connectionCount++;
 		}
 
 		bool IsDone();
 		void Join();
+
+		/// <summary>
+		/// Join, but if the Collective hasn't finished by the deadline then
+		/// cancel it, and wait up to grace longer for the Boxes to unwind.
+		/// Returns false if the deadline was missed. A Box only sees the
+		/// cancellation at a port operation, so one that is computing may
+		/// still be running when this returns: IsDone tells, and Join, or
+		/// the destructor, waits for it.
+		/// </summary>
+		bool JoinUntil(std::chrono::steady_clock::time_point deadline, std::chrono::steady_clock::duration grace = std::chrono::milliseconds(100));
+		bool JoinFor(std::chrono::steady_clock::duration timeout, std::chrono::steady_clock::duration grace = std::chrono::milliseconds(100));
+
+		//Every Box observes the token at its next port operation, and halts
+		void Cancel();
+		CancellationToken const &GetCancellationToken();
+		//distinguishes this Collective from those in other processes
+		std::uint64_t GetId() const;
+		//the number of barriers passed so far, in superstep mode
+		std::uint64_t GetSuperstepCount() const;
+		//the runners that Pinned or Connected placement failed to pin, which run wherever the system puts them
+		int GetUnpinnedRunnerCount() const;
+		//where the Boxes' coroutine stacks come from, and go back to when they finish
+		StackPool &GetStackPool();
+		//the timers queued for timed waits, including those cancelled but not yet dropped
+		std::size_t GetQueuedTimerCount();
+
+		//Boxes of type T created after this call run on stacks of the given size
+		template<typename T>
+		void SetStackSize(std::size_t stackSize) {
+			SetStackSize(std::type_index(typeid(T)), stackSize);
+		}
+
 		template<typename T, typename... U>
-		std::shared_ptr<T> CreateBox(U... args) {
-			std::lock<std::mutex> lock(boxesMutex);
-			auto box = new T(args...);
+		T* CreateBox(U... args) {
+			std::unique_lock<std::mutex> lock(boxesMutex);
+			int homeRunner = ChooseHomeRunner();
+			//a Box with a home is given pages of its own on its runner's node
+			void* allocation = homeRunner >= 0 ? Topology::AllocateOnNode(sizeof(T), GetNodeOfRunner(homeRunner)) : nullptr;
+			T* result;
+			try {
+				result = allocation ? new (allocation) T(args...) : new T(args...);
+			}
+			catch (...) {
+				if (allocation) Topology::FreeOnNode(allocation, sizeof(T));
+				throw;
+			}
+			Box* box = result; //the Box members are accessible to Collective only through Box*
+			box->allocation = allocation;
+			box->allocationSize = sizeof(T);
 			box->collective = this;
+			box->defersTransmission = mode == ExecutionMode::Superstep;
 			box->Initializer();
-			box->coro = std::move(coroutine::call_type([this, box](coroutine::yield_type& yield) {
-				box->yield = &yield;
-				box->Computer();
-			}));
-			box->hasPendingWork = true;
-			boxes.emplace_front(box);
+			box->stackSize = GetStackSize(std::type_index(typeid(T)));
+			SetHome(box, homeRunner);
+			box->SetState(Box::PendingWork);
+			boxCount++;
+			boxes.push_front(std::unique_ptr<Box, Box::Deleter>(box));
+			return result;
 		}
 
+		virtual ~Collective();
 	protected:
-		Collective(int threadCount = -1);
+		Collective(int threadCount = -1, PlacementPolicy placement = PlacementPolicy::Any, ExecutionMode mode = ExecutionMode::Asynchronous);
 		void ConstructionCompleted();
 		virtual void Terminator();
 	private:
 		friend class Box;
 
 		NoResetEvent startBlocker;
+		std::atomic<int> boxCount;
 		std::atomic<int> haltedBoxCount;
 		NoResetEvent blocker;
-		lock_free_forward_list<std::unique_ptr<Box>> boxes;
+		//declared before boxes, so that every coroutine has returned its stack before the pool is torn down
+		StackPool stackPool;
+		std::map<std::type_index, std::size_t> stackSizes;
+		std::mutex stackSizesMutex;
+		lock_free_forward_list<std::unique_ptr<Box, Box::Deleter>> boxes;
+		std::mutex boxesMutex;
+		CancellationToken cancellationToken;
+		std::uint64_t id;
+		//lets the deadlock detector see that the graph changed while it was being read
+		std::atomic<int> connectionCount;
+		//every Box's list of dependents, including those replaced by a Connect while running
+		std::vector<std::unique_ptr<std::vector<Box*>>> dependentLists;
+		std::mutex dependentsMutex;
+		std::chrono::steady_clock::time_point nextDeadlockCheck;
+
+		//each Box has at most one live timer; the others queued for it are stale, and are dropped as they surface
+		typedef std::tuple<std::chrono::steady_clock::time_point, std::uint64_t, Box*> timer_t;
+		std::priority_queue<timer_t, std::vector<timer_t>, std::greater<timer_t>> timers;
+		//the live timers
+		std::atomic<int> timerCount;
+		std::mutex timersMutex;
 
-		boost::thread_specific_ptr<coroutine::call_type> runner;
-		std::vector<coroutine::call_type> runners;
 		std::vector<std::thread> runnerThreads;
+		PlacementPolicy placement;
+		//the processor each runner is pinned to
+		std::vector<int> runnerProcessors;
+		std::atomic<int> unpinnedRunnerCount;
+		//the index of the runner on the current thread, if it is a runner
+		boost::thread_specific_ptr<int> currentRunner;
+
+		ExecutionMode mode;
+		std::mutex superstepMutex;
+		std::condition_variable superstepCondition;
+		std::size_t superstepArrivedCount;
+		std::uint64_t superstepGeneration;
+		std::atomic<std::uint64_t> superstepCount;
 
+		void SetStackSize(std::type_index boxType, std::size_t stackSize);
+		std::size_t GetStackSize(std::type_index boxType);
+		void StartCoroutine(Box* box);
+		void RecycleStack(Box* box);
+		void AddDependent(Box* producer, Box* consumer);
+		void ScheduleWake(Box* box, std::chrono::steady_clock::time_point deadline);
+		void CancelWake(Box* box);
+		void WakeExpired();
+		void CompactTimers();
+		void Halt(Box* box);
 		void PropagateHalt(Box* box);
 		void BoxHalted();
 		bool DeadlockBreaker();
-		Box* DetectDeadlock(bool lockCollective);
-		void RunnerLoop(coroutine::yield_type& yield);
+		bool DetectDeadlock(bool breakDeadlock);
+		void RunnerLoop(int runnerIndex);
+		bool TryRun(Box* box);
+		int ChooseHomeRunner();
+		int GetNodeOfRunner(int runnerIndex);
+		void SetHome(Box* box, int runnerIndex);
+		void PlaceBoxes();
+		void AwaitSuperstep();
+		void ExchangeMessages();
 	};
 }
 
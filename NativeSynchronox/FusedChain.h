@@ -0,0 +1,174 @@
+#ifndef _FUSED_CHAIN_H_
+#define _FUSED_CHAIN_H_
+
+#include <tuple>
+#include <cstddef>
+#include "Box.h"
+#include "Input.h"
+#include "Output.h"
+#include "Collective.h"
+
+namespace Synchronox {
+	enum class ChainMode {
+		//one Box per stage, connected by Input/Output queues
+		Unfused,
+		//a single Box that calls every stage directly
+		Fused
+	};
+
+	/// <summary>
+	/// A pure one-in/one-out transform from TIn to TOut
+	/// </summary>
+	template<typename TIn, typename TOut, typename F>
+	class ChainStage {
+	public:
+		typedef TIn input_type;
+		typedef TOut output_type;
+		typedef F function_type;
+
+		ChainStage(F function) : function(function) {}
+
+		TOut operator()(TIn const &datum) {
+			return function(datum);
+		}
+
+		F function;
+	};
+
+	/// <summary>
+	/// Runs a single ChainStage in its own Box. This is what every stage
+	/// of an unfused chain becomes.
+	/// </summary>
+	template<typename TIn, typename TOut, typename F>
+	class StageBox : public Box {
+	public:
+		Input<TIn> input;
+		Output<TOut> output;
+
+		StageBox(ChainStage<TIn, TOut, F> stage) : input(this), output(this), stage(stage) {}
+	protected:
+		void Computer() {
+			TIn datum;
+			while (input.Dequeue(datum)) {
+				output.Enqueue(stage(datum));
+			}
+		}
+	private:
+		ChainStage<TIn, TOut, F> stage;
+	};
+
+	namespace detail {
+		//feeds a datum through stages I..N-1 by direct call, then enqueues the result
+		template<std::size_t I, std::size_t N>
+		struct RunStages {
+			template<typename Tuple, typename T, typename TOut>
+			static void Run(Tuple &stages, T const &datum, Output<TOut> &output) {
+				RunStages<I + 1, N>::Run(stages, std::get<I>(stages)(datum), output);
+			}
+		};
+
+		template<std::size_t N>
+		struct RunStages<N, N> {
+			template<typename Tuple, typename T, typename TOut>
+			static void Run(Tuple &, T const &datum, Output<TOut> &output) {
+				output.Enqueue(datum);
+			}
+		};
+
+		//creates a StageBox for each of stages I..N-1, connecting each to its predecessor
+		template<std::size_t I, std::size_t N>
+		struct LinkStages {
+			template<typename Tuple, typename TIn, typename TOut>
+			static Output<TOut>* Link(Collective &collective, Tuple &stages, Output<TIn> &upstream) {
+				typedef typename std::tuple_element<I, Tuple>::type stage_t;
+				auto box = collective.CreateBox<StageBox<typename stage_t::input_type, typename stage_t::output_type, typename stage_t::function_type>>(std::get<I>(stages));
+				collective.Connect(box->input, upstream);
+				return LinkStages<I + 1, N>::template Link<Tuple, typename stage_t::output_type, TOut>(collective, stages, box->output);
+			}
+		};
+
+		template<std::size_t N>
+		struct LinkStages<N, N> {
+			template<typename Tuple, typename TIn, typename TOut>
+			static Output<TOut>* Link(Collective &, Tuple &, Output<TIn> &upstream) {
+				return &upstream;
+			}
+		};
+	}
+
+	/// <summary>
+	/// Every stage of a chain in a single Box. Intermediate values are
+	/// passed by direct call, so there is no queue, lock, or coroutine
+	/// switch between stages. Data is still processed in arrival order, and
+	/// the Box halts when its input halts, just as the last StageBox of the
+	/// equivalent unfused chain would.
+	/// </summary>
+	template<typename TIn, typename TOut, typename... Stages>
+	class FusedBox : public Box {
+	public:
+		Input<TIn> input;
+		Output<TOut> output;
+
+		FusedBox(std::tuple<Stages...> stages) : input(this), output(this), stages(stages) {}
+	protected:
+		void Computer() {
+			TIn datum;
+			while (input.Dequeue(datum)) {
+				detail::RunStages<0, sizeof...(Stages)>::Run(stages, datum, output);
+			}
+		}
+	private:
+		std::tuple<Stages...> stages;
+	};
+
+	/// <summary>
+	/// The ends of an instantiated chain, for connecting it to the rest of the Collective
+	/// </summary>
+	template<typename TIn, typename TOut>
+	class ChainEnds {
+	public:
+		Input<TIn>* input;
+		Output<TOut>* output;
+	};
+
+	/// <summary>
+	/// A statically typed sequence of one-in/one-out stages, built with
+	/// MakeChain(f).Then&lt;B&gt;(g)... and instantiated in a Collective as
+	/// either one Box per stage or a single FusedBox.
+	/// </summary>
+	template<typename TIn, typename TOut, typename... Stages>
+	class Chain {
+	public:
+		Chain(std::tuple<Stages...> stages) : stages(stages) {}
+
+		template<typename TNext, typename F>
+		Chain<TIn, TNext, Stages..., ChainStage<TOut, TNext, F>> Then(F function) const {
+			return Chain<TIn, TNext, Stages..., ChainStage<TOut, TNext, F>>(std::tuple_cat(stages, std::make_tuple(ChainStage<TOut, TNext, F>(function))));
+		}
+
+		ChainEnds<TIn, TOut> Instantiate(Collective &collective, ChainMode mode) {
+			ChainEnds<TIn, TOut> result;
+			if (mode == ChainMode::Fused) {
+				auto box = collective.CreateBox<FusedBox<TIn, TOut, Stages...>>(stages);
+				result.input = &box->input;
+				result.output = &box->output;
+			}
+			else {
+				typedef typename std::tuple_element<0, std::tuple<Stages...>>::type first_t;
+				auto box = collective.CreateBox<StageBox<TIn, typename first_t::output_type, typename first_t::function_type>>(std::get<0>(stages));
+				result.input = &box->input;
+				result.output = detail::LinkStages<1, sizeof...(Stages)>::template Link<std::tuple<Stages...>, typename first_t::output_type, TOut>(collective, stages, box->output);
+			}
+			return result;
+		}
+	private:
+		std::tuple<Stages...> stages;
+	};
+
+	template<typename TIn, typename TOut, typename F>
+	Chain<TIn, TOut, ChainStage<TIn, TOut, F>> MakeChain(F function) {
+		return Chain<TIn, TOut, ChainStage<TIn, TOut, F>>(std::make_tuple(ChainStage<TIn, TOut, F>(function)));
+	}
+}
+
+#endif
\ No newline at end of file
@@ -1,11 +1,7 @@
 #include "IInput.h"
 
-
-IInput::IInput()
-{
-}
-
-
-IInput::~IInput()
-{
+namespace Synchronox {
+	IInput::~IInput()
+	{
+	}
 }
@@ -1,23 +1,50 @@
 #ifndef _IINPUT_H_
 #define _IINPUT_H_
 
+#include <vector>
+
 namespace Synchronox {
 	class Box;
 
 	class IOutput;
 
+	enum class DequeueResult {
+		Dequeued,
+		//every connected Output has halted, and the queue is empty
+		Halted,
+		//the deadline passed with nothing queued
+		TimedOut
+	};
+
 	class IInput
 	{
 	public:
 		virtual ~IInput();
 	protected:
+		enum class PollResult {
+			//nothing queued, but a connected Output may still send more
+			Empty,
+			//a datum is queued
+			Ready,
+			//the input has just been found to be halted
+			Halted,
+			//the halt was already reported by an earlier Poll or Dequeue
+			HaltObserved
+		};
+
 		friend class Box;
 		friend class Collective;
-		virtual std::set<IOutput *> GetConnectedOutputs() = 0;
+		virtual std::vector<IOutput *> GetConnectedOutputs() = 0;
 		virtual Box* GetOwner() = 0;
 		virtual bool GetIsBlocked() = 0;
+		virtual void SetIsBlocked(bool value) = 0;
+		virtual PollResult Poll() = 0;
+		//treat the input as though every connected Output had halted, the caller holds Lock
+		virtual void SignalHalt() = 0;
 		virtual void Lock() = 0;
 		virtual void Unlock() = 0;
+		//queue data on the node of the owner's home runner from now on, unless something is already queued
+		virtual void SetHomeNode(int node) = 0;
 	};
 }
 
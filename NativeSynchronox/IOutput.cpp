@@ -1,11 +1,7 @@
 #include "IOutput.h"
 
-
-IOutput::IOutput()
-{
-}
-
-
-IOutput::~IOutput()
-{
+namespace Synchronox {
+	IOutput::~IOutput()
+	{
+	}
 }
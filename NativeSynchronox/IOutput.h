@@ -1,7 +1,8 @@
 #ifndef _IOUTPUT_H_
 #define _IOUTPUT_H_
 
-#include <set>
+#include <vector>
+#include <cstddef>
 
 namespace Synchronox {
 	class Box;
@@ -16,7 +17,9 @@ namespace Synchronox {
 		virtual Box* GetOwner() = 0;
 	private:
 		friend class Collective;
-		virtual std::set<IInput*> GetConnectedInputs() = 0;
+		virtual std::vector<IInput*> GetConnectedInputs() = 0;
+		//deliver anything enqueued but not yet delivered, and return how much that was
+		virtual std::size_t Transmit() = 0;
 	};
 }
 
@@ -1,39 +1,113 @@
 #ifndef _INPUT_H_
 #define _INPUT_H_
 
+#include <deque>
 #include <queue>
+#include <cassert>
+#include <set>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
 #include "IInput.h"
-#include "ConcurrentSet.h"
-#include "ConditionVariable.h"
+#include "Box.h"
+#include "SpillFile.h"
+#include "ChannelTraits.h"
+#include "NodeAllocator.h"
 
 namespace Synchronox {
-	class Box;
-
 	class IOutput;
 
 	template<typename T>
 	class Output;
 
 	template<typename T>
-	class Input : public IInput<T> final
+	class Input final : public IInput
 	{
 	public:
-		Input(Box* owner) : owner(owner) {
+		Input(Box* owner) : storageNode(-1), owner(owner), causedHalt(false), haltObserved(false), isBlocked(false), spillThreshold(0), serialize(nullptr), deserialize(nullptr) {
 			owner->_internal_use_only_register_input(this);
 		}
 
-		void Dequeue(T& datum) {
-			std::unique_lock l(sync);
-			if (queue.empty()) {
+		/// <summary>
+		/// Take the next datum, suspending the owning Box until one arrives.
+		/// Returns false once every connected Output's Box has halted and
+		/// the queue has been drained.
+		/// </summary>
+		bool Dequeue(T& datum) {
+			return DequeueUntil(datum, std::chrono::steady_clock::time_point::max()) == DequeueResult::Dequeued;
+		}
+
+		DequeueResult DequeueFor(T& datum, std::chrono::steady_clock::duration timeout) {
+			return DequeueUntil(datum, std::chrono::steady_clock::now() + timeout);
+		}
+
+		/// <summary>
+		/// As Dequeue, but gives up once the deadline has passed. Throws
+		/// OperationCancelledException if the Collective is cancelled.
+		/// </summary>
+		DequeueResult DequeueUntil(T& datum, std::chrono::steady_clock::time_point deadline) {
+			bool timed = deadline != std::chrono::steady_clock::time_point::max();
+			owner->ThrowIfCancelled();
+			std::unique_lock<std::mutex> l(sync);
+			while (GetIsQueueEmpty()) {
+				if (ComputeIsHalting()) {
+					haltObserved = true;
+					return DequeueResult::Halted;
+				}
+				if (timed && std::chrono::steady_clock::now() >= deadline) {
+					return DequeueResult::TimedOut;
+				}
+				//a timed wait will end on its own, so it can't be part of a deadlock
+				isBlocked = !timed;
 				l.unlock();
-				owner->collective->runner
+				owner->SuspendUntil(deadline);
+				l.lock();
+				isBlocked = false;
+				owner->ThrowIfCancelled();
+			}
+			if (queue.empty()) {
+				Refill();
+				//GetIsQueueEmpty said the spill held something
+				if (queue.empty()) throw std::logic_error("Input: spilled data could not be read back");
 			}
 			datum = queue.front();
 			queue.pop();
+			//in bulk once half the queue has drained, rather than a record at a time
+			if (spill && queue.size() <= spillThreshold / 2) {
+				Refill();
+			}
+			return DequeueResult::Dequeued;
+		}
+
+		/// <summary>
+		/// Once options.memoryThreshold bytes are queued in memory, append
+		/// anything more to a memory mapped SpillFile instead, so that a fast
+		/// producer is neither stalled nor able to exhaust memory. Spilled
+		/// data is moved back into memory as the queue drains, and is still
+		/// dequeued in order. T must be supported by ChannelTraits.
+		/// Call before anything is enqueued.
+		/// </summary>
+		void EnableSpill(SpillOptions const &options = SpillOptions()) {
+			std::unique_lock<std::mutex> l(sync);
+			assert(GetIsQueueEmpty());
+			spill.reset(new SpillFile(options));
+			spillThreshold = std::max<std::size_t>(1, options.memoryThreshold / sizeof(T));
+			serialize = &ChannelTraits<T>::Serialize;
+			deserialize = &ChannelTraits<T>::Deserialize;
+		}
+
+		SpillMetrics GetSpillMetrics() {
+			std::unique_lock<std::mutex> l(sync);
+			return spill ? spill->GetMetrics() : SpillMetrics();
 		}
 	private:
 		std::vector<IOutput*> GetConnectedOutputs() {
 			std::vector<IOutput*> results;
+			std::unique_lock<std::mutex> l(sync);
 			for (auto &connectedOutput : connectedOutputs) {
 				results.push_back(connectedOutput);
 			}
@@ -45,25 +119,118 @@ namespace Synchronox {
 		}
 
 		friend class Collective;
-		template<typename T>
+		template<typename U>
 		friend class Output;
 		friend class Box;
-		std::queue<T> queue;
+		typedef std::queue<T, std::deque<T, NodeAllocator<T>>> queue_t;
+		queue_t queue;
+		//where queue's storage comes from, or -1 for the ordinary heap
+		int storageNode;
 		std::set<Output<T>*> connectedOutputs;
 		Box* owner;
 		std::mutex sync;
+		bool causedHalt;
+		bool haltObserved;
+		std::atomic<bool> isBlocked;
+		//data queued after the in memory queue reached spillThreshold, in order, and all of it after queue
+		std::unique_ptr<SpillFile> spill;
+		std::size_t spillThreshold;
+		std::vector<char> spillBuffer;
+		//set by EnableSpill, so that only Inputs that spill require ChannelTraits<T>
+		void (*serialize)(T const &, std::vector<char> &);
+		void (*deserialize)(std::vector<char> const &, T &);
+
 		void DidConnect(Output<T>* output) {
+			std::unique_lock<std::mutex> l(sync);
+			assert(!causedHalt); //connections may not be made after all existing connections have halted
 			connectedOutputs.insert(output);
 		}
 
 		void Enqueue(T const &datum) {
-			std::unique_lock l(sync);
-			queue.push(datum);
-			owner->hasPendingWork = true;
+			std::unique_lock<std::mutex> l(sync);
+			//only the deadlock breaker halts an input that still has a live Output
+			if (causedHalt) return;
+			Push(datum);
+			isBlocked = false;
+			owner->Wake();
+		}
+
+		//as Enqueue, but takes the lock and wakes the owner once for the lot
+		void EnqueueRange(T const* first, T const* last) {
+			std::unique_lock<std::mutex> l(sync);
+			if (causedHalt || first == last) return;
+			for (; first != last; ++first) {
+				Push(*first);
+			}
+			isBlocked = false;
+			owner->Wake();
+		}
+
+		//must be called while holding sync
+		void Push(T const &datum) {
+			//once anything is spilled, the rest must follow it to stay in order
+			if (spill && (queue.size() >= spillThreshold || !spill->GetIsEmpty())) {
+				serialize(datum, spillBuffer);
+				spill->Append(spillBuffer);
+			}
+			else {
+				queue.push(datum);
+			}
+		}
+
+		//Must be called while holding sync. Moves spilled data back into the
+		//queue, up to spillThreshold, so that once the consumer catches up
+		//Push can stop spilling.
+		void Refill() {
+			while (queue.size() < spillThreshold && spill->TryRead(spillBuffer)) {
+				T datum;
+				deserialize(spillBuffer, datum);
+				queue.push(std::move(datum));
+			}
+		}
+
+		//must be called while holding sync
+		bool GetIsQueueEmpty() {
+			return queue.empty() && (!spill || spill->GetIsEmpty());
+		}
+
+		//must be called while holding sync
+		bool ComputeIsHalting() {
+			if (causedHalt) {
+				return true;
+			}
+			if (!GetIsQueueEmpty()) return false;
+			for (auto connectedOutput : connectedOutputs) {
+				if (!connectedOutput->GetOwner()->GetIsHalted()) {
+					return false;
+				}
+			}
+			causedHalt = true;
+			return true;
 		}
 
 		bool GetIsBlocked() {
-			return cv.GetAnyWaiting();
+			return isBlocked;
+		}
+
+		void SetIsBlocked(bool value) {
+			isBlocked = value;
+		}
+
+		PollResult Poll() {
+			std::unique_lock<std::mutex> l(sync);
+			if (!GetIsQueueEmpty()) return PollResult::Ready;
+			if (haltObserved) return PollResult::HaltObserved;
+			if (ComputeIsHalting()) {
+				haltObserved = true;
+				return PollResult::Halted;
+			}
+			return PollResult::Empty;
+		}
+
+		void SignalHalt() {
+			causedHalt = true;
+			owner->Wake();
 		}
 
 		void Lock() {
@@ -73,6 +240,14 @@ namespace Synchronox {
 		void Unlock() {
 			sync.unlock();
 		}
+
+		void SetHomeNode(int node) {
+			std::unique_lock<std::mutex> l(sync);
+			//data already queued stays where it is
+			if (node == storageNode || !queue.empty()) return;
+			queue = queue_t(typename queue_t::container_type(NodeAllocator<T>(node)));
+			storageNode = node;
+		}
 	};
 }
 #endif
\ No newline at end of file
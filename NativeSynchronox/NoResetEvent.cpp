@@ -1,10 +1,6 @@
 #include "NoResetEvent.h"
 #include <atomic>
 
-NoResetEvent::NoResetEvent() : _state(false) { }
-
-NoResetEvent::~NoResetEvent() { }
-
 void NoResetEvent::Wait() {
 	std::unique_lock<std::mutex> lock(_sync);
 	while (!_state) {
@@ -12,8 +8,22 @@ void NoResetEvent::Wait() {
 	}
 }
 
+bool NoResetEvent::WaitUntil(std::chrono::steady_clock::time_point deadline) {
+	std::unique_lock<std::mutex> lock(_sync);
+	while (!_state) {
+		if (_underlying.wait_until(lock, deadline) == std::cv_status::timeout) {
+			return _state;
+		}
+	}
+	return true;
+}
+
 void NoResetEvent::Set() {
 	std::unique_lock<std::mutex> lock(_sync);
 	_state = true;
 	_underlying.notify_all();
+}
+
+bool NoResetEvent::IsSet() {
+	return _state;
 }
\ No newline at end of file
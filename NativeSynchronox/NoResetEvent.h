@@ -3,6 +3,7 @@
 
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 
 class NoResetEvent
 {
@@ -10,6 +11,8 @@ public:
 	NoResetEvent() : _state(false) {}
 	NoResetEvent(const NoResetEvent& other) = delete;
 	void Wait();
+	//returns false if the deadline passed before the event was set
+	bool WaitUntil(std::chrono::steady_clock::time_point deadline);
 	void Set();
 	bool IsSet();
 private:
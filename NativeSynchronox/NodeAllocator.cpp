@@ -0,0 +1,73 @@
+#include "NodeAllocator.h"
+#include "Topology.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Synchronox {
+	//blocks any larger get a region of their own
+	static std::size_t const MaxPooledSize = 16 * 1024;
+	static std::size_t const SlabSize = 256 * 1024;
+	static std::size_t const Alignment = 16;
+
+	struct NodePool {
+		//rounded size -> freed blocks of that size
+		std::map<std::size_t, std::vector<void*>> freeBlocks;
+		char* next;
+		char* end;
+		std::vector<void*> slabs;
+		NodePool() : next(nullptr), end(nullptr) {}
+		~NodePool() {
+			for (void* slab : slabs) {
+				Topology::FreeOnNode(slab, SlabSize);
+			}
+		}
+	};
+
+	struct NodePools {
+		std::mutex sync;
+		std::map<int, std::unique_ptr<NodePool>> byNode;
+	};
+
+	static NodePools &GetPools() {
+		static NodePools pools;
+		return pools;
+	}
+
+	void* NodeHeap::Allocate(std::size_t size, int node) {
+		if (size > MaxPooledSize) return Topology::AllocateOnNode(size, node);
+		size = (size + Alignment - 1) / Alignment * Alignment;
+		NodePools &pools = GetPools();
+		std::unique_lock<std::mutex> lock(pools.sync);
+		std::unique_ptr<NodePool> &pool = pools.byNode[node];
+		if (!pool) pool.reset(new NodePool());
+		auto &freed = pool->freeBlocks[size];
+		if (!freed.empty()) {
+			void* block = freed.back();
+			freed.pop_back();
+			return block;
+		}
+		if (static_cast<std::size_t>(pool->end - pool->next) < size) {
+			//what is left of the last slab is abandoned
+			pool->slabs.reserve(pool->slabs.size() + 1);
+			pool->next = static_cast<char*>(Topology::AllocateOnNode(SlabSize, node));
+			pool->end = pool->next + SlabSize;
+			pool->slabs.push_back(pool->next);
+		}
+		void* block = pool->next;
+		pool->next += size;
+		return block;
+	}
+
+	void NodeHeap::Free(void* block, std::size_t size, int node) {
+		if (size > MaxPooledSize) {
+			Topology::FreeOnNode(block, size);
+			return;
+		}
+		size = (size + Alignment - 1) / Alignment * Alignment;
+		NodePools &pools = GetPools();
+		std::unique_lock<std::mutex> lock(pools.sync);
+		pools.byNode[node]->freeBlocks[size].push_back(block);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef _NODE_ALLOCATOR_H_
+#define _NODE_ALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace Synchronox {
+	/// <summary>
+	/// Small blocks carved from slabs on a NUMA node, so that a queue's
+	/// storage lives on the node of the runner that reads it. Freed blocks
+	/// are kept on their node for reuse, and the slabs are only released
+	/// when the process exits.
+	/// </summary>
+	class NodeHeap {
+	public:
+		static void* Allocate(std::size_t size, int node);
+		static void Free(void* block, std::size_t size, int node);
+	};
+
+	//an allocator from a NodeHeap node, or from the ordinary heap for node -1
+	template<typename T>
+	class NodeAllocator {
+	public:
+		typedef T value_type;
+		//a container moved into takes the node along with the storage
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		NodeAllocator(int node = -1) : node(node) {}
+
+		template<typename U>
+		NodeAllocator(NodeAllocator<U> const &other) : node(other.GetNode()) {}
+
+		T* allocate(std::size_t count) {
+			std::size_t size = count * sizeof(T);
+			return static_cast<T*>(node < 0 ? ::operator new(size) : NodeHeap::Allocate(size, node));
+		}
+
+		void deallocate(T* block, std::size_t count) {
+			if (node < 0) {
+				::operator delete(block);
+			}
+			else {
+				NodeHeap::Free(block, count * sizeof(T), node);
+			}
+		}
+
+		int GetNode() const {
+			return node;
+		}
+	private:
+		int node;
+	};
+
+	template<typename T, typename U>
+	bool operator==(NodeAllocator<T> const &l, NodeAllocator<U> const &r) {
+		return l.GetNode() == r.GetNode();
+	}
+
+	template<typename T, typename U>
+	bool operator!=(NodeAllocator<T> const &l, NodeAllocator<U> const &r) {
+		return l.GetNode() != r.GetNode();
+	}
+}
+
+#endif
\ No newline at end of file
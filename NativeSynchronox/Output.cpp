@@ -1,11 +1 @@
 #include "Output.h"
-
-
-Output::Output()
-{
-}
-
-
-Output::~Output()
-{
-}
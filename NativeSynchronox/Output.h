@@ -4,6 +4,7 @@
 #include <vector>
 #include <mutex>
 #include "IOutput.h"
+#include "Box.h"
 
 namespace Synchronox {
 	class Box;
@@ -14,16 +15,23 @@ namespace Synchronox {
 	class Input;
 
 	template<typename T>
-	class Output : public IOutput<T> final
+	class Output final : public IOutput
 	{
 	public:
-		Output(Box* owner) : owner(owner) { }
-
-		~Output();
+		Output(Box* owner) : owner(owner) {
+			owner->_internal_use_only_register_output(this);
+		}
 
 		void Enqueue(T datum) {
-			data.push_back(datum);
-			DoTransmissions();
+			owner->ThrowIfCancelled();
+			{
+				std::unique_lock<std::mutex> l(dataLock);
+				data.push_back(datum);
+			}
+			//in a superstep, data is delivered in bulk at the barrier
+			if (!owner->defersTransmission) {
+				DoTransmissions();
+			}
 		}
 
 		Box* GetOwner() {
@@ -35,29 +43,63 @@ namespace Synchronox {
 		class Connection {
 		public:
 			Input<T> *input;
-			int nextTransmitDataIndex;
+			std::size_t nextTransmitDataIndex;
 		};
 
 		Box* owner;
 		std::vector<T> data;
+		std::mutex dataLock;
 		std::vector<Connection> connections;
 		std::mutex connectionsLock;
 
-		void Connect(Input<T> input) {
-			{
-				std::unique_lock<std::mutex> l(connectionsLock);
-				connections.push_back(Connection{ input, 0 });
+		void Connect(Input<T> &input) {
+			input.DidConnect(this);
+			//only the new connection can have anything outstanding; what is kept is
+			//either everything, if it is the first, or nothing, since the others took it
+			std::unique_lock<std::mutex> l(connectionsLock);
+			std::unique_lock<std::mutex> d(dataLock);
+			connections.push_back(Connection{ &input, data.size() });
+			if (!data.empty()) {
+				input.EnqueueRange(data.data(), data.data() + data.size());
 			}
-			DoTransmissions();
 		}
 
 		void DoTransmissions() {
 			std::unique_lock<std::mutex> l(connectionsLock);
+			std::unique_lock<std::mutex> d(dataLock);
 			for (auto &connection : connections) {
 				while (connection.nextTransmitDataIndex < data.size()) {
 					connection.input->Enqueue(data[connection.nextTransmitDataIndex++]);
 				}
 			}
+			Trim();
+		}
+
+		std::size_t Transmit() {
+			std::unique_lock<std::mutex> l(connectionsLock);
+			std::unique_lock<std::mutex> d(dataLock);
+			std::size_t count = 0;
+			for (auto &connection : connections) {
+				if (connection.nextTransmitDataIndex < data.size()) {
+					count += data.size() - connection.nextTransmitDataIndex;
+					connection.input->EnqueueRange(data.data() + connection.nextTransmitDataIndex, data.data() + data.size());
+					connection.nextTransmitDataIndex = data.size();
+				}
+			}
+			Trim();
+			return count;
+		}
+
+		//Every connection has been sent everything, so only one yet to be made could
+		//want it. A Box that has no connections yet keeps it all for the first one.
+		//Connections are all made before a superstep Collective starts, so in
+		//superstep mode nothing is kept regardless. The caller holds both locks.
+		void Trim() {
+			if (connections.empty() && !owner->defersTransmission) return;
+			data.clear();
+			for (auto &connection : connections) {
+				connection.nextTransmitDataIndex = 0;
+			}
 		}
 
 		std::vector<IInput*> GetConnectedInputs() {
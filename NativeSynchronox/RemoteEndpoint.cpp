@@ -0,0 +1,7 @@
+#include "RemoteEndpoint.h"
+
+namespace Synchronox {
+	RemoteEndpoint::~RemoteEndpoint()
+	{
+	}
+}
\ No newline at end of file
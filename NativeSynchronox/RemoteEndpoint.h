@@ -0,0 +1,35 @@
+#ifndef _REMOTE_ENDPOINT_H_
+#define _REMOTE_ENDPOINT_H_
+
+#include <cstdint>
+
+namespace Synchronox {
+	/// <summary>
+	/// Implemented by a Box that stands in for a connection to a Box in
+	/// another process, so that the deadlock detector can see across the
+	/// process boundary. A Receiver waits on the other process, and a
+	/// Sender is waited on by it.
+	/// </summary>
+	class RemoteEndpoint
+	{
+	public:
+		virtual ~RemoteEndpoint();
+	protected:
+		enum class Role { Sender, Receiver };
+
+		friend class Collective;
+		virtual Role GetRole() = 0;
+		//the id of the Collective at the other end, or 0 if it isn't attached yet
+		virtual std::uint64_t GetPeerId() = 0;
+		//Receiver: nothing is queued and the other end hasn't halted
+		virtual bool GetIsStarved() = 0;
+		//Receiver: starved, and the other end has reported the same stall, without sending anything, since the last call
+		virtual bool GetIsPeerStalled() = 0;
+		//Receiver: halt as though the other end had
+		virtual void BreakDeadlock() = 0;
+		//Sender: report to the other end whether this end is deadlocked, on the assumption that the other end is too
+		virtual void SetIsStalled(bool value) = 0;
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,196 @@
+#ifndef _SHARED_MEMORY_CHANNEL_H_
+#define _SHARED_MEMORY_CHANNEL_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include "Box.h"
+#include "Input.h"
+#include "Output.h"
+#include "RemoteEndpoint.h"
+#include "SharedRing.h"
+#include "ChannelTraits.h"
+
+namespace Synchronox {
+	namespace detail {
+		//how long an end waits between looks at the ring while there is nothing it can do
+		static std::chrono::microseconds const channelMinimumBackoff(20);
+		static std::chrono::microseconds const channelMaximumBackoff(1000);
+	}
+
+	/// <summary>
+	/// Sends whatever arrives on its input to the SharedMemoryReceiver of
+	/// the same name, which may be in another process. When the input
+	/// halts, so does the receiver's output. If the receiver halts first,
+	/// anything else that arrives is discarded. A datum too large for the
+	/// ring halts the sender, and both ends then report the stream as
+	/// truncated rather than complete.
+	/// </summary>
+	template<typename T>
+	class SharedMemorySender : public Box, public RemoteEndpoint {
+	public:
+		Input<T> input;
+		SharedMemorySender(std::string const &name, std::size_t capacity = 1 << 20) : input(this), name(name), capacity(capacity), isTruncated(false) {}
+
+		//true once a datum too large for the ring has stopped the sender
+		bool GetIsTruncated() const {
+			return isTruncated;
+		}
+	protected:
+		void Initializer() {
+			ring = SharedRing::Attach(name, SharedRing::End::Writer, capacity, GetCollectiveId());
+		}
+
+		void Computer() {
+			T datum;
+			std::vector<char> buffer;
+			while (input.Dequeue(datum)) {
+				ring->SetWriterStalled(false);
+				ChannelTraits<T>::Serialize(datum, buffer);
+				if (buffer.size() > ring->GetMaximumRecordSize()) {
+					isTruncated = true;
+					ring->SetWriterTruncated();
+					return;
+				}
+				auto backoff = detail::channelMinimumBackoff;
+				while (!ring->TryWrite(buffer.data(), buffer.size())) {
+					if (ring->GetReaderHalted()) break;
+					ThrowIfCancelled();
+					SuspendFor(backoff);
+					backoff = std::min(backoff * 2, detail::channelMaximumBackoff);
+				}
+			}
+		}
+
+		void Terminator() {
+			ring->SetWriterHalted();
+		}
+
+		RemoteEndpoint* GetRemoteEndpoint() {
+			return this;
+		}
+	private:
+		std::string name;
+		std::size_t capacity;
+		std::unique_ptr<SharedRing> ring;
+		std::atomic<bool> isTruncated;
+
+		Role GetRole() {
+			return Role::Sender;
+		}
+
+		std::uint64_t GetPeerId() {
+			return ring->GetPeerId();
+		}
+
+		bool GetIsStarved() {
+			return false;
+		}
+
+		bool GetIsPeerStalled() {
+			return false;
+		}
+
+		void BreakDeadlock() {}
+
+		void SetIsStalled(bool value) {
+			ring->SetWriterStalled(value);
+		}
+	};
+
+	/// <summary>
+	/// Outputs whatever the SharedMemorySender of the same name sends, and
+	/// halts once that sender has halted and everything it sent has been
+	/// output.
+	/// </summary>
+	template<typename T>
+	class SharedMemoryReceiver : public Box, public RemoteEndpoint {
+	public:
+		Output<T> output;
+		SharedMemoryReceiver(std::string const &name, std::size_t capacity = 1 << 20) : output(this), name(name), capacity(capacity), isBroken(false), isTruncated(false), lastStallEpoch(0), lastWriteCount(0) {}
+
+		//true if the sender halted because a datum was too large for the ring, so the output is incomplete
+		bool GetIsTruncated() const {
+			return isTruncated;
+		}
+	protected:
+		void Initializer() {
+			ring = SharedRing::Attach(name, SharedRing::End::Reader, capacity, GetCollectiveId());
+		}
+
+		void Computer() {
+			std::vector<char> buffer;
+			auto backoff = detail::channelMinimumBackoff;
+			for (;;) {
+				if (ring->TryRead(buffer)) {
+					T datum;
+					ChannelTraits<T>::Deserialize(buffer, datum);
+					output.Enqueue(datum);
+					backoff = detail::channelMinimumBackoff;
+					continue;
+				}
+				if (isBroken) return;
+				//the sender may have written its last record just before halting
+				if (ring->GetWriterHalted()) {
+					if (ring->GetIsEmpty()) {
+						isTruncated = ring->GetWriterTruncated();
+						return;
+					}
+					continue;
+				}
+				ThrowIfCancelled();
+				SuspendFor(backoff);
+				backoff = std::min(backoff * 2, detail::channelMaximumBackoff);
+			}
+		}
+
+		void Terminator() {
+			ring->SetReaderHalted();
+		}
+
+		RemoteEndpoint* GetRemoteEndpoint() {
+			return this;
+		}
+	private:
+		std::string name;
+		std::size_t capacity;
+		std::unique_ptr<SharedRing> ring;
+		std::atomic<bool> isBroken;
+		std::atomic<bool> isTruncated;
+		std::uint64_t lastStallEpoch;
+		std::uint64_t lastWriteCount;
+
+		Role GetRole() {
+			return Role::Receiver;
+		}
+
+		std::uint64_t GetPeerId() {
+			return ring->GetPeerId();
+		}
+
+		bool GetIsStarved() {
+			return !isBroken && ring->GetIsEmpty() && !ring->GetWriterHalted();
+		}
+
+		bool GetIsPeerStalled() {
+			std::uint64_t stallEpoch = ring->GetWriterStallEpoch();
+			std::uint64_t writeCount = ring->GetWriteCount();
+			bool confirmed = GetIsStarved() && stallEpoch != 0 && stallEpoch == lastStallEpoch && writeCount == lastWriteCount;
+			lastStallEpoch = stallEpoch;
+			lastWriteCount = writeCount;
+			return confirmed;
+		}
+
+		//Computer sees this on its next look at the ring
+		void BreakDeadlock() {
+			isBroken = true;
+		}
+
+		void SetIsStalled(bool) {}
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "SharedRing.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <cerrno>
+#endif
+
+namespace Synchronox {
+	static std::uint32_t const ringMagic = 0x53584e52; //"SXNR"
+	static std::uint32_t const ringVersion = 2;
+	//a record length that tells the reader to skip to the start of the ring
+	static std::uint32_t const wrapMarker = 0xffffffff;
+	static std::size_t const cacheLineSize = 64;
+
+	//Everything here must be address free, since each process maps it at
+	//its own address. The two counters get their own cache lines, so the
+	//ends don't contend for them.
+	struct SharedRing::Header {
+		std::atomic<std::uint32_t> magic;
+		std::uint32_t version;
+		std::uint64_t capacity;
+		std::atomic<std::uint32_t> attachedCount;
+		//set when the reader detaches, and cleared when one attaches
+		std::atomic<std::uint32_t> readerDetached;
+		std::atomic<std::uint32_t> writerHalted;
+		std::atomic<std::uint32_t> writerTruncated;
+		std::atomic<std::uint32_t> readerHalted;
+		std::atomic<std::uint64_t> writerId;
+		std::atomic<std::uint64_t> readerId;
+		//0 while the writer isn't stalled, otherwise the number of its stall
+		std::atomic<std::uint64_t> stallEpoch;
+		std::atomic<std::uint64_t> stallCount;
+		char writePadding[cacheLineSize];
+		std::atomic<std::uint64_t> writeCount;
+		char readPadding[cacheLineSize - sizeof(std::uint64_t)];
+		std::atomic<std::uint64_t> readCount;
+		char endPadding[cacheLineSize - sizeof(std::uint64_t)];
+	};
+
+	static std::size_t RoundUp(std::size_t value, std::size_t multiple) {
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	static std::size_t RoundToPowerOfTwo(std::size_t value) {
+		std::size_t result = cacheLineSize;
+		while (result < value) result <<= 1;
+		return result;
+	}
+
+	std::unique_ptr<SharedRing> SharedRing::Attach(std::string const &name, End end, std::size_t capacity, std::uint64_t collectiveId, int timeoutMilliseconds) {
+		capacity = RoundToPowerOfTwo(capacity);
+		std::size_t dataOffset = RoundUp(sizeof(Header), cacheLineSize);
+		std::size_t size = dataOffset + capacity;
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+		bool created;
+		void* mapping;
+#ifdef _WIN32
+		std::string path = "Local\\" + name;
+		HANDLE handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<std::uint64_t>(size) >> 32), static_cast<DWORD>(size), path.c_str());
+		if (handle == NULL) {
+			throw std::runtime_error("could not create shared memory " + path);
+		}
+		created = GetLastError() != ERROR_ALREADY_EXISTS;
+		mapping = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		if (mapping == NULL) {
+			CloseHandle(handle);
+			throw std::runtime_error("could not map shared memory " + path);
+		}
+		if (!created) {
+			MEMORY_BASIC_INFORMATION info;
+			VirtualQuery(mapping, &info, sizeof(info));
+			size = info.RegionSize;
+		}
+#else
+		std::string path = name[0] == '/' ? name : "/" + name;
+		int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		created = fd != -1;
+		if (created) {
+			if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+				close(fd);
+				shm_unlink(path.c_str());
+				throw std::runtime_error("could not size shared memory " + path);
+			}
+		}
+		else {
+			if (errno != EEXIST || (fd = shm_open(path.c_str(), O_RDWR, 0)) == -1) {
+				throw std::runtime_error("could not open shared memory " + path);
+			}
+			//the creator may not have sized it yet
+			struct stat status;
+			while (fstat(fd, &status) == 0 && static_cast<std::size_t>(status.st_size) < dataOffset) {
+				if (std::chrono::steady_clock::now() >= deadline) {
+					close(fd);
+					throw std::runtime_error("timed out attaching to shared memory " + path);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			size = static_cast<std::size_t>(status.st_size);
+		}
+		mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED) {
+			if (created) shm_unlink(path.c_str());
+			throw std::runtime_error("could not map shared memory " + path);
+		}
+#endif
+		Header* header = static_cast<Header*>(mapping);
+		if (created) {
+			//the new mapping is zeroed, which is a valid state for every atomic
+			header->version = ringVersion;
+			header->capacity = capacity;
+			header->magic.store(ringMagic, std::memory_order_release);
+		}
+		else {
+			while (header->magic.load(std::memory_order_acquire) != ringMagic) {
+				if (std::chrono::steady_clock::now() >= deadline) {
+#ifdef _WIN32
+					UnmapViewOfFile(mapping);
+					CloseHandle(handle);
+#else
+					munmap(mapping, size);
+#endif
+					throw std::runtime_error("timed out attaching to shared memory " + path);
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			if (header->version != ringVersion) {
+#ifdef _WIN32
+				UnmapViewOfFile(mapping);
+				CloseHandle(handle);
+#else
+				munmap(mapping, size);
+#endif
+				throw std::runtime_error("shared memory " + path + " has an incompatible version");
+			}
+		}
+		auto &ownId = end == End::Writer ? header->writerId : header->readerId;
+		auto &peerId = end == End::Writer ? header->readerId : header->writerId;
+		if (ownId.exchange(collectiveId) != 0) {
+			//A previous occupant of this end never detached, since a clean
+			//detach clears its id, so the segment is left over from a run
+			//that crashed; start the ring afresh. The peer, if there is
+			//one, is taken to be from that run too: it is taken off the
+			//count now, and if it is still attached, it finds its id gone
+			//when it detaches and leaves the count alone.
+			std::uint32_t staleCount = peerId.exchange(0) != 0 ? 2 : 1;
+			header->writerHalted = 0;
+			header->writerTruncated = 0;
+			header->readerHalted = 0;
+			header->readerDetached = 0;
+			header->stallEpoch = 0;
+			header->readCount = 0;
+			header->writeCount = 0;
+			header->attachedCount -= staleCount;
+		}
+		if (end == End::Reader) {
+			header->readerDetached = 0;
+		}
+		header->attachedCount++;
+		std::unique_ptr<SharedRing> result(new SharedRing(path, end, collectiveId, mapping, size));
+#ifdef _WIN32
+		result->handle = handle;
+#endif
+		return result;
+	}
+
+	SharedRing::SharedRing(std::string const &name, End end, std::uint64_t collectiveId, void* mapping, std::size_t mappingSize) :
+		name(name), end(end), collectiveId(collectiveId), header(static_cast<Header*>(mapping)), data(static_cast<char*>(mapping) + RoundUp(sizeof(Header), cacheLineSize)), mapping(mapping), mappingSize(mappingSize)
+	{
+	}
+
+	SharedRing::~SharedRing() {
+		//an end whose id was cleared by a stale reset was already taken off the count
+		auto &ownId = end == End::Writer ? header->writerId : header->readerId;
+		std::uint64_t expected = collectiveId;
+		bool held = ownId.compare_exchange_strong(expected, 0);
+		if (held && end == End::Reader) {
+			header->readerDetached = 1;
+		}
+		std::uint32_t remaining = held ? --header->attachedCount : header->attachedCount.load();
+#ifdef _WIN32
+		//the name goes away with the last handle
+		(void)remaining;
+		UnmapViewOfFile(mapping);
+		CloseHandle(handle);
+#else
+		//Only once the reader is done with it, so that a writer that
+		//finishes before the reader attaches leaves its records and its
+		//halt behind for it
+		bool last = remaining == 0 && header->readerDetached != 0;
+		munmap(mapping, mappingSize);
+		if (last) {
+			shm_unlink(name.c_str());
+		}
+#endif
+	}
+
+	//Each record is a 32 bit length followed by the payload, padded so
+	//that the next length is 8 byte aligned. A record never wraps; when it
+	//doesn't fit before the end of the ring, a wrap marker is written and
+	//the record goes at the start.
+	bool SharedRing::TryWrite(void const* record, std::size_t size) {
+		std::uint64_t capacity = header->capacity;
+		if (size > GetMaximumRecordSize()) {
+			throw std::length_error("record is too large for the shared ring " + name);
+		}
+		std::size_t need = RoundUp(sizeof(std::uint32_t) + size, 8);
+		std::uint64_t writeCount = header->writeCount.load(std::memory_order_relaxed);
+		std::uint64_t free = capacity - (writeCount - header->readCount.load(std::memory_order_acquire));
+		std::size_t position = static_cast<std::size_t>(writeCount & (capacity - 1));
+		std::size_t contiguous = static_cast<std::size_t>(capacity - position);
+		std::size_t skip = need > contiguous ? contiguous : 0;
+		if (skip + need > free) return false;
+		if (skip) {
+			std::memcpy(data + position, &wrapMarker, sizeof(wrapMarker));
+			position = 0;
+		}
+		std::uint32_t length = static_cast<std::uint32_t>(size);
+		std::memcpy(data + position, &length, sizeof(length));
+		std::memcpy(data + position + sizeof(length), record, size);
+		header->writeCount.store(writeCount + skip + need, std::memory_order_release);
+		return true;
+	}
+
+	bool SharedRing::TryRead(std::vector<char> &record) {
+		std::uint64_t capacity = header->capacity;
+		std::uint64_t readCount = header->readCount.load(std::memory_order_relaxed);
+		std::uint64_t writeCount = header->writeCount.load(std::memory_order_acquire);
+		if (readCount == writeCount) return false;
+		std::size_t position = static_cast<std::size_t>(readCount & (capacity - 1));
+		std::uint32_t length;
+		std::memcpy(&length, data + position, sizeof(length));
+		if (length == wrapMarker) {
+			readCount += capacity - position;
+			position = 0;
+			std::memcpy(&length, data, sizeof(length));
+		}
+		record.assign(data + position + sizeof(length), data + position + sizeof(length) + length);
+		header->readCount.store(readCount + RoundUp(sizeof(length) + length, 8), std::memory_order_release);
+		return true;
+	}
+
+	//a record may take at most half the ring, so that one never waits on a wrap marker for room
+	std::size_t SharedRing::GetMaximumRecordSize() const {
+		return static_cast<std::size_t>(header->capacity / 2) - sizeof(std::uint32_t);
+	}
+
+	bool SharedRing::GetIsEmpty() const {
+		return header->readCount.load(std::memory_order_acquire) == header->writeCount.load(std::memory_order_acquire);
+	}
+
+	void SharedRing::SetWriterHalted() {
+		header->stallEpoch = 0;
+		header->writerHalted = 1;
+	}
+
+	bool SharedRing::GetWriterHalted() const {
+		return header->writerHalted != 0;
+	}
+
+	void SharedRing::SetWriterTruncated() {
+		header->writerTruncated = 1;
+	}
+
+	bool SharedRing::GetWriterTruncated() const {
+		return header->writerTruncated != 0;
+	}
+
+	void SharedRing::SetReaderHalted() {
+		header->readerHalted = 1;
+	}
+
+	bool SharedRing::GetReaderHalted() const {
+		return header->readerHalted != 0;
+	}
+
+	void SharedRing::SetWriterStalled(bool value) {
+		if (!value) {
+			header->stallEpoch = 0;
+		}
+		else if (header->stallEpoch == 0) {
+			header->stallEpoch = ++header->stallCount;
+		}
+	}
+
+	std::uint64_t SharedRing::GetWriterStallEpoch() const {
+		return header->stallEpoch;
+	}
+
+	std::uint64_t SharedRing::GetWriteCount() const {
+		return header->writeCount.load(std::memory_order_acquire);
+	}
+
+	std::uint64_t SharedRing::GetPeerId() const {
+		return end == End::Writer ? header->readerId : header->writerId;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef _SHARED_RING_H_
+#define _SHARED_RING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+namespace Synchronox {
+	/// <summary>
+	/// A single producer, single consumer ring of variable length records
+	/// in a named shared memory segment, so that it can be attached by two
+	/// processes on the same host. Besides the records, the segment holds
+	/// the state each end publishes for halt propagation and deadlock
+	/// detection. The name is removed once the reader has detached and
+	/// the writer has too, so a writer may finish before the reader
+	/// attaches. On Windows the segment lasts only while an end holds it.
+	/// </summary>
+	class SharedRing {
+		SharedRing(SharedRing const &other) = delete;
+	public:
+		enum class End { Writer, Reader };
+
+		/// <summary>
+		/// Create the named segment, or attach to it if the other end
+		/// already has. A segment whose end is still claimed by a process
+		/// that never detached is reset. Throws std::runtime_error if the segment can't be
+		/// mapped, or if it isn't initialized before the timeout passes.
+		/// capacity is rounded up to a power of two.
+		/// </summary>
+		static std::unique_ptr<SharedRing> Attach(std::string const &name, End end, std::size_t capacity, std::uint64_t collectiveId, int timeoutMilliseconds = 10000);
+		~SharedRing();
+
+		//returns false if there isn't room for the record; throws std::length_error if it could never fit
+		bool TryWrite(void const* data, std::size_t size);
+		//returns false if there is no record to read
+		bool TryRead(std::vector<char> &record);
+		bool GetIsEmpty() const;
+		std::size_t GetMaximumRecordSize() const;
+
+		void SetWriterHalted();
+		bool GetWriterHalted() const;
+		//the writer dropped records before halting; set before SetWriterHalted
+		void SetWriterTruncated();
+		bool GetWriterTruncated() const;
+		void SetReaderHalted();
+		bool GetReaderHalted() const;
+
+		/// <summary>
+		/// The writing end reports whether it is blocked on its own inputs.
+		/// Each report of true is numbered, so that the reading end can
+		/// tell a long lasting stall from a series of short ones.
+		/// </summary>
+		void SetWriterStalled(bool value);
+		std::uint64_t GetWriterStallEpoch() const;
+		std::uint64_t GetWriteCount() const;
+
+		//the id of the Collective attached at the other end, or 0 if none is yet
+		std::uint64_t GetPeerId() const;
+	private:
+		struct Header;
+
+		SharedRing(std::string const &name, End end, std::uint64_t collectiveId, void* mapping, std::size_t mappingSize);
+
+		std::string name;
+		End end;
+		std::uint64_t collectiveId;
+		Header* header;
+		char* data;
+		void* mapping;
+		std::size_t mappingSize;
+#ifdef _WIN32
+		void* handle;
+#endif
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "SpillFile.h"
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <stdlib.h>
+#	include <unistd.h>
+#endif
+
+namespace Synchronox {
+	//a record length that tells the reader to go on to the next segment
+	static std::uint32_t const wrapMarker = 0xffffffff;
+	//the length, padding, and the time the record was spilled
+	static std::size_t const recordHeaderSize = 16;
+
+	static std::size_t RoundUp(std::size_t value, std::size_t multiple) {
+		return (value + multiple - 1) / multiple * multiple;
+	}
+
+	class SpillFile::Segment {
+		Segment(Segment const &other) = delete;
+	public:
+		char* data;
+		std::size_t size;
+
+		Segment(std::string const &directory, std::size_t size) : size(size) {
+#ifdef _WIN32
+			char path[MAX_PATH];
+			std::string folder = directory;
+			if (folder.empty()) {
+				GetTempPathA(MAX_PATH, path);
+				folder = path;
+			}
+			if (GetTempFileNameA(folder.c_str(), "sxs", 0, path) == 0) {
+				throw std::runtime_error("could not name a spill file in " + folder);
+			}
+			file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+			if (file == INVALID_HANDLE_VALUE) {
+				throw std::runtime_error(std::string("could not create spill file ") + path);
+			}
+			mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, static_cast<DWORD>(static_cast<std::uint64_t>(size) >> 32), static_cast<DWORD>(size), NULL);
+			data = mapping == NULL ? nullptr : static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+			if (data == nullptr) {
+				if (mapping != NULL) CloseHandle(mapping);
+				CloseHandle(file);
+				throw std::runtime_error(std::string("could not map spill file ") + path);
+			}
+#else
+			std::string folder = directory;
+			if (folder.empty()) {
+				char const* temporary = std::getenv("TMPDIR");
+				folder = temporary ? temporary : "/tmp";
+			}
+			std::string pattern = folder + "/synchronox-spill-XXXXXX";
+			std::vector<char> path(pattern.begin(), pattern.end());
+			path.push_back('\0');
+			int fd = mkstemp(path.data());
+			if (fd == -1) {
+				throw std::runtime_error("could not create a spill file in " + folder);
+			}
+			//the file lives on only as long as it is mapped
+			unlink(path.data());
+			void* mapped = MAP_FAILED;
+			if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+				mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			}
+			close(fd);
+			if (mapped == MAP_FAILED) {
+				throw std::runtime_error("could not map a spill file in " + folder);
+			}
+			data = static_cast<char*>(mapped);
+#endif
+		}
+
+		~Segment() {
+#ifdef _WIN32
+			UnmapViewOfFile(data);
+			CloseHandle(mapping);
+			CloseHandle(file);
+#else
+			munmap(data, size);
+#endif
+		}
+#ifdef _WIN32
+	private:
+		HANDLE file;
+		HANDLE mapping;
+#endif
+	};
+
+	SpillFile::SpillFile(SpillOptions const &options) : options(options), readOffset(0), writeOffset(0) {
+		this->options.segmentSize = RoundUp(std::max<std::size_t>(options.segmentSize, 4096), 4096);
+	}
+
+	SpillFile::~SpillFile() {}
+
+	void SpillFile::Append(std::vector<char> const &record) {
+		std::size_t need = RoundUp(recordHeaderSize + record.size(), 8);
+		if (need > options.segmentSize) {
+			throw std::length_error("record is larger than a spill file segment");
+		}
+		if (segments.empty() || writeOffset + need > segments.back()->size) {
+			if (!segments.empty() && writeOffset + sizeof(wrapMarker) <= segments.back()->size) {
+				std::memcpy(segments.back()->data + writeOffset, &wrapMarker, sizeof(wrapMarker));
+			}
+			segments.emplace_back(new Segment(options.directory, options.segmentSize));
+			writeOffset = 0;
+		}
+		char* destination = segments.back()->data + writeOffset;
+		std::uint32_t length = static_cast<std::uint32_t>(record.size());
+		std::int64_t spilledAt = std::chrono::steady_clock::now().time_since_epoch().count();
+		std::memcpy(destination, &length, sizeof(length));
+		std::memcpy(destination + 8, &spilledAt, sizeof(spilledAt));
+		if (!record.empty()) {
+			std::memcpy(destination + recordHeaderSize, record.data(), record.size());
+		}
+		writeOffset += need;
+
+		metrics.spilledCount++;
+		metrics.spilledBytes += record.size();
+		metrics.residentBytes += need;
+		metrics.peakResidentBytes = std::max(metrics.peakResidentBytes, metrics.residentBytes);
+	}
+
+	bool SpillFile::TryRead(std::vector<char> &record) {
+		for (;;) {
+			if (GetIsEmpty()) {
+				//start over at the top of the segment that is left
+				readOffset = writeOffset = 0;
+				return false;
+			}
+			Segment* front = segments.front().get();
+			std::uint32_t length = wrapMarker;
+			if (readOffset + recordHeaderSize <= front->size) {
+				std::memcpy(&length, front->data + readOffset, sizeof(length));
+			}
+			if (length == wrapMarker) {
+				//the writer has moved on, so this segment is done with
+				segments.pop_front();
+				readOffset = 0;
+				continue;
+			}
+			std::int64_t spilledAt;
+			std::memcpy(&spilledAt, front->data + readOffset + 8, sizeof(spilledAt));
+			char const* source = front->data + readOffset + recordHeaderSize;
+			record.assign(source, source + length);
+			std::size_t need = RoundUp(recordHeaderSize + length, 8);
+			readOffset += need;
+
+			auto latency = std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(spilledAt);
+			metrics.readBackCount++;
+			metrics.residentBytes -= need;
+			metrics.totalReadBackLatency += latency;
+			metrics.maxReadBackLatency = std::max(metrics.maxReadBackLatency, latency);
+			return true;
+		}
+	}
+
+	bool SpillFile::GetIsEmpty() const {
+		return segments.empty() || (segments.size() == 1 && readOffset == writeOffset);
+	}
+
+	SpillMetrics const &SpillFile::GetMetrics() const {
+		return metrics;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef _SPILL_FILE_H_
+#define _SPILL_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <chrono>
+
+namespace Synchronox {
+	struct SpillOptions {
+		//once this many bytes of data are queued in memory, more are spilled
+		std::size_t memoryThreshold;
+		//where the spill files go, or empty for the system's temporary directory
+		std::string directory;
+		//spill files are created, mapped, and deleted this many bytes at a time
+		std::size_t segmentSize;
+
+		SpillOptions(std::size_t memoryThreshold = 64 << 20, std::string const &directory = "", std::size_t segmentSize = 16 << 20) :
+			memoryThreshold(memoryThreshold), directory(directory), segmentSize(segmentSize) {}
+	};
+
+	struct SpillMetrics {
+		std::uint64_t spilledCount;
+		std::uint64_t spilledBytes;
+		std::uint64_t readBackCount;
+		//the bytes currently on disk, and the most there have been at once
+		std::uint64_t residentBytes;
+		std::uint64_t peakResidentBytes;
+		//how long read back data spent in the spill file
+		std::chrono::steady_clock::duration totalReadBackLatency;
+		std::chrono::steady_clock::duration maxReadBackLatency;
+
+		SpillMetrics() : spilledCount(0), spilledBytes(0), readBackCount(0), residentBytes(0), peakResidentBytes(0),
+			totalReadBackLatency(std::chrono::steady_clock::duration::zero()), maxReadBackLatency(std::chrono::steady_clock::duration::zero()) {}
+	};
+
+	/// <summary>
+	/// A first in, first out queue of records kept in memory mapped
+	/// temporary files. The files are created a segment at a time as the
+	/// queue grows, and each is deleted as soon as it has been read, so
+	/// disk use follows the length of the queue. Not thread safe.
+	/// </summary>
+	class SpillFile {
+		SpillFile(SpillFile const &other) = delete;
+	public:
+		SpillFile(SpillOptions const &options);
+		~SpillFile();
+
+		//throws std::runtime_error if a segment can't be created
+		void Append(std::vector<char> const &record);
+		//returns false if the queue is empty
+		bool TryRead(std::vector<char> &record);
+		bool GetIsEmpty() const;
+		SpillMetrics const &GetMetrics() const;
+	private:
+		class Segment;
+
+		SpillOptions options;
+		std::deque<std::unique_ptr<Segment>> segments;
+		//into the front and back segments respectively
+		std::size_t readOffset;
+		std::size_t writeOffset;
+		SpillMetrics metrics;
+	};
+}
+
+#endif
\ No newline at end of file
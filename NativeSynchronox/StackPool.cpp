@@ -0,0 +1,125 @@
+#include "StackPool.h"
+#include <cassert>
+#include <new>
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+namespace Synchronox {
+	StackPool::StackPool(std::size_t defaultStackSize, std::size_t maxRetainedPerSize) : maxRetainedPerSize(maxRetainedPerSize), mappedCount(0) {
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		pageSize = info.dwPageSize;
+#else
+		pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+		this->defaultStackSize = RoundToPages(defaultStackSize);
+	}
+
+	StackPool::~StackPool() {
+		for (auto &pair : freeStacks) {
+			for (void* base : pair.second) {
+				Unmap(base, pair.first);
+			}
+		}
+		assert(mappedCount == 0); //a coroutine outlived its pool
+	}
+
+	std::size_t StackPool::GetDefaultStackSize() {
+		return defaultStackSize;
+	}
+
+	std::size_t StackPool::GetRetainedCount() {
+		std::unique_lock<std::mutex> lock(sync);
+		std::size_t result = 0;
+		for (auto &pair : freeStacks) {
+			result += pair.second.size();
+		}
+		return result;
+	}
+
+	std::size_t StackPool::GetMappedCount() {
+		std::unique_lock<std::mutex> lock(sync);
+		return mappedCount;
+	}
+
+	void StackPool::Allocate(boost::coroutines::stack_context &context, std::size_t size) {
+		std::size_t usableSize = RoundToPages(size == 0 ? defaultStackSize : size);
+		void* base = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(sync);
+			auto i = freeStacks.find(usableSize);
+			if (i != freeStacks.end() && !i->second.empty()) {
+				base = i->second.back();
+				i->second.pop_back();
+			}
+		}
+		if (!base) {
+			base = Map(usableSize);
+		}
+		//stacks grow down, so the guard page sits below the usable region
+		context.size = usableSize;
+		context.sp = static_cast<char*>(base) + pageSize + usableSize;
+	}
+
+	void StackPool::Deallocate(boost::coroutines::stack_context &context) {
+		assert(context.sp);
+		void* base = static_cast<char*>(context.sp) - context.size - pageSize;
+		{
+			std::unique_lock<std::mutex> lock(sync);
+			auto &stacks = freeStacks[context.size];
+			if (stacks.size() < maxRetainedPerSize) {
+				stacks.push_back(base);
+				base = nullptr;
+			}
+		}
+		if (base) {
+			Unmap(base, context.size);
+		}
+		context.sp = nullptr;
+		context.size = 0;
+	}
+
+	std::size_t StackPool::RoundToPages(std::size_t size) {
+		return (size + pageSize - 1) / pageSize * pageSize;
+	}
+
+	void* StackPool::Map(std::size_t usableSize) {
+		std::size_t totalSize = usableSize + pageSize;
+#ifdef _WIN32
+		void* base = VirtualAlloc(nullptr, totalSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (!base) throw std::bad_alloc();
+		//PAGE_GUARD would only fault once, letting a second overflow run on silently
+		DWORD oldProtection;
+		if (!VirtualProtect(base, pageSize, PAGE_NOACCESS, &oldProtection)) {
+			VirtualFree(base, 0, MEM_RELEASE);
+			throw std::bad_alloc();
+		}
+#else
+		void* base = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base == MAP_FAILED) throw std::bad_alloc();
+		if (mprotect(base, pageSize, PROT_NONE) != 0) {
+			munmap(base, totalSize);
+			throw std::bad_alloc();
+		}
+#endif
+		std::unique_lock<std::mutex> lock(sync);
+		mappedCount++;
+		return base;
+	}
+
+	void StackPool::Unmap(void* base, std::size_t usableSize) {
+#ifdef _WIN32
+		VirtualFree(base, 0, MEM_RELEASE);
+#else
+		munmap(base, usableSize + pageSize);
+#endif
+		std::unique_lock<std::mutex> lock(sync);
+		mappedCount--;
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef _STACK_POOL_H_
+#define _STACK_POOL_H_
+
+#include <cstddef>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <boost/coroutine/stack_context.hpp>
+
+namespace Synchronox {
+	/// <summary>
+	/// Hands out guard-paged coroutine stacks, and keeps the stacks of
+	/// finished coroutines so they can be handed out again. Boxes that are
+	/// created while a Collective is running then reuse a mapping instead
+	/// of paying for a fresh one.
+	/// </summary>
+	class StackPool {
+		StackPool(StackPool const &other) = delete;
+	public:
+		StackPool(std::size_t defaultStackSize = 64 * 1024, std::size_t maxRetainedPerSize = 256);
+		~StackPool();
+
+		std::size_t GetDefaultStackSize();
+		std::size_t GetRetainedCount();
+		std::size_t GetMappedCount();
+
+		void Allocate(boost::coroutines::stack_context &context, std::size_t size);
+		void Deallocate(boost::coroutines::stack_context &context);
+	private:
+		std::size_t defaultStackSize;
+		std::size_t maxRetainedPerSize;
+		std::size_t pageSize;
+		std::size_t mappedCount;
+		//usable size -> base addresses of idle mappings of that size
+		std::map<std::size_t, std::vector<void*>> freeStacks;
+		std::mutex sync;
+
+		std::size_t RoundToPages(std::size_t size);
+		void* Map(std::size_t usableSize);
+		void Unmap(void* base, std::size_t usableSize);
+	};
+
+	/// <summary>
+	/// A copyable handle to a StackPool that satisfies the StackAllocator
+	/// concept of boost.coroutine
+	/// </summary>
+	class PooledStackAllocator {
+	public:
+		//record, if given, receives a copy of each stack_context handed out
+		PooledStackAllocator(StackPool &pool, boost::coroutines::stack_context *record = nullptr) : pool(&pool), record(record) {}
+
+		void allocate(boost::coroutines::stack_context &context, std::size_t size) {
+			pool->Allocate(context, size);
+			if (record) *record = context;
+		}
+
+		void deallocate(boost::coroutines::stack_context &context) {
+			pool->Deallocate(context);
+		}
+	private:
+		StackPool *pool;
+		boost::coroutines::stack_context *record;
+	};
+}
+
+#endif
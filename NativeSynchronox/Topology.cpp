@@ -0,0 +1,197 @@
+#include "Topology.h"
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <utility>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <pthread.h>
+#	include <sched.h>
+#	include <sys/mman.h>
+#endif
+#ifdef SYNCHRONOX_LIBNUMA
+#	include <numaif.h>
+#endif
+
+namespace Synchronox {
+#ifndef _WIN32
+	//parse a sysfs cpu list such as "0-3,8-11"
+	static std::vector<int> ParseCpuList(std::string const &text) {
+		std::vector<int> results;
+		std::stringstream stream(text);
+		std::string range;
+		while (std::getline(stream, range, ',')) {
+			if (range.empty() || range == "\n") continue;
+			std::size_t dash = range.find('-');
+			int first = std::stoi(range.substr(0, dash));
+			int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			for (int processor = first; processor <= last; processor++) {
+				results.push_back(processor);
+			}
+		}
+		return results;
+	}
+#endif
+
+	//Only the processors in the process's affinity mask are listed, since
+	//under a cpuset or a container they needn't be numbered from 0, and a
+	//thread can't be pinned to any other.
+	Topology::Topology() : nodeCount(0) {
+		std::vector<int> usable;
+#ifdef _WIN32
+		DWORD_PTR processMask = 0, systemMask = 0;
+		if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+			for (int processor = 0; processor < static_cast<int>(sizeof(DWORD_PTR) * 8); processor++) {
+				if (processMask & (DWORD_PTR(1) << processor)) usable.push_back(processor);
+			}
+		}
+#else
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for (int processor = 0; processor < CPU_SETSIZE; processor++) {
+				if (CPU_ISSET(processor, &set)) usable.push_back(processor);
+			}
+		}
+#endif
+		if (usable.empty()) {
+			int processorCount = std::thread::hardware_concurrency();
+			for (int processor = 0; processor < std::max(processorCount, 1); processor++) {
+				usable.push_back(processor);
+			}
+		}
+		processorNodes.assign(usable.back() + 1, -1);
+		for (int processor : usable) {
+			processorNodes[processor] = 0;
+		}
+
+		//each node's usable processors, by the node's own number
+		std::vector<std::pair<int, std::vector<int>>> nodes;
+#ifdef _WIN32
+		ULONG highestNode = 0;
+		if (GetNumaHighestNodeNumber(&highestNode)) {
+			for (ULONG node = 0; node <= highestNode; node++) {
+				ULONGLONG mask = 0;
+				if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask)) continue;
+				nodes.emplace_back(static_cast<int>(node), std::vector<int>());
+				for (int processor : usable) {
+					if (mask & (1ULL << processor)) nodes.back().second.push_back(processor);
+				}
+			}
+		}
+#else
+		//nodes that are online needn't be numbered consecutively
+		std::ifstream online("/sys/devices/system/node/online");
+		std::string onlineText;
+		if (online && std::getline(online, onlineText)) {
+			for (int node : ParseCpuList(onlineText)) {
+				std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+				std::string text;
+				if (!file || !std::getline(file, text)) continue;
+				nodes.emplace_back(node, std::vector<int>());
+				for (int processor : ParseCpuList(text)) {
+					if (processor < static_cast<int>(processorNodes.size()) && processorNodes[processor] >= 0) nodes.back().second.push_back(processor);
+				}
+			}
+		}
+#endif
+		for (auto &node : nodes) {
+			if (node.second.empty()) continue;
+			for (int processor : node.second) {
+				processorsByNode.push_back(processor);
+				processorNodes[processor] = node.first;
+			}
+			nodeCount++;
+		}
+		if (nodeCount == 0 || processorsByNode.size() != usable.size()) {
+			//no (or incomplete) NUMA information, so treat the machine as a single node
+			nodeCount = 1;
+			processorsByNode = usable;
+			for (int processor : usable) {
+				processorNodes[processor] = 0;
+			}
+		}
+	}
+
+	Topology const &Topology::GetCurrent() {
+		static Topology current;
+		return current;
+	}
+
+	int Topology::GetNodeCount() const {
+		return nodeCount;
+	}
+
+	int Topology::GetProcessorCount() const {
+		return static_cast<int>(processorsByNode.size());
+	}
+
+	std::vector<int> const &Topology::GetProcessorsByNode() const {
+		return processorsByNode;
+	}
+
+	int Topology::GetNodeOfProcessor(int processor) const {
+		if (processor < 0 || processor >= static_cast<int>(processorNodes.size())) return -1;
+		return processorNodes[processor];
+	}
+
+	bool Topology::PinCurrentThread(int processor) {
+#ifdef _WIN32
+		if (processor >= 64) return false;
+		return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << processor) != 0;
+#else
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(processor, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+	}
+
+	bool Topology::BindToNode(void* base, std::size_t size, int node) {
+#ifdef SYNCHRONOX_LIBNUMA
+		if (node < 0) return false;
+		//a node mask wide enough to hold node, however many nodes there are
+		std::size_t const bitsPerWord = sizeof(unsigned long) * 8;
+		std::vector<unsigned long> mask(node / bitsPerWord + 1, 0);
+		mask[node / bitsPerWord] = 1UL << (node % bitsPerWord);
+		//the kernel reads one less than maxnode bits
+		return mbind(base, size, MPOL_PREFERRED, mask.data(), mask.size() * bitsPerWord + 1, MPOL_MF_MOVE) == 0;
+#else
+		//without libnuma the pages stay where they were first touched
+		(void)base;
+		(void)size;
+		(void)node;
+		return false;
+#endif
+	}
+	//Windows places each page on first touch from the node given; elsewhere
+	//the region is bound to the node, with SYNCHRONOX_LIBNUMA, before any
+	//page is touched
+	void* Topology::AllocateOnNode(std::size_t size, int node) {
+#ifdef _WIN32
+		void* base = node >= 0
+			? VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, static_cast<DWORD>(node))
+			: VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+		if (!base) throw std::bad_alloc();
+#else
+		void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base == MAP_FAILED) throw std::bad_alloc();
+		if (node >= 0) BindToNode(base, size, node);
+#endif
+		return base;
+	}
+
+	void Topology::FreeOnNode(void* base, std::size_t size) {
+#ifdef _WIN32
+		(void)size;
+		VirtualFree(base, 0, MEM_RELEASE);
+#else
+		munmap(base, size);
+#endif
+	}
+}
\ No newline at end of file
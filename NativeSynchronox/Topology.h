@@ -0,0 +1,44 @@
+#ifndef _TOPOLOGY_H_
+#define _TOPOLOGY_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace Synchronox {
+	/// <summary>
+	/// The processors this process may run on and the NUMA nodes they
+	/// belong to. Without NUMA information, every processor is placed in
+	/// node 0.
+	/// </summary>
+	class Topology {
+		Topology(Topology const &other) = delete;
+	public:
+		static Topology const &GetCurrent();
+
+		//the nodes with a processor this process may use
+		int GetNodeCount() const;
+		int GetProcessorCount() const;
+		//processor ids ordered so that those sharing a node are adjacent
+		std::vector<int> const &GetProcessorsByNode() const;
+		//the operating system's number for the node, or -1 for a processor that isn't listed
+		int GetNodeOfProcessor(int processor) const;
+
+		//returns false if the platform doesn't support it
+		static bool PinCurrentThread(int processor);
+		//move (or prefer) the pages of a page aligned region to a node; only
+		//implemented with SYNCHRONOX_LIBNUMA, and returns false otherwise
+		static bool BindToNode(void* base, std::size_t size, int node);
+		//a fresh page aligned region whose pages come from node, or from
+		//anywhere if node is -1; throws std::bad_alloc
+		static void* AllocateOnNode(std::size_t size, int node);
+		static void FreeOnNode(void* base, std::size_t size);
+	private:
+		Topology();
+		int nodeCount;
+		std::vector<int> processorsByNode;
+		//by processor id
+		std::vector<int> processorNodes;
+	};
+}
+
+#endif
\ No newline at end of file
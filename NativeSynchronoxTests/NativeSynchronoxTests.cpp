@@ -8,12 +8,87 @@
 #endif
 
 #include "lock_free_forward_list_tests.h"
+#include "fused_chain_tests.h"
+#include "select_tests.h"
+#include "deadline_tests.h"
+#include "placement_tests.h"
+#include "shared_memory_tests.h"
+#include "spill_tests.h"
+#include "superstep_tests.h"
+#include "stress_tests.h"
+#include "stack_pool_tests.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#ifdef __APPLE__
+#	include <malloc/malloc.h>
+#else
+#	include <malloc.h>
+#endif
+
+#ifdef _MSC_VER
+#	define usable_size(block) _msize(block)
+#elif defined(__APPLE__)
+#	define usable_size(block) malloc_size(block)
+#else
+#	define usable_size(block) malloc_usable_size(block)
+#endif
+
+std::atomic<std::int64_t> allocatedBytes(0);
+
+//every allocation is counted, so that stress_tests can tell how much a Box takes
+void* operator new(std::size_t size) {
+	void* block = std::malloc(size ? size : 1);
+	if (!block) throw std::bad_alloc();
+	allocatedBytes += usable_size(block);
+	return block;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+	if (!block) return;
+	allocatedBytes -= usable_size(block);
+	std::free(block);
+}
+
+void operator delete[](void* block) noexcept {
+	operator delete(block);
+}
+
+//the size isn't needed, since the count uses the size malloc reports
+void operator delete(void* block, std::size_t) noexcept {
+	operator delete(block);
+}
+
+void operator delete[](void* block, std::size_t) noexcept {
+	operator delete(block);
+}
 
 int main(int argc, char** argv)
 {
 #ifdef _MSC_VER
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
+	//the benchmark is slow and chatty, so it only runs when asked for
+	if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+		stress_tests::benchmark();
+		return 0;
+	}
 	lock_free_forward_list_tests::test_all();
+	fused_chain_tests::test_all();
+	select_tests::test_all();
+	deadline_tests::test_all();
+	placement_tests::test_all();
+	shared_memory_tests::test_all();
+	spill_tests::test_all();
+	superstep_tests::test_all();
+	stress_tests::test_all();
+	stack_pool_tests::test_all();
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "Collective.h"
+
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+class deadline_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount) : Collective(threadCount) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	//waits on its input, forwarding anything it gets
+	class Relay : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		Synchronox::Output<int> output;
+		Relay() : input(this), output(this) {}
+	protected:
+		void Computer() {
+			int datum;
+			while (input.Dequeue(datum)) {
+				output.Enqueue(datum);
+			}
+		}
+	};
+
+	//waits on its input a little at a time, forever, so it is never deadlocked
+	class Poller : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		Synchronox::Output<int> output;
+		Poller() : input(this), output(this) {}
+	protected:
+		void Computer() {
+			int datum;
+			for (;;) {
+				if (input.DequeueFor(datum, std::chrono::milliseconds(1)) == Synchronox::DequeueResult::Halted) return;
+			}
+		}
+	};
+
+	//computes until told to stop, without a port operation to see a cancellation at
+	class Spinner : public Synchronox::Box {
+	public:
+		Synchronox::Output<int> output;
+		std::atomic<bool> &stop;
+		Spinner(std::atomic<bool>* stop) : output(this), stop(*stop) {}
+	protected:
+		void Computer() {
+			while (!stop) {}
+			output.Enqueue(1);
+		}
+	};
+
+	class TimedConsumer : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		Synchronox::Output<int> output;
+		Synchronox::DequeueResult result;
+		std::chrono::steady_clock::duration timeout;
+		TimedConsumer(std::chrono::steady_clock::duration timeout) : input(this), output(this), result(Synchronox::DequeueResult::Dequeued), timeout(timeout) {}
+	protected:
+		void Computer() {
+			int datum;
+			result = input.DequeueFor(datum, timeout);
+		}
+	};
+
+	class Source : public Synchronox::Box {
+	public:
+		Synchronox::Output<int> output;
+		Source() : output(this) {}
+	protected:
+		void Computer() {
+			output.Enqueue(1);
+		}
+	};
+
+	//sends each datum only once the last has been acknowledged, so the consumer waits for every one
+	class Pinger : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> acknowledgements;
+		Synchronox::Output<int> output;
+		int count;
+		Pinger(int count) : acknowledgements(this), output(this), count(count) {}
+	protected:
+		void Computer() {
+			int acknowledgement;
+			for (int i = 0; i < count; i++) {
+				output.Enqueue(i);
+				if (!acknowledgements.Dequeue(acknowledgement)) return;
+			}
+		}
+	};
+
+	//waits with a far deadline that its input always beats, noting how many timers were ever queued
+	class PatientConsumer : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		Synchronox::Output<int> acknowledgements;
+		Synchronox::Collective* collective;
+		int received;
+		std::size_t maxQueuedTimers;
+		PatientConsumer(Synchronox::Collective* collective) : input(this), acknowledgements(this), collective(collective), received(0), maxQueuedTimers(0) {}
+	protected:
+		void Computer() {
+			int datum;
+			while (input.DequeueFor(datum, std::chrono::seconds(10)) == Synchronox::DequeueResult::Dequeued) {
+				received++;
+				acknowledgements.Enqueue(datum);
+				maxQueuedTimers = std::max(maxQueuedTimers, collective->GetQueuedTimerCount());
+			}
+		}
+	};
+
+public:
+	//nothing arrives, so the wait times out, and the cycle then halts
+	static void test_01() {
+		TestCollective collective(2);
+		auto consumer = collective.CreateBox<TimedConsumer>(std::chrono::milliseconds(20));
+		auto relay = collective.CreateBox<Relay>();
+		collective.Connect(consumer->input, relay->output);
+		collective.Connect(relay->input, consumer->output);
+		auto start = std::chrono::steady_clock::now();
+		collective.Start();
+		collective.Join();
+		assert(consumer->result == Synchronox::DequeueResult::TimedOut);
+		assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+	}
+
+	//data arrives before the deadline
+	static void test_02() {
+		TestCollective collective(2);
+		auto consumer = collective.CreateBox<TimedConsumer>(std::chrono::seconds(10));
+		auto source = collective.CreateBox<Source>();
+		collective.Connect(consumer->input, source->output);
+		collective.Start();
+		collective.Join();
+		assert(consumer->result == Synchronox::DequeueResult::Dequeued);
+	}
+
+	//two Pollers waiting on each other never finish on their own, and
+	//aren't deadlocked, so the deadline on Join cancels them
+	static void test_03() {
+		TestCollective collective(2);
+		auto a = collective.CreateBox<Poller>();
+		auto b = collective.CreateBox<Poller>();
+		collective.Connect(a->input, b->output);
+		collective.Connect(b->input, a->output);
+		collective.Start();
+		bool finished = collective.JoinFor(std::chrono::milliseconds(20));
+		assert(!finished);
+		assert(collective.IsDone());
+		assert(collective.GetCancellationToken().IsCancellationRequested());
+	}
+
+	//each wait that data beats cancels its timer, so they don't accumulate until their deadlines
+	static void test_04() {
+		int const count = 20000;
+		TestCollective collective(2);
+		auto pinger = collective.CreateBox<Pinger>(count);
+		auto consumer = collective.CreateBox<PatientConsumer>(&collective);
+		collective.Connect(consumer->input, pinger->output);
+		collective.Connect(pinger->acknowledgements, consumer->acknowledgements);
+		collective.Start();
+		collective.Join();
+		assert(consumer->received == count);
+		assert(consumer->maxQueuedTimers <= 2 + 64);
+		assert(collective.GetQueuedTimerCount() <= 2 + 64);
+	}
+
+	//a Box that never reaches a port operation can't be cancelled, so the
+	//deadline gives up on it after the grace period rather than waiting
+	static void test_05() {
+		std::atomic<bool> stop(false);
+		TestCollective collective(2);
+		auto spinner = collective.CreateBox<Spinner>(&stop);
+		auto relay = collective.CreateBox<Relay>();
+		collective.Connect(relay->input, spinner->output);
+		collective.Start();
+		auto start = std::chrono::steady_clock::now();
+		bool finished = collective.JoinFor(std::chrono::milliseconds(20), std::chrono::milliseconds(20));
+		assert(!finished);
+		assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+		assert(!collective.IsDone());
+		stop = true;
+		collective.Join();
+		assert(collective.IsDone());
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+		test_03();
+		test_04();
+		test_05();
+	}
+};
\ No newline at end of file
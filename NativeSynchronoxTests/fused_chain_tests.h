@@ -0,0 +1,101 @@
+#include "Collective.h"
+#include "FusedChain.h"
+
+#include <chrono>
+#include <iostream>
+#include <cassert>
+
+class fused_chain_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount) : Collective(threadCount) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	class Source : public Synchronox::Box {
+	public:
+		Synchronox::Output<int> output;
+		Source(int count) : output(this), count(count) {}
+	protected:
+		void Computer() {
+			for (int i = 0; i < count; i++) {
+				output.Enqueue(i);
+			}
+		}
+	private:
+		int count;
+	};
+
+	class Sink : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		long long sum;
+		int received;
+		int lastReceived;
+		bool ordered;
+		Sink() : input(this), sum(0), received(0), lastReceived(-1), ordered(true) {}
+	protected:
+		void Computer() {
+			int datum;
+			while (input.Dequeue(datum)) {
+				ordered &= datum > lastReceived;
+				lastReceived = datum;
+				sum += datum;
+				received++;
+			}
+		}
+	};
+
+	//x -> (x + 1) -> (x + 1) * 2 -> (x + 1) * 2 - 2 == 2x
+	static double run(Synchronox::ChainMode mode, int count, int threadCount, long long &sum, int &received, bool &ordered) {
+		auto start = std::chrono::high_resolution_clock::now();
+		Sink* sink;
+		{
+			TestCollective collective(threadCount);
+			auto source = collective.CreateBox<Source>(count);
+			sink = collective.CreateBox<Sink>();
+			auto chain = Synchronox::MakeChain<int, int>([](int x) { return x + 1; })
+				.Then<long long>([](int x) { return 2LL * x; })
+				.Then<int>([](long long x) { return static_cast<int>(x - 2); });
+			auto ends = chain.Instantiate(collective, mode);
+			collective.Connect(*ends.input, source->output);
+			collective.Connect(sink->input, *ends.output);
+			collective.Start();
+			collective.Join();
+			sum = sink->sum;
+			received = sink->received;
+			ordered = sink->ordered;
+		}
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+public:
+	static void test_01() {
+		long long sum;
+		int received;
+		bool ordered;
+		int const count = 1000;
+		for (auto mode : { Synchronox::ChainMode::Unfused, Synchronox::ChainMode::Fused }) {
+			run(mode, count, 2, sum, received, ordered);
+			assert(received == count);
+			assert(ordered);
+			assert(sum == (long long)count * (count - 1));
+		}
+	}
+
+	//compare throughput of the two modes
+	static void test_02() {
+		long long sum;
+		int received;
+		bool ordered;
+		int const count = 200000;
+		double unfused = run(Synchronox::ChainMode::Unfused, count, 4, sum, received, ordered);
+		double fused = run(Synchronox::ChainMode::Fused, count, 4, sum, received, ordered);
+		std::cout << "unfused: " << count / unfused << " items/s, fused: " << count / fused << " items/s\n";
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "Collective.h"
+#include "Topology.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <cassert>
+#include <vector>
+
+class placement_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount, Synchronox::PlacementPolicy placement) : Collective(threadCount, placement) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	class Source : public Synchronox::Box {
+	public:
+		Synchronox::Output<int> output;
+		Source(int count) : output(this), count(count) {}
+	protected:
+		void Computer() {
+			for (int i = 0; i < count; i++) {
+				output.Enqueue(i);
+			}
+		}
+	private:
+		int count;
+	};
+
+	class Relay : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		Synchronox::Output<int> output;
+		Relay() : input(this), output(this) {}
+	protected:
+		void Computer() {
+			int datum;
+			while (input.Dequeue(datum)) {
+				output.Enqueue(datum + 1);
+			}
+		}
+	};
+
+	class Sink : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		long long sum;
+		int received;
+		Sink() : input(this), sum(0), received(0) {}
+	protected:
+		void Computer() {
+			int datum;
+			while (input.Dequeue(datum)) {
+				sum += datum;
+				received++;
+			}
+		}
+	};
+
+	//chainCount independent Source -> Relay x depth -> Sink pipelines
+	static double run(Synchronox::PlacementPolicy placement, int chainCount, int depth, int count, int threadCount, std::vector<long long> &sums, std::vector<int> &received) {
+		auto start = std::chrono::high_resolution_clock::now();
+		{
+			TestCollective collective(threadCount, placement);
+			std::vector<Sink*> sinks;
+			for (int chain = 0; chain < chainCount; chain++) {
+				auto source = collective.CreateBox<Source>(count);
+				Synchronox::Output<int>* tail = &source->output;
+				for (int stage = 0; stage < depth; stage++) {
+					auto relay = collective.CreateBox<Relay>();
+					collective.Connect(relay->input, *tail);
+					tail = &relay->output;
+				}
+				auto sink = collective.CreateBox<Sink>();
+				collective.Connect(sink->input, *tail);
+				sinks.push_back(sink);
+			}
+			collective.Start();
+			collective.Join();
+			sums.clear();
+			received.clear();
+			for (auto sink : sinks) {
+				sums.push_back(sink->sum);
+				received.push_back(sink->received);
+			}
+		}
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+public:
+	//every policy delivers the same data
+	static void test_01() {
+		int const chainCount = 4, depth = 3, count = 500;
+		long long const expected = static_cast<long long>(count) * (count - 1) / 2 + static_cast<long long>(depth) * count;
+		for (auto placement : { Synchronox::PlacementPolicy::Any, Synchronox::PlacementPolicy::Pinned, Synchronox::PlacementPolicy::Connected }) {
+			std::vector<long long> sums;
+			std::vector<int> received;
+			run(placement, chainCount, depth, count, 2, sums, received);
+			for (int chain = 0; chain < chainCount; chain++) {
+				assert(received[chain] == count);
+				assert(sums[chain] == expected);
+			}
+		}
+	}
+
+	//throughput of independent pipelines under each policy
+	static void test_02() {
+		auto &topology = Synchronox::Topology::GetCurrent();
+		int const chainCount = 8, depth = 4, count = 20000;
+		int threadCount = topology.GetProcessorCount();
+		std::vector<long long> sums;
+		std::vector<int> received;
+		char const* names[] = { "any", "pinned", "connected" };
+		int nameIndex = 0;
+		std::cout << "placement: " << topology.GetNodeCount() << " node(s), " << threadCount << " runner(s)" << std::endl;
+		for (auto placement : { Synchronox::PlacementPolicy::Any, Synchronox::PlacementPolicy::Pinned, Synchronox::PlacementPolicy::Connected }) {
+			double seconds = run(placement, chainCount, depth, count, threadCount, sums, received);
+			std::cout << "placement " << names[nameIndex++] << ": " << (chainCount * count * (depth + 1) / seconds) << " msgs/sec" << std::endl;
+		}
+	}
+
+	//the topology lists only processors the process may use, so every runner can be pinned to one,
+	//and a Connected Collective gives each Box pages of its own on its runner's node
+	static void test_03() {
+		auto &topology = Synchronox::Topology::GetCurrent();
+		auto const &processors = topology.GetProcessorsByNode();
+		assert(static_cast<int>(processors.size()) == topology.GetProcessorCount());
+		for (int processor : processors) {
+			assert(topology.GetNodeOfProcessor(processor) >= 0);
+		}
+		for (auto placement : { Synchronox::PlacementPolicy::Pinned, Synchronox::PlacementPolicy::Connected }) {
+			TestCollective collective(topology.GetProcessorCount() + 1, placement);
+			auto source = collective.CreateBox<Source>(10);
+			auto sink = collective.CreateBox<Sink>();
+			collective.Connect(sink->input, source->output);
+			if (placement == Synchronox::PlacementPolicy::Connected) {
+				assert(reinterpret_cast<std::uintptr_t>(source) % 4096 == 0);
+				assert(reinterpret_cast<std::uintptr_t>(sink) % 4096 == 0);
+			}
+			collective.Start();
+			collective.Join();
+			assert(sink->received == 10);
+			assert(collective.GetUnpinnedRunnerCount() == 0);
+		}
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+		test_03();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "Collective.h"
+
+#include <string>
+#include <thread>
+#include <cassert>
+
+class select_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount) : Collective(threadCount) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	template<typename T>
+	class Source : public Synchronox::Box {
+	public:
+		Synchronox::Output<T> output;
+		Source(T value, int count) : output(this), value(value), count(count) {}
+	protected:
+		void Computer() {
+			for (int i = 0; i < count; i++) {
+				output.Enqueue(value);
+			}
+		}
+	private:
+		T value;
+		int count;
+	};
+
+	//merges two differently typed inputs with Select
+	class Merger : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> numbers;
+		Synchronox::Input<std::string> words;
+		int numberCount;
+		int wordCount;
+		int haltCount;
+		Merger() : numbers(this), words(this), numberCount(0), wordCount(0), haltCount(0) {}
+	protected:
+		void Computer() {
+			int index;
+			while ((index = Select(numbers, words)) != -1) {
+				if (index == 0) {
+					int number;
+					if (numbers.Dequeue(number)) numberCount++;
+					else haltCount++;
+				}
+				else {
+					std::string word;
+					if (words.Dequeue(word)) wordCount++;
+					else haltCount++;
+				}
+			}
+		}
+	};
+
+	//runs the Merger's loop on a thread of its own, so Select blocks that thread instead of yielding
+	class ThreadMerger : public Merger {
+	protected:
+		void Computer() {
+			std::thread worker([this] { Merger::Computer(); });
+			worker.join();
+		}
+	};
+
+public:
+	static void test_01() {
+		int const count = 10000;
+		for (int threadCount = 1; threadCount <= 4; threadCount++) {
+			TestCollective collective(threadCount);
+			auto numbers = collective.CreateBox<Source<int>>(7, count);
+			auto words = collective.CreateBox<Source<std::string>>(std::string("seven"), count / 2);
+			auto merger = collective.CreateBox<Merger>();
+			collective.Connect(merger->numbers, numbers->output);
+			collective.Connect(merger->words, words->output);
+			collective.Start();
+			collective.Join();
+			assert(merger->numberCount == count);
+			assert(merger->wordCount == count / 2);
+			assert(merger->haltCount == 2);
+		}
+	}
+
+	//the blocking path; the runner the Box occupies while it waits for its worker needs another to feed it
+	static void test_02() {
+		int const count = 10000;
+		for (int threadCount = 2; threadCount <= 4; threadCount++) {
+			TestCollective collective(threadCount);
+			auto numbers = collective.CreateBox<Source<int>>(7, count);
+			auto words = collective.CreateBox<Source<std::string>>(std::string("seven"), count / 2);
+			auto merger = collective.CreateBox<ThreadMerger>();
+			collective.Connect(merger->numbers, numbers->output);
+			collective.Connect(merger->words, words->output);
+			collective.Start();
+			collective.Join();
+			assert(merger->numberCount == count);
+			assert(merger->wordCount == count / 2);
+			assert(merger->haltCount == 2);
+		}
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "Collective.h"
+#include "SharedMemoryChannel.h"
+
+#include <chrono>
+#include <cassert>
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#ifndef _WIN32
+#	include <sys/wait.h>
+#	include <unistd.h>
+#endif
+
+class shared_memory_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount) : Collective(threadCount) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	template<typename T>
+	class Source : public Synchronox::Box {
+	public:
+		Synchronox::Output<T> output;
+		Source(std::vector<T> data) : output(this), data(data) {}
+	protected:
+		void Computer() {
+			for (auto &datum : data) {
+				output.Enqueue(datum);
+			}
+		}
+	private:
+		std::vector<T> data;
+	};
+
+	template<typename T>
+	class Sink : public Synchronox::Box {
+	public:
+		Synchronox::Input<T> input;
+		std::vector<T> received;
+		Sink() : input(this) {}
+	protected:
+		void Computer() {
+			T datum;
+			while (input.Dequeue(datum)) {
+				received.push_back(datum);
+			}
+		}
+	};
+
+	class Relay : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		Synchronox::Output<int> output;
+		Relay() : input(this), output(this) {}
+	protected:
+		void Computer() {
+			int datum;
+			while (input.Dequeue(datum)) {
+				output.Enqueue(datum);
+			}
+		}
+	};
+
+	//names are shared by the whole host, so they must not collide with another run
+	static std::string UniqueName() {
+		std::random_device entropy;
+		return "synchronox_test_" + std::to_string(entropy()) + std::to_string(entropy());
+	}
+
+	//each Collective stands in for a separate process
+	template<typename T>
+	static void RoundTrip(std::vector<T> const &data, std::size_t capacity) {
+		std::string name = UniqueName();
+		TestCollective sending(1);
+		TestCollective receiving(1);
+		auto source = sending.CreateBox<Source<T>>(data);
+		auto sender = sending.CreateBox<Synchronox::SharedMemorySender<T>>(name, capacity);
+		sending.Connect(sender->input, source->output);
+		auto receiver = receiving.CreateBox<Synchronox::SharedMemoryReceiver<T>>(name, capacity);
+		auto sink = receiving.CreateBox<Sink<T>>();
+		receiving.Connect(sink->input, receiver->output);
+		sending.Start();
+		receiving.Start();
+		sending.Join();
+		//the receiving side only finishes because the sender's halt crossed over
+		bool received = receiving.JoinFor(std::chrono::seconds(10));
+		assert(received);
+		assert(sink->received == data);
+		assert(!receiver->GetIsTruncated());
+	}
+
+#ifndef _WIN32
+	//runs in a child process, returning whether the child exited cleanly
+	template<typename F>
+	static bool InChild(F body) {
+		pid_t child = fork();
+		assert(child != -1);
+		if (child == 0) {
+			_exit(body() ? 0 : 1);
+		}
+		int status;
+		waitpid(child, &status, 0);
+		return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+#endif
+
+public:
+	//more data than fits in the ring at once, so it wraps and the sender waits for room
+	static void test_01() {
+		std::vector<int> data;
+		for (int i = 0; i < 100000; i++) {
+			data.push_back(i);
+		}
+		RoundTrip(data, 4096);
+	}
+
+	static void test_02() {
+		std::vector<std::string> data;
+		for (int i = 0; i < 1000; i++) {
+			data.push_back(std::string(i % 50, 'a' + i % 26));
+		}
+		RoundTrip(data, 4096);
+	}
+
+	//a cycle within one Collective is broken by halting one of its inputs
+	static void test_03() {
+		TestCollective collective(2);
+		auto a = collective.CreateBox<Relay>();
+		auto b = collective.CreateBox<Relay>();
+		collective.Connect(a->input, b->output);
+		collective.Connect(b->input, a->output);
+		collective.Start();
+		bool joined = collective.JoinFor(std::chrono::seconds(10));
+		assert(joined);
+		assert(!collective.GetCancellationToken().IsCancellationRequested());
+	}
+
+	//a cycle that passes through two Collectives is broken as well
+	static void test_04() {
+		std::string there = UniqueName();
+		std::string back = UniqueName();
+		TestCollective first(1);
+		TestCollective second(1);
+		auto firstReceiver = first.CreateBox<Synchronox::SharedMemoryReceiver<int>>(back, 4096);
+		auto firstRelay = first.CreateBox<Relay>();
+		auto firstSender = first.CreateBox<Synchronox::SharedMemorySender<int>>(there, 4096);
+		first.Connect(firstRelay->input, firstReceiver->output);
+		first.Connect(firstSender->input, firstRelay->output);
+		auto secondReceiver = second.CreateBox<Synchronox::SharedMemoryReceiver<int>>(there, 4096);
+		auto secondRelay = second.CreateBox<Relay>();
+		auto secondSender = second.CreateBox<Synchronox::SharedMemorySender<int>>(back, 4096);
+		second.Connect(secondRelay->input, secondReceiver->output);
+		second.Connect(secondSender->input, secondRelay->output);
+		first.Start();
+		second.Start();
+		bool firstJoined = first.JoinFor(std::chrono::seconds(10));
+		bool secondJoined = second.JoinFor(std::chrono::seconds(10));
+		assert(firstJoined);
+		assert(secondJoined);
+	}
+
+	//a record too large for the ring halts the sender, and the receiver with it, both reporting the loss
+	static void test_05() {
+		std::string name = UniqueName();
+		std::vector<std::string> data;
+		data.push_back("small");
+		data.push_back(std::string(4096, 'x'));
+		data.push_back("unsent");
+		TestCollective sending(1);
+		TestCollective receiving(1);
+		auto source = sending.CreateBox<Source<std::string>>(data);
+		auto sender = sending.CreateBox<Synchronox::SharedMemorySender<std::string>>(name, 4096);
+		sending.Connect(sender->input, source->output);
+		auto receiver = receiving.CreateBox<Synchronox::SharedMemoryReceiver<std::string>>(name, 4096);
+		auto sink = receiving.CreateBox<Sink<std::string>>();
+		receiving.Connect(sink->input, receiver->output);
+		sending.Start();
+		receiving.Start();
+		bool sent = sending.JoinFor(std::chrono::seconds(10));
+		bool received = receiving.JoinFor(std::chrono::seconds(10));
+		assert(sent);
+		assert(received);
+		assert(sink->received == std::vector<std::string>(1, "small"));
+		assert(sender->GetIsTruncated());
+		assert(receiver->GetIsTruncated());
+	}
+
+#ifndef _WIN32
+	//the sending Collective really is in another process
+	static void test_06() {
+		std::string name = UniqueName();
+		std::vector<int> data;
+		for (int i = 0; i < 100000; i++) {
+			data.push_back(i);
+		}
+		TestCollective receiving(1);
+		auto receiver = receiving.CreateBox<Synchronox::SharedMemoryReceiver<int>>(name, 4096);
+		auto sink = receiving.CreateBox<Sink<int>>();
+		receiving.Connect(sink->input, receiver->output);
+		receiving.Start();
+		bool sent = InChild([&] {
+			TestCollective sending(1);
+			auto source = sending.CreateBox<Source<int>>(data);
+			auto sender = sending.CreateBox<Synchronox::SharedMemorySender<int>>(name, 4096);
+			sending.Connect(sender->input, source->output);
+			sending.Start();
+			return sending.JoinFor(std::chrono::seconds(10));
+		});
+		assert(sent);
+		bool received = receiving.JoinFor(std::chrono::seconds(10));
+		assert(received);
+		assert(sink->received == data);
+	}
+
+	//a writer that died without detaching leaves its ring behind, which the next writer starts afresh
+	static void test_07() {
+		std::string name = UniqueName();
+		bool crashed = InChild([&] {
+			auto ring = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Writer, 4096, 1);
+			int datum = 1;
+			ring->TryWrite(&datum, sizeof(datum));
+			ring->SetWriterHalted();
+			ring.release();
+			return true;
+		});
+		assert(crashed);
+		auto writer = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Writer, 4096, 2);
+		auto reader = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Reader, 4096, 3);
+		assert(reader->GetIsEmpty());
+		assert(!reader->GetWriterHalted());
+		assert(reader->GetPeerId() == 2);
+		assert(writer->GetPeerId() == 3);
+		int datum = 2;
+		bool written = writer->TryWrite(&datum, sizeof(datum));
+		assert(written);
+		std::vector<char> record;
+		bool read = reader->TryRead(record);
+		assert(read);
+		assert(record.size() == sizeof(datum));
+		read = reader->TryRead(record);
+		assert(!read);
+	}
+
+	//a writer that finishes before the reader attaches leaves its records and its halt for it
+	static void test_09() {
+		std::string name = UniqueName();
+		{
+			auto writer = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Writer, 4096, 1);
+			int datum = 1;
+			bool written = writer->TryWrite(&datum, sizeof(datum));
+			assert(written);
+			writer->SetWriterHalted();
+		}
+		{
+			auto reader = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Reader, 4096, 2);
+			std::vector<char> record;
+			bool read = reader->TryRead(record);
+			assert(read);
+			assert(record.size() == sizeof(int));
+			assert(reader->GetWriterHalted());
+		}
+		//the reader was the last to detach, so the next one finds a new ring
+		auto reader = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Reader, 4096, 3);
+		assert(reader->GetIsEmpty());
+		assert(!reader->GetWriterHalted());
+	}
+#endif
+
+	//a writer that detaches cleanly is succeeded by the next one without disturbing the reader
+	static void test_08() {
+		std::string name = UniqueName();
+		auto reader = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Reader, 4096, 3);
+		int datum = 1;
+		{
+			auto writer = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Writer, 4096, 1);
+			bool written = writer->TryWrite(&datum, sizeof(datum));
+			assert(written);
+		}
+		assert(reader->GetPeerId() == 0);
+		auto writer = Synchronox::SharedRing::Attach(name, Synchronox::SharedRing::End::Writer, 4096, 2);
+		assert(reader->GetPeerId() == 2);
+		assert(writer->GetPeerId() == 3);
+		datum = 2;
+		bool written = writer->TryWrite(&datum, sizeof(datum));
+		assert(written);
+		std::vector<char> record;
+		for (int expected = 1; expected <= 2; expected++) {
+			bool read = reader->TryRead(record);
+			assert(read);
+			assert(record.size() == sizeof(datum));
+			std::memcpy(&datum, record.data(), sizeof(datum));
+			assert(datum == expected);
+		}
+		bool read = reader->TryRead(record);
+		assert(!read);
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+		test_03();
+		test_04();
+		test_05();
+#ifndef _WIN32
+		test_06();
+		test_07();
+		test_09();
+#endif
+		test_08();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "Collective.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+
+#ifdef _WIN32
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <unistd.h>
+#endif
+
+class spill_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount) : Collective(threadCount) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	template<typename T>
+	class Source : public Synchronox::Box {
+	public:
+		Synchronox::Output<T> output;
+		Source(std::vector<T> data) : output(this), data(data) {}
+	protected:
+		void Computer() {
+			for (auto &datum : data) {
+				output.Enqueue(datum);
+			}
+		}
+	private:
+		std::vector<T> data;
+	};
+
+	template<typename T>
+	class Sink : public Synchronox::Box {
+	public:
+		Synchronox::Input<T> input;
+		std::vector<T> received;
+		Sink() : input(this) {}
+	protected:
+		void Computer() {
+			T datum;
+			while (input.Dequeue(datum)) {
+				received.push_back(datum);
+			}
+		}
+	};
+
+	//one runner, so the Source enqueues everything before the Sink takes any of it
+	template<typename T>
+	static Synchronox::SpillMetrics RoundTrip(std::vector<T> const &data, Synchronox::SpillOptions const &options) {
+		TestCollective collective(1);
+		auto source = collective.CreateBox<Source<T>>(data);
+		auto sink = collective.CreateBox<Sink<T>>();
+		sink->input.EnableSpill(options);
+		collective.Connect(sink->input, source->output);
+		collective.Start();
+		collective.Join();
+		assert(sink->received == data);
+		return sink->input.GetSpillMetrics();
+	}
+
+	struct Record {
+		std::uint64_t words[8];
+	};
+
+	class Generator : public Synchronox::Box {
+	public:
+		Synchronox::Output<Record> output;
+		int count;
+		Generator(int count) : output(this), count(count) {}
+	protected:
+		void Computer() {
+			Record record = Record();
+			for (int i = 0; i < count; i++) {
+				record.words[0] = i;
+				output.Enqueue(record);
+			}
+		}
+	};
+
+	class Counter : public Synchronox::Box {
+	public:
+		Synchronox::Input<Record> input;
+		int count;
+		bool inOrder;
+		Counter() : input(this), count(0), inOrder(true) {}
+	protected:
+		void Computer() {
+			Record record;
+			while (input.Dequeue(record)) {
+				inOrder = inOrder && record.words[0] == static_cast<std::uint64_t>(count);
+				count++;
+			}
+		}
+	};
+
+	//sends a burst, then a few more once the Taker has worked through part of it
+	class Stepper : public Synchronox::Box {
+	public:
+		Synchronox::Output<int> output;
+		std::atomic<int>* taken;
+		std::atomic<bool>* released;
+		Stepper(std::atomic<int>* taken, std::atomic<bool>* released) : output(this), taken(taken), released(released) {}
+	protected:
+		void Computer() {
+			for (int i = 0; i < 15; i++) {
+				output.Enqueue(i);
+			}
+			while (*taken < 8) {
+				SuspendFor(std::chrono::milliseconds(1));
+			}
+			for (int i = 15; i < 18; i++) {
+				output.Enqueue(i);
+			}
+			*released = true;
+		}
+	};
+
+	class Taker : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		std::vector<int> received;
+		std::atomic<int> taken;
+		std::atomic<bool> released;
+		Taker() : input(this), taken(0), released(false) {}
+	protected:
+		void Computer() {
+			int datum;
+			while (input.Dequeue(datum)) {
+				received.push_back(datum);
+				if (++taken == 8) {
+					while (!released) {
+						SuspendFor(std::chrono::milliseconds(1));
+					}
+				}
+			}
+		}
+	};
+
+	static std::size_t GetResidentBytes() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.WorkingSetSize;
+#else
+		std::ifstream statm("/proc/self/statm");
+		std::size_t size = 0, resident = 0;
+		statm >> size >> resident;
+		return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+	}
+
+public:
+	//most of a burst goes to disk, over several segments, and comes back in order
+	static void test_01() {
+		std::vector<int> data;
+		for (int i = 0; i < 100000; i++) {
+			data.push_back(i);
+		}
+		auto metrics = RoundTrip(data, Synchronox::SpillOptions(1024 * sizeof(int), "", 64 * 1024));
+		assert(metrics.spilledCount == data.size() - 1024);
+		assert(metrics.readBackCount == metrics.spilledCount);
+		assert(metrics.residentBytes == 0);
+		assert(metrics.peakResidentBytes > 64 * 1024);
+		std::cout << "spill: " << metrics.spilledBytes << " bytes spilled, mean read back latency "
+			<< std::chrono::duration<double, std::micro>(metrics.totalReadBackLatency).count() / metrics.readBackCount << " us, max "
+			<< std::chrono::duration<double, std::micro>(metrics.maxReadBackLatency).count() << " us" << std::endl;
+	}
+
+	static void test_02() {
+		std::vector<std::string> data;
+		for (int i = 0; i < 5000; i++) {
+			data.push_back(std::string(i % 100, 'a' + i % 26));
+		}
+		auto metrics = RoundTrip(data, Synchronox::SpillOptions(16 * sizeof(std::string), "", 4096));
+		assert(metrics.spilledCount == data.size() - 16);
+		assert(metrics.readBackCount == metrics.spilledCount);
+	}
+
+	//below the threshold nothing is spilled
+	static void test_03() {
+		std::vector<int> data(100, 7);
+		auto metrics = RoundTrip(data, Synchronox::SpillOptions());
+		assert(metrics.spilledCount == 0);
+	}
+
+	//A long spill passes through the producer's Output too, which mustn't keep it.
+	//The spill's own segments are gone once read back, so nearly all of the
+	//64 MB must have been let go of by the time everything has arrived.
+	static void test_04() {
+		int const count = 1 << 20;
+		std::size_t residentBefore = GetResidentBytes();
+		TestCollective collective(1);
+		auto generator = collective.CreateBox<Generator>(count);
+		auto counter = collective.CreateBox<Counter>();
+		counter->input.EnableSpill(Synchronox::SpillOptions(1 << 20, "", 4 << 20));
+		collective.Connect(counter->input, generator->output);
+		collective.Start();
+		collective.Join();
+		assert(counter->count == count);
+		assert(counter->inOrder);
+		assert(counter->input.GetSpillMetrics().spilledCount > 0);
+		std::size_t residentAfter = GetResidentBytes();
+		assert(residentAfter < residentBefore + (16 << 20));
+	}
+
+	//The 5 spilled out of the first 15 are back in memory by the time 8 have
+	//been taken, so the 3 that follow are queued in memory rather than spilled.
+	static void test_05() {
+		TestCollective collective(1);
+		auto taker = collective.CreateBox<Taker>();
+		auto stepper = collective.CreateBox<Stepper>(&taker->taken, &taker->released);
+		taker->input.EnableSpill(Synchronox::SpillOptions(10 * sizeof(int)));
+		collective.Connect(taker->input, stepper->output);
+		collective.Start();
+		collective.Join();
+		std::vector<int> expected;
+		for (int i = 0; i < 18; i++) {
+			expected.push_back(i);
+		}
+		assert(taker->received == expected);
+		auto metrics = taker->input.GetSpillMetrics();
+		assert(metrics.spilledCount == 5);
+		assert(metrics.readBackCount == 5);
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+		test_03();
+		test_04();
+		test_05();
+	}
+};
\ No newline at end of file
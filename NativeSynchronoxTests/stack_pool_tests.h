@@ -0,0 +1,72 @@
+#include "Collective.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cassert>
+
+class stack_pool_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount) : Collective(threadCount) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	//finishes as soon as it runs, handing its stack back
+	class Transient : public Synchronox::Box {
+	public:
+		Transient(std::atomic<int> *runCount) : runCount(runCount) {}
+	protected:
+		void Computer() {
+			(*runCount)++;
+		}
+	private:
+		std::atomic<int> *runCount;
+	};
+
+public:
+	//many short-lived Boxes run on a handful of mappings
+	static void test_01() {
+		int const boxCount = 2000;
+		for (int threadCount = 1; threadCount <= 4; threadCount++) {
+			std::atomic<int> runCount(0);
+			TestCollective collective(threadCount);
+			for (int i = 0; i < boxCount; i++) {
+				collective.CreateBox<Transient>(&runCount);
+			}
+			collective.Start();
+			collective.Join();
+			assert(runCount == boxCount);
+			Synchronox::StackPool &pool = collective.GetStackPool();
+			//no more stacks than Boxes that could run at once were ever mapped
+			assert(pool.GetMappedCount() >= 1);
+			assert(pool.GetMappedCount() <= static_cast<std::size_t>(threadCount));
+			//and every one of them comes back, the last few just after their Boxes halt
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (pool.GetRetainedCount() != pool.GetMappedCount() && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::yield();
+			}
+			assert(pool.GetRetainedCount() == pool.GetMappedCount());
+		}
+	}
+
+	//a stack handed back is the next one handed out
+	static void test_02() {
+		Synchronox::StackPool pool;
+		boost::coroutines::stack_context first, second;
+		pool.Allocate(first, 0);
+		void *sp = first.sp;
+		pool.Deallocate(first);
+		assert(pool.GetRetainedCount() == 1);
+		pool.Allocate(second, 0);
+		assert(second.sp == sp);
+		assert(pool.GetMappedCount() == 1);
+		assert(pool.GetRetainedCount() == 0);
+		pool.Deallocate(second);
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include "Collective.h"
+
+#include <chrono>
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+
+#include <atomic>
+
+//the bytes allocated with new and not yet deleted, counted by the operators in NativeSynchronoxTests.cpp
+extern std::atomic<std::int64_t> allocatedBytes;
+
+/// <summary>
+/// Generates Box graphs of several shapes and measures Collective on each
+/// of them, for 1 to N runners. The benchmark is run by passing
+/// --benchmark to the test program, rather than with the tests. If
+/// SYNCHRONOX_BASELINE names a file of "shape runners metric value" lines,
+/// any metric that is worse than its baseline by more than
+/// SYNCHRONOX_BASELINE_TOLERANCE (0.25 by default), and by more than the
+/// timer noise for a latency, fails the run. SYNCHRONOX_BASELINE_WRITE
+/// names a file to record the results to, in the same format.
+/// </summary>
+class stress_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount) : Collective(threadCount) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	typedef std::chrono::steady_clock clock;
+
+	struct Message {
+		std::int64_t sentAt;
+		int sequence;
+		//how many more Nodes a circulating Message may visit
+		int hops;
+	};
+
+	class Source : public Synchronox::Box {
+	public:
+		Synchronox::Output<Message> output;
+		Source(int count, int hops) : output(this), count(count), hops(hops) {}
+	protected:
+		void Computer() {
+			for (int sequence = 0; sequence < count; sequence++) {
+				output.Enqueue(Message{ clock::now().time_since_epoch().count(), sequence, hops });
+			}
+		}
+	private:
+		int count;
+		int hops;
+	};
+
+	//Forwards each sequence number once, however many paths it arrives by,
+	//or while circulating, for as many hops as the Message has left
+	class Node : public Synchronox::Box {
+	public:
+		Synchronox::Input<Message> input;
+		Synchronox::Output<Message> output;
+		std::int64_t received;
+		clock::time_point lastReceived;
+		Node(bool circulate) : input(this), output(this), received(0), circulate(circulate), nextSequence(0) {}
+	protected:
+		void Computer() {
+			Message message;
+			while (input.Dequeue(message)) {
+				received++;
+				lastReceived = clock::now();
+				if (circulate) {
+					if (message.hops-- > 0) output.Enqueue(message);
+				}
+				else if (message.sequence >= nextSequence) {
+					nextSequence = message.sequence + 1;
+					output.Enqueue(message);
+				}
+			}
+		}
+	private:
+		bool circulate;
+		int nextSequence;
+	};
+
+	class Sink : public Synchronox::Box {
+	public:
+		Synchronox::Input<Message> input;
+		std::vector<std::int64_t> latencies;
+		Sink() : input(this) {}
+	protected:
+		void Computer() {
+			Message message;
+			while (input.Dequeue(message)) {
+				latencies.push_back(clock::now().time_since_epoch().count() - message.sentAt);
+			}
+		}
+	};
+
+	class Graph {
+	public:
+		Source* source;
+		std::vector<Node*> nodes;
+		Sink* sink;
+	};
+
+	typedef void (*builder_t)(TestCollective &collective, Graph &graph, int size, int messageCount);
+
+	static void ConnectToSink(TestCollective &collective, Graph &graph, std::vector<bool> const &hasSuccessor) {
+		for (std::size_t index = 0; index < graph.nodes.size(); index++) {
+			if (!hasSuccessor[index]) collective.Connect(graph.sink->input, graph.nodes[index]->output);
+		}
+	}
+
+	//source -> n0 -> n1 -> ... -> sink
+	static void BuildChain(TestCollective &collective, Graph &graph, int size, int messageCount) {
+		graph.source = collective.CreateBox<Source>(messageCount, 0);
+		graph.sink = collective.CreateBox<Sink>();
+		for (int index = 0; index < size; index++) {
+			graph.nodes.push_back(collective.CreateBox<Node>(false));
+			collective.Connect(graph.nodes[index]->input, index == 0 ? graph.source->output : graph.nodes[index - 1]->output);
+		}
+		collective.Connect(graph.sink->input, graph.nodes.back()->output);
+	}
+
+	//source -> n0 -> {n1 .. nk} -> n(k+1) -> sink
+	static void BuildFan(TestCollective &collective, Graph &graph, int size, int messageCount) {
+		graph.source = collective.CreateBox<Source>(messageCount, 0);
+		graph.sink = collective.CreateBox<Sink>();
+		Node* spread = collective.CreateBox<Node>(false);
+		Node* gather = collective.CreateBox<Node>(false);
+		collective.Connect(spread->input, graph.source->output);
+		graph.nodes.push_back(spread);
+		for (int index = 0; index < size; index++) {
+			Node* node = collective.CreateBox<Node>(false);
+			collective.Connect(node->input, spread->output);
+			collective.Connect(gather->input, node->output);
+			graph.nodes.push_back(node);
+		}
+		graph.nodes.push_back(gather);
+		collective.Connect(graph.sink->input, gather->output);
+	}
+
+	//a chain of diamonds, each splitting in two and joining again
+	static void BuildDiamonds(TestCollective &collective, Graph &graph, int size, int messageCount) {
+		graph.source = collective.CreateBox<Source>(messageCount, 0);
+		graph.sink = collective.CreateBox<Sink>();
+		Synchronox::Output<Message>* tail = &graph.source->output;
+		for (int index = 0; index < size; index++) {
+			Node* left = collective.CreateBox<Node>(false);
+			Node* right = collective.CreateBox<Node>(false);
+			Node* join = collective.CreateBox<Node>(false);
+			collective.Connect(left->input, *tail);
+			collective.Connect(right->input, *tail);
+			collective.Connect(join->input, left->output);
+			collective.Connect(join->input, right->output);
+			graph.nodes.push_back(left);
+			graph.nodes.push_back(right);
+			graph.nodes.push_back(join);
+			tail = &join->output;
+		}
+		collective.Connect(graph.sink->input, *tail);
+	}
+
+	//each node takes from 1 to 3 earlier nodes, so every node is reachable from the first
+	static void BuildRandomDag(TestCollective &collective, Graph &graph, int size, int messageCount) {
+		std::mt19937 random(size);
+		graph.source = collective.CreateBox<Source>(messageCount, 0);
+		graph.sink = collective.CreateBox<Sink>();
+		std::vector<bool> hasSuccessor(size, false);
+		for (int index = 0; index < size; index++) {
+			graph.nodes.push_back(collective.CreateBox<Node>(false));
+			if (index == 0) {
+				collective.Connect(graph.nodes[0]->input, graph.source->output);
+				continue;
+			}
+			int predecessorCount = 1 + random() % std::min(3, index);
+			for (int predecessor = 0; predecessor < predecessorCount; predecessor++) {
+				int from = random() % index;
+				collective.Connect(graph.nodes[index]->input, graph.nodes[from]->output);
+				hasSuccessor[from] = true;
+			}
+		}
+		ConnectToSink(collective, graph, hasSuccessor);
+	}
+
+	//the messages go round the ring a few times, after which the ring is
+	//deadlocked, and only the deadlock breaker lets it halt
+	static void BuildCycle(TestCollective &collective, Graph &graph, int size, int messageCount) {
+		graph.source = collective.CreateBox<Source>(messageCount, size * 3);
+		graph.sink = collective.CreateBox<Sink>();
+		for (int index = 0; index < size; index++) {
+			graph.nodes.push_back(collective.CreateBox<Node>(true));
+		}
+		collective.Connect(graph.nodes[0]->input, graph.source->output);
+		for (int index = 0; index < size; index++) {
+			collective.Connect(graph.nodes[(index + 1) % size]->input, graph.nodes[index]->output);
+		}
+		collective.Connect(graph.sink->input, graph.nodes[0]->output);
+	}
+
+	typedef std::map<std::string, double> metrics_t;
+
+	static metrics_t Measure(builder_t build, int size, int messageCount, int threadCount, bool deadlocks) {
+		metrics_t metrics;
+		TestCollective collective(threadCount);
+		Graph graph;
+		//nothing runs until Start, so only the graph is allocated in between
+		std::int64_t allocatedBefore = allocatedBytes;
+		build(collective, graph, size, messageCount);
+		std::int64_t graphBytes = allocatedBytes - allocatedBefore;
+		std::size_t boxCount = graph.nodes.size() + 2;
+
+		auto start = clock::now();
+		collective.Start();
+		collective.Join();
+		auto end = clock::now();
+		//the Boxes and their ports, and the stacks they ran on, which the pool keeps
+		auto &stackPool = collective.GetStackPool();
+		double stackBytes = static_cast<double>(stackPool.GetMappedCount() * stackPool.GetDefaultStackSize());
+		metrics["bytes_per_box"] = (graphBytes + stackBytes) / boxCount;
+
+		std::int64_t received = static_cast<std::int64_t>(graph.sink->latencies.size());
+		clock::time_point lastReceived = start;
+		for (auto node : graph.nodes) {
+			received += node->received;
+			lastReceived = std::max(lastReceived, node->lastReceived);
+		}
+		metrics["msgs_per_sec"] = received / std::chrono::duration<double>(end - start).count();
+
+		auto &latencies = graph.sink->latencies;
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&latencies](double fraction) {
+			if (latencies.empty()) return 0.0;
+			std::size_t index = std::min(latencies.size() - 1, static_cast<std::size_t>(fraction * latencies.size()));
+			return std::chrono::duration<double, std::micro>(clock::duration(latencies[index])).count();
+		};
+		metrics["p50_us"] = percentile(0.50);
+		metrics["p90_us"] = percentile(0.90);
+		metrics["p99_us"] = percentile(0.99);
+		//from the last datum moving to every Box having halted, which only a graph that deadlocks has to wait for
+		if (deadlocks) {
+			metrics["break_ms"] = std::chrono::duration<double, std::milli>(end - lastReceived).count();
+		}
+		return metrics;
+	}
+
+	//for each metric, whether a larger value is better
+	static bool GetIsLargerBetter(std::string const &metric) {
+		return metric == "msgs_per_sec";
+	}
+
+	//A difference smaller than this is the clock and the scheduler rather
+	//than the code, however large it is relative to a sub-millisecond value
+	static double GetNoiseFloor(std::string const &metric) {
+		if (metric.size() > 3 && metric.compare(metric.size() - 3, 3, "_ms") == 0) return 1;
+		if (metric.size() > 3 && metric.compare(metric.size() - 3, 3, "_us") == 0) return 1000;
+		return 0;
+	}
+
+public:
+	static void benchmark() {
+		struct shape {
+			char const* name;
+			builder_t build;
+			int size;
+			int messageCount;
+			bool deadlocks;
+		};
+		shape const shapes[] = {
+			{ "chain", &BuildChain, 64, 5000, false },
+			{ "fan", &BuildFan, 64, 2000, false },
+			{ "diamonds", &BuildDiamonds, 16, 5000, false },
+			{ "random_dag", &BuildRandomDag, 64, 2000, false },
+			{ "cycle", &BuildCycle, 16, 100, true },
+		};
+
+		int maximumThreadCount = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+		std::vector<int> threadCounts;
+		for (int threadCount = 1; threadCount < maximumThreadCount; threadCount *= 2) {
+			threadCounts.push_back(threadCount);
+		}
+		threadCounts.push_back(maximumThreadCount);
+
+		std::map<std::string, double> results;
+		for (auto &s : shapes) {
+			for (int threadCount : threadCounts) {
+				auto metrics = Measure(s.build, s.size, s.messageCount, threadCount, s.deadlocks);
+				std::cout << std::left << std::setw(11) << s.name << std::setw(3) << threadCount;
+				for (auto &metric : metrics) {
+					std::cout << " " << metric.first << "=" << metric.second;
+					std::ostringstream key;
+					key << s.name << " " << threadCount << " " << metric.first;
+					results[key.str()] = metric.second;
+				}
+				std::cout << std::endl;
+			}
+		}
+
+		char const* writePath = std::getenv("SYNCHRONOX_BASELINE_WRITE");
+		if (writePath) {
+			std::ofstream file(writePath);
+			for (auto &result : results) {
+				file << result.first << " " << result.second << "\n";
+			}
+		}
+
+		char const* baselinePath = std::getenv("SYNCHRONOX_BASELINE");
+		if (!baselinePath) return;
+		char const* toleranceText = std::getenv("SYNCHRONOX_BASELINE_TOLERANCE");
+		double tolerance = toleranceText ? std::atof(toleranceText) : 0.25;
+		std::ifstream baseline(baselinePath);
+		std::string name, metric;
+		int threadCount;
+		double expected;
+		bool regressed = false;
+		while (baseline >> name >> threadCount >> metric >> expected) {
+			std::ostringstream key;
+			key << name << " " << threadCount << " " << metric;
+			auto found = results.find(key.str());
+			if (found == results.end()) continue;
+			double slack = std::max(expected * tolerance, GetNoiseFloor(metric));
+			bool worse = GetIsLargerBetter(metric) ? found->second < expected - slack : found->second > expected + slack;
+			if (worse) {
+				std::cout << "regression: " << key.str() << " is " << found->second << ", baseline " << expected << std::endl;
+				regressed = true;
+			}
+		}
+		//not an assert, so that release builds fail too
+		if (regressed) std::exit(EXIT_FAILURE);
+	}
+
+	//every shape delivers what it should
+	static void test_01() {
+		TestCollective collective(2);
+		Graph graph;
+		BuildDiamonds(collective, graph, 4, 100);
+		collective.Start();
+		collective.Join();
+		assert(graph.sink->latencies.size() == 100);
+	}
+
+	//the cycle halts, which it can only do through the deadlock breaker
+	static void test_02() {
+		TestCollective collective(2);
+		Graph graph;
+		BuildCycle(collective, graph, 4, 10);
+		collective.Start();
+		bool joined = collective.JoinFor(std::chrono::seconds(10));
+		assert(joined);
+		assert(!collective.GetCancellationToken().IsCancellationRequested());
+	}
+
+	//a halt that fans out to 100k Boxes, and the teardown that follows
+	static void test_03() {
+		int const boxCount = 100000;
+		auto start = clock::now();
+		clock::time_point joined;
+		{
+			TestCollective collective(2);
+			Graph graph;
+			for (int index = 0; index < boxCount; index++) {
+				graph.nodes.push_back(collective.CreateBox<Node>(false));
+			}
+			//created last, so that it runs, and halts, first
+			graph.source = collective.CreateBox<Source>(0, 0);
+			for (auto node : graph.nodes) {
+				collective.Connect(node->input, graph.source->output);
+			}
+			auto created = clock::now();
+			std::cout << "teardown: created " << boxCount << " Boxes in " << std::chrono::duration<double, std::milli>(created - start).count() << " ms" << std::endl;
+			start = created;
+			collective.Start();
+			collective.Join();
+			joined = clock::now();
+		}
+		auto destroyed = clock::now();
+		std::cout << "teardown: halted in " << std::chrono::duration<double, std::milli>(joined - start).count() << " ms, destroyed in "
+			<< std::chrono::duration<double, std::milli>(destroyed - joined).count() << " ms" << std::endl;
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+		test_03();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "Collective.h"
+
+#include <chrono>
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+class superstep_tests {
+	class TestCollective : public Synchronox::Collective {
+	public:
+		TestCollective(int threadCount, Synchronox::ExecutionMode mode) : Collective(threadCount, Synchronox::PlacementPolicy::Any, mode) {}
+		void Start() { ConstructionCompleted(); }
+	};
+
+	//label propagation: each vertex ends up with the least id in its component
+	class Vertex : public Synchronox::Box {
+	public:
+		Synchronox::Input<int> input;
+		Synchronox::Output<int> output;
+		int label;
+		Vertex(int id) : input(this), output(this), label(id) {}
+	protected:
+		void Computer() {
+			output.Enqueue(label);
+			int candidate;
+			while (input.Dequeue(candidate)) {
+				if (candidate < label) {
+					label = candidate;
+					output.Enqueue(label);
+				}
+			}
+		}
+	};
+
+	//a ring of vertexCount vertices, cut into componentCount arcs
+	static double run(Synchronox::ExecutionMode mode, int vertexCount, int componentCount, int threadCount, std::vector<int> &labels, std::uint64_t &superstepCount) {
+		auto start = std::chrono::high_resolution_clock::now();
+		{
+			TestCollective collective(threadCount, mode);
+			std::vector<Vertex*> vertices;
+			for (int id = 0; id < vertexCount; id++) {
+				//numbered so that the least id of an arc is in its middle
+				vertices.push_back(collective.CreateBox<Vertex>((id * 7919) % vertexCount));
+			}
+			int arcLength = vertexCount / componentCount;
+			for (int id = 0; id < vertexCount; id++) {
+				int next = id + 1;
+				if (next % arcLength == 0 || next == vertexCount) continue;
+				collective.Connect(vertices[next]->input, vertices[id]->output);
+				collective.Connect(vertices[id]->input, vertices[next]->output);
+			}
+			collective.Start();
+			collective.Join();
+			labels.clear();
+			for (auto vertex : vertices) {
+				labels.push_back(vertex->label);
+			}
+			superstepCount = collective.GetSuperstepCount();
+		}
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+public:
+	//both modes reach the same fixpoint
+	static void test_01() {
+		std::vector<int> asynchronous, superstep;
+		std::uint64_t superstepCount;
+		run(Synchronox::ExecutionMode::Asynchronous, 60, 3, 2, asynchronous, superstepCount);
+		run(Synchronox::ExecutionMode::Superstep, 60, 3, 2, superstep, superstepCount);
+		assert(asynchronous == superstep);
+		for (int id = 0; id < 60; id++) {
+			int arc = id / 20;
+			int least = 60;
+			for (int member = arc * 20; member < arc * 20 + 20; member++) {
+				least = std::min(least, (member * 7919) % 60);
+			}
+			assert(superstep[id] == least);
+		}
+		assert(superstepCount > 0);
+	}
+
+	static void test_02() {
+		std::vector<int> labels;
+		std::uint64_t superstepCount;
+		int const vertexCount = 400, componentCount = 4;
+		double asynchronous = run(Synchronox::ExecutionMode::Asynchronous, vertexCount, componentCount, 2, labels, superstepCount);
+		double superstep = run(Synchronox::ExecutionMode::Superstep, vertexCount, componentCount, 2, labels, superstepCount);
+		std::cout << "label propagation: asynchronous " << asynchronous << " s, superstep " << superstep << " s in " << superstepCount << " supersteps" << std::endl;
+	}
+
+	//many small components all reach their fixpoint at once, and halt together at the next barrier
+	static void test_03() {
+		std::vector<int> labels;
+		std::uint64_t superstepCount;
+		run(Synchronox::ExecutionMode::Superstep, 400, 200, 2, labels, superstepCount);
+		for (int id = 0; id < 400; id += 2) {
+			assert(labels[id] == labels[id + 1]);
+		}
+		assert(superstepCount < 10);
+	}
+
+	static void test_all() {
+		test_01();
+		test_02();
+		test_03();
+	}
+};
\ No newline at end of file
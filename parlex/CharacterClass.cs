@@ -0,0 +1,169 @@
+using System;
+using System.Collections.Generic;
+
+namespace Parlex {
+    /// <summary>
+    /// A set of code points, kept as a bitmap over the first 256, where nearly
+    /// every grammar's lookahead lives, and sorted inclusive ranges above that.
+    /// </summary>
+    public sealed class CharacterClass {
+        public const int MaxCodePoint = 0x10FFFF;
+
+        public static CharacterClass All {
+            get {
+                var result = new CharacterClass();
+                result.AddRange(0, MaxCodePoint);
+                return result;
+            }
+        }
+
+        public bool IsEmpty {
+            get { return _high.Count == 0 && _low[0] == 0 && _low[1] == 0 && _low[2] == 0 && _low[3] == 0; }
+        }
+
+        /// <summary>
+        /// The bitmap over code points 0 to 255, 64 to a word, lowest bit first
+        /// </summary>
+        public IReadOnlyList<UInt64> LowBits {
+            get { return _low; }
+        }
+
+        public CharacterClass() {}
+
+        public CharacterClass(IEnumerable<Int32> codePoints) {
+            if (codePoints == null) {
+                throw new ArgumentNullException("codePoints");
+            }
+            foreach (var codePoint in codePoints) {
+                Add(codePoint);
+            }
+        }
+
+        public bool Add(int codePoint) {
+            return AddRange(codePoint, codePoint);
+        }
+
+        //returns whether anything was added
+        public bool AddRange(int first, int last) {
+            if (first < 0 || last > MaxCodePoint || first > last) {
+                throw new ArgumentOutOfRangeException("first", "the range must lie within the code point space");
+            }
+            var changed = false;
+            for (var codePoint = first; codePoint <= Math.Min(last, 255); ++codePoint) {
+                var bit = 1UL << (codePoint & 63);
+                if ((_low[codePoint >> 6] & bit) == 0) {
+                    _low[codePoint >> 6] |= bit;
+                    changed = true;
+                }
+            }
+            if (last > 255) {
+                changed |= AddHighRange(Math.Max(first, 256), last);
+            }
+            return changed;
+        }
+
+        public bool UnionWith(CharacterClass other) {
+            if (other == null) {
+                throw new ArgumentNullException("other");
+            }
+            var changed = false;
+            for (var i = 0; i < _low.Length; ++i) {
+                if ((other._low[i] & ~_low[i]) != 0) {
+                    _low[i] |= other._low[i];
+                    changed = true;
+                }
+            }
+            for (var i = 0; i < other._high.Count; i += 2) {
+                changed |= AddHighRange(other._high[i], other._high[i + 1]);
+            }
+            return changed;
+        }
+
+        public bool Contains(int codePoint) {
+            if (codePoint < 0) {
+                return false;
+            }
+            if (codePoint < 256) {
+                return (_low[codePoint >> 6] & (1UL << (codePoint & 63))) != 0;
+            }
+            for (var i = 0; i < _high.Count && _high[i] <= codePoint; i += 2) {
+                if (codePoint <= _high[i + 1]) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        public CharacterClass Complement() {
+            var result = new CharacterClass();
+            var next = 0;
+            foreach (var range in GetRanges()) {
+                if (range.Item1 > next) {
+                    result.AddRange(next, range.Item1 - 1);
+                }
+                next = range.Item2 + 1;
+            }
+            if (next <= MaxCodePoint) {
+                result.AddRange(next, MaxCodePoint);
+            }
+            return result;
+        }
+
+        /// <summary>
+        /// The whole set as sorted, disjoint, inclusive ranges
+        /// </summary>
+        public IEnumerable<Tuple<Int32, Int32>> GetRanges() {
+            var first = -1;
+            for (var codePoint = 0; codePoint < 256; ++codePoint) {
+                if (Contains(codePoint)) {
+                    if (first < 0) {
+                        first = codePoint;
+                    }
+                } else if (first >= 0) {
+                    yield return Tuple.Create(first, codePoint - 1);
+                    first = -1;
+                }
+            }
+            for (var i = 0; i < _high.Count; i += 2) {
+                if (first >= 0) {
+                    if (_high[i] == 256) {
+                        yield return Tuple.Create(first, _high[i + 1]);
+                        first = -1;
+                        continue;
+                    }
+                    yield return Tuple.Create(first, 255);
+                    first = -1;
+                }
+                yield return Tuple.Create(_high[i], _high[i + 1]);
+            }
+            if (first >= 0) {
+                yield return Tuple.Create(first, 255);
+            }
+        }
+
+        private bool AddHighRange(int first, int last) {
+            //the first range that ends at or after the code point before first
+            var i = 0;
+            while (i < _high.Count && _high[i + 1] < first - 1) {
+                i += 2;
+            }
+            if (i < _high.Count && _high[i] <= first && last <= _high[i + 1]) {
+                return false;
+            }
+            var j = i;
+            while (j < _high.Count && _high[j] <= last + 1) {
+                first = Math.Min(first, _high[j]);
+                last = Math.Max(last, _high[j + 1]);
+                j += 2;
+            }
+            _high.RemoveRange(i, j - i);
+            _high.Insert(i, last);
+            _high.Insert(i, first);
+            return true;
+        }
+
+        private readonly UInt64[] _low = new UInt64[4];
+        //inclusive [first, last] pairs, all above 255
+        private readonly List<Int32> _high = new List<Int32>();
+    }
+}
\ No newline at end of file
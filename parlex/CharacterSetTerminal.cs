@@ -11,6 +11,10 @@ namespace Parlex {
             get { return _shortName; }
         }
 
+        public override CharacterClass FirstCharacters {
+            get { return new CharacterClass(_unicodeCodePoints); }
+        }
+
         public CharacterSetTerminal(String name, IEnumerable<Int32> unicodeCodePoints, String shortName = null) : base(name) {
             if (name == null) {
                 throw new ArgumentNullException("name");
@@ -1,12 +1,463 @@
 ﻿using System;
+using System.Collections.Generic;
+using System.Globalization;
+using System.Linq;
+using System.Text;
 
 namespace Parlex {
     /// <summary>
-    /// Outputs a single self-contained C++ header file
+    /// Outputs a single self-contained C++ header file: a packrat recursive
+    /// descent recognizer compiled from each production's BehaviorTree. A
+    /// choice switches on the next code point to the alternatives that can
+    /// start with it, a repetition is a loop, and only productions referred
+    /// to from more than one place are memoized. Choices are ordered and
+    /// repetitions greedy, as in a PEG, so it agrees with the ParseEngine
+    /// where the grammar is unambiguous and its choices are decided by their
+    /// first code point, with no dispatchers or threads. Left recursive
+    /// grammars are rejected.
     /// </summary>
     public class CppParserGenerator : IParserGenerator {
         public void Generate(string destinationDirectory, NfaGrammar grammar, String parserName) {
-            throw new NotImplementedException();
+            if (destinationDirectory == null) {
+                throw new ArgumentNullException("destinationDirectory");
+            }
+            System.IO.File.WriteAllText(destinationDirectory + "/" + parserName + ".h", GenerateHeader(grammar, parserName));
+        }
+
+        public String GenerateHeader(NfaGrammar grammar, String parserName) {
+            if (grammar == null) {
+                throw new ArgumentNullException("grammar");
+            }
+            if (parserName == null) {
+                throw new ArgumentNullException("parserName");
+            }
+            if (grammar.Main == null) {
+                throw new ArgumentException("the grammar has no main production", "grammar");
+            }
+            return new HeaderWriter(grammar, parserName).Write();
+        }
+
+        private class HeaderWriter {
+            public HeaderWriter(NfaGrammar grammar, String parserName) {
+                _grammar = grammar;
+                _parserName = CppName(parserName);
+                _lookahead = new LookaheadSets(grammar, false);
+                CollectProductions();
+                RejectLeftRecursion();
+            }
+
+            public String Write() {
+                foreach (var production in _productions) {
+                    WriteProduction(production);
+                }
+                var guard = "_" + String.Concat(_parserName.Select((c, i) => i > 0 && Char.IsUpper(c) ? "_" + c : c.ToString())).ToUpperInvariant() + "_H_";
+                var builder = new StringBuilder();
+                builder.AppendLine("//generated by parlex from " + Comment(_grammar.Main.Name));
+                builder.AppendLine("#ifndef " + guard);
+                builder.AppendLine("#define " + guard);
+                builder.AppendLine();
+                builder.AppendLine("#include <algorithm>");
+                builder.AppendLine("#include <vector>");
+                builder.AppendLine();
+                builder.AppendLine("class " + _parserName + " {");
+                builder.AppendLine("public:");
+                builder.AppendLine("\t//text must outlive the parser");
+                builder.Append("\t" + _parserName + "(char32_t const *text, int size) : text(text), size(size)");
+                foreach (var production in _productions.Where(x => _memoized.Contains(x))) {
+                    builder.Append(", memo" + _names[production].Substring("Parse".Length) + "(size + 1, Unknown)");
+                }
+                builder.AppendLine(" {}");
+                builder.AppendLine();
+                builder.AppendLine("\t//the length " + Comment(_grammar.Main.Name) + " matches at the start of the text, or -1");
+                builder.AppendLine("\tint Match() { return " + _names[_grammar.Main] + "(0); }");
+                builder.AppendLine("\tbool Parse() { return Match() == size; }");
+                builder.AppendLine("private:");
+                builder.AppendLine("\tenum { Fail = -1, Unknown = -2 };");
+                builder.AppendLine();
+                builder.AppendLine("\tint Peek(int p) const { return p < size ? static_cast<int>(text[p]) : -1; }");
+                builder.AppendLine();
+                builder.AppendLine("\tstatic bool InRanges(char32_t const *ranges, int count, char32_t c) {");
+                builder.AppendLine("\t\t//the first bound at or above c; c is in a range if that's its last, or its first and equal");
+                builder.AppendLine("\t\tchar32_t const *bound = std::lower_bound(ranges, ranges + count, c);");
+                builder.AppendLine("\t\treturn bound != ranges + count && (((bound - ranges) & 1) != 0 || *bound == c);");
+                builder.AppendLine("\t}");
+                if (_hooks.Count > 0) {
+                    builder.AppendLine();
+                    builder.AppendLine("\t//terminals only known by their code, to be defined alongside the parser");
+                    foreach (var hook in _hooks) {
+                        builder.AppendLine("\tbool " + hook + "(int position, int &length) const;");
+                    }
+                }
+                builder.AppendLine();
+                builder.Append(_functions);
+                builder.AppendLine("\tchar32_t const *text;");
+                builder.AppendLine("\tint size;");
+                foreach (var production in _productions.Where(x => _memoized.Contains(x))) {
+                    builder.AppendLine("\tstd::vector<int> memo" + _names[production].Substring("Parse".Length) + ";");
+                }
+                builder.AppendLine("};");
+                builder.AppendLine();
+                builder.Append("#endif");
+                return builder.ToString();
+            }
+
+            //the productions main reaches, how often each is referred to, and their names
+            private void CollectProductions() {
+                var queue = new Queue<NfaProduction>();
+                Action<NfaProduction> reference = production => {
+                    int count;
+                    _referenceCounts.TryGetValue(production, out count);
+                    _referenceCounts[production] = count + 1;
+                    if (count == 0) {
+                        _trees[production] = new BehaviorTree(production.Nfa).Root;
+                        _names[production] = UniqueName("Parse" + CppName(production.Name));
+                        _productions.Add(production);
+                        queue.Enqueue(production);
+                    }
+                };
+                reference(_grammar.Main);
+                while (queue.Count > 0) {
+                    foreach (var leaf in Leaves(_trees[queue.Dequeue()])) {
+                        var asProduction = leaf.Recognizer as NfaProduction;
+                        if (asProduction != null) {
+                            reference(asProduction);
+                        }
+                    }
+                }
+                //one referred to from a single place is only ever asked for once at a position
+                foreach (var production in _productions.Where(x => _referenceCounts[x] > 1)) {
+                    _memoized.Add(production);
+                }
+            }
+
+            private void RejectLeftRecursion() {
+                var visiting = new HashSet<NfaProduction>();
+                var done = new HashSet<NfaProduction>();
+                Action<NfaProduction> visit = null;
+                visit = production => {
+                    if (done.Contains(production)) {
+                        return;
+                    }
+                    if (!visiting.Add(production)) {
+                        throw new NotSupportedException(production.Name + " is left recursive, which recursive descent can't parse; use the ParseEngine instead");
+                    }
+                    foreach (var callee in LeftCalls(_trees[production])) {
+                        visit(callee);
+                    }
+                    visiting.Remove(production);
+                    done.Add(production);
+                };
+                foreach (var production in _productions) {
+                    visit(production);
+                }
+            }
+
+            private void WriteProduction(NfaProduction production) {
+                var name = _names[production];
+                var root = _trees[production];
+                if (!_memoized.Contains(production)) {
+                    WriteFunction(name, root, production, production.Name);
+                    return;
+                }
+                var call = Call(root, production, "p");
+                _functions.AppendLine("\t//" + Comment(production.Name));
+                _functions.AppendLine("\tint " + name + "(int p) {");
+                _functions.AppendLine("\t\tint &result = memo" + name.Substring("Parse".Length) + "[p];");
+                _functions.AppendLine("\t\tif (result == Unknown) result = " + call + ";");
+                _functions.AppendLine("\t\treturn result;");
+                _functions.AppendLine("\t}");
+                _functions.AppendLine();
+            }
+
+            //a call that returns where node's match at position ends, or Fail
+            private String Call(BehaviorNode node, NfaProduction production, String position) {
+                if (node is NullBehavior) {
+                    return position;
+                }
+                var leaf = node as BehaviorLeaf;
+                if (leaf != null) {
+                    var asProduction = leaf.Recognizer as NfaProduction;
+                    return (asProduction != null ? _names[asProduction] : TerminalFunction(leaf.Recognizer)) + "(" + position + ")";
+                }
+                var name = _names[production] + "_" + (++_helperCounts[_names[production]]).ToString(CultureInfo.InvariantCulture);
+                WriteFunction(name, node, production, null);
+                return name + "(" + position + ")";
+            }
+
+            private void WriteFunction(String name, BehaviorNode node, NfaProduction production, String comment) {
+                //children's functions are written first, so this one's body is built aside
+                var body = new List<String>();
+                if (node is SequenceBehavior) {
+                    var children = ((SequenceBehavior)node).Children;
+                    for (var i = 0; i < children.Count - 1; ++i) {
+                        body.Add("if ((p = " + Call(children[i], production, "p") + ") < 0) return Fail;");
+                    }
+                    body.Add("return " + (children.Count > 0 ? Call(children.Last(), production, "p") : "p") + ";");
+                } else if (node is ChoiceBehavior) {
+                    body.AddRange(ChoiceBody(((ChoiceBehavior)node).Children, production));
+                } else if (node is RepetitionBehavior) {
+                    body.Add("//as many as match, stopping at one that matches nothing");
+                    body.Add("for (;;) {");
+                    body.Add("\tint next = " + Call(((RepetitionBehavior)node).Child, production, "p") + ";");
+                    body.Add("\tif (next <= p) return p;");
+                    body.Add("\tp = next;");
+                    body.Add("}");
+                } else if (node is Optional) {
+                    body.Add("int next = " + Call(((Optional)node).Child, production, "p") + ";");
+                    body.Add("return next < 0 ? p : next;");
+                } else {
+                    body.Add("return " + Call(node, production, "p") + ";");
+                }
+                if (comment != null) {
+                    _functions.AppendLine("\t//" + Comment(comment));
+                }
+                _functions.AppendLine("\tint " + name + "(int p) {");
+                foreach (var line in body) {
+                    _functions.AppendLine("\t\t" + line);
+                }
+                _functions.AppendLine("\t}");
+                _functions.AppendLine();
+            }
+
+            private IEnumerable<String> ChoiceBody(List<BehaviorNode> alternatives, NfaProduction production) {
+                var calls = alternatives.Select(x => Call(x, production, "p")).ToArray();
+                var firsts = alternatives.Select(First).ToArray();
+                var nullable = alternatives.Select(IsNullable).ToArray();
+                //code points below 128 grouped by the alternatives that can start with them; the rest try them all
+                var groups = new Dictionary<String, List<int>>();
+                var candidatesOf = new Dictionary<String, int[]>();
+                var order = new List<String>();
+                for (var c = 0; c < 128; ++c) {
+                    var candidates = Enumerable.Range(0, alternatives.Count).Where(i => nullable[i] || firsts[i].Contains(c)).ToArray();
+                    if (candidates.Length == alternatives.Count) {
+                        continue;
+                    }
+                    var key = String.Join(",", candidates);
+                    if (!groups.ContainsKey(key)) {
+                        groups[key] = new List<int>();
+                        candidatesOf[key] = candidates;
+                        order.Add(key);
+                    }
+                    groups[key].Add(c);
+                }
+                var lines = new List<String> {"int r;"};
+                if (groups.Count == 0) {
+                    lines.AddRange(TryEach(calls, Enumerable.Range(0, calls.Length)));
+                    return lines;
+                }
+                lines.Add("switch (Peek(p)) {");
+                foreach (var key in order) {
+                    lines.Add(String.Join(" ", groups[key].Select(c => "case " + Hex(c) + ":")));
+                    lines.AddRange(TryEach(calls, candidatesOf[key]).Select(x => "\t" + x));
+                }
+                lines.Add("default:");
+                lines.AddRange(TryEach(calls, Enumerable.Range(0, calls.Length)).Select(x => "\t" + x));
+                lines.Add("}");
+                return lines;
+            }
+
+            private static IEnumerable<String> TryEach(String[] calls, IEnumerable<int> candidates) {
+                foreach (var i in candidates) {
+                    yield return "if ((r = " + calls[i] + ") >= 0) return r;";
+                }
+                yield return "return Fail;";
+            }
+
+            private String TerminalFunction(Recognizer recognizer) {
+                String name;
+                if (_terminalNames.TryGetValue(recognizer, out name)) {
+                    return name;
+                }
+                name = UniqueName("MatchTerminal" + _terminalNames.Count.ToString(CultureInfo.InvariantCulture));
+                _terminalNames[recognizer] = name;
+                var lines = new List<String>();
+                var asString = recognizer as StringTerminal;
+                var terminal = recognizer as Terminal;
+                if (asString != null) {
+                    var codePoints = asString.Text.GetUtf32CodePoints();
+                    if (codePoints.Length == 0) {
+                        lines.Add("return p;");
+                    } else {
+                        var tests = codePoints.Select((c, i) => "text[p" + (i > 0 ? " + " + i.ToString(CultureInfo.InvariantCulture) : "") + "] != " + Hex(c));
+                        lines.Add("if (size - p < " + codePoints.Length.ToString(CultureInfo.InvariantCulture) + " || " + String.Join(" || ", tests) + ") return Fail;");
+                        lines.Add("return p + " + codePoints.Length.ToString(CultureInfo.InvariantCulture) + ";");
+                    }
+                } else if (terminal != null && terminal.Length == 1 && (terminal is CharacterSetTerminal || StandardSymbols.IsBuiltIn(terminal))) {
+                    //these match exactly the code points they can start with
+                    var ranges = terminal.FirstCharacters.GetRanges().ToArray();
+                    lines.Add("if (p >= size) return Fail;");
+                    lines.Add("char32_t c = text[p];");
+                    if (ranges.Length <= 4) {
+                        //c is unsigned, so a range from 0 only needs its upper bound
+                        var tests = ranges.Select(x => x.Item1 == x.Item2 ? "c == " + Hex(x.Item1) : x.Item1 == 0 ? "c <= " + Hex(x.Item2) : "(c >= " + Hex(x.Item1) + " && c <= " + Hex(x.Item2) + ")");
+                        lines.Add("return " + (ranges.Length > 0 ? String.Join(" || ", tests) : "false") + " ? p + 1 : Fail;");
+                    } else {
+                        lines.Add("static char32_t const ranges[] = {" + String.Join(", ", ranges.Select(x => Hex(x.Item1) + ", " + Hex(x.Item2))) + "};");
+                        lines.Add("return InRanges(ranges, " + (ranges.Length * 2).ToString(CultureInfo.InvariantCulture) + ", c) ? p + 1 : Fail;");
+                    }
+                } else if (recognizer == StandardSymbols.SimpleEscapeSequence) {
+                    //a backslash and one of the characters it escapes, as ReadSimpleEscapeSequence in BuiltinTerminals.h
+                    var escaped = StandardSymbols.EscapeCharMap.Left.Keys.OrderBy(x => x);
+                    lines.Add("if (size - p < 2 || text[p] != " + Hex('\\') + ") return Fail;");
+                    lines.Add("switch (text[p + 1]) {");
+                    lines.Add(String.Join(" ", escaped.Select(c => "case " + Hex(c) + ":")) + " return p + 2;");
+                    lines.Add("default: return Fail;");
+                    lines.Add("}");
+                } else if (recognizer == StandardSymbols.UnicodeEscapeSequence) {
+                    //\x and six hexadecimal digits, as ReadUnicodeEscapeSequence in BuiltinTerminals.h
+                    lines.Add("if (size - p < 8 || text[p] != " + Hex('\\') + " || text[p + 1] != " + Hex('x') + ") return Fail;");
+                    lines.Add("for (int i = p + 2; i < p + 8; ++i) {");
+                    lines.Add("\tchar32_t c = text[i];");
+                    lines.Add("\tif (!((c >= " + Hex('0') + " && c <= " + Hex('9') + ") || (c >= " + Hex('A') + " && c <= " + Hex('F') + ") || (c >= " + Hex('a') + " && c <= " + Hex('f') + "))) return Fail;");
+                    lines.Add("}");
+                    lines.Add("return p + 8;");
+                } else {
+                    var hook = UniqueName("Match" + CppName(recognizer.Name));
+                    _hooks.Add(hook);
+                    lines.Add("int length;");
+                    lines.Add("return " + hook + "(p, length) ? p + length : Fail;");
+                }
+                _functions.AppendLine("\t//" + Comment(recognizer.Name));
+                _functions.AppendLine("\tint " + name + "(int p) const {");
+                foreach (var line in lines) {
+                    _functions.AppendLine("\t\t" + line);
+                }
+                _functions.AppendLine("\t}");
+                _functions.AppendLine();
+                return name;
+            }
+
+            private bool IsNullable(BehaviorNode node) {
+                if (node is NullBehavior || node is Optional || node is RepetitionBehavior) {
+                    return true;
+                }
+                if (node is SequenceBehavior) {
+                    return ((SequenceBehavior)node).Children.All(IsNullable);
+                }
+                if (node is ChoiceBehavior) {
+                    return ((ChoiceBehavior)node).Children.Any(IsNullable);
+                }
+                return _lookahead.IsNullable(((BehaviorLeaf)node).Recognizer);
+            }
+
+            private CharacterClass First(BehaviorNode node) {
+                var result = new CharacterClass();
+                if (node is SequenceBehavior) {
+                    foreach (var child in ((SequenceBehavior)node).Children) {
+                        result.UnionWith(First(child));
+                        if (!IsNullable(child)) {
+                            break;
+                        }
+                    }
+                } else if (node is ChoiceBehavior) {
+                    foreach (var child in ((ChoiceBehavior)node).Children) {
+                        result.UnionWith(First(child));
+                    }
+                } else if (node is RepetitionBehavior) {
+                    result.UnionWith(First(((RepetitionBehavior)node).Child));
+                } else if (node is Optional) {
+                    result.UnionWith(First(((Optional)node).Child));
+                } else if (node is BehaviorLeaf) {
+                    result.UnionWith(_lookahead.GetFirst(((BehaviorLeaf)node).Recognizer));
+                }
+                return result;
+            }
+
+            //the productions node can ask for before it has consumed anything
+            private IEnumerable<NfaProduction> LeftCalls(BehaviorNode node) {
+                if (node is SequenceBehavior) {
+                    foreach (var child in ((SequenceBehavior)node).Children) {
+                        foreach (var callee in LeftCalls(child)) {
+                            yield return callee;
+                        }
+                        if (!IsNullable(child)) {
+                            yield break;
+                        }
+                    }
+                } else if (node is ChoiceBehavior) {
+                    foreach (var callee in ((ChoiceBehavior)node).Children.SelectMany(LeftCalls)) {
+                        yield return callee;
+                    }
+                } else if (node is RepetitionBehavior) {
+                    foreach (var callee in LeftCalls(((RepetitionBehavior)node).Child)) {
+                        yield return callee;
+                    }
+                } else if (node is Optional) {
+                    foreach (var callee in LeftCalls(((Optional)node).Child)) {
+                        yield return callee;
+                    }
+                } else if (node is BehaviorLeaf && ((BehaviorLeaf)node).Recognizer is NfaProduction) {
+                    yield return (NfaProduction)((BehaviorLeaf)node).Recognizer;
+                }
+            }
+
+            private static IEnumerable<BehaviorLeaf> Leaves(BehaviorNode node) {
+                if (node is BehaviorLeaf) {
+                    return new[] {(BehaviorLeaf)node};
+                }
+                if (node is SequenceBehavior) {
+                    return ((SequenceBehavior)node).Children.SelectMany(Leaves);
+                }
+                if (node is ChoiceBehavior) {
+                    return ((ChoiceBehavior)node).Children.SelectMany(Leaves);
+                }
+                if (node is RepetitionBehavior) {
+                    return Leaves(((RepetitionBehavior)node).Child);
+                }
+                if (node is Optional) {
+                    return Leaves(((Optional)node).Child);
+                }
+                return Enumerable.Empty<BehaviorLeaf>();
+            }
+
+            private String UniqueName(String name) {
+                var result = name;
+                for (var i = 2; !_usedNames.Add(result); ++i) {
+                    result = name + i.ToString(CultureInfo.InvariantCulture);
+                }
+                _helperCounts[result] = 0;
+                return result;
+            }
+
+            //PascalCase, keeping only what a C++ identifier can hold
+            private static String CppName(String name) {
+                var result = new StringBuilder();
+                var capitalize = true;
+                foreach (var c in name) {
+                    if (c < 128 && Char.IsLetterOrDigit(c)) {
+                        result.Append(capitalize ? Char.ToUpper(c, CultureInfo.InvariantCulture) : c);
+                        capitalize = false;
+                    } else {
+                        capitalize = true;
+                    }
+                }
+                if (result.Length == 0 || Char.IsDigit(result[0])) {
+                    result.Insert(0, "Symbol");
+                }
+                return result.ToString();
+            }
+
+            private static String Comment(String text) {
+                return new String(text.Where(c => !Char.IsControl(c)).ToArray());
+            }
+
+            private static String Hex(int codePoint) {
+                return "0x" + codePoint.ToString("X2", CultureInfo.InvariantCulture);
+            }
+
+            private readonly NfaGrammar _grammar;
+            private readonly String _parserName;
+            private readonly LookaheadSets _lookahead;
+            private readonly List<NfaProduction> _productions = new List<NfaProduction>();
+            private readonly Dictionary<NfaProduction, BehaviorNode> _trees = new Dictionary<NfaProduction, BehaviorNode>();
+            private readonly Dictionary<NfaProduction, int> _referenceCounts = new Dictionary<NfaProduction, int>();
+            private readonly HashSet<NfaProduction> _memoized = new HashSet<NfaProduction>();
+            private readonly Dictionary<Recognizer, String> _names = new Dictionary<Recognizer, String>();
+            private readonly Dictionary<Recognizer, String> _terminalNames = new Dictionary<Recognizer, String>();
+            private readonly Dictionary<String, int> _helperCounts = new Dictionary<String, int>();
+            private readonly HashSet<String> _usedNames = new HashSet<String>();
+            private readonly List<String> _hooks = new List<String>();
+            private readonly StringBuilder _functions = new StringBuilder();
         }
     }
-}
+}
\ No newline at end of file
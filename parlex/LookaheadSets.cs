@@ -0,0 +1,169 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using Automata;
+
+namespace Parlex {
+    /// <summary>
+    /// Whether each recognizer in an NfaGrammar can match nothing, the code
+    /// points its matches can start with, and optionally the code points
+    /// that can follow it, found by iterating each production's NFA to a
+    /// fixpoint. The native engine checks these before it creates a
+    /// dispatcher, so work that can't match where it would start is skipped.
+    /// </summary>
+    public class LookaheadSets {
+        public IEnumerable<Recognizer> Recognizers {
+            get { return _first.Keys; }
+        }
+
+        public bool HasFollow {
+            get { return _follow != null; }
+        }
+
+        public LookaheadSets(NfaGrammar grammar, bool computeFollow = true) {
+            if (grammar == null) {
+                throw new ArgumentNullException("grammar");
+            }
+            CollectRecognizers(grammar);
+            ComputeFirst();
+            if (computeFollow) {
+                ComputeFollow(grammar.Main);
+            }
+        }
+
+        public bool IsNullable(Recognizer recognizer) {
+            return _nullable.Contains(recognizer);
+        }
+
+        public CharacterClass GetFirst(Recognizer recognizer) {
+            return _first[recognizer];
+        }
+
+        //null unless follow sets were computed
+        public CharacterClass GetFollow(Recognizer recognizer) {
+            return _follow == null ? null : _follow[recognizer];
+        }
+
+        //whether the end of the input can follow the recognizer
+        public bool CanPrecedeEnd(Recognizer recognizer) {
+            return _precedesEnd.Contains(recognizer);
+        }
+
+        private void CollectRecognizers(NfaGrammar grammar) {
+            var queue = new Queue<NfaProduction>(grammar.Productions);
+            if (grammar.Main != null) {
+                queue.Enqueue(grammar.Main);
+            }
+            while (queue.Count > 0) {
+                var production = queue.Dequeue();
+                if (_first.ContainsKey(production)) {
+                    continue;
+                }
+                _first[production] = new CharacterClass();
+                _productions.Add(production);
+                foreach (var transition in production.Nfa.GetTransitions()) {
+                    var asProduction = transition.Symbol as NfaProduction;
+                    if (asProduction != null) {
+                        queue.Enqueue(asProduction);
+                        continue;
+                    }
+                    if (_first.ContainsKey(transition.Symbol)) {
+                        continue;
+                    }
+                    var terminal = transition.Symbol as Terminal;
+                    if (terminal != null) {
+                        _first[terminal] = terminal.FirstCharacters;
+                        if (terminal.Length == 0) {
+                            _nullable.Add(terminal);
+                        }
+                    } else {
+                        //nothing is known about it, so it could start with, or be, anything
+                        _first[transition.Symbol] = CharacterClass.All;
+                        _nullable.Add(transition.Symbol);
+                    }
+                }
+            }
+        }
+
+        private void ComputeFirst() {
+            bool changed;
+            do {
+                changed = false;
+                foreach (var production in _productions) {
+                    var reachable = NullableClosure(production.Nfa, production.Nfa.StartStates);
+                    if (!_nullable.Contains(production) && reachable.Overlaps(production.Nfa.AcceptStates)) {
+                        _nullable.Add(production);
+                        changed = true;
+                    }
+                    changed |= _first[production].UnionWith(FirstOf(production.Nfa, reachable));
+                }
+            } while (changed);
+        }
+
+        private void ComputeFollow(NfaProduction main) {
+            _follow = _first.Keys.ToDictionary(x => x, x => new CharacterClass());
+            if (main != null) {
+                _precedesEnd.Add(main);
+            }
+            //nullability is settled, so what can come after each transition only has to be found once
+            var edges = new List<Tuple<Recognizer, NfaProduction, CharacterClass, bool>>();
+            foreach (var production in _productions) {
+                foreach (var transition in production.Nfa.GetTransitions()) {
+                    var after = NullableClosure(production.Nfa, new[] {transition.ToState});
+                    edges.Add(Tuple.Create(transition.Symbol, production, FirstOf(production.Nfa, after), after.Overlaps(production.Nfa.AcceptStates)));
+                }
+            }
+            bool changed;
+            do {
+                changed = false;
+                foreach (var edge in edges) {
+                    var follow = _follow[edge.Item1];
+                    changed |= follow.UnionWith(edge.Item3);
+                    if (edge.Item4) {
+                        changed |= follow.UnionWith(_follow[edge.Item2]);
+                        if (_precedesEnd.Contains(edge.Item2)) {
+                            changed |= _precedesEnd.Add(edge.Item1);
+                        }
+                    }
+                }
+            } while (changed);
+        }
+
+        //the states reachable from states through transitions on nullable recognizers
+        private HashSet<Nfa<Recognizer>.State> NullableClosure(Nfa<Recognizer> nfa, IEnumerable<Nfa<Recognizer>.State> states) {
+            var result = new HashSet<Nfa<Recognizer>.State>(states);
+            var stack = new Stack<Nfa<Recognizer>.State>(result);
+            while (stack.Count > 0) {
+                foreach (var transition in nfa.TransitionFunction[stack.Pop()]) {
+                    if (!_nullable.Contains(transition.Key)) {
+                        continue;
+                    }
+                    foreach (var target in transition.Value) {
+                        if (result.Add(target)) {
+                            stack.Push(target);
+                        }
+                    }
+                }
+            }
+            return result;
+        }
+
+        private CharacterClass FirstOf(Nfa<Recognizer> nfa, IEnumerable<Nfa<Recognizer>.State> states) {
+            var result = new CharacterClass();
+            foreach (var state in states) {
+                foreach (var transition in nfa.TransitionFunction[state]) {
+                    if (transition.Value.Count > 0) {
+                        result.UnionWith(_first[transition.Key]);
+                    }
+                }
+            }
+            return result;
+        }
+
+        private readonly List<NfaProduction> _productions = new List<NfaProduction>();
+        private readonly Dictionary<Recognizer, CharacterClass> _first = new Dictionary<Recognizer, CharacterClass>();
+        private readonly HashSet<Recognizer> _nullable = new HashSet<Recognizer>();
+        private readonly HashSet<Recognizer> _precedesEnd = new HashSet<Recognizer>();
+        private Dictionary<Recognizer, CharacterClass> _follow;
+    }
+}
\ No newline at end of file
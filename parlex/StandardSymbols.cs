@@ -110,6 +110,7 @@ namespace Parlex {
 
         private class SimpleEscapeSequenceTerminal : Terminal {
             public SimpleEscapeSequenceTerminal() : base("escape sequence") {}
+            public override CharacterClass FirstCharacters { get { return new CharacterClass(new[] {(Int32)'\\'}); } }
             public override int Length { get { return 2; } }
             public override bool Matches(IReadOnlyList<Int32> documentUtf32CodePoints, int documentIndex) {
                 if (documentUtf32CodePoints == null) {
@@ -131,6 +132,7 @@ namespace Parlex {
 
         private class UnicodeEscapeSequenceTerminal : Terminal {
             public UnicodeEscapeSequenceTerminal() : base("Unicode escape sequence") {}
+            public override CharacterClass FirstCharacters { get { return new CharacterClass(new[] {(Int32)'\\'}); } }
             public override int Length { get { return 7; } }
             public override bool Matches(IReadOnlyList<Int32> documentUtf32CodePoints, int documentIndex) {
                 if (documentUtf32CodePoints == null) {
@@ -153,6 +155,7 @@ namespace Parlex {
 
         private class NonDoubleQuoteCharacterTerminal : Terminal {
             public NonDoubleQuoteCharacterTerminal() : base("Non-double quote character") {}
+            public override CharacterClass FirstCharacters { get { return new CharacterClass(new[] {(Int32)'"'}).Complement(); } }
 
             public override bool Matches(IReadOnlyList<Int32> documentUtf32CodePoints, int documentIndex) {
                 if (documentUtf32CodePoints == null) {
@@ -172,6 +175,7 @@ namespace Parlex {
 
         private class NonDoubleQuoteNonBackslashCharacterTerminal : Terminal {
             public NonDoubleQuoteNonBackslashCharacterTerminal() : base("Non-double quote character, non-back slash character") {}
+            public override CharacterClass FirstCharacters { get { return new CharacterClass(new[] {(Int32)'"', '\\'}).Complement(); } }
             public override int Length { get { return 1; }}
             public override bool Matches(IReadOnlyList<Int32> documentUtf32CodePoints, int documentIndex) {
                 if (documentUtf32CodePoints == null) {
@@ -188,6 +192,7 @@ namespace Parlex {
 
         private class CarriageReturnTerminal : Terminal {
             public CarriageReturnTerminal() : base("Carriage return") {}
+            public override CharacterClass FirstCharacters { get { return new CharacterClass(new[] {(Int32)'\r'}); } }
             public override int Length { get { return 1; } }
             public override bool Matches(IReadOnlyList<Int32> documentUtf32CodePoints, int documentIndex) {
                 if (documentUtf32CodePoints == null) {
@@ -203,6 +208,7 @@ namespace Parlex {
 
         private class LinefeedTerminal : Terminal {
             public LinefeedTerminal() : base("Line feed") { }
+            public override CharacterClass FirstCharacters { get { return new CharacterClass(new[] {(Int32)'\n'}); } }
             public override int Length { get { return 1; } }
             public override bool Matches(IReadOnlyList<Int32> documentUtf32CodePoints, int documentIndex) {
                 if (documentUtf32CodePoints == null) {
@@ -1,5 +1,6 @@
 using System;
 using System.Collections.Generic;
+using System.Linq;
 
 namespace Parlex {
     public sealed class StringTerminal : Terminal {
@@ -15,6 +16,10 @@ namespace Parlex {
             get { return _text; }
         }
 
+        public override CharacterClass FirstCharacters {
+            get { return new CharacterClass(_unicodeCodePoints.Take(1)); }
+        }
+
         public StringTerminal(String text) : base("String Terminal: " + text) {
             if (text == null) {
                 throw new ArgumentNullException("text");
@@ -6,6 +6,8 @@ namespace Parlex {
         public override string Name { get { return _name; } }
         public abstract int Length { get; }
         public override bool IsGreedy { get { return false; } }
+        //the code points a match can start with; any of them, unless a terminal knows better
+        public virtual CharacterClass FirstCharacters { get { return CharacterClass.All; } }
         public abstract bool Matches(IReadOnlyList<Int32> documentUtf32CodePoints, int documentIndex);
         public override void Start() {
             if (!Matches(ParseContext.Engine.CodePoints, ParseContext.Position)) {